@@ -5,6 +5,9 @@
 #include "timer.h"
 #include "radio.h"
 #include "tremo_system.h"
+#include "tremo_uart.h"
+#include "tremo_gpio.h"
+#include "tremo_rcc.h"
 
 #if defined( REGION_AS923 )
 #define RF_FREQUENCY                                923000000
@@ -58,10 +61,118 @@ typedef enum { LOWPOWER, RX, RX_TIMEOUT, RX_ERROR, TX, TX_TIMEOUT } States_t;
 #define CHUNK_MAX               270
 
 #define MAX_JUMP_THRESHOLD          20000  // Cho phép gap lớn hơn trong mạng yếu
+#define FIRST_SEQ_MAX               1000000 // node mới với seq lớn hơn phải xác nhận lại
 #define ANTI_REPLAY_WINDOW_SEC      300
 #define CLOCK_SKEW_TOLERANCE_SEC    5
-#define MAX_NODES                   10
-#define WINDOW_SIZE 32  // Khớp với 32-bit bitmap (uint32_t)
+// Node table: node ids index node_index[] directly into a pool of states.
+// By default the pool holds every id, so no convoy size is ever refused; a
+// build that shrinks NODE_POOL_SIZE to save RAM recycles states
+// least-recently-heard first.
+#define NODE_ID_SPACE               256
+#ifndef NODE_POOL_SIZE
+#define NODE_POOL_SIZE              NODE_ID_SPACE
+#endif
+#if NODE_POOL_SIZE < 1 || NODE_POOL_SIZE > NODE_ID_SPACE
+#error "NODE_POOL_SIZE must be 1..NODE_ID_SPACE"
+#endif
+#define NODE_EVICT_SILENT_MS        120000  // only nodes silent this long may be evicted
+#define NODE_NONE                   0xFFFF  // pool index type is 16 bit: 256 live states
+// Anti-replay sliding window: bit i of bitmap[] marks seq (last_seq - i) as seen.
+// Wider windows tolerate more reordering at 4 B/node per extra 32 bits.
+#ifndef WINDOW_SIZE
+#define WINDOW_SIZE                 128
+#endif
+#if (WINDOW_SIZE % 32) != 0 || WINDOW_SIZE < 32
+#error "WINDOW_SIZE must be a multiple of 32"
+#endif
+#define WINDOW_WORDS                (WINDOW_SIZE / 32)
+
+// Gateway -> RX ESP32 link: one COBS-framed binary record per accepted packet
+// on its own UART; printf (UART0) stays the human debug console.
+// Record (before COBS, little endian), see include/gateway_record.h:
+//   [type 1][node 1][seq 4][ts_ms 4][rssi 2][snr 1][len 2][payload len][crc16 2]
+// crc16 = CRC-16/CCITT-FALSE over everything before it; 0x00 ends a frame.
+// GW_REC_PACKET carries the sealed payload of a packet that passed validation.
+// Built with GW_CAPTURE_RAW=1 the gateway also writes a GW_REC_RAW record
+// (node/seq 0, payload = the whole frame) for everything OnRxDone delivers,
+// so `cat` on the link port records traffic for tools/gw_replay.
+#define GW_LINK_UART                UART1
+#ifndef GW_LINK_BAUD
+#define GW_LINK_BAUD                115200
+#endif
+// UART1 pads depend on how the RA-08H is wired to the RX ESP32, and no
+// assignment has been checked on hardware, so there is no default: pass
+// all four for the board, e.g. -DGW_LINK_GPIO_PORT=GPIOx
+// -DGW_LINK_RX_PIN=GPIO_PIN_n -DGW_LINK_TX_PIN=GPIO_PIN_m -DGW_LINK_IOMUX=f
+// with the UART1 RX/TX function of those pads from the ASR6601 datasheet.
+#if !defined(GW_LINK_GPIO_PORT) || !defined(GW_LINK_RX_PIN) || !defined(GW_LINK_TX_PIN) || !defined(GW_LINK_IOMUX)
+#error "Set GW_LINK_GPIO_PORT, GW_LINK_RX_PIN, GW_LINK_TX_PIN and GW_LINK_IOMUX to the UART1 pads of this board"
+#endif
+#define GW_REC_PACKET               1
+#define GW_REC_RAW                  2
+#define GW_REC_HDR_SIZE             15
+#define GW_REC_MAX                  (GW_REC_HDR_SIZE + BUFFER_SIZE + 2)
+#define GW_COBS_MAX                 (GW_REC_MAX + GW_REC_MAX / 254 + 2)
+
+// Per-packet debug text (payload hex is the slow part, off by default)
+#ifndef GW_LOG_PACKETS
+#define GW_LOG_PACKETS              1
+#endif
+#ifndef GW_LOG_PAYLOAD
+#define GW_LOG_PAYLOAD              0
+#endif
+#ifndef GW_CAPTURE_RAW
+#define GW_CAPTURE_RAW              0
+#endif
+
+// Ack beacon: every GW_BEACON_MS the gateway transmits which sealed frames
+// (AEAD vehicle/epoch/seq, not the bridge seq) it accepted, so vehicles can
+// replay what was lost in a dead zone (store-and-forward backlog, backlog.h).
+// Same packet layout and auth tag as a bridge packet, from node id 0:
+//   payload = [count 1] then per vehicle heard in the last GW_ACK_FRESH_MS:
+//   [vehicle 1][epoch 2][top 4][bits 4][n_old 1][n_old x (epoch 2, seq 4)]
+// top is the newest seq of that epoch, bit k of bits acks top - 1 - k;
+// n_old lists late frames below the bitmap (older epoch or > 32 back), each
+// reported in one beacon only. An ack only states what really arrived, so a
+// replayed beacon is harmless and beacons need no anti-replay of their own.
+// GW_BEACON_MS=0 turns beacons off (always off with the FSK modem).
+//
+// The beacon goes out only in the beacon slot that ends every uplink
+// superframe (include/slot_scheduler.h), the first one after it is due,
+// so it never lands on a vehicle's slot. The gateway has no GPS: it times
+// the superframe from the sealed frames it hears. A vehicle sends its
+// reading as its slot opens, so rx time - airtime - TX latency - slot *
+// slot_ms is a superframe start plus that vehicle's guard; the earliest
+// estimate wins, later ones pull the anchor forward by 1/8 to follow clock
+// drift. Slot budget: at most GW_BEACON_MAX_NODES entries of 12 + 6 *
+// GW_ACK_OLD_MAX bytes, 217 payload bytes, ~360 ms at SF7/125 kHz.
+// GW_SLOT_* must match the vehicles' SLOT_* convoy constants.
+#ifndef GW_BEACON_MS
+#if defined( USE_MODEM_LORA )
+#define GW_BEACON_MS                10000
+#else
+#define GW_BEACON_MS                0
+#endif
+#endif
+#define GW_BEACON_NODE_ID           0       // bridges use 1..100
+#define GW_BEACON_MAX_NODES         6
+#define GW_ACK_OLD_MAX              4
+#define GW_ACK_FRESH_MS             60000
+#define AEAD_OVERHEAD               15
+#define GW_SLOT_COUNT               8       // SLOT_COUNT
+#define GW_SLOT_PAYLOAD_MAX         38      // SLOT_PAYLOAD_MAX (143 with SLOT_BATCH=1)
+#define GW_SLOT_FRAME_MIN_MS        2000    // SLOT_FRAME_MIN_MS
+#define GW_SLOT_TX_LATENCY_MS       15      // SLOT_TX_LATENCY_MS
+#define GW_SLOT_GUARD_MS            60      // SLOT_GUARD_FREE_MS
+#define GW_SLOT_BEACON_GUARD_MS     60      // SLOT_BEACON_GUARD_MS
+#define GW_SLOT_BEACON_PAYLOAD_MAX  217     // SLOT_BEACON_PAYLOAD_MAX
+#define GW_BRIDGE_OVERHEAD          9       // node(1) seq(4) len(2) ... auth(2)
+// Vehicle n sends in slot n - 1 (VEHICLE_SLOT_AUTO), vehicles past
+// GW_SLOT_COUNT have no slot; a convoy that moves vehicles with setSlot()
+// builds the gateway with its own map
+#ifndef GW_SLOT_OF
+#define GW_SLOT_OF(vehicle)         ((uint32_t)(vehicle) - 1)
+#endif
 
 #define SECRET_KEY_LEN 16
 static const uint8_t SECRET_KEY[SECRET_KEY_LEN] = {
@@ -69,24 +180,154 @@ static const uint8_t SECRET_KEY[SECRET_KEY_LEN] = {
     0xBE,0xEF,0x77,0x21,0x66,0x88,0xCC,0x10
 };
 
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF), one table lookup per byte
+static const uint16_t CRC16_TABLE[256] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+    0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
+    0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
+    0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
+    0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
+    0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
+    0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
+    0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
+    0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
+    0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
+    0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
+    0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
+    0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+    0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
+    0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
+    0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
+    0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+    0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
+    0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
+    0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
+    0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+    0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
+    0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
+    0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
+    0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
+    0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
+    0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+    0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
+    0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
+    0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
+    0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0
+};
+
+static uint16_t crc16_update(uint16_t crc, const uint8_t* data, uint16_t len)
+{
+    for (uint16_t i = 0; i < len; i++) {
+        crc = (uint16_t)((crc << 8) ^ CRC16_TABLE[(uint8_t)((crc >> 8) ^ data[i])]);
+    }
+    return crc;
+}
+
+// Streams key | node_id | seq | payload through the CRC, no staging buffer
 static uint16_t compute_auth_tag(uint8_t node_id, uint32_t seq, const uint8_t* payload, uint16_t len) {
-    uint8_t auth_buf[BUFFER_SIZE];
-    int p = 0;
-    memcpy(&auth_buf[p], SECRET_KEY, SECRET_KEY_LEN); p += SECRET_KEY_LEN;
-    auth_buf[p++] = node_id;
-    auth_buf[p++] = (seq >> 0) & 0xFF;
-    auth_buf[p++] = (seq >> 8) & 0xFF;
-    auth_buf[p++] = (seq >> 16) & 0xFF;
-    auth_buf[p++] = (seq >> 24) & 0xFF;
-    memcpy(&auth_buf[p], payload, len); p += len;
-    return crc16_calc(auth_buf, p);
+    uint8_t hdr[5];
+    hdr[0] = node_id;
+    hdr[1] = (seq >> 0) & 0xFF;
+    hdr[2] = (seq >> 8) & 0xFF;
+    hdr[3] = (seq >> 16) & 0xFF;
+    hdr[4] = (seq >> 24) & 0xFF;
+
+    uint16_t crc = crc16_update(0xFFFF, SECRET_KEY, SECRET_KEY_LEN);
+    crc = crc16_update(crc, hdr, sizeof(hdr));
+    return crc16_update(crc, payload, len);
 }
 
 uint8_t Buffer[BUFFER_SIZE];
 uint16_t BufferSize = 0;
 
+static uint32_t link_records = 0;
+static uint32_t link_bytes = 0;
+
+static void gw_link_init(void)
+{
+    rcc_enable_peripheral_clk(RCC_PERIPHERAL_UART1, true);
+    gpio_set_iomux(GW_LINK_GPIO_PORT, GW_LINK_RX_PIN, GW_LINK_IOMUX);
+    gpio_set_iomux(GW_LINK_GPIO_PORT, GW_LINK_TX_PIN, GW_LINK_IOMUX);
+
+    uart_config_t cfg;
+    uart_config_init(&cfg);
+
+    cfg.baudrate     = GW_LINK_BAUD;
+    cfg.data_width   = UART_DATA_WIDTH_8;
+    cfg.stop_bits    = UART_STOP_BITS_1;
+    cfg.parity       = UART_PARITY_NO;
+    cfg.flow_control = UART_FLOW_CONTROL_DISABLED;
+    cfg.mode         = UART_MODE_TX;
+    cfg.fifo_mode    = 1;
+
+    uart_init(GW_LINK_UART, &cfg);
+    uart_cmd(GW_LINK_UART, true);
+}
+
+// COBS: replaces every 0x00 so the only zero on the wire is the delimiter
+static uint16_t cobs_encode(const uint8_t* in, uint16_t len, uint8_t* out)
+{
+    uint16_t code_pos = 0;
+    uint16_t o = 1;
+    uint8_t code = 1;
+
+    for (uint16_t i = 0; i < len; i++) {
+        if (in[i] == 0) {
+            out[code_pos] = code;
+            code_pos = o++;
+            code = 1;
+            continue;
+        }
+        out[o++] = in[i];
+        if (++code == 0xFF) {
+            out[code_pos] = code;
+            code_pos = o++;
+            code = 1;
+        }
+    }
+    out[code_pos] = code;
+    out[o++] = 0x00;
+    return o;
+}
+
+static void put_le(uint8_t* p, uint32_t v, int n)
+{
+    for (int i = 0; i < n; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+// One record per accepted packet. uart_send_data() only waits on a full FIFO;
+// a full record at 115200 baud (~25 ms) is shorter than the SF7 airtime of
+// the packet it carries, so the link keeps up with the radio.
+static void gw_emit_record(uint8_t type, uint8_t node_id, uint32_t seq, uint32_t ts_ms,
+                           int16_t rssi, int8_t snr, const uint8_t* payload, uint16_t len)
+{
+    static uint8_t rec[GW_REC_MAX];
+    static uint8_t wire[GW_COBS_MAX];
+
+    rec[0] = type;
+    rec[1] = node_id;
+    put_le(&rec[2], seq, 4);
+    put_le(&rec[6], ts_ms, 4);
+    put_le(&rec[10], (uint16_t)rssi, 2);
+    rec[12] = (uint8_t)snr;
+    put_le(&rec[13], len, 2);
+    memcpy(&rec[GW_REC_HDR_SIZE], payload, len);
+    uint16_t n = GW_REC_HDR_SIZE + len;
+    put_le(&rec[n], crc16_update(0xFFFF, rec, n), 2);
+    n += 2;
+
+    uint16_t w = cobs_encode(rec, n, wire);
+    for (uint16_t i = 0; i < w; i++) {
+        uart_send_data(GW_LINK_UART, wire[i]);
+    }
+    link_records++;
+    link_bytes += w;
+}
+
 static uint8_t  LoraBuf[BUFFER_SIZE];
 static uint16_t LoraLen = 0;
+static uint32_t LoraRxTime = 0;
 
 volatile States_t State = LOWPOWER;
 int8_t RssiValue = 0;
@@ -95,26 +336,50 @@ uint32_t ChipId[2] = {0};
 
 static RadioEvents_t RadioEvents;
 
-static uint32_t valid_packets = 0;
-static uint32_t invalid_seq = 0;
-static uint32_t invalid_crc = 0;
-static uint32_t invalid_jump = 0;
+// Rejections by reason, plus resyncs (accepted, but the window restarted)
+typedef struct {
+    uint32_t bad_len;
+    uint32_t auth_fail;
+    uint32_t replay;
+    uint32_t too_old;
+    uint32_t jump_held;     // large jump waiting for a confirming packet
+    uint32_t resync;
+    uint32_t gateway;       // another gateway's beacon
+} RxRejectStats_t;
+
+static RxRejectStats_t rx_stats;
 
 // === DEMO 3: Timing Tracking ===
 static uint32_t demo_start_time = 0;
-static uint32_t last_rx_time[MAX_NODES];
 #define TIMED_LOG(fmt, ...) do { \
     uint32_t elapsed = TimerGetCurrentTime() - demo_start_time; \
     printf("[%7lu ms] " fmt "\r\n", (unsigned long)elapsed, ##__VA_ARGS__); \
 } while(0)
 
 typedef struct {
-    uint8_t  node_id;
+    uint32_t seq;
+    uint16_t epoch;
+} AckOld_t;
+
+typedef struct {
     uint32_t last_seq;
-    uint32_t bitmap;
+    uint32_t bitmap[WINDOW_WORDS];
+    uint32_t resync_seq;    // last seq of an unconfirmed large jump, 0 if none
+    uint32_t last_rx_ms;
     uint32_t packets_received;
     uint32_t packets_rejected;
+    uint8_t  node_id;
     int8_t   last_rssi;
+    uint16_t lru_prev;      // pool indices, NODE_NONE terminated
+    uint16_t lru_next;
+    // Beacon acks, from the sealed payload's AEAD header
+    uint8_t  ack_valid;
+    uint8_t  ack_vehicle;
+    uint16_t ack_epoch;
+    uint32_t ack_top;       // newest AEAD seq accepted in ack_epoch
+    uint32_t ack_bits;      // bit k: ack_top - 1 - k accepted
+    uint8_t  ack_old_n;
+    AckOld_t ack_old[GW_ACK_OLD_MAX];
 } PerNodeState_t;
 
 typedef struct {
@@ -124,11 +389,21 @@ typedef struct {
     uint8_t  payload[CHUNK_MAX];
     uint16_t crc;
     int      valid;
+    uint32_t prev_rx_ms;    // previous accepted packet from this node, 0 if first
     char     reject_reason[80];
 } ParsedPacket_t;
 
-static PerNodeState_t node_states[MAX_NODES];
-static uint8_t node_count = 0;
+static PerNodeState_t node_states[NODE_POOL_SIZE];
+static uint16_t node_index[NODE_ID_SPACE]; // node id -> pool index, NODE_NONE if unknown
+static uint16_t node_count = 0;
+static uint16_t lru_head = NODE_NONE;      // most recently heard
+static uint16_t lru_tail = NODE_NONE;      // eviction candidate
+static uint32_t node_evictions = 0;
+static uint32_t node_table_full = 0;
+
+static uint32_t beacon_seq = 0;
+static uint32_t beacons_sent = 0;
+static uint32_t ack_old_lost = 0;       // late acks pushed out before a beacon carried them
 
 void OnTxDone(void);
 void OnRxDone(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr);
@@ -136,80 +411,237 @@ void OnTxTimeout(void);
 void OnRxTimeout(void);
 void OnRxError(void);
 
-static uint16_t crc16_calc(const uint8_t* data, uint16_t len)
+static void per_node_init(void)
 {
-    uint16_t crc = 0xFFFF;
-    for (uint16_t i = 0; i < len; i++) {
-        crc ^= ((uint16_t)data[i] << 8);
-        for (int j = 0; j < 8; j++) {
-            crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
-            crc &= 0xFFFF;
-        }
+    memset(node_states, 0, sizeof(node_states));
+    for (uint16_t id = 0; id < NODE_ID_SPACE; id++) {
+        node_index[id] = NODE_NONE;
     }
-    return crc;
+    node_count = 0;
+    lru_head = NODE_NONE;
+    lru_tail = NODE_NONE;
 }
 
-static void per_node_init(void)
+static void lru_unlink(uint16_t i)
 {
-    memset(node_states, 0, sizeof(node_states));
-    node_count = 0;
+    PerNodeState_t* n = &node_states[i];
+    if (n->lru_prev != NODE_NONE) node_states[n->lru_prev].lru_next = n->lru_next;
+    else lru_head = n->lru_next;
+    if (n->lru_next != NODE_NONE) node_states[n->lru_next].lru_prev = n->lru_prev;
+    else lru_tail = n->lru_prev;
+}
+
+static void lru_push_front(uint16_t i)
+{
+    node_states[i].lru_prev = NODE_NONE;
+    node_states[i].lru_next = lru_head;
+    if (lru_head != NODE_NONE) node_states[lru_head].lru_prev = i;
+    lru_head = i;
+    if (lru_tail == NODE_NONE) lru_tail = i;
+}
+
+// Marks the node as just heard (moves it to the LRU head)
+static void per_node_touch(PerNodeState_t* n, uint32_t now_ms)
+{
+    uint16_t i = (uint16_t)(n - node_states);
+    n->last_rx_ms = now_ms;
+    if (lru_head != i) {
+        lru_unlink(i);
+        lru_push_front(i);
+    }
 }
 
 static PerNodeState_t* per_node_get_or_create(uint8_t node_id)
 {
-    for (uint8_t i = 0; i < node_count; i++) {
-        if (node_states[i].node_id == node_id) {
-            return &node_states[i];
+    uint16_t i = node_index[node_id];
+    if (i != NODE_NONE) {
+        return &node_states[i];
+    }
+
+    if (node_count < NODE_POOL_SIZE) {
+        i = node_count++;
+    } else {
+        // Recycle the least recently heard node, but never one still talking
+        uint16_t victim = lru_tail;
+        uint32_t silent = TimerGetElapsedTime(node_states[victim].last_rx_ms);
+        if (silent < NODE_EVICT_SILENT_MS) {
+            node_table_full++;
+            return NULL;
         }
+        printf("[NODES] Evicting node %u (silent %lu s) for node %u\r\n",
+               (unsigned)node_states[victim].node_id, (unsigned long)(silent / 1000), (unsigned)node_id);
+        node_index[node_states[victim].node_id] = NODE_NONE;
+        lru_unlink(victim);
+        node_evictions++;
+        i = victim;
     }
 
-    if (node_count < MAX_NODES) {
-        node_states[node_count].node_id = node_id;
-        node_states[node_count].last_seq = 0;
-        node_states[node_count].packets_received = 0;
-        node_states[node_count].packets_rejected = 0;
-        node_states[node_count].last_rssi = 0;
-        return &node_states[node_count++];
+    memset(&node_states[i], 0, sizeof(node_states[i]));
+    node_states[i].node_id = node_id;
+    node_states[i].last_rx_ms = TimerGetCurrentTime();
+    node_index[node_id] = i;
+    lru_push_front(i);
+    return &node_states[i];
+}
+
+typedef enum { SEQ_OK, SEQ_RESYNC, SEQ_REPLAY, SEQ_TOO_OLD, SEQ_JUMP_HELD } SeqVerdict_t;
+
+static void window_shift(uint32_t* w, uint32_t shift)
+{
+    if (shift >= WINDOW_SIZE) {
+        memset(w, 0, WINDOW_WORDS * sizeof(uint32_t));
+        return;
     }
+    uint32_t words = shift / 32;
+    uint32_t bits = shift % 32;
+    for (int i = WINDOW_WORDS - 1; i >= 0; i--) {
+        uint32_t v = 0;
+        if (i >= (int)words) {
+            v = w[i - words] << bits;
+            if (bits && i > (int)words) v |= w[i - words - 1] >> (32 - bits);
+        }
+        w[i] = v;
+    }
+}
+
+static void window_restart(PerNodeState_t* t, uint32_t seq)
+{
+    memset(t->bitmap, 0, sizeof(t->bitmap));
+    t->bitmap[0] = 1;
+    t->last_seq = seq;
+    t->resync_seq = 0;
+}
 
-    return NULL;
+// A jump the window cannot bridge is only trusted once a second packet
+// confirms the new sequence: one forged or corrupted tag must not drag the
+// window forward and lock the real node out.
+static SeqVerdict_t hold_or_resync(PerNodeState_t* t, uint32_t seq)
+{
+    if (t->resync_seq != 0 && seq - t->resync_seq - 1 < WINDOW_SIZE) {
+        window_restart(t, seq);
+        return SEQ_RESYNC;
+    }
+    t->resync_seq = seq;
+    return SEQ_JUMP_HELD;
 }
 
-static int check_and_update_seq(PerNodeState_t* t, uint32_t seq)
+static uint32_t get_le32(const uint8_t* p)
 {
-    if (seq > t->last_seq) {
-        uint32_t shift = seq - t->last_seq;
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
 
-        if (shift > WINDOW_SIZE) {
-            printf("[DROP] Jump too large: %lu\r\n", (unsigned long)shift);
-            return 0;
+// Whether a packet far behind the window may start or confirm a restart.
+// By its header alone a bridge reboot looks exactly like a replay of the
+// previous session's low seqs, so the payload has to show it is new: a
+// sealed frame with a newer AEAD epoch/seq than anything this node delivered
+// before (the beacon ack state). Anything else only restarts a node silent
+// for NODE_EVICT_SILENT_MS, which could have been evicted and re-created at
+// that seq anyway.
+static int restart_is_fresh(const PerNodeState_t* t, const uint8_t* p, uint16_t len)
+{
+    if (len >= AEAD_OVERHEAD && p[0] != '{' && t->ack_valid && p[0] == t->ack_vehicle) {
+        int16_t de = (int16_t)((uint16_t)(p[1] | (p[2] << 8)) - t->ack_epoch);
+        if (de > 0 || (de == 0 && (int32_t)(get_le32(&p[3]) - t->ack_top) > 0)) {
+            return 1;
         }
+    }
+    return TimerGetElapsedTime(t->last_rx_ms) >= NODE_EVICT_SILENT_MS;
+}
+
+static SeqVerdict_t check_and_update_seq(PerNodeState_t* t, uint32_t seq, const uint8_t* p, uint16_t len)
+{
+    int32_t d = (int32_t)(seq - t->last_seq);   // serial arithmetic, wraps cleanly
 
+    if (d > 0) {
+        uint32_t shift = (uint32_t)d;
+
+        if (shift > MAX_JUMP_THRESHOLD) {
+            return hold_or_resync(t, seq);
+        }
         if (shift >= WINDOW_SIZE) {
-            t->bitmap = 0;
-        } else {
-            t->bitmap <<= shift;
+            // Back from a dead zone: nothing in the old window can be replayed
+            // past last_seq, so a plain restart is safe
+            window_restart(t, seq);
+            return SEQ_RESYNC;
         }
 
-        t->bitmap |= 1;
+        window_shift(t->bitmap, shift);
+        t->bitmap[0] |= 1;
         t->last_seq = seq;
-        return 1;
+        t->resync_seq = 0;
+        return SEQ_OK;
     }
 
-    uint32_t diff = t->last_seq - seq;
+    uint32_t diff = (uint32_t)(-d);
 
     if (diff >= WINDOW_SIZE) {
-        printf("[DROP] Too old\r\n");
-        return 0;
+        // Far behind: ancient, a replay of an earlier bridge session, or the
+        // bridge rebooted (tx_sequence restarts at 0). The bridge has no boot
+        // epoch, so both the held packet and the one confirming it must carry
+        // newer data than the node sent before the hold.
+        if (seq >= WINDOW_SIZE || !restart_is_fresh(t, p, len)) {
+            return SEQ_TOO_OLD;
+        }
+        return hold_or_resync(t, seq);
     }
 
-    if (t->bitmap & (1UL << diff)) {
-        printf("[DROP] Replay\r\n");
-        return 0;
+    uint32_t mask = 1UL << (diff % 32);
+    if (t->bitmap[diff / 32] & mask) {
+        return SEQ_REPLAY;
+    }
+
+    t->bitmap[diff / 32] |= mask;
+    return SEQ_OK;
+}
+
+// Notes an accepted sealed frame for the next beacon. Plain-text (JSON)
+// payloads and anything too short to carry an AEAD header are not acked.
+static void ack_record(PerNodeState_t* n, const uint8_t* p, uint16_t len)
+{
+    if (len < AEAD_OVERHEAD || p[0] == '{') {
+        return;
+    }
+    uint8_t vehicle = p[0];
+    uint16_t epoch = (uint16_t)(p[1] | (p[2] << 8));
+    uint32_t seq = get_le32(&p[3]);
+
+    if (!n->ack_valid || vehicle != n->ack_vehicle || (int16_t)(epoch - n->ack_epoch) > 0) {
+        // First frame, another vehicle on this bridge, or the vehicle rebooted
+        n->ack_valid = 1;
+        n->ack_vehicle = vehicle;
+        n->ack_epoch = epoch;
+        n->ack_top = seq;
+        n->ack_bits = 0;
+        return;
+    }
+
+    if (epoch == n->ack_epoch) {
+        int32_t d = (int32_t)(seq - n->ack_top);
+        if (d == 0) {
+            return;
+        }
+        if (d > 0) {
+            if (d > 32)       n->ack_bits = 0;
+            else if (d == 32) n->ack_bits = 1UL << 31;
+            else              n->ack_bits = (n->ack_bits << d) | (1UL << (d - 1));
+            n->ack_top = seq;
+            return;
+        }
+        if (d >= -32) {
+            n->ack_bits |= 1UL << (-d - 1);
+            return;
+        }
     }
 
-    t->bitmap |= (1UL << diff);
-    return 1;
+    // Older epoch or below the bitmap: a replayed backlog frame
+    if (n->ack_old_n == GW_ACK_OLD_MAX) {
+        memmove(&n->ack_old[0], &n->ack_old[1], (GW_ACK_OLD_MAX - 1) * sizeof(AckOld_t));
+        n->ack_old_n--;
+        ack_old_lost++;
+    }
+    n->ack_old[n->ack_old_n].epoch = epoch;
+    n->ack_old[n->ack_old_n].seq = seq;
+    n->ack_old_n++;
 }
 
 static void parse_and_validate_packet(const uint8_t* raw, uint16_t raw_len, ParsedPacket_t* pkt)
@@ -218,6 +650,7 @@ static void parse_and_validate_packet(const uint8_t* raw, uint16_t raw_len, Pars
     pkt->valid = 0;
 
     if (raw_len < 9) {
+        rx_stats.bad_len++;
         snprintf(pkt->reject_reason, sizeof(pkt->reject_reason), "Packet quá nhỏ (%u)", raw_len);
         return;
     }
@@ -234,7 +667,14 @@ static void parse_and_validate_packet(const uint8_t* raw, uint16_t raw_len, Pars
     pkt->payload_len = (uint16_t)raw[pos+0] | ((uint16_t)raw[pos+1] << 8);
     pos += 2;
 
+    if (pkt->node_id == GW_BEACON_NODE_ID) {
+        rx_stats.gateway++;
+        snprintf(pkt->reject_reason, sizeof(pkt->reject_reason), "Gateway beacon");
+        return;
+    }
+
     if (pkt->payload_len > CHUNK_MAX || pos + pkt->payload_len + 2 > raw_len) {
+        rx_stats.bad_len++;
         snprintf(pkt->reject_reason, sizeof(pkt->reject_reason), "Payload len không hợp lệ");
         return;
     }
@@ -247,6 +687,7 @@ static void parse_and_validate_packet(const uint8_t* raw, uint16_t raw_len, Pars
     {
         uint16_t expected = compute_auth_tag(pkt->node_id, pkt->seq, pkt->payload, pkt->payload_len);
         if (expected != pkt->crc) {
+            rx_stats.auth_fail++;
             snprintf(pkt->reject_reason, sizeof(pkt->reject_reason), "AUTH FAIL");
             return;
         }
@@ -256,40 +697,187 @@ static void parse_and_validate_packet(const uint8_t* raw, uint16_t raw_len, Pars
     {
         PerNodeState_t* node = per_node_get_or_create(pkt->node_id);
         if (!node) {
-            snprintf(pkt->reject_reason, sizeof(pkt->reject_reason), "Max nodes exceeded");
+            snprintf(pkt->reject_reason, sizeof(pkt->reject_reason), "Node table full (%u active)", NODE_POOL_SIZE);
             return;
         }
 
-        // Node mới (first packet)
+        SeqVerdict_t v;
         if (node->packets_received == 0) {
-
-            // (optional) chống attacker gửi seq cực lớn ngay từ đầu
-            if (pkt->seq > 1000000) {
-                snprintf(pkt->reject_reason, sizeof(pkt->reject_reason), "First seq too large");
-                return;
+            // Node mới (first packet): seq cực lớn phải được gói kế tiếp xác nhận
+            if (pkt->seq > FIRST_SEQ_MAX) {
+                v = hold_or_resync(node, pkt->seq);
+            } else {
+                window_restart(node, pkt->seq);
+                v = SEQ_OK;
             }
+        } else {
+            v = check_and_update_seq(node, pkt->seq, pkt->payload, pkt->payload_len);
+        }
 
-            node->last_seq = pkt->seq;
-            node->bitmap   = 1;
-            pkt->valid     = 1;
+        switch (v) {
+        case SEQ_RESYNC:
+            rx_stats.resync++;
+            TIMED_LOG("[RESYNC] node=%u window restarted at seq=%lu",
+                      (unsigned)pkt->node_id, (unsigned long)pkt->seq);
+            /* fall through */
+        case SEQ_OK:
+            pkt->valid = 1;
+            break;
+        case SEQ_REPLAY:
+            rx_stats.replay++;
+            snprintf(pkt->reject_reason, sizeof(pkt->reject_reason), "Replay");
+            break;
+        case SEQ_TOO_OLD:
+            rx_stats.too_old++;
+            snprintf(pkt->reject_reason, sizeof(pkt->reject_reason), "Too old (last=%lu)",
+                     (unsigned long)node->last_seq);
+            break;
+        case SEQ_JUMP_HELD:
+            rx_stats.jump_held++;
+            snprintf(pkt->reject_reason, sizeof(pkt->reject_reason), "Jump too large (last=%lu), awaiting confirm",
+                     (unsigned long)node->last_seq);
+            break;
         }
-        else {
-            if (check_and_update_seq(node, pkt->seq)) {
-                pkt->valid = 1;
-            } else {
-                snprintf(pkt->reject_reason, sizeof(pkt->reject_reason), "Replay/Too old");
-                node->packets_rejected++;
-                return;
-            }
+        if (!pkt->valid) {
+            node->packets_rejected++;
+            return;
         }
 
         // Cập nhật thống kê nếu gói hợp lệ
         if (pkt->valid) {
+            pkt->prev_rx_ms = (node->packets_received > 0) ? node->last_rx_ms : 0;
             node->last_rssi = (int8_t)RssiValue;
             node->packets_received++;
+            per_node_touch(node, TimerGetCurrentTime());
+            ack_record(node, pkt->payload, pkt->payload_len);
+        }
+    }
+}
+
+#if GW_BEACON_MS > 0
+// Uplink superframe as the vehicles compute it, and where it starts
+static uint32_t slot_ms = 0;
+static uint32_t slot_frame_ms = 0;
+static uint32_t slot_anchor_ms = 0;     // local time of a superframe start
+static uint32_t slot_heard_ms = 0;      // last frame that moved the anchor
+static uint8_t  slot_anchor_valid = 0;
+
+// Time on air of one LoRa packet (explicit header, CRC on), Semtech AN1200.13;
+// same as lora_airtime_ms() in slot_scheduler.cpp
+static uint32_t gw_airtime_ms(uint16_t len)
+{
+    const uint32_t sf = LORA_SPREADING_FACTOR;
+    uint32_t t_sym_us = (uint32_t)((1000000ULL << sf) / 125000);    // LORA_BANDWIDTH 0
+    int de = (t_sym_us > 16000) ? 1 : 0;
+    int32_t num = 8 * (int32_t)len - 4 * (int32_t)sf + 28 + 16;
+    int32_t den = 4 * ((int32_t)sf - 2 * de);
+    int32_t blocks = (num > 0) ? (num + den - 1) / den : 0;
+    uint32_t n_payload = 8 + (uint32_t)blocks * (LORA_CODINGRATE + 4);
+    uint32_t t_pre_us = (LORA_PREAMBLE_LENGTH * 4 + 17) * t_sym_us / 4;
+    return (t_pre_us + n_payload * t_sym_us + 999) / 1000;
+}
+
+// Same plan as SlotScheduler::configure() with the convoy constants
+static void gw_slot_init(void)
+{
+    uint32_t beacon = gw_airtime_ms(GW_SLOT_BEACON_PAYLOAD_MAX + GW_BRIDGE_OVERHEAD)
+                    + 2 * GW_SLOT_GUARD_MS + GW_SLOT_BEACON_GUARD_MS;
+    beacon = (beacon + 9) / 10 * 10;
+
+    uint32_t need = gw_airtime_ms(GW_SLOT_PAYLOAD_MAX + GW_BRIDGE_OVERHEAD) + GW_SLOT_TX_LATENCY_MS
+                  + 2 * GW_SLOT_GUARD_MS;
+    need = (need + 9) / 10 * 10;
+    uint32_t spread = (GW_SLOT_FRAME_MIN_MS > beacon) ? (GW_SLOT_FRAME_MIN_MS - beacon) / GW_SLOT_COUNT : 0;
+    slot_ms = (spread > need) ? spread : need;
+    slot_frame_ms = slot_ms * GW_SLOT_COUNT + beacon;
+}
+
+// Superframe start implied by an accepted sealed frame (see GW_BEACON_MS)
+static void gw_slot_observe(const uint8_t* p, uint16_t len, uint32_t rx_ms)
+{
+    if (len < AEAD_OVERHEAD || p[0] == '{') {
+        return;
+    }
+    uint32_t slot = GW_SLOT_OF(p[0]);
+    if (slot >= GW_SLOT_COUNT) {
+        return;         // no slot in the convoy plan, its timing says nothing
+    }
+    uint32_t start = rx_ms - gw_airtime_ms(len + GW_BRIDGE_OVERHEAD) - GW_SLOT_TX_LATENCY_MS
+                   - slot * slot_ms;
+
+    if (!slot_anchor_valid || TimerGetElapsedTime(slot_heard_ms) > GW_ACK_FRESH_MS) {
+        slot_anchor_ms = start;
+        slot_anchor_valid = 1;
+    } else {
+        int32_t frame = (int32_t)slot_frame_ms;
+        int32_t r = (int32_t)(start - slot_anchor_ms) % frame;
+        if (r > frame / 2)        r -= frame;
+        else if (r <= -frame / 2) r += frame;
+        // Same phase, moved next to this frame; earlier wins, later creeps
+        slot_anchor_ms = start - r + ((r < 0) ? r : r / 8);
+    }
+    slot_heard_ms = rx_ms;
+}
+
+// True while the beacon slot is open far enough to start a beacon in it
+static int gw_beacon_slot_open(uint32_t now)
+{
+    if (!slot_anchor_valid || TimerGetElapsedTime(slot_heard_ms) > GW_ACK_FRESH_MS) {
+        return 0;
+    }
+    int32_t frame = (int32_t)slot_frame_ms;
+    int32_t phase = (int32_t)(now - slot_anchor_ms) % frame;
+    if (phase < 0) phase += frame;
+    int32_t open = (int32_t)(slot_ms * GW_SLOT_COUNT);
+    return phase >= open && phase < open + GW_SLOT_BEACON_GUARD_MS;
+}
+
+// Builds and transmits one ack beacon; OnTxDone re-arms Rx (case TX)
+static void gw_send_beacon(void)
+{
+    static uint8_t pkt[BUFFER_SIZE];
+    uint8_t* payload = &pkt[7];
+    uint16_t len = 1;
+    uint8_t count = 0;
+
+    for (uint16_t i = lru_head; i != NODE_NONE && count < GW_BEACON_MAX_NODES; i = node_states[i].lru_next) {
+        PerNodeState_t* n = &node_states[i];
+        if (TimerGetElapsedTime(n->last_rx_ms) > GW_ACK_FRESH_MS) {
+            break;      // LRU order: everything after is older still
         }
+        if (!n->ack_valid) {
+            continue;
+        }
+        uint8_t* e = &payload[len];
+        e[0] = n->ack_vehicle;
+        put_le(&e[1], n->ack_epoch, 2);
+        put_le(&e[3], n->ack_top, 4);
+        put_le(&e[7], n->ack_bits, 4);
+        e[11] = n->ack_old_n;
+        len += 12;
+        for (uint8_t k = 0; k < n->ack_old_n; k++) {
+            put_le(&payload[len], n->ack_old[k].epoch, 2);
+            put_le(&payload[len + 2], n->ack_old[k].seq, 4);
+            len += 6;
+        }
+        n->ack_old_n = 0;
+        count++;
+    }
+    if (count == 0) {
+        return;     // nobody to ack, keep the channel free
     }
+    payload[0] = count;
+
+    uint32_t seq = ++beacon_seq;
+    pkt[0] = GW_BEACON_NODE_ID;
+    put_le(&pkt[1], seq, 4);
+    put_le(&pkt[5], len, 2);
+    put_le(&pkt[7 + len], compute_auth_tag(GW_BEACON_NODE_ID, seq, payload, len), 2);
+
+    Radio.Send(pkt, (uint8_t)(7 + len + 2));
+    beacons_sent++;
 }
+#endif
 
 int app_start(void)
 {
@@ -300,7 +888,10 @@ int app_start(void)
     printf("\r\n");
 
     per_node_init();
-    memset(last_rx_time, 0, sizeof(last_rx_time));
+    gw_link_init();
+#if GW_BEACON_MS > 0
+    gw_slot_init();
+#endif
     demo_start_time = TimerGetCurrentTime();
 
     RadioEvents.TxDone = OnTxDone;
@@ -337,7 +928,20 @@ int app_start(void)
     Radio.Rx(RX_TIMEOUT_VALUE);
 
     printf("Listening for Follower Nodes...\r\n");
-    printf("Max nodes: %u | Max payload: %u bytes\r\n", MAX_NODES, CHUNK_MAX);
+    printf("Node table: %u ids, %u active | Replay window: %u | Max payload: %u bytes\r\n",
+           NODE_ID_SPACE, NODE_POOL_SIZE, WINDOW_SIZE, CHUNK_MAX);
+    printf("Memory: node index %u B + node pool %u B (%u B/node) = %u B\r\n",
+           (unsigned)sizeof(node_index), (unsigned)sizeof(node_states),
+           (unsigned)sizeof(PerNodeState_t),
+           (unsigned)(sizeof(node_index) + sizeof(node_states)));
+    printf("Uplink: binary records on UART1 @ %u baud%s\r\n", GW_LINK_BAUD,
+           GW_CAPTURE_RAW ? " + raw capture" : "");
+#if GW_BEACON_MS > 0
+    printf("Ack beacon: every %u ms, in the beacon slot of the %lu ms superframe\r\n",
+           (unsigned)GW_BEACON_MS, (unsigned long)slot_frame_ms);
+#else
+    printf("Ack beacon: off\r\n");
+#endif
     printf("==============================================\r\n\r\n");
 
     static uint32_t total_accepted = 0;
@@ -350,15 +954,26 @@ int app_start(void)
         case RX:
             {
                 ParsedPacket_t pkt;
+#if GW_CAPTURE_RAW
+                gw_emit_record(GW_REC_RAW, 0, 0, LoraRxTime, RssiValue, SnrValue, LoraBuf, LoraLen);
+#endif
                 parse_and_validate_packet(LoraBuf, LoraLen, &pkt);
 
+                // Packet is copied out: re-arm the radio before the link/log output
+                State = LOWPOWER;
+                Radio.Rx(RX_TIMEOUT_VALUE);
+
                 if (pkt.valid) {
                     total_accepted++;
                     uint32_t now_ms = TimerGetCurrentTime();
-                    uint32_t delta_ms = (last_rx_time[pkt.node_id] > 0) ? 
-                        (now_ms - last_rx_time[pkt.node_id]) : 0;
-                    last_rx_time[pkt.node_id] = now_ms;
-                    
+#if GW_BEACON_MS > 0
+                    gw_slot_observe(pkt.payload, pkt.payload_len, LoraRxTime);
+#endif
+                    gw_emit_record(GW_REC_PACKET, pkt.node_id, pkt.seq, LoraRxTime, RssiValue, SnrValue,
+                                   pkt.payload, pkt.payload_len);
+
+#if GW_LOG_PACKETS
+                    uint32_t delta_ms = (pkt.prev_rx_ms > 0) ? (now_ms - pkt.prev_rx_ms) : 0;
                     TIMED_LOG("[RX OK] node=%u, seq=%lu, len=%u, delta=%lu ms, rssi=%d dBm, snr=%d dB",
                            (unsigned)pkt.node_id,
                            (unsigned long)pkt.seq,
@@ -366,13 +981,21 @@ int app_start(void)
                            (unsigned long)delta_ms,
                            (int)RssiValue,
                            (int)SnrValue);
+#endif
 
+#if GW_LOG_PAYLOAD
                     if (pkt.payload_len > 0) {
-                        char payload_str[CHUNK_MAX + 1];
-                        memcpy(payload_str, (char*)pkt.payload, pkt.payload_len);
-                        payload_str[pkt.payload_len] = '\0';
+                        // Sealed binary frames (AES-CCM) are printed as hex
+                        static const char hex_digits[] = "0123456789ABCDEF";
+                        char payload_str[2 * CHUNK_MAX + 1];
+                        for (uint16_t i = 0; i < pkt.payload_len; i++) {
+                            payload_str[2 * i]     = hex_digits[pkt.payload[i] >> 4];
+                            payload_str[2 * i + 1] = hex_digits[pkt.payload[i] & 0x0F];
+                        }
+                        payload_str[2 * pkt.payload_len] = '\0';
                         printf("        Payload: %s\r\n", payload_str);
                     }
+#endif
                 } else {
                     total_rejected++;
                     TIMED_LOG("[RX DROP] node=%u, seq=%lu, rssi=%d (Reason: %s)",
@@ -382,8 +1005,6 @@ int app_start(void)
                            pkt.reject_reason);
                 }
             }
-            Radio.Rx(RX_TIMEOUT_VALUE);
-            State = LOWPOWER;
             break;
         case TX:
             Radio.Rx(RX_TIMEOUT_VALUE);
@@ -400,6 +1021,16 @@ int app_start(void)
             break;
         case LOWPOWER:
         default:
+#if GW_BEACON_MS > 0
+            {
+                static uint32_t last_beacon = 0;
+                uint32_t now = TimerGetCurrentTime();
+                if (TimerGetElapsedTime(last_beacon) >= GW_BEACON_MS && gw_beacon_slot_open(now)) {
+                    last_beacon = now;
+                    gw_send_beacon();
+                }
+            }
+#endif
             break;
         }
 
@@ -413,20 +1044,33 @@ int app_start(void)
                 TIMED_LOG("=== GATEWAY STATISTICS (30sec) ===");
                 TIMED_LOG("Total accepted: %lu | Total rejected: %lu", 
                     (unsigned long)total_accepted, (unsigned long)total_rejected);
-                TIMED_LOG("Active nodes:   %u/%u", node_count, MAX_NODES);
+                TIMED_LOG("Active nodes:   %u/%u (evicted %lu, refused %lu)", node_count, NODE_POOL_SIZE,
+                    (unsigned long)node_evictions, (unsigned long)node_table_full);
+                TIMED_LOG("Rejects:        replay=%lu old=%lu jump=%lu auth=%lu len=%lu | resync=%lu",
+                    (unsigned long)rx_stats.replay, (unsigned long)rx_stats.too_old,
+                    (unsigned long)rx_stats.jump_held, (unsigned long)rx_stats.auth_fail,
+                    (unsigned long)rx_stats.bad_len,
+                    (unsigned long)rx_stats.resync);
+                TIMED_LOG("Uplink link:    %lu records, %lu bytes",
+                    (unsigned long)link_records, (unsigned long)link_bytes);
+                TIMED_LOG("Ack beacons:    %lu sent, %lu late acks lost, %lu foreign beacons",
+                    (unsigned long)beacons_sent, (unsigned long)ack_old_lost,
+                    (unsigned long)rx_stats.gateway);
                 printf("\r\n");
 
-                TIMED_LOG("Per-Node Status:");
-                for (uint8_t i = 0; i < node_count; i++) {
-                    uint32_t total = node_states[i].packets_received + node_states[i].packets_rejected;
-                    uint32_t rate = (total > 0) ? (100U * node_states[i].packets_received / total) : 0;
-                    TIMED_LOG("  Node %u: seq=%lu, ok=%lu, bad=%lu, rate=%lu%%, rssi=%d dBm",
-                           (unsigned)node_states[i].node_id,
-                           (unsigned long)node_states[i].last_seq,
-                           (unsigned long)node_states[i].packets_received,
-                           (unsigned long)node_states[i].packets_rejected,
+                TIMED_LOG("Per-Node Status (most recent first):");
+                for (uint16_t i = lru_head; i != NODE_NONE; i = node_states[i].lru_next) {
+                    const PerNodeState_t* n = &node_states[i];
+                    uint32_t total = n->packets_received + n->packets_rejected;
+                    uint32_t rate = (total > 0) ? (100U * n->packets_received / total) : 0;
+                    TIMED_LOG("  Node %u: seq=%lu, ok=%lu, bad=%lu, rate=%lu%%, rssi=%d dBm, silent=%lu s",
+                           (unsigned)n->node_id,
+                           (unsigned long)n->last_seq,
+                           (unsigned long)n->packets_received,
+                           (unsigned long)n->packets_rejected,
                            (unsigned long)rate,
-                           (int)node_states[i].last_rssi);
+                           (int)n->last_rssi,
+                           (unsigned long)(TimerGetElapsedTime(n->last_rx_ms) / 1000));
                 }
                 TIMED_LOG("==================================\r\n");
 
@@ -449,6 +1093,7 @@ void OnRxDone(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr)
     uint16_t use_len = (size > BUFFER_SIZE) ? BUFFER_SIZE : size;
     memcpy(LoraBuf, payload, use_len);
     LoraLen = use_len;
+    LoraRxTime = TimerGetCurrentTime();
     RssiValue = rssi;
     SnrValue = snr;
 
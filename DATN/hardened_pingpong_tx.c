@@ -64,7 +64,6 @@ static uint8_t  LoraBuf[BUFFER_SIZE];
 static uint16_t LoraLen = 0;
 
 static volatile States_t State = LOWPOWER;
-static volatile uint8_t  txDone = 0;
 
 static int8_t  RssiValue = 0;
 static int8_t  SnrValue  = 0;
@@ -90,44 +89,163 @@ static uint8_t seq_tracker_count = 0;
 static uint32_t tx_sequence = 0;
 static uint8_t LOCAL_NODE_ID = 0;
 
+// Radio TX queue: UART lines are queued and sent one at a time from the
+// main loop; OnTxDone/OnTxTimeout complete the frame through State.
+#ifndef TX_QUEUE_DEPTH
+#define TX_QUEUE_DEPTH      8
+#endif
+
+#define TX_DROP_OLDEST      0   // full queue: evict the oldest frame
+#define TX_DROP_NEWEST      1   // full queue: refuse the incoming frame
+#define TX_DROP_PRIORITY    2   // full queue: evict the oldest normal frame, urgent ones last
+
+#ifndef TX_QUEUE_DROP_POLICY
+#define TX_QUEUE_DROP_POLICY TX_DROP_PRIORITY
+#endif
+
+#define TX_PRIO_NORMAL      0
+#define TX_PRIO_URGENT      1
+#define TX_URGENT_MARK      '!'     // ESP32 prefixes alert lines with this
+
+// Radio.Send() has its own 3000 ms TX timeout; this only catches a lost IRQ
+#define TX_WATCHDOG_MS      4000
+
+typedef struct {
+    uint8_t  payload[CHUNK_MAX];
+    uint16_t len;
+    uint8_t  prio;
+    uint32_t enq_time;
+} TxSlot_t;
+
+typedef struct {
+    uint32_t enqueued;
+    uint32_t sent;
+    uint32_t timeouts;
+    uint32_t dropped_oldest;
+    uint32_t dropped_newest;
+    uint32_t dropped_normal;     // evicted in favour of a newer/urgent frame
+    uint32_t latency_sum_ms;     // enqueue -> TxDone, sent frames only
+    uint32_t latency_max_ms;
+    uint8_t  high_water;
+} TxQueueStats_t;
+
+static TxSlot_t tx_slots[TX_QUEUE_DEPTH];
+static uint8_t  tx_order[TX_QUEUE_DEPTH];   // slot indices, oldest first
+static uint8_t  tx_free[TX_QUEUE_DEPTH];
+static uint8_t  tx_count = 0;
+static uint8_t  tx_free_count = 0;
+
+static uint8_t  tx_frame[BUFFER_SIZE];      // packet on air, valid until TxDone
+static uint8_t  tx_busy = 0;
+static uint32_t tx_inflight_enq_time = 0;
+static uint32_t tx_inflight_start = 0;
+static TxQueueStats_t tx_stats;
+
 #define UART_INST UART0
 #define UART_BAUD 115200
 
+// Gateway ack beacons (see hardened_pingpong_rx.c): the radio listens
+// whenever it is not sending, and a valid beacon is passed to the ESP32 as
+// text lines on the shared UART0 console, which the ESP32 already reads:
+//   @BCN <beacon seq> <rssi> <snr>
+//   @ACK <vehicle> <epoch> <top seq> <bits hex> [<epoch>:<seq> ...]
+// Only entries for the vehicle behind this bridge are forwarded (learnt
+// from the AEAD header of the frames it sends).
+#define GW_BEACON_NODE_ID   0
+#define AEAD_OVERHEAD       15
+
+static uint8_t  rx_armed = 0;
+static uint8_t  esp_vehicle = 0;
+static uint8_t  esp_vehicle_known = 0;
+static uint32_t beacons_ok = 0;
+static uint32_t beacons_bad = 0;
+static uint32_t rx_other = 0;       // bridge traffic heard while listening
+
 #define SECRET_KEY_LEN 16
 static const uint8_t SECRET_KEY[SECRET_KEY_LEN] = {
     0x13,0x37,0xAA,0x55,0x99,0x42,0xDE,0xAD,
     0xBE,0xEF,0x77,0x21,0x66,0x88,0xCC,0x10
 };
 
-static uint16_t compute_auth_tag(uint8_t node_id, uint32_t seq, const uint8_t* payload, uint16_t len) {
-    uint8_t auth_buf[BUFFER_SIZE];
-    int p = 0;
-    memcpy(&auth_buf[p], SECRET_KEY, SECRET_KEY_LEN); p += SECRET_KEY_LEN;
-    auth_buf[p++] = node_id;
-    auth_buf[p++] = (seq >> 0) & 0xFF;
-    auth_buf[p++] = (seq >> 8) & 0xFF;
-    auth_buf[p++] = (seq >> 16) & 0xFF;
-    auth_buf[p++] = (seq >> 24) & 0xFF;
-    memcpy(&auth_buf[p], payload, len); p += len;
-    return crc16_calc(auth_buf, p);
-}
-
-static char uart_json_buffer[300];
-static uint16_t uart_json_idx = 0;
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF), one table lookup per byte
+static const uint16_t CRC16_TABLE[256] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+    0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
+    0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
+    0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
+    0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
+    0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
+    0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
+    0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
+    0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
+    0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
+    0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
+    0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
+    0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+    0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
+    0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
+    0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
+    0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+    0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
+    0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
+    0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
+    0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+    0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
+    0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
+    0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
+    0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
+    0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
+    0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+    0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
+    0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
+    0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
+    0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0
+};
 
-static uint16_t crc16_calc(const uint8_t* data, uint16_t len)
+static uint16_t crc16_update(uint16_t crc, const uint8_t* data, uint16_t len)
 {
-    uint16_t crc = 0xFFFF;
     for (uint16_t i = 0; i < len; i++) {
-        crc ^= ((uint16_t)data[i] << 8);
-        for (int j = 0; j < 8; j++) {
-            crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
-            crc &= 0xFFFF;
-        }
+        crc = (uint16_t)((crc << 8) ^ CRC16_TABLE[(uint8_t)((crc >> 8) ^ data[i])]);
     }
     return crc;
 }
 
+// Streams key | node_id | seq | payload through the CRC, no staging buffer
+static uint16_t compute_auth_tag(uint8_t node_id, uint32_t seq, const uint8_t* payload, uint16_t len) {
+    uint8_t hdr[5];
+    hdr[0] = node_id;
+    hdr[1] = (seq >> 0) & 0xFF;
+    hdr[2] = (seq >> 8) & 0xFF;
+    hdr[3] = (seq >> 16) & 0xFF;
+    hdr[4] = (seq >> 24) & 0xFF;
+
+    uint16_t crc = crc16_update(0xFFFF, SECRET_KEY, SECRET_KEY_LEN);
+    crc = crc16_update(crc, hdr, sizeof(hdr));
+    return crc16_update(crc, payload, len);
+}
+
+// UART ingress: the ISR drains the hardware FIFO into this ring, the main
+// loop frames lines out of it. Single producer (ISR) / single consumer.
+#define UART_RING_SIZE      1024            // power of two
+#define UART_RING_MASK      (UART_RING_SIZE - 1)
+#define UART_LINE_MAX       300
+
+static volatile uint8_t  uart_ring[UART_RING_SIZE];
+static volatile uint16_t uart_ring_head = 0;    // written by the ISR only
+static volatile uint16_t uart_ring_tail = 0;    // written by the main loop only
+
+static volatile uint32_t uart_rx_bytes = 0;
+static volatile uint32_t uart_ring_dropped = 0; // ring full, byte lost
+static volatile uint32_t uart_hw_overruns = 0;  // hardware FIFO overran before the ISR ran
+
+static char     uart_line_buffer[UART_LINE_MAX];
+static uint16_t uart_line_idx = 0;
+static uint8_t  uart_line_discard = 0;          // skipping the tail of an oversized line
+static uint32_t uart_lines_ok = 0;
+static uint32_t uart_lines_too_long = 0;
+static uint32_t uart_line_dropped_bytes = 0;
+
 static void seq_init(void)
 {
     memset(seq_trackers, 0, sizeof(seq_trackers));
@@ -188,96 +306,356 @@ static void uart_init_wrapper(uint32_t baud)
     uart_cmd(UART_INST, true);
 }
 
-static int uart_available_wrapper(void)
+void UART0_IRQHandler(void)
 {
-    return uart_get_flag_status(UART_INST, UART_FLAG_RX_FIFO_EMPTY) ? 0 : 1;
+    if (uart_get_interrupt_status(UART_INST, UART_INTERRUPT_RX_OVERRUN)) {
+        uart_clear_interrupt(UART_INST, UART_INTERRUPT_RX_OVERRUN);
+        uart_hw_overruns++;
+    }
+
+    if (uart_get_interrupt_status(UART_INST, UART_INTERRUPT_RX_DONE) ||
+        uart_get_interrupt_status(UART_INST, UART_INTERRUPT_RX_TIMEOUT)) {
+        uint16_t head = uart_ring_head;
+        while (!uart_get_flag_status(UART_INST, UART_FLAG_RX_FIFO_EMPTY)) {
+            uint8_t byte = (uint8_t)uart_receive_data(UART_INST);
+            uint16_t next = (head + 1) & UART_RING_MASK;
+            uart_rx_bytes++;
+            if (next == uart_ring_tail) {
+                uart_ring_dropped++;
+                continue;
+            }
+            uart_ring[head] = byte;
+            head = next;
+        }
+        uart_ring_head = head;
+        uart_clear_interrupt(UART_INST, UART_INTERRUPT_RX_DONE | UART_INTERRUPT_RX_TIMEOUT);
+    }
 }
 
-static int uart_readbyte_wrapper(void)
+static void uart_rx_irq_init(void)
 {
-    if (!uart_available_wrapper()) return -1;
-    return (int)uart_receive_data(UART_INST);
+    // Interrupt at half-full FIFO, plus the idle timeout for the last bytes of a line
+    uart_set_rx_fifo_threshold(UART_INST, UART_FIFO_LEVEL_1_2);
+    uart_config_interrupt(UART_INST,
+                          UART_INTERRUPT_RX_DONE | UART_INTERRUPT_RX_TIMEOUT | UART_INTERRUPT_RX_OVERRUN,
+                          true);
+    NVIC_SetPriority(UART0_IRQn, 2);
+    NVIC_EnableIRQ(UART0_IRQn);
 }
 
-static const char* uart_read_json_line(uint32_t timeout_ms)
+// Non-blocking: consume buffered bytes, return a complete line or NULL.
+// An oversized line is dropped as a whole (up to its '\n') and counted.
+static const char* uart_poll_line(void)
 {
-    uint32_t start = TimerGetCurrentTime();
+    while (uart_ring_tail != uart_ring_head) {
+        uint16_t tail = uart_ring_tail;
+        char byte = (char)uart_ring[tail];
+        uart_ring_tail = (tail + 1) & UART_RING_MASK;
+
+        if (byte == '\n') {
+            if (uart_line_discard) {
+                uart_line_discard = 0;
+                uart_line_idx = 0;
+                continue;
+            }
+            if (uart_line_idx > 0) {
+                uart_line_buffer[uart_line_idx] = 0;
+                uart_line_idx = 0;
+                uart_lines_ok++;
+                return uart_line_buffer;
+            }
+        } else if (byte == '\r') {
+            continue;
+        } else if (uart_line_discard) {
+            uart_line_dropped_bytes++;
+        } else if (uart_line_idx < (sizeof(uart_line_buffer) - 1)) {
+            uart_line_buffer[uart_line_idx++] = byte;
+        } else {
+            printf("[UART ERROR] Line longer than %u bytes, dropping it\r\n",
+                   (unsigned)(sizeof(uart_line_buffer) - 1));
+            uart_lines_too_long++;
+            uart_line_dropped_bytes += uart_line_idx + 1;
+            uart_line_idx = 0;
+            uart_line_discard = 1;
+        }
+    }
 
-    while (TimerGetElapsedTime(start) < timeout_ms) {
-        int byte = uart_readbyte_wrapper();
+    return NULL;
+}
 
-        if (byte >= 0) {
-            if (byte == '\n') {
-                uart_json_buffer[uart_json_idx] = 0;
+static int base64_value(char c)
+{
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+') return 62;
+    if (c == '/') return 63;
+    return -1;
+}
 
-                if (uart_json_idx > 0) {
-                    printf("[UART RX] Got JSON line (%u bytes): ", uart_json_idx);
-                    printf("%s\r\n", uart_json_buffer);
-                    uart_json_idx = 0;
-                    return uart_json_buffer;
-                }
-                uart_json_idx = 0;
-            } else if (byte == '\r') {
-            } else if (uart_json_idx < (sizeof(uart_json_buffer) - 1)) {
-                uart_json_buffer[uart_json_idx++] = (char)byte;
-            } else {
-                printf("[UART ERROR] Buffer overflow, resetting\r\n");
-                uart_json_idx = 0;
+// ESP32 sends sealed binary frames as Base64 lines (UART framing only).
+// Returns the decoded length, or -1 if the line is not Base64 (e.g. old JSON).
+static int base64_decode_line(const char* in, uint16_t in_len, uint8_t* out, uint16_t cap)
+{
+    if (in_len == 0 || (in_len % 4) != 0) return -1;
+
+    uint16_t out_len = 0;
+    for (uint16_t i = 0; i < in_len; i += 4) {
+        int v[4];
+        int pad = 0;
+        for (int k = 0; k < 4; k++) {
+            char c = in[i + k];
+            if (c == '=' && i + 4 == in_len && k >= 2) {
+                v[k] = 0;
+                pad++;
+            } else if (pad > 0 || (v[k] = base64_value(c)) < 0) {
+                return -1;
             }
         }
+
+        uint32_t triple = ((uint32_t)v[0] << 18) | ((uint32_t)v[1] << 12)
+                        | ((uint32_t)v[2] << 6) | (uint32_t)v[3];
+        uint8_t bytes[3] = { (uint8_t)(triple >> 16), (uint8_t)(triple >> 8), (uint8_t)triple };
+        for (int k = 0; k < 3 - pad; k++) {
+            if (out_len >= cap) return -1;
+            out[out_len++] = bytes[k];
+        }
     }
+    return out_len;
+}
 
-    return NULL;
+static void tx_queue_init(void)
+{
+    memset(&tx_stats, 0, sizeof(tx_stats));
+    tx_count = 0;
+    tx_busy = 0;
+    for (uint8_t i = 0; i < TX_QUEUE_DEPTH; i++) {
+        tx_free[i] = (uint8_t)(TX_QUEUE_DEPTH - 1 - i);
+    }
+    tx_free_count = TX_QUEUE_DEPTH;
 }
 
-static void radio_send_blocking(const uint8_t* data, uint16_t len)
+// Removes tx_order[pos] and returns its slot to the free list
+static void tx_queue_remove(uint8_t pos)
 {
-    txDone = 0;
-    Radio.Send((uint8_t*)data, len);
-    while (!txDone) { Radio.IrqProcess(); }
+    tx_free[tx_free_count++] = tx_order[pos];
+    for (uint8_t i = pos; i + 1 < tx_count; i++) {
+        tx_order[i] = tx_order[i + 1];
+    }
+    tx_count--;
 }
 
-static void send_enhanced_secure_packet(const uint8_t* plaintext, uint16_t plain_len) {
-    if (plain_len > CHUNK_MAX) return;
+// Makes room in a full queue according to TX_QUEUE_DROP_POLICY.
+// Returns 0 when the incoming frame is the one to drop.
+static int tx_queue_make_room(uint8_t prio)
+{
+#if TX_QUEUE_DROP_POLICY == TX_DROP_NEWEST
+    (void)prio;
+    tx_stats.dropped_newest++;
+    return 0;
+#elif TX_QUEUE_DROP_POLICY == TX_DROP_OLDEST
+    (void)prio;
+    tx_queue_remove(0);
+    tx_stats.dropped_oldest++;
+    return 1;
+#else
+    for (uint8_t i = 0; i < tx_count; i++) {
+        if (tx_slots[tx_order[i]].prio == TX_PRIO_NORMAL) {
+            tx_queue_remove(i);
+            tx_stats.dropped_normal++;
+            return 1;
+        }
+    }
+    // Only urgent frames queued: a normal one waits its turn, an urgent one replaces the oldest
+    if (prio == TX_PRIO_NORMAL) {
+        tx_stats.dropped_newest++;
+        return 0;
+    }
+    tx_queue_remove(0);
+    tx_stats.dropped_oldest++;
+    return 1;
+#endif
+}
+
+static int tx_queue_push(const uint8_t* payload, uint16_t len, uint8_t prio)
+{
+    if (len == 0 || len > CHUNK_MAX) return 0;
+    if (tx_count == TX_QUEUE_DEPTH && !tx_queue_make_room(prio)) {
+        printf("[TX QUEUE] Full, frame dropped (%u bytes)\r\n", (unsigned)len);
+        return 0;
+    }
+
+    uint8_t slot = tx_free[--tx_free_count];
+    memcpy(tx_slots[slot].payload, payload, len);
+    tx_slots[slot].len = len;
+    tx_slots[slot].prio = prio;
+    tx_slots[slot].enq_time = TimerGetCurrentTime();
+    tx_order[tx_count++] = slot;
+
+    tx_stats.enqueued++;
+    if (tx_count > tx_stats.high_water) tx_stats.high_water = tx_count;
+    return 1;
+}
 
-    uint8_t packet[BUFFER_SIZE];
+// Frames the payload (seq is taken here, so dropped frames leave no gap) and starts the radio
+static void tx_start(const TxSlot_t* s)
+{
+    uint16_t plain_len = s->len;
     int pkt_pos = 0;
     uint32_t current_seq = tx_sequence;
 
-    packet[pkt_pos++] = LOCAL_NODE_ID;
-    packet[pkt_pos++] = (current_seq >>  0) & 0xFF;
-    packet[pkt_pos++] = (current_seq >>  8) & 0xFF;
-    packet[pkt_pos++] = (current_seq >> 16) & 0xFF;
-    packet[pkt_pos++] = (current_seq >> 24) & 0xFF;
-    
+    tx_frame[pkt_pos++] = LOCAL_NODE_ID;
+    tx_frame[pkt_pos++] = (current_seq >>  0) & 0xFF;
+    tx_frame[pkt_pos++] = (current_seq >>  8) & 0xFF;
+    tx_frame[pkt_pos++] = (current_seq >> 16) & 0xFF;
+    tx_frame[pkt_pos++] = (current_seq >> 24) & 0xFF;
+
     tx_sequence++; // Tăng seq cho gói tiếp theo
 
-    packet[pkt_pos++] = (plain_len >> 0) & 0xFF;
-    packet[pkt_pos++] = (plain_len >> 8) & 0xFF;
+    tx_frame[pkt_pos++] = (plain_len >> 0) & 0xFF;
+    tx_frame[pkt_pos++] = (plain_len >> 8) & 0xFF;
 
-    memcpy(&packet[pkt_pos], plaintext, plain_len);
+    memcpy(&tx_frame[pkt_pos], s->payload, plain_len);
     pkt_pos += plain_len;
 
     // AUTH TAG (Thay thế cho CRC cũ)
-    uint16_t auth = compute_auth_tag(LOCAL_NODE_ID, current_seq, plaintext, plain_len);
-    packet[pkt_pos++] = (auth >> 0) & 0xFF;
-    packet[pkt_pos++] = (auth >> 8) & 0xFF;
+    uint16_t auth = compute_auth_tag(LOCAL_NODE_ID, current_seq, s->payload, plain_len);
+    tx_frame[pkt_pos++] = (auth >> 0) & 0xFF;
+    tx_frame[pkt_pos++] = (auth >> 8) & 0xFF;
+
+    tx_busy = 1;
+    rx_armed = 0;           // Send() takes the radio out of Rx
+    tx_inflight_enq_time = s->enq_time;
+    tx_inflight_start = TimerGetCurrentTime();
+    Radio.Send(tx_frame, (uint16_t)pkt_pos);
+    printf("[TX SECURE] Node=%u, seq=%lu, AUTH=0x%04X%s\r\n", LOCAL_NODE_ID, (unsigned long)current_seq,
+           auth, s->prio == TX_PRIO_URGENT ? " (urgent)" : "");
+}
+
+static void tx_complete(int ok)
+{
+    tx_busy = 0;
+    if (!ok) {
+        tx_stats.timeouts++;
+        printf("[TX ERROR] Radio TX timeout\r\n");
+        return;
+    }
+
+    uint32_t latency = TimerGetElapsedTime(tx_inflight_enq_time);
+    tx_stats.sent++;
+    tx_stats.latency_sum_ms += latency;
+    if (latency > tx_stats.latency_max_ms) tx_stats.latency_max_ms = latency;
+}
+
+// Called every main loop pass: completes the frame in flight, then starts the next one
+static void tx_queue_service(void)
+{
+    if (State == TX || State == TX_TIMEOUT) {
+        int ok = (State == TX);
+        State = LOWPOWER;
+        if (tx_busy) tx_complete(ok);
+    }
+
+    if (tx_busy) {
+        if (TimerGetElapsedTime(tx_inflight_start) > TX_WATCHDOG_MS) {
+            Radio.Sleep();
+            tx_complete(0);
+        }
+        return;
+    }
+    if (tx_count == 0) return;
+
+    // Urgent frames go first, FIFO within each priority
+    uint8_t pos = 0;
+    for (uint8_t i = 0; i < tx_count; i++) {
+        if (tx_slots[tx_order[i]].prio == TX_PRIO_URGENT) {
+            pos = i;
+            break;
+        }
+    }
+    uint8_t slot = tx_order[pos];
+    tx_start(&tx_slots[slot]);
+    tx_queue_remove(pos);
+}
+
+static uint32_t get_le32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Validates a received packet as a gateway beacon and forwards its acks
+static void beacon_handle(const uint8_t* raw, uint16_t raw_len)
+{
+    if (raw_len < 9 || raw[0] != GW_BEACON_NODE_ID) {
+        rx_other++;
+        return;
+    }
+    uint32_t seq = get_le32(&raw[1]);
+    uint16_t len = (uint16_t)(raw[5] | (raw[6] << 8));
+    if (len == 0 || 7 + len + 2 > raw_len) {
+        beacons_bad++;
+        return;
+    }
+    const uint8_t* p = &raw[7];
+    uint16_t auth = (uint16_t)(p[len] | (p[len + 1] << 8));
+    if (auth != compute_auth_tag(GW_BEACON_NODE_ID, seq, p, len)) {
+        beacons_bad++;
+        return;
+    }
+
+    beacons_ok++;
+    printf("@BCN %lu %d %d\r\n", (unsigned long)seq, (int)RssiValue, (int)SnrValue);
+
+    uint8_t count = p[0];
+    uint16_t pos = 1;
+    for (uint8_t i = 0; i < count; i++) {
+        if (pos + 12 > len) break;
+        const uint8_t* e = &p[pos];
+        uint8_t n_old = e[11];
+        if (pos + 12 + 6 * n_old > len) break;
+        pos += 12;
+
+        if (!esp_vehicle_known || e[0] == esp_vehicle) {
+            printf("@ACK %u %u %lu %08lX", (unsigned)e[0], (unsigned)(e[1] | (e[2] << 8)),
+                   (unsigned long)get_le32(&e[3]), (unsigned long)get_le32(&e[7]));
+            for (uint8_t k = 0; k < n_old; k++) {
+                const uint8_t* o = &p[pos + 6 * k];
+                printf(" %u:%lu", (unsigned)(o[0] | (o[1] << 8)), (unsigned long)get_le32(&o[2]));
+            }
+            printf("\r\n");
+        }
+        pos += 6 * n_old;
+    }
+}
+
+// Called every main loop pass after tx_queue_service(): handles what the
+// receiver delivered and keeps it listening while nothing is being sent
+static void rx_service(void)
+{
+    if (State == RX) {
+        State = LOWPOWER;
+        rx_armed = 0;
+        beacon_handle(LoraBuf, LoraLen);
+    } else if (State == RX_TIMEOUT || State == RX_ERROR) {
+        State = LOWPOWER;
+        rx_armed = 0;
+    }
 
-    radio_send_blocking(packet, (uint16_t)pkt_pos);
-    printf("[TX SECURE] Node=%u, seq=%lu, AUTH=0x%04X\r\n", LOCAL_NODE_ID, (unsigned long)current_seq, auth);
+    if (!tx_busy && !rx_armed) {
+        Radio.Rx(RX_TIMEOUT_VALUE);
+        rx_armed = 1;
+    }
 }
 
 static void OnTxDone(void)
 {
     Radio.Sleep();
-    txDone = 1;
     State = TX;
 }
 
 static void OnTxTimeout(void)
 {
     Radio.Sleep();
-    txDone = 1;
     State = TX_TIMEOUT;
 }
 
@@ -344,32 +722,74 @@ int app_start(void)
 #endif
 
     uart_init_wrapper(UART_BAUD);
+    uart_rx_irq_init();
     printf("[INIT] UART initialized at %lu baud\r\n", (unsigned long)UART_BAUD);
     printf("[INIT] Listening for sensor JSON from ESP32...\r\n");
     seq_init();
+    tx_queue_init();
 
     Radio.Rx(RX_TIMEOUT_VALUE);
+    rx_armed = 1;
 
     while (1) {
         Radio.IrqProcess();
+        tx_queue_service();
+        rx_service();
 
-        const char* json_line = uart_read_json_line(100);
+        const char* json_line = uart_poll_line();
 
         if (json_line != NULL && strlen(json_line) > 0) {
-            printf("[TX UART] Received sensor data from ESP32, queuing transmission\r\n");
+            uint8_t prio = TX_PRIO_NORMAL;
+            if (json_line[0] == TX_URGENT_MARK) {
+                prio = TX_PRIO_URGENT;
+                json_line++;
+            }
+
+            uint8_t sealed[CHUNK_MAX];
+            int sealed_len = base64_decode_line(json_line, (uint16_t)strlen(json_line), sealed, sizeof(sealed));
 
-            if (strlen(json_line) <= CHUNK_MAX) {
-                send_enhanced_secure_packet((uint8_t*)json_line, strlen(json_line));
-                printf("[TX OK] Real sensor data transmitted\r\n");
+            if (sealed_len > 0) {
+                // AES-CCM sealed frame: put the raw bytes on air
+                if (sealed_len >= AEAD_OVERHEAD) {
+                    esp_vehicle = sealed[0];
+                    esp_vehicle_known = 1;
+                }
+                if (tx_queue_push(sealed, (uint16_t)sealed_len, prio)) {
+                    printf("[TX UART] Sealed frame queued (%d bytes, depth %u)\r\n", sealed_len, (unsigned)tx_count);
+                }
+            } else if (strlen(json_line) <= CHUNK_MAX) {
+                if (tx_queue_push((const uint8_t*)json_line, (uint16_t)strlen(json_line), prio)) {
+                    printf("[TX UART] Sensor data queued (depth %u)\r\n", (unsigned)tx_count);
+                }
             } else {
                 printf("[TX ERROR] JSON too long (%u > %u)\r\n", (unsigned)strlen(json_line), CHUNK_MAX);
             }
+            tx_queue_service();
         } else {
             static uint32_t last_status_msg = 0;
             uint32_t now = TimerGetCurrentTime();
 
             if (TimerGetElapsedTime(last_status_msg) > 5000) {
-                printf("[STATUS] Waiting for real sensor data from ESP32 via UART\r\n");
+                printf("[STATUS] UART rx=%lu lines=%lu ring_drop=%lu hw_overrun=%lu long_lines=%lu line_drop=%lu\r\n",
+                       (unsigned long)uart_rx_bytes,
+                       (unsigned long)uart_lines_ok,
+                       (unsigned long)uart_ring_dropped,
+                       (unsigned long)uart_hw_overruns,
+                       (unsigned long)uart_lines_too_long,
+                       (unsigned long)uart_line_dropped_bytes);
+                printf("[STATUS] TXQ depth=%u/%u hwm=%u enq=%lu sent=%lu timeout=%lu drop(old/new/normal)=%lu/%lu/%lu lat avg=%lums max=%lums\r\n",
+                       (unsigned)tx_count, (unsigned)TX_QUEUE_DEPTH, (unsigned)tx_stats.high_water,
+                       (unsigned long)tx_stats.enqueued,
+                       (unsigned long)tx_stats.sent,
+                       (unsigned long)tx_stats.timeouts,
+                       (unsigned long)tx_stats.dropped_oldest,
+                       (unsigned long)tx_stats.dropped_newest,
+                       (unsigned long)tx_stats.dropped_normal,
+                       (unsigned long)(tx_stats.sent ? tx_stats.latency_sum_ms / tx_stats.sent : 0),
+                       (unsigned long)tx_stats.latency_max_ms);
+                printf("[STATUS] Beacons ok=%lu bad=%lu other_rx=%lu vehicle=%d\r\n",
+                       (unsigned long)beacons_ok, (unsigned long)beacons_bad, (unsigned long)rx_other,
+                       esp_vehicle_known ? (int)esp_vehicle : -1);
                 last_status_msg = now;
             }
         }
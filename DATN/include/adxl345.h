@@ -1,4 +1,3 @@
-
 #ifndef ADXL345_H
 #define ADXL345_H
 
@@ -6,6 +5,42 @@
 #include <Adafruit_Sensor.h>
 #include <Adafruit_ADXL345_U.h>
 
+// FIFO stream mode: ADXL345 samples at ADXL_FIFO_RATE_HZ into its 32-entry
+// FIFO and raises INT1 at the watermark; the task drains it in one burst.
+// Task wakeups while moving = rate / watermark: 400 / 31 = ~13 per second,
+// against 20 per second for the 50 ms polling task (and none when parked).
+// 800 Hz at the same watermark doubles that to ~26. Watermark 31 leaves one
+// entry (2.5 ms at 400 Hz) for the task to start draining; a late drain
+// drops the oldest samples, while taps still latch in hardware.
+// Set to 0 to fall back to the 50 ms polling task.
+#ifndef ADXL_USE_FIFO_STREAM
+#define ADXL_USE_FIFO_STREAM 1
+#endif
+
+#ifndef ADXL_INT1_PIN
+#define ADXL_INT1_PIN 4          // ESP32 GPIO wired to ADXL345 INT1
+#endif
+
+#ifndef ADXL_FIFO_RATE_HZ
+#define ADXL_FIFO_RATE_HZ 400    // 400 or 800
+#endif
+
+#ifndef ADXL_FIFO_WATERMARK
+#define ADXL_FIFO_WATERMARK 31   // samples per interrupt (1-31), deepest by default
+#endif
+
+// Seconds below the motion threshold before the INACTIVITY interrupt
+// fires and FIFO draining is paused until the next ACTIVITY/TAP.
+#ifndef ADXL_INACTIVITY_S
+#define ADXL_INACTIVITY_S 5
+#endif
+
+// INT_SOURCE / INT_ENABLE bits
+#define ADXL_INT_SINGLE_TAP  0x40
+#define ADXL_INT_ACTIVITY    0x10
+#define ADXL_INT_INACTIVITY  0x08
+#define ADXL_INT_WATERMARK   0x02
+
 class ADXLModule {
 public:
   ADXLModule();
@@ -14,9 +49,28 @@ public:
   
   // Get raw LSB values
   void getRawLSB(int16_t &x_lsb, int16_t &y_lsb, int16_t &z_lsb);
+
+  // Configure FIFO stream mode + watermark interrupt on INT1
+  bool beginFifoStream(uint16_t rate_hz, uint8_t watermark);
+
+  // Number of samples currently in the FIFO (0 on I2C error)
+  uint8_t fifoEntries();
+
+  // Pop up to max samples from the FIFO, in g. Returns samples read.
+  uint8_t readFifo(float (*xyz)[3], uint8_t max);
+
+  // Program single-tap (shock) and activity/inactivity detection on INT1
+  bool beginEvents(float shock_g, float motion_g, uint8_t inactivity_s);
+
+  // Read (and clear) INT_SOURCE; 0 on I2C error
+  uint8_t readIntSource();
+
+  // Enable/disable the FIFO watermark interrupt
+  void setWatermarkInt(bool on);
   
 private:
   Adafruit_ADXL345_Unified accel = Adafruit_ADXL345_Unified(12345);
+  uint8_t int_enable = 0;
 };
 
 // Helper to start the ADXL telemetry task (implemented in adxl345.cpp)
@@ -0,0 +1,127 @@
+#ifndef BACKLOG_H
+#define BACKLOG_H
+
+#include <Arduino.h>
+#include "security.h"
+
+/**
+ * Store-and-forward backlog - replays sealed frames the gateway never acked
+ *
+ * Every sealed frame the uplink writes is kept in a small RAM in-flight
+ * table until a gateway ack beacon (hardened_pingpong_rx.c, forwarded by
+ * the TX bridge as "@BCN"/"@ACK" lines on LORA_SER) lists its AEAD
+ * epoch/seq. A frame still unacked after three beacon periods spills to a
+ * persistent ring of fixed slots:
+ *
+ *   - /backlog.bin on the SD card when sd_init() succeeded (preallocated
+ *     on first use), or
+ *   - the data partition of subtype "spiffs" (unused by this firmware)
+ *     through esp_partition when there is no card (ESP32 only).
+ *
+ * The link counts as up while beacons keep arriving. Then the backlog task
+ * reads the oldest spilled frames back and the send task replays them in
+ * its own TDMA slot, at most one every BACKLOG_DRAIN_INTERVAL_MS. Alerts
+ * and the superframe's reading always go first; a replay only takes the
+ * window time they leave, so no live reading is ever displaced. A slot
+ * stretched to fill SLOT_FRAME_MIN_MS (SLOT_COUNT=4) or sized with
+ * SLOT_BATCH holds a reading and a replay; a bare 230 ms slot (6 or more
+ * slots, the default 8 included) read out every superframe does not, and
+ * the backlog then drains only in superframes without a reading
+ * (send-on-delta, longer send interval). TaskLoraSend says so at boot.
+ * Replays are the identical sealed bytes (same epoch/seq, nonce and tag);
+ * the ingest side dedups on vehicle/epoch/seq, so a frame delivered twice
+ * is stored once. Delta frames are replayed as they are: the uplink sends
+ * a full reading after a link loss, and the ingest side rebuilds a late
+ * delta on the reading sealed right before it (same epoch, lower seq;
+ * TelemetryDeltaHistory in telemetry_frame.h), not on the newest one.
+ *
+ * Slot (BACKLOG_SLOT_SIZE bytes, little endian):
+ *
+ *   off  size  field
+ *   0    2     magic BACKLOG_SLOT_MAGIC (0xFFFF: erased / never written)
+ *   2    1     state 0xFF pending, 0x00 replayed (flash can clear bits in place)
+ *   3    1     reserved
+ *   4    4     crc32 (sd_log_format.h) of bytes 8 .. 16 + len
+ *   8    4     write id, grows by one per slot written
+ *   12   1     len
+ *   13   1     tries (replays so far)
+ *   14   2     reserved
+ *   16   len   sealed frame
+ *
+ * The ring is rebuilt at boot by scanning the slot headers. On flash a
+ * whole sector of slots is erased before reuse. When the ring is full the
+ * oldest pending frames are overwritten (stats.overwritten). Frames in RAM
+ * (in flight or read back for replay) are lost on a reset.
+ */
+
+#ifndef BACKLOG_BEACON_MS
+#define BACKLOG_BEACON_MS          10000   // GW_BEACON_MS on the gateway
+#endif
+#define BACKLOG_INFLIGHT           32      // sealed frames awaiting an ack in RAM
+#define BACKLOG_SPILL_QUEUE_LEN    8       // send task -> backlog task
+#define BACKLOG_READY_QUEUE_LEN    2       // backlog task -> send task, read ahead
+#ifndef BACKLOG_DRAIN_INTERVAL_MS
+#define BACKLOG_DRAIN_INTERVAL_MS  1000    // at most one replay per interval
+#endif
+#define BACKLOG_MAX_TRIES          5       // replays before a frame is given up
+#define BACKLOG_SLOT_SIZE          256
+#define BACKLOG_SLOT_HDR_SIZE      16
+#define BACKLOG_SLOT_MAGIC         0x4C42  // "BL"
+#ifndef BACKLOG_SD_SLOTS
+#define BACKLOG_SD_SLOTS           4096    // 1 MB file
+#endif
+#define BACKLOG_SD_PATH            "/backlog.bin"
+#define BACKLOG_LINE_MAX           128     // longest "@..." line kept from the bridge
+
+struct BacklogStats {
+  uint32_t tracked;       // sealed frames handed to backlog_track()
+  uint32_t acked;
+  uint32_t inflight;      // awaiting an ack right now
+  uint32_t spilled;       // unacked in time, sent to storage
+  uint32_t spill_dropped; // no storage or spill queue full
+  uint32_t stored;        // slots written
+  uint32_t pending;       // slots waiting for replay
+  uint32_t overwritten;   // pending slots lost to a full ring
+  uint32_t replayed;      // frames resent from the backlog
+  uint32_t expired;       // given up after BACKLOG_MAX_TRIES
+  uint32_t store_errors;  // read/write failures and bad slot CRCs
+  uint32_t beacons;
+};
+
+// Pick the storage (after sd_init(), if the card is used) and create the
+// queues. beacon_ms sets the ack timeout (3 beacons) and the link timeout
+// (2.5 beacons). Returns false if only the RAM in-flight table is available.
+bool backlog_begin(uint32_t beacon_ms = BACKLOG_BEACON_MS);
+
+// Low-priority task owning the storage (ring scan, spill writes, read-ahead)
+void startBacklog(unsigned long stackSize, UBaseType_t priority);
+
+// ---- Send task only ----
+
+// Remember a sealed frame just written to the bridge until it is acked
+void backlog_track(const uint8_t* pkt, size_t len, uint32_t now_ms);
+
+// A line from the bridge; "@BCN" and "@ACK" are consumed, others ignored
+void backlog_on_line(const char* line, uint32_t now_ms);
+
+// Spill frames whose ack timed out; call every send loop pass
+void backlog_service(uint32_t now_ms);
+
+// Next frame to replay if the link is up and the pace allows, else NULL.
+// Stays the same frame until backlog_replayed() is called.
+const uint8_t* backlog_peek(uint32_t now_ms, size_t& len);
+
+// The peeked frame went out: track it again for its ack
+void backlog_replayed(uint32_t now_ms);
+
+// ---- Any task ----
+
+// A beacon arrived within the link timeout
+bool backlog_link_up(uint32_t now_ms);
+
+// Beacons were heard since boot but stopped: the gateway is out of reach
+bool backlog_link_lost(uint32_t now_ms);
+
+BacklogStats backlog_stats();
+
+#endif // BACKLOG_H
@@ -0,0 +1,111 @@
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+#include <Arduino.h>
+
+/**
+ * Config store - versioned key/value settings, read once at boot
+ *
+ * All settings live in one record held in RAM. begin() reads it once, and
+ * every get() after that is served from RAM. set() only changes the RAM
+ * copy. commit() writes the whole record in one go, and only if a value
+ * actually changed.
+ *
+ * The record is kept twice in NVS (Preferences, namespace
+ * CONFIG_STORE_NAMESPACE, keys "rec0"/"rec1"). Each commit overwrites the
+ * older copy with a higher generation, so the newer one is never touched
+ * while a write is in progress. At boot the newest copy that passes its
+ * CRC wins: a reset in the middle of a commit loses that change, not the
+ * config. NVS itself spreads the writes over the pages of its partition
+ * (wear levelling) and checks every entry it stores.
+ *
+ * Record (little endian):
+ *
+ *   off  size  field
+ *   0    2     magic CONFIG_STORE_MAGIC
+ *   2    1     format version CONFIG_STORE_VERSION
+ *   3    1     reserved
+ *   4    4     generation, +1 per commit
+ *   8    2     payload length
+ *   10   2     reserved
+ *   12   n     payload: entries of key(1) len(1) value(len)
+ *   12+n 4     crc32 (sd_log_format.h) of bytes 0 .. 12 + n
+ *
+ * Integers are little endian. Keys this firmware does not know are kept
+ * across commits, and a missing key reads as "not set", so settings can
+ * be added without changing the format version.
+ */
+
+#define CONFIG_STORE_NAMESPACE    "vcfg"
+#define CONFIG_STORE_MAGIC        0x4643   // "CF"
+#define CONFIG_STORE_VERSION      1
+#define CONFIG_STORE_HDR_SIZE     12
+#define CONFIG_STORE_PAYLOAD_MAX  240
+#define CONFIG_STORE_RECORD_MAX   (CONFIG_STORE_HDR_SIZE + CONFIG_STORE_PAYLOAD_MAX + 4)
+
+// Keys are part of the stored format: append, never renumber
+enum ConfigKey : uint8_t {
+  CFG_DEVICE_ID = 1,          // string, no NUL
+  CFG_VEHICLE_NUM = 2,        // u8
+  CFG_BOOT_EPOCH = 3,         // u16, AEAD nonce epoch of the last boot
+  CFG_BATCH_SIZE = 4,         // u8
+  CFG_BATCH_LATENCY_S = 5,    // u16
+  CFG_DELTA_HEARTBEAT_S = 6,  // u16
+  CFG_SEND_INTERVAL_MS = 7,   // u32
+  CFG_TAMPER_THRESHOLD = 8,   // u16
+  CFG_SLOT = 9,               // u8, TDMA slot
+  CFG_AES_KEY = 10,           // 16 bytes
+  CFG_MAC_KEY = 11,           // 1..32 bytes
+  CFG_NODE_COUNTER = 12,      // u8, old main.cpp auto node_id (no longer written)
+  CFG_VEHICLE_UNIT = 13,      // 6 bytes, eFuse MAC the vehicle number was provisioned on
+};
+
+struct ConfigStoreStats {
+  uint32_t generation;   // of the record in RAM
+  uint32_t commits;      // records written since boot
+  uint32_t skipped;      // commit() calls with nothing changed
+  uint8_t valid_copies;  // copies that passed the CRC at begin()
+};
+
+class ConfigStore {
+public:
+  ConfigStore();
+
+  // Read both copies and keep the newest valid one in RAM. Returns false
+  // if neither is valid (first boot, or NVS erased); the store is empty
+  // then. Safe to call again to reload.
+  bool begin();
+
+  // Value length, or -1 if the key is not set. Copies at most cap bytes.
+  int get(ConfigKey key, void* out, size_t cap);
+  bool getU8(ConfigKey key, uint8_t& v);
+  bool getU16(ConfigKey key, uint16_t& v);
+  bool getU32(ConfigKey key, uint32_t& v);
+
+  // Change the RAM copy; false if the payload would not fit
+  bool set(ConfigKey key, const void* data, size_t len);
+  bool setU8(ConfigKey key, uint8_t v);
+  bool setU16(ConfigKey key, uint16_t v);
+  bool setU32(ConfigKey key, uint32_t v);
+  void remove(ConfigKey key);
+
+  // Write the RAM copy if anything changed since the last commit
+  bool commit();
+
+  ConfigStoreStats stats();
+
+private:
+  uint8_t _rec[CONFIG_STORE_RECORD_MAX];
+  uint32_t _gen;
+  uint16_t _len;          // payload bytes in use
+  bool _dirty;
+  ConfigStoreStats _stats;
+
+  int find(ConfigKey key);
+  void lock();
+  void unlock();
+};
+
+extern ConfigStore gConfigStore;
+
+#endif // CONFIG_STORE_H
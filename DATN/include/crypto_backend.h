@@ -0,0 +1,93 @@
+#ifndef CRYPTO_BACKEND_H
+#define CRYPTO_BACKEND_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "mbedtls/aes.h"
+#include "mbedtls/sha256.h"
+
+/**
+ * Crypto Backend - AES-128 (CBC/CTR) and HMAC-SHA256 with a selectable engine
+ *
+ *   CRYPTO_BACKEND_HW  platform mbedTLS. The ESP32 Arduino core builds it with
+ *                      CONFIG_MBEDTLS_HARDWARE_AES/SHA, so these calls run on
+ *                      the AES/SHA peripherals (falls back to CPU if the SHA
+ *                      engine is busy). On the host it is plain mbedTLS.
+ *   CRYPTO_BACKEND_SW  portable C on the CPU (T-table AES, reference SHA-256),
+ *                      independent of how mbedTLS was configured.
+ *
+ * Contexts are plain structs owned by the caller; nothing allocates.
+ * CRYPTO_DEFAULT_BACKEND picks the engine for gCryptoSession.
+ */
+
+enum CryptoBackend : uint8_t {
+    CRYPTO_BACKEND_SW = 0,
+    CRYPTO_BACKEND_HW = 1
+};
+
+#ifndef CRYPTO_DEFAULT_BACKEND
+#define CRYPTO_DEFAULT_BACKEND CRYPTO_BACKEND_HW
+#endif
+
+const char* crypto_backend_name(CryptoBackend b);
+
+// True when CRYPTO_BACKEND_HW really runs on a hardware accelerator
+bool crypto_backend_hw_accelerated();
+
+// ===== AES-128 =====
+struct CryptoAes {
+    CryptoBackend backend;
+    mbedtls_aes_context hw_enc;
+    mbedtls_aes_context hw_dec;
+    uint32_t sw_enc[44];           // expanded round keys (little-endian words)
+    uint32_t sw_dec[44];
+};
+
+void crypto_aes_init(CryptoAes& a, CryptoBackend b, const uint8_t key[16]);
+void crypto_aes_free(CryptoAes& a);
+
+// len must be a multiple of 16; iv is updated for chaining. in may equal out.
+void crypto_aes_cbc_encrypt(CryptoAes& a, uint8_t iv[16], const uint8_t* in, uint8_t* out, size_t len);
+void crypto_aes_cbc_decrypt(CryptoAes& a, uint8_t iv[16], const uint8_t* in, uint8_t* out, size_t len);
+
+// Big-endian counter block, incremented per 16 bytes; any len. in may equal out.
+void crypto_aes_ctr(CryptoAes& a, uint8_t counter[16], const uint8_t* in, uint8_t* out, size_t len);
+
+// ===== SHA-256 / HMAC-SHA256 =====
+struct CryptoSoftSha256 {
+    uint32_t h[8];
+    uint64_t total;
+    uint8_t buf[64];
+    size_t buf_len;
+};
+
+struct CryptoSha256 {
+    CryptoBackend backend;
+    mbedtls_sha256_context hw;
+    CryptoSoftSha256 sw;
+};
+
+void crypto_sha256_init(CryptoSha256& s, CryptoBackend b);
+void crypto_sha256_free(CryptoSha256& s);
+void crypto_sha256_starts(CryptoSha256& s);
+void crypto_sha256_update(CryptoSha256& s, const uint8_t* data, size_t len);
+void crypto_sha256_finish(CryptoSha256& s, uint8_t out[32]);
+// On the ESP32 a clone of a hardware-mode context continues in software
+void crypto_sha256_clone(CryptoSha256& dst, const CryptoSha256& src);
+
+// HMAC key. SW: the ipad/opad blocks already hashed, cloned per packet.
+// HW: the padded blocks themselves, hashed per packet on the SHA engine,
+// since cloning a primed state would drop the packet to CPU SHA.
+struct CryptoHmac {
+    CryptoBackend backend;
+    CryptoSha256 inner;
+    CryptoSha256 outer;
+    uint8_t ipad[64];
+    uint8_t opad[64];
+};
+
+void crypto_hmac_init(CryptoHmac& h, CryptoBackend b, const uint8_t* key, size_t key_len);
+void crypto_hmac_free(CryptoHmac& h);
+void crypto_hmac_sha256(const CryptoHmac& h, const uint8_t* data, size_t len, uint8_t out[32]);
+
+#endif // CRYPTO_BACKEND_H
@@ -0,0 +1,91 @@
+#ifndef GATEWAY_RECORD_H
+#define GATEWAY_RECORD_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Gateway Record - binary link from the ASR6601 RX gateway
+ *
+ * hardened_pingpong_rx.c writes one record per accepted LoRa packet on
+ * its link UART, COBS-encoded and terminated by 0x00 (the only zero on
+ * the wire, so a reader resyncs at the next delimiter after any garbage).
+ * Decoded record, little endian:
+ *
+ *   off  size  field
+ *   0    1     record type (GW_RECORD_PACKET / GW_RECORD_RAW)
+ *   1    1     node id (bridge header)
+ *   2    4     seq     (bridge header, already replay-checked)
+ *   6    4     ts_ms   (gateway TimerGetCurrentTime() at reception)
+ *   10   2     rssi    (int16, dBm)
+ *   12   1     snr     (int8, dB)
+ *   13   2     payload length n
+ *   15   n     payload (the sealed AES-CCM packet, security.h)
+ *   15+n 2     crc16   (CRC-16/CCITT-FALSE of bytes 0 .. 14+n)
+ *
+ * GW_RECORD_RAW records only appear on gateways built with GW_CAPTURE_RAW:
+ * every frame the radio delivered, before validation, node/seq 0 and the
+ * whole bridge frame as payload (capture input for tools/gw_replay).
+ *
+ * Keep in sync with GW_REC_* in hardened_pingpong_rx.c.
+ */
+
+#define GW_RECORD_PACKET        1
+#define GW_RECORD_RAW           2
+#define GW_RECORD_HDR_SIZE      15
+#define GW_RECORD_MAX_PAYLOAD   280     // gateway BUFFER_SIZE
+#define GW_RECORD_MAX_SIZE      (GW_RECORD_HDR_SIZE + GW_RECORD_MAX_PAYLOAD + 2)
+#define GW_RECORD_MAX_WIRE      (GW_RECORD_MAX_SIZE + GW_RECORD_MAX_SIZE / 254 + 2)
+
+struct GatewayRecord {
+  uint8_t  type;                // GW_RECORD_*
+  uint8_t  node;
+  uint32_t seq;
+  uint32_t ts_ms;
+  int16_t  rssi;
+  int8_t   snr;
+  uint16_t len;
+  const uint8_t *payload;       // points into the reader's buffer
+};
+
+struct GatewayReaderStats {
+  uint32_t records;
+  uint32_t bad_cobs;
+  uint32_t bad_crc;
+  uint32_t bad_format;          // unknown type or wrong length
+  uint32_t overflow;            // frame longer than GW_RECORD_MAX_WIRE
+};
+
+uint16_t gateway_crc16(const uint8_t *data, size_t len);
+
+// Decode one COBS frame (without the 0x00) into out. Returns the decoded
+// length, 0 on a malformed frame. out may alias in.
+size_t gateway_cobs_decode(const uint8_t *in, size_t len, uint8_t *out);
+
+// Validate and parse a decoded record. payload points into rec.
+bool gateway_record_parse(const uint8_t *rec, size_t len, GatewayRecord &out);
+
+// Gateway side, for host tools and capture synthesis: record + COBS + 0x00
+// into out. Returns the wire length, 0 if cap (>= GW_RECORD_MAX_WIRE) is short.
+size_t gateway_record_encode(const GatewayRecord &r, uint8_t *out, size_t cap);
+
+// Streaming reader: feed UART bytes as they arrive, one record at a time.
+class GatewayRecordReader {
+public:
+  GatewayRecordReader() { reset(); }
+  void reset();
+
+  // Returns true when byte completed a valid record; out stays valid until
+  // the next push().
+  bool push(uint8_t byte, GatewayRecord &out);
+
+  const GatewayReaderStats &stats() const { return _stats; }
+
+private:
+  uint8_t _buf[GW_RECORD_MAX_WIRE];
+  size_t _len;
+  bool _overflow;
+  GatewayReaderStats _stats;
+};
+
+#endif // GATEWAY_RECORD_H
@@ -2,45 +2,81 @@
 #define GPS_NEO6M_H
 
 #pragma once
-#include <TinyGPSPlus.h>
-#include <HardwareSerial.h>
+#include <Arduino.h>
+#include "nmea.h"
+
+/**
+ * GPS NEO-6M on UART2, driven by the UART driver's event queue
+ *
+ * The ESP-IDF UART driver detects '\n' in hardware (pattern detect) and
+ * posts one event per NMEA line, so TaskGPS sleeps on the queue and wakes
+ * once per sentence instead of polling bytes. Each line is read out of
+ * the driver ring buffer in one go and parsed in place by NmeaParser
+ * (RMC + GGA only); read() returns a GpsFix with the UTC of the epoch.
+ *
+ * begin() configures the receiver over UBX: only RMC and GGA, at
+ * GPS_RATE_HZ, on GPS_FAST_BAUD. It sends the port setting at both the
+ * default and the fast baud, so it also works when only the ESP32 was
+ * reset and the receiver is still on the fast baud.
+ */
+
+#ifndef GPS_PPS_PIN
+#define GPS_PPS_PIN -1            // NEO-6M TIMEPULSE pin, -1 = not wired (NMEA time only)
+#endif
+#ifndef GPS_RATE_HZ
+#define GPS_RATE_HZ 5             // navigation rate, NEO-6M max 5 Hz (u-blox 7/M8: 10 Hz)
+#endif
+#ifndef GPS_FAST_BAUD
+#define GPS_FAST_BAUD 38400       // after configuration, 0 = stay on the begin() baud
+#endif
+#define GPS_UART_PORT       2
+#define GPS_UART_RX_BUF     1024  // driver ring buffer (bytes)
+#define GPS_UART_QUEUE_LEN  16    // UART events / pattern positions
+#define GPS_NMEA_LATENCY_MS 50    // epoch -> first sentence's '\n' (receiver output + wire time)
+
+struct GpsStats {
+  NmeaStats nmea;
+  uint32_t events;      // UART events taken from the queue
+  uint32_t overflows;   // FIFO/ring buffer full or pattern queue lost: input flushed
+  uint32_t overlong;    // lines longer than NMEA_MAX_LEN, dropped
+};
 
 class GPSNeo6M {
 public:
   GPSNeo6M(int rxPin, int txPin, long baud);
 
   void begin();
-  void read();
+
+  // Block on the UART events until a fix completes (true), or until no line
+  // arrived for timeout_ms (false)
+  bool read(GpsFix& fix, uint32_t timeout_ms);
+
+  // Latest completed fix
+  const GpsFix& lastFix() { return _last; }
+  bool hasFix() { return _last.valid && _last.sats > 0; }
 
   // Debug
   void printLocation();
-  void printTimestamp();
-
-  TinyGPSPlus& gpsObject(){ 
-        return _gps; 
-    }
-
-  // Getter KHÔNG const (TinyGPS++ methods are non-const)
-  inline bool     updated()     { return _gps.location.isUpdated(); }
-  inline bool     hasFix()      { return _gps.location.isValid() && _gps.satellites.value() > 0; }
-  inline double   latitude()    { return _gps.location.lat(); }
-  inline double   longitude()   { return _gps.location.lng(); }
-  inline uint32_t satellites()  { return _gps.satellites.isValid() ? (uint32_t)_gps.satellites.value() : 0; }
-  
-  // Debug helpers
   void printDebugStats();
-  uint32_t getCharsProcessed() { return _gps.charsProcessed(); }
-  uint32_t getSentencesWithFix() { return _gps.sentencesWithFix(); }
+  GpsStats stats();
 
   // Trả chuỗi thời gian GPS "YYYY-MM-DD HH:MM:SS" (return true nếu hợp lệ)
   bool buildTimestamp(char* buf, size_t n);
 
+  // millis() of the latest PPS edge; false if PPS is not wired or not seen yet
+  bool lastPps(uint32_t& local_ms);
+
 private:
   int _rxPin, _txPin;
   long _baud;
-  HardwareSerial _serial;
-  TinyGPSPlus _gps;
-  uint32_t _last_bytes_available = 0;
+  QueueHandle_t _events;
+  NmeaParser _nmea;
+  GpsFix _last;
+  GpsStats _stats;
+  char _line[NMEA_MAX_LEN];
+
+  void configureReceiver();
+  void flushInput();
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -1,19 +1,77 @@
 #ifndef LOCAL_MEMORY_H
 #define LOCAL_MEMORY_H
 
+#include <Arduino.h>
 #include <SPI.h>
 #include <SD.h>
 
-// Khai báo hàm khởi tạo thẻ SD
+/**
+ * Local Memory - log nhị phân lên thẻ SD, không chặn task gọi
+ *
+ * Mỗi lần boot mở một file /log_NNNN.bin mới (định dạng trong
+ * sd_log_format.h: header có device id + boot epoch, block 512 byte có
+ * CRC, record 24 byte cố định). Producer (sensor, radio, ...) chỉ đổi mẫu
+ * sang record và copy vào block trong một trong hai buffer cấp phát sẵn;
+ * task writer ưu tiên thấp (startSdLogger) tính CRC và ghi nguyên buffer
+ * xuống thẻ. Thẻ SD có thể treo 100+ ms khi wear levelling, lúc đó producer
+ * ghi tiếp vào buffer còn lại, hết chỗ thì bỏ record và đếm ở dropped_rows
+ * chứ không chờ.
+ *
+ * SD_LOG_BUF_SIZE là bội số của SDLOG_BLOCK_SIZE nên mỗi lần ghi là trọn
+ * sector (8 KB = một cluster trên thẻ FAT32 8 KB/cluster). Record nằm trong
+ * buffer quá SD_LOG_FLUSH_MS thì writer đóng block đang dở (cờ
+ * SDLOG_BLOCK_FLUSHED) và ghi luôn; log thưa thì nên tăng SD_LOG_FLUSH_MS để
+ * block không bị đóng khi còn trống nhiều.
+ */
+
+#ifndef SD_LOG_BUF_SIZE
+#define SD_LOG_BUF_SIZE       8192    // mỗi buffer, bội số của SDLOG_BLOCK_SIZE
+#endif
+
+#ifndef SD_LOG_FLUSH_MS
+#define SD_LOG_FLUSH_MS       2000    // độ trễ tối đa từ lúc append tới lúc ghi thẻ
+#endif
+
+#define SD_LOG_SLOW_WRITE_MS  100     // lần ghi lâu hơn mức này được đếm ở slow_writes
+
+#define SD_LINE_QUEUE_LEN     8       // hàng đợi sd_append_line()
+#define SD_LINE_NAME_MAX      32
+#define SD_LINE_DATA_MAX      120
+
+struct SdLogStats {
+  uint32_t rows;            // record đã nhận vào buffer
+  uint32_t bytes;
+  uint32_t dropped_rows;    // cả hai buffer đều đầy
+  uint32_t dropped_bytes;
+  uint32_t writes;          // lần ghi buffer xuống thẻ
+  uint32_t partial_writes;  // trong đó do hết SD_LOG_FLUSH_MS hoặc sd_flush()
+  uint32_t write_errors;
+  uint32_t slow_writes;     // > SD_LOG_SLOW_WRITE_MS
+  uint32_t max_write_ms;
+  uint32_t lines;           // sd_append_line() đã ghi
+  uint32_t lines_dropped;   // hàng đợi sd_append_line() đầy
+};
+
+// Khởi tạo thẻ SD và mở file log mới (gọi sau gVehicleConfig.begin())
 extern bool sd_init(uint8_t csPin);
 
-// Khai báo hàm ghi dữ liệu CSV vào thẻ SD (yêu cầu 9 tham số)
-extern bool sd_append_csv(uint32_t ts_ms, double lat, double lng, uint32_t sats, float temp, float hum, float ax, float ay, float az);
+// true sau khi sd_init() thành công (thẻ dùng được cho module khác, vd. backlog.h)
+extern bool sd_ready();
+
+// Tạo task writer (gọi sau sd_init); ưu tiên nên thấp hơn các task sensor/radio
+extern void startSdLogger(unsigned long stackSize, UBaseType_t priority);
 
-// Khai báo hàm ghi dữ liệu vào file text
+// Ghi một mẫu (9 trường) vào buffer; false nếu chưa init hoặc bị bỏ
+extern bool sd_append_sample(uint32_t ts_ms, double lat, double lng, uint32_t sats, float temp, float hum, float ax, float ay, float az);
+
+// Ghi một dòng vào file text khác qua hàng đợi của writer (dài hơn
+// SD_LINE_DATA_MAX thì bị cắt); writer giữ file mở giữa các lần gọi
 extern bool sd_append_line(const char* filename, const char* data);
 
-// Khai báo hàm flush (để ghi dữ liệu vào thẻ SD trước khi tắt hoặc reset)
-extern void sd_flush();
+// Yêu cầu ghi ngay phần đang nằm trong buffer (trước khi reset/deep sleep).
+// wait_ms > 0: chờ tối đa chừng đó cho tới khi dữ liệu xuống thẻ
+extern bool sd_flush(uint32_t wait_ms = 0);
+
+extern SdLogStats sd_log_stats();
 
 #endif // LOCAL_MEMORY_H
@@ -0,0 +1,79 @@
+#ifndef NMEA_H
+#define NMEA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * NMEA 0183 parser for the GPS task - RMC and GGA only
+ *
+ * Takes one complete sentence at a time, the way the UART driver's
+ * pattern detect hands them over (up to and including the '\n'). Fields
+ * are parsed straight out of that buffer: no per-character state machine,
+ * no field copies, no strtod. Other sentence types are turned away on the
+ * address field, before the checksum is even computed.
+ *
+ * RMC and GGA of one receiver epoch (same hhmmss.ss) are merged into one
+ * GpsFix. The fix is complete when both have arrived, or when the next
+ * epoch starts with one of them missing (receiver set to output only one).
+ */
+
+#define NMEA_MAX_LEN 96   // 82 by the standard, plus slack for leading noise
+
+struct GpsFix {
+  uint64_t utc_ms;     // UTC of the fix, ms since 2000-01-01; 0 = date not known yet
+  uint32_t rx_ms;      // millis() when the first sentence of the epoch ended
+  double   lat;        // degrees, meaningful only if valid
+  double   lng;
+  float    speed_kmh;  // RMC, 0 if the epoch had none
+  float    course_deg;
+  float    hdop;       // GGA, 0 if the epoch had none
+  uint8_t  sats;
+  uint8_t  quality;    // GGA fix quality: 0 none, 1 GPS, 2 DGPS
+  bool     valid;      // position valid (RMC status 'A', else GGA quality > 0)
+};
+
+struct NmeaStats {
+  uint32_t sentences;  // lines handed to feed()
+  uint32_t rmc;
+  uint32_t gga;
+  uint32_t ignored;    // other sentence types
+  uint32_t bad;        // framing, checksum or field errors
+  uint32_t fixes;      // GpsFix records completed
+};
+
+class NmeaParser {
+public:
+  NmeaParser();
+
+  // One line, len bytes, '\r'/'\n' at the end optional. Bytes before the
+  // '$' (UBX replies, line noise) are skipped. rx_ms = millis() when the
+  // newline arrived. Returns true when it completed a fix (see fix()).
+  bool feed(const char* line, size_t len, uint32_t rx_ms);
+
+  // The fix completed by the last feed() that returned true
+  const GpsFix& fix() const { return _out; }
+
+  const NmeaStats& stats() const { return _stats; }
+
+private:
+  GpsFix _cur;           // epoch being assembled
+  GpsFix _out;
+  int32_t _curTod;       // ms of day of _cur, -1 = none
+  bool _curRmc;
+  bool _curGga;
+  bool _curDone;         // _cur already handed out
+  uint32_t _dateDays;    // days since 2000-01-01 from the latest RMC
+  int32_t _dateTod;      // ms of day of that RMC, -1 = no date yet
+  NmeaStats _stats;
+
+  bool complete();
+  void startEpoch(int32_t tod, uint32_t rx_ms);
+  bool parseRmc(const char* f, const char* end, int32_t& tod);
+  bool parseGga(const char* f, const char* end, int32_t& tod);
+};
+
+// ms since 2000-01-01 UTC (proleptic Gregorian, valid 2000..2099)
+uint64_t nmea_utc_ms(uint16_t year, uint8_t month, uint8_t day, uint32_t ms_of_day);
+
+#endif // NMEA_H
@@ -0,0 +1,128 @@
+#ifndef SD_LOG_FORMAT_H
+#define SD_LOG_FORMAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * SD Log Format - binary, append-only sensor log (/log_NNNN.bin)
+ *
+ * One file per boot. Everything is SDLOG_BLOCK_SIZE (one sector) so block
+ * i lives at offset SDLOG_BLOCK_SIZE * (i + 1) and a reader can binary
+ * search by seq or time without scanning the card. Little endian.
+ *
+ * File header (block "-1", offset 0):
+ *
+ *   off  size  field
+ *   0    4     magic "VLOG"
+ *   4    1     version
+ *   5    1     record size (SDLOG_RECORD_SIZE)
+ *   6    2     block size  (SDLOG_BLOCK_SIZE)
+ *   8    2     boot epoch  (same counter as the uplink AEAD header)
+ *   10   1     vehicle number
+ *   11   1     records per block
+ *   12   4     created, millis() when the file was opened
+ *   16   32    device id, NUL padded
+ *   508  4     crc32 of bytes 0 .. 507
+ *
+ * Data block:
+ *
+ *   0    2     magic 0x4B42 ("BK")
+ *   2    1     record count (1 .. SDLOG_RECORDS_PER_BLOCK)
+ *   3    1     flags (SDLOG_BLOCK_FLUSHED: sealed early by a latency flush)
+ *   4    4     block number (index in the file)
+ *   8    4     seq of the first record, record k has seq first_seq + k
+ *   12   4     ts_ms of the first record
+ *   16   24*n  records
+ *   508  4     crc32 of bytes 0 .. 507 (unused bytes are zero)
+ *
+ * Record (no floats, same scaling and "no data" values as telemetry_frame.h):
+ *
+ *   0    4     ts_ms   (uint32, millis())
+ *   4    4     lat     (int32, degrees * 1e7)
+ *   8    4     lng     (int32, degrees * 1e7)
+ *   12   2     temp    (int16, 0.1 °C, TF_INVALID_I16 = no data)
+ *   14   2     hum     (uint16, 0.1 %, TF_INVALID_U16 = no data)
+ *   16   6     ax, ay, az (int16, mg, TF_INVALID_I16 = no data)
+ *   22   1     sats    (clamped to 255)
+ *   23   1     flags   (reserved, 0)
+ *
+ * seq counts every sample offered to the logger, so rows dropped while the
+ * card stalled show up as a gap in seq. ts_ms and seq only grow within a
+ * file (millis() wraps after 49 days).
+ *
+ * Pure C++ (no Arduino dependency) so tools/sdlog_dump links the same code.
+ */
+
+#define SDLOG_MAGIC              "VLOG"
+#define SDLOG_VERSION            1
+#define SDLOG_BLOCK_SIZE         512
+#define SDLOG_BLOCK_MAGIC        0x4B42
+#define SDLOG_BLOCK_HDR_SIZE     16
+#define SDLOG_RECORD_SIZE        24
+#define SDLOG_RECORDS_PER_BLOCK  20      // 16 + 20 * 24 = 496 <= 508
+#define SDLOG_CRC_OFFSET         (SDLOG_BLOCK_SIZE - 4)
+#define SDLOG_DEVICE_ID_MAX      32
+
+#define SDLOG_BLOCK_FLUSHED      0x01
+
+struct SdLogHeader {
+  uint8_t  version;
+  uint16_t epoch;
+  uint8_t  vehicle;
+  uint32_t created_ms;
+  char     device_id[SDLOG_DEVICE_ID_MAX + 1];
+};
+
+struct SdLogRecord {
+  uint32_t seq;          // not stored, from the block's first_seq
+  uint32_t ts_ms;
+  int32_t  lat_e7;
+  int32_t  lng_e7;
+  int16_t  temp_dc;
+  uint16_t hum_dp;
+  int16_t  ax_mg;
+  int16_t  ay_mg;
+  int16_t  az_mg;
+  uint8_t  sats;
+  uint8_t  flags;
+};
+
+struct SdLogBlock {
+  uint32_t block_no;
+  uint32_t first_seq;
+  uint32_t first_ts_ms;
+  uint8_t  count;
+  uint8_t  flags;
+  const uint8_t *records;
+};
+
+uint32_t sdlog_crc32(const uint8_t *data, size_t len);
+
+// Fill a record from the same inputs sd_append_sample() takes
+void sdlog_record_fill(SdLogRecord &r, uint32_t ts_ms, double lat, double lng, uint32_t sats,
+                       float temp, float hum, float ax, float ay, float az);
+
+void sdlog_header_encode(const SdLogHeader &h, uint8_t *out);        // SDLOG_BLOCK_SIZE bytes
+bool sdlog_header_decode(const uint8_t *in, SdLogHeader &h);
+
+// Writer side: start an empty block, add records, then seal (CRC) it
+void sdlog_block_begin(uint8_t *blk, uint32_t block_no, uint32_t first_seq, uint32_t first_ts_ms);
+bool sdlog_block_full(const uint8_t *blk);
+bool sdlog_block_put(uint8_t *blk, const SdLogRecord &r);
+void sdlog_block_seal(uint8_t *blk, uint8_t flags);
+
+// Reader side: magic, count and CRC check
+bool sdlog_block_decode(const uint8_t *blk, SdLogBlock &b);
+void sdlog_block_record(const SdLogBlock &b, uint8_t k, SdLogRecord &r);
+
+// Indexed seek. read(ctx, i, out) loads data block i (SDLOG_BLOCK_SIZE
+// bytes into out). Returns the last block whose first record is <= key,
+// i.e. where records >= key start (0 if the key is before the log).
+// Blocks that fail their CRC are stepped over. O(log n) reads.
+typedef bool (*SdLogReadBlock)(void *ctx, uint32_t block, uint8_t *out);
+enum SdLogKey { SDLOG_KEY_SEQ, SDLOG_KEY_TS };
+uint32_t sdlog_seek(SdLogReadBlock read, void *ctx, uint32_t nblocks,
+                    SdLogKey kind, uint32_t key, uint8_t *scratch);
+
+#endif // SD_LOG_FORMAT_H
@@ -2,8 +2,109 @@
 #define SECURITY_MODULE_H
 
 #include <Arduino.h>
+#include "crypto_backend.h"
+
+/**
+ * Sealed frame (AES-128 CCM, RFC 3610), raw binary:
+ *
+ *   off  size  field
+ *   0    1     vehicle number      \
+ *   1    2     boot epoch (LE)      > header, authenticated as AAD
+ *   3    4     seq (LE)            /
+ *   7    n     ciphertext (telemetry_frame.h frame)
+ *   7+n  8     CCM tag
+ *
+ * Nonce (13 bytes) = vehicle | epoch | seq | 0 padding. The epoch is a
+ * boot counter persisted in the config store, so seq may restart at 0 every boot
+ * without ever reusing a nonce under the same key. The vehicle number is
+ * the per-unit part: the uplink only seals once it was provisioned on this
+ * unit (VehicleConfig::isProvisioned()), never under a default that every
+ * unit holding the fleet key shares.
+ */
+#define AEAD_HDR_LEN    7
+#define AEAD_TAG_LEN    8
+#define AEAD_NONCE_LEN  13
+#define AEAD_OVERHEAD   (AEAD_HDR_LEN + AEAD_TAG_LEN)
+
+// Largest frame handled by seal/open
+#define FRAME_MAX_PLAIN 128
+#define FRAME_MAX_SEALED (FRAME_MAX_PLAIN + AEAD_OVERHEAD)
+
+// Base64 line for a FRAME_MAX_SEALED packet, including the NUL (UART framing only)
+#define FRAME_MAX_B64 (4 * ((FRAME_MAX_SEALED + 2) / 3) + 1)
+
+struct AeadHeader {
+    uint8_t  vehicle;
+    uint16_t epoch;
+    uint32_t seq;
+};
+
+/**
+ * Crypto Session - AES-128 CCM / CBC + HMAC-SHA256 with everything precomputed
+ *
+ * begin() expands the AES encrypt/decrypt key schedules once and prepares
+ * the HMAC ipad/opad blocks (crypto_backend.h: hashed into two SHA-256
+ * states on the software backend, kept padded for the SHA engine on the
+ * hardware one). Each packet then reuses them instead of re-keying, and
+ * writes into caller buffers: no heap, no VLAs, no String.
+ *
+ * The AES/SHA engine comes from crypto_backend.h (CRYPTO_DEFAULT_BACKEND
+ * unless begin() is told otherwise).
+ *
+ * Methods only read the session, so one instance can be shared by the
+ * send task and a gateway/host decoder after begin() has returned.
+ */
+class CryptoSession {
+public:
+    CryptoSession();
+    ~CryptoSession();
+
+    void begin(const uint8_t aes_key[16], const uint8_t aes_iv[16],
+               const uint8_t* mac_key, size_t mac_key_len,
+               CryptoBackend backend = CRYPTO_DEFAULT_BACKEND);
+    void end();
+    bool ready() const { return _ready; }
+    CryptoBackend backend() const { return _backend; }
+
+    void hmac(const uint8_t* data, size_t len, uint8_t out[32]);
+
+    // PKCS#7 pad + AES-128 CBC. in may equal out. Returns ciphertext length, 0 if cap too small.
+    size_t encrypt(const uint8_t* in, size_t len, uint8_t* out, size_t cap);
+
+    // AES-128 CBC + PKCS#7 check. in may equal out. Returns false on bad length/padding.
+    bool decrypt(const uint8_t* in, size_t len, uint8_t* out, size_t& out_len);
+
+    // header || CCM(frame) || tag into out. Returns packet length, 0 on error.
+    // cap >= FRAME_MAX_SEALED always fits.
+    size_t seal(const AeadHeader& hdr, const uint8_t* frame, size_t len, uint8_t* out, size_t cap);
+
+    // Verify the tag (constant time) and decrypt. Returns false on any mismatch.
+    bool open(const uint8_t* pkt, size_t len, AeadHeader& hdr, uint8_t* out, size_t cap, size_t& out_len);
+
+private:
+    CryptoAes _aes;
+    CryptoHmac _mac;                 // K ^ ipad / K ^ opad, see crypto_backend.h
+    uint8_t _iv[16];
+    CryptoBackend _backend;
+    bool _ready;
+};
+
+// Session keyed with the project keys, or with provisioned ones (both
+// given, from the config store); call securityBegin() once in setup()
+extern CryptoSession gCryptoSession;
+void securityBegin(const uint8_t* aes_key = NULL, const uint8_t* mac_key = NULL, size_t mac_key_len = 0);
 
 String encryptDataToAESBase64(const String& jsonStr);
 String hmacSha256(const String& message);
 
-#endif // SECURITY_MODULE_H
\ No newline at end of file
+// Binary telemetry frame helpers on gCryptoSession
+size_t sealFrame(const AeadHeader& hdr, const uint8_t* frame, size_t len, uint8_t* out, size_t cap);
+bool openFrame(const uint8_t* pkt, size_t len, AeadHeader& hdr, uint8_t* out, size_t cap, size_t& out_len);
+
+// Same, Base64-wrapped for the line-based UART hop to the TX bridge
+// (the bridge decodes it again, the air carries the raw packet)
+size_t sealFrameToBase64(const AeadHeader& hdr, const uint8_t* frame, size_t len, char* out, size_t cap);
+size_t sealedToBase64(const uint8_t* pkt, size_t pkt_len, char* out, size_t cap);   // already sealed
+bool openFrameFromBase64(const char* b64, size_t b64_len, AeadHeader& hdr, uint8_t* out, size_t cap, size_t& out_len);
+
+#endif // SECURITY_MODULE_H
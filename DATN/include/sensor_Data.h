@@ -1,8 +1,11 @@
 #ifndef SENSOR_DATA_H
 #define SENSOR_DATA_H
 
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
 #include <freertos/FreeRTOS.h>
-#include <freertos/semphr.h>
+#include <freertos/task.h>
 
 struct SensorData {
     double lat;              // GPS latitude
@@ -14,10 +17,96 @@ struct SensorData {
     float accel;            // acceleration magnitude in g
     bool shock_detected;     // ADXL345 shock
     bool is_moving;          // motion flag
+    uint32_t shock_count;    // shock events since boot
+    uint32_t shock_ts_ms;    // millis() of the latest shock event
+    float shock_peak_g;      // peak dynamic g of the latest shock event
 };
 
-// Global sensor data + mutex
-extern SensorData sensorData;
-extern SemaphoreHandle_t sensorDataMutex;
+// Field groups, each published by exactly one task
+struct GpsSample {           // TaskGPS
+    double lat;
+    double lng;
+    uint32_t sats;
+    float speed;
+    uint64_t utc_ms;         // UTC of the fix, ms since 2000-01-01 (0 = not known)
+};
+
+struct EnvSample {           // TaskDHT11
+    float temp;
+    float hum;
+};
+
+struct MotionSample {        // TaskADXLData / TaskADXLFifo
+    float accel;
+    bool shock_detected;
+    bool is_moving;
+    uint32_t shock_count;
+    uint32_t shock_ts_ms;
+    float shock_peak_g;
+};
+
+/**
+ * Seqlock for a single-writer value.
+ * Writer bumps the sequence to odd, copies, bumps to even: never blocks.
+ * Reader retries while a write is in flight or the sequence changed, so
+ * it always returns a consistent copy (no zeroed snapshot on contention).
+ */
+template <typename T>
+class SeqLock {
+public:
+    void write(const T& v) {
+        uint32_t s = _seq.load(std::memory_order_relaxed);
+        _seq.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        copy(_data, v);
+        std::atomic_thread_fence(std::memory_order_release);
+        _seq.store(s + 2, std::memory_order_relaxed);
+    }
+
+    T read() const {
+        T out;
+        uint8_t spins = 0;
+        for (;;) {
+            uint32_t s1 = _seq.load(std::memory_order_acquire);
+            if ((s1 & 1) == 0) {
+                copy(out, _data);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (_seq.load(std::memory_order_relaxed) == s1) return out;
+            }
+            // Writer preempted mid-copy on this core: let it finish
+            if (++spins >= 4) {
+                vTaskDelay(1);
+                spins = 0;
+            }
+        }
+    }
+
+private:
+    static void copy(volatile T& dst, const T& src) {
+        const uint8_t* s = (const uint8_t*)&src;
+        volatile uint8_t* d = (volatile uint8_t*)&dst;
+        for (size_t i = 0; i < sizeof(T); i++) d[i] = s[i];
+    }
+    static void copy(T& dst, const volatile T& src) {
+        const volatile uint8_t* s = (const volatile uint8_t*)&src;
+        uint8_t* d = (uint8_t*)&dst;
+        for (size_t i = 0; i < sizeof(T); i++) d[i] = s[i];
+    }
+
+    std::atomic<uint32_t> _seq{0};
+    volatile T _data{};
+};
+
+// Reset all groups to "no data" (-999) before the sensor tasks start
+void sensor_data_init();
+
+// Writers (one task per group, never block)
+void sensor_data_publish_gps(const GpsSample& s);
+void sensor_data_publish_env(const EnvSample& s);
+void sensor_data_publish_motion(const MotionSample& s);
+
+// Readers: consistent per-group copies, assembled into a full snapshot
+SensorData sensor_data_snapshot();
+GpsSample sensor_data_snapshot_gps();
 
 #endif
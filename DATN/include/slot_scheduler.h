@@ -0,0 +1,159 @@
+#ifndef SLOT_SCHEDULER_H
+#define SLOT_SCHEDULER_H
+
+#include <Arduino.h>
+#include "sensor_Data.h"
+#include "security.h"
+#include "telemetry_frame.h"
+
+/**
+ * TDMA Slot Scheduler - convoy-wide uplink slots on GPS time
+ *
+ * The superframe is N slots of slot_ms plus the gateway's beacon slot,
+ * aligned to UTC: slot s of frame k opens at UTC k * frame_ms + s * slot_ms
+ * on every vehicle, and the beacon slot takes the last beacon_ms. TaskGPS
+ * feeds UTC observations (PPS edge or NMEA sentence) into syncUtc();
+ * the send task maps them back to its own millis() on every decision,
+ * so the schedule re-aligns continuously instead of drifting from a
+ * one-off offset.
+ *
+ * Slot width is sized from the LoRa airtime of SLOT_PAYLOAD_MAX plus
+ * the UART/bridge hop and two guard bands, and stretched so slots plus
+ * beacon slot fill SLOT_FRAME_MIN_MS when there is room. By default
+ * SLOT_PAYLOAD_MAX is one sealed K=1 reading (38 B, 230 ms slots); a
+ * convoy where any vehicle batches (VEHICLE_BATCH_SIZE > 1) builds with
+ * SLOT_BATCH=1 to size every slot for FRAME_MAX_SEALED (390 ms slots),
+ * otherwise its batches are cut to what the slot carries. The default
+ * 8 slots (the baseline's 8 vehicles) come to a 2380 ms superframe, so at
+ * the default 2000 ms send interval each vehicle reads every 2380 ms and
+ * TaskLoraSend warns at boot. Without a recent
+ * GPS time the scheduler free-runs on the last offset (or millis() alone),
+ * growing the guard bands with the drift budget.
+ *
+ * The plan must come out the same on every vehicle of a convoy, so it is
+ * built from convoy-wide constants only (SLOT_COUNT, SLOT_PAYLOAD_MAX,
+ * SLOT_FRAME_MIN_MS), never from a vehicle's own batch size or send
+ * interval. A vehicle with a longer send interval just skips superframes.
+ *
+ * Convoy size: vehicle n sends in slot n - 1, so SLOT_COUNT must be at
+ * least the highest vehicle number in the convoy (or vehicles are packed
+ * with VehicleConfig::setSlot()). A vehicle past SLOT_COUNT gets no slot
+ * and does not start its uplink; it never wraps onto another vehicle's
+ * slot. Once the slots no longer fit SLOT_FRAME_MIN_MS, every extra slot
+ * adds a full slot to the superframe, frame = SLOT_COUNT * slot + 540 ms:
+ *
+ *   SLOT_COUNT   4        6        8        12       16
+ *   K=1 slots    2000 ms  1998 ms  2380 ms  3300 ms  4220 ms
+ *   SLOT_BATCH   2100 ms  2880 ms  3660 ms  5220 ms  6780 ms
+ *
+ * A vehicle reads at most once per superframe, so past 6 slots (4 with
+ * SLOT_BATCH) the default 2000 ms send interval slips and TaskLoraSend
+ * warns at boot; alerts wait up to one superframe for the slot as well.
+ * Only up to 4 K=1 slots leave room for a backlog replay beside the
+ * reading; with more, a vehicle reading every superframe replays only in
+ * superframes it sends no reading in (backlog.h). A convoy of up to 6
+ * that needs the 2000 ms cadence builds with -DSLOT_COUNT=6 (or 4 for
+ * replays beside every reading). The gateway's GW_SLOT_COUNT has to
+ * match.
+ *
+ * Beacon slot: the gateway's ack beacon (hardened_pingpong_rx.c) goes out
+ * only in it, so it never lands on a vehicle slot. Its budget is the
+ * largest beacon, GW_BEACON_MAX_NODES (6) vehicles with GW_ACK_OLD_MAX (4)
+ * late acks each: 1 + 6 * (12 + 4 * 6) = 217 payload bytes, 226 on air,
+ * ~360 ms at SF7/125 kHz. The gateway has no GPS and times the slot from
+ * the frames it hears, so the slot adds SLOT_BEACON_GUARD_MS for that
+ * estimate on top of the usual guard on both sides. The gateway repeats
+ * these numbers (GW_SLOT_*); change both together.
+ */
+
+// LoRa settings of the RA-08H TX bridge (hardened_pingpong_tx.c)
+#define SLOT_LORA_SF            7
+#define SLOT_LORA_BW_HZ         125000
+#define SLOT_LORA_CR            1       // 4/5
+#define SLOT_LORA_PREAMBLE      8
+#define SLOT_BRIDGE_OVERHEAD    9       // node(1) seq(4) len(2) ... auth(2)
+
+#ifndef SLOT_COUNT
+#define SLOT_COUNT              8       // vehicles in the convoy, see above
+#endif
+#ifndef SLOT_BATCH
+#define SLOT_BATCH              0       // 1: slots carry a worst-case batch frame
+#endif
+#ifndef SLOT_PAYLOAD_MAX
+#if SLOT_BATCH
+#define SLOT_PAYLOAD_MAX        FRAME_MAX_SEALED  // largest sealed frame any vehicle may send
+#else
+#define SLOT_PAYLOAD_MAX        (TELEMETRY_FRAME_SIZE + AEAD_OVERHEAD)  // one sealed reading
+#endif
+#endif
+#ifndef SLOT_FRAME_MIN_MS
+#define SLOT_FRAME_MIN_MS       2000    // superframe floor (the default send interval)
+#endif
+#define SLOT_BEACON_PAYLOAD_MAX 217     // largest gateway beacon payload
+#define SLOT_BEACON_GUARD_MS    60      // gateway's error timing the superframe from uplinks
+#define SLOT_TX_LATENCY_MS      15      // UART line + bridge framing before the radio keys up
+#define SLOT_GUARD_PPS_MS       5       // synced on the PPS edge
+#define SLOT_GUARD_NMEA_MS      60      // synced on NMEA arrival (sentence + TaskGPS poll jitter)
+#define SLOT_GUARD_FREE_MS      60      // never synced: slot offsets on the local clock only
+#define SLOT_DRIFT_PPM          100     // crystal + tick error budget while free-running
+#define SLOT_SYNC_STALE_MS      5000    // older GPS time counts as free-running
+#define SLOT_SLEW_MAX_MS        200     // larger corrections step, smaller ones are filtered
+
+// Time on air of one LoRa packet (explicit header, CRC on), Semtech AN1200.13
+uint32_t lora_airtime_ms(size_t payload_len, uint8_t sf, uint32_t bw_hz, uint8_t cr, uint16_t preamble);
+
+struct SlotSync {
+  int64_t  offset_ms;        // UTC ms - local millis()
+  uint32_t last_local_ms;    // millis() of the last observation
+  bool     valid;
+  bool     pps;
+};
+
+struct SlotPlan {
+  uint16_t n_slots;
+  uint16_t slot;             // our slot index
+  uint32_t slot_ms;
+  uint32_t beacon_ms;        // gateway beacon slot at the end of the superframe
+  uint32_t frame_ms;         // n_slots * slot_ms + beacon_ms
+  uint32_t airtime_ms;       // largest frame the plan was sized for
+};
+
+class SlotScheduler {
+public:
+  SlotScheduler();
+
+  // Size the plan: max_frame is the largest sealed frame (before the bridge
+  // header), min_frame_ms the send interval the frame should not undercut.
+  void configure(uint16_t n_slots, uint16_t slot, size_t max_frame, uint32_t min_frame_ms);
+  const SlotPlan& plan() const { return _plan; }
+
+  // TaskGPS: the local millis() at which UTC was utc_ms
+  void syncUtc(uint64_t utc_ms, uint32_t local_ms, bool pps);
+
+  // Send task side. All times are local millis().
+  bool synced(uint32_t now) const;
+  uint32_t guardMs(uint32_t now) const;
+
+  // Can a frame of airtime_ms start now and end inside our slot?
+  bool canStart(uint32_t now, uint32_t airtime_ms) const;
+
+  // Largest sealed frame that still fits the TX window right now
+  size_t maxFrameBytes(uint32_t now) const;
+
+  // Superframe number at now (advances once per frame_ms)
+  uint64_t frameIndex(uint32_t now) const;
+
+  // Local time our next TX window opens, strictly after now
+  uint32_t nextWindowOpen(uint32_t now) const;
+
+private:
+  SlotPlan _plan;
+  SlotSync _writer;              // TaskGPS copy, filtered before publishing
+  SeqLock<SlotSync> _sync;
+
+  uint64_t globalMs(const SlotSync& s, uint32_t now) const;
+};
+
+extern SlotScheduler gSlotScheduler;
+
+#endif // SLOT_SCHEDULER_H
@@ -0,0 +1,221 @@
+#ifndef TELEMETRY_FRAME_H
+#define TELEMETRY_FRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Telemetry Frame - compact binary uplink format
+ *
+ * Replaces the snprintf JSON built in TaskLoraSend. Fixed layout,
+ * little-endian, no floats on the wire:
+ *
+ *   off  size  field
+ *   0    1     version (high nibble) | frame type (low nibble)
+ *   1    1     vehicle number
+ *   2    1     flags (bit0 tamper, bit1 shock, bit2 moving) | sats << 3
+ *   3    4     ts_ms        (uint32, millis() of the sample)
+ *   7    4     lat          (int32, degrees * 1e7)
+ *   11   4     lng          (int32, degrees * 1e7)
+ *   15   2     temp         (int16, 0.1 °C, TF_INVALID_I16 = no data)
+ *   17   2     hum          (uint16, 0.1 %, TF_INVALID_U16 = no data)
+ *   19   2     accel        (uint16, mg,    TF_INVALID_U16 = no data)
+ *   21   2     light        (uint16, 0-1023 normalized LDR level)
+ *
+ * Alert frame (type 0x2), sent immediately on tamper/shock events:
+ *
+ *   0    1     version | type
+ *   1    1     vehicle number
+ *   2    1     alert type (TF_ALERT_*)
+ *   3    4     ts_ms of the event
+ *   7    2     value (tamper: light level, shock: peak mg)
+ *   9    4     lat  (int32, degrees * 1e7)
+ *   13   4     lng  (int32, degrees * 1e7)
+ *
+ * Batch frame (type 0x3), K readings in one uplink:
+ *
+ *   0    1     version | type
+ *   1    1     vehicle number
+ *   2    1     sample count K
+ *   3    21    sample 0, absolute (reading layout from offset 2: flags .. light)
+ *   24   ...   samples 1..K-1, each: flags byte, then 7 zigzag varints holding
+ *              the difference to the previous sample of ts, lat, lng, temp,
+ *              hum, accel, light (16-bit fields wrap mod 2^16)
+ *
+ * A parked vehicle sampled every 2 s costs ~9 bytes per extra sample
+ * instead of a full 38-byte sealed packet.
+ *
+ * Delta frame (type 0x4), send-on-delta: only fields that moved past
+ * their deadband since the last value sent, absolute (not differences),
+ * so a lost frame never corrupts later ones:
+ *
+ *   0    1     version | type
+ *   1    1     vehicle number
+ *   2    1     flags | sats << 3 (always)
+ *   3    4     ts_ms (always)
+ *   7    1     presence bitmap (TF_HAS_*)
+ *   8    ...   present fields in bit order, same encoding as the reading
+ *
+ * The gateway applies it on top of the reading sealed right before it
+ * (same epoch, lower seq; see TelemetryDeltaHistory).
+ *
+ * Pure C++ (no Arduino dependency) so the gateway side can link the
+ * same encoder/decoder.
+ */
+
+#define TELEMETRY_FRAME_VERSION       1
+#define TELEMETRY_FRAME_TYPE_READING  0x1
+#define TELEMETRY_FRAME_TYPE_ALERT    0x2
+#define TELEMETRY_FRAME_TYPE_BATCH    0x3
+#define TELEMETRY_FRAME_TYPE_DELTA    0x4
+
+#define TELEMETRY_FRAME_SIZE          23
+#define TELEMETRY_ALERT_SIZE          17
+#define TELEMETRY_BATCH_HDR_SIZE      24    // header + absolute first sample
+#define TELEMETRY_BATCH_MAX_SIZE      120   // keep <= FRAME_MAX_PLAIN (security.h)
+#define TELEMETRY_BATCH_MAX_SAMPLES   16
+#define TELEMETRY_BATCH_SAMPLE_MAX    28    // worst case bytes one delta sample adds
+#define TELEMETRY_DELTA_HDR_SIZE      8
+#define TELEMETRY_DELTA_MAX_SIZE      32    // output buffer for telemetry_delta_encode
+#define TELEMETRY_DELTA_HISTORY       32    // readings per vehicle a late delta can build on
+
+#define TF_HAS_LAT       0x01
+#define TF_HAS_LNG       0x02
+#define TF_HAS_TEMP      0x04
+#define TF_HAS_HUM       0x08
+#define TF_HAS_ACCEL     0x10
+#define TF_HAS_LIGHT     0x20
+#define TF_HAS_ALL       0x3F
+
+#define TF_ALERT_TAMPER  1
+#define TF_ALERT_SHOCK   2
+
+#define TF_FLAG_TAMPER   0x01
+#define TF_FLAG_SHOCK    0x02
+#define TF_FLAG_MOVING   0x04
+#define TF_FLAG_MASK     0x07
+#define TF_SATS_SHIFT    3
+#define TF_SATS_MAX      31
+
+#define TF_INVALID_I16   INT16_MIN
+#define TF_INVALID_U16   0xFFFF
+
+struct TelemetryFrame {
+  uint8_t  vehicle;
+  uint8_t  flags;        // TF_FLAG_*
+  uint8_t  sats;         // clamped to TF_SATS_MAX on the wire
+  uint32_t ts_ms;
+  int32_t  lat_e7;
+  int32_t  lng_e7;
+  int16_t  temp_dc;      // deci-°C
+  uint16_t hum_dp;       // deci-percent
+  uint16_t accel_mg;
+  uint16_t light;
+};
+
+struct TelemetryAlert {
+  uint8_t  vehicle;
+  uint8_t  type;         // TF_ALERT_*
+  uint32_t ts_ms;
+  uint16_t value;
+  int32_t  lat_e7;
+  int32_t  lng_e7;
+};
+
+// Batch builder: encodes incrementally so the caller knows when it is full
+struct TelemetryBatch {
+  uint8_t  buf[TELEMETRY_BATCH_MAX_SIZE];
+  size_t   len;          // encoded bytes so far (0 = empty)
+  uint8_t  count;
+  TelemetryFrame last;   // previous sample, delta base
+};
+
+// Gateway side: the last readings of one vehicle by AEAD epoch/seq. A delta
+// frame is built on the reading sealed before it, and a backlog replay
+// arrives after newer live frames, so the base is looked up by seq instead
+// of taking whatever arrived last. Evicted in arrival order, so the base of
+// a replay (the replay before it) is still there.
+struct TelemetryDeltaHistory {
+  TelemetryFrame f[TELEMETRY_DELTA_HISTORY];
+  uint32_t seq[TELEMETRY_DELTA_HISTORY];
+  uint16_t epoch[TELEMETRY_DELTA_HISTORY];
+  uint8_t  used;         // entries filled
+  uint8_t  next;         // entry overwritten next (oldest arrival)
+};
+
+// Per-field deadbands, in wire units. A field is resent once it moves by
+// more than its deadband from the value last sent, or flips to/from "no data".
+struct TelemetryDeadband {
+  int32_t  pos_e7;
+  uint16_t temp_dc;
+  uint16_t hum_dp;
+  uint16_t accel_mg;
+  uint16_t light;
+};
+
+// Sender side state for send-on-delta
+struct TelemetryDeltaEncoder {
+  TelemetryFrame sent;   // value the gateway holds for each field
+  uint32_t last_full_ms;
+  bool     primed;       // a full reading has been sent
+};
+
+// Scale sensor values (same -999 "no data" convention as SensorData) into a frame
+void telemetry_frame_fill(TelemetryFrame &f, uint8_t vehicle, uint32_t ts_ms,
+                          double lat, double lng, uint32_t sats,
+                          float temp, float hum, float accel_g,
+                          uint16_t light, bool tamper, bool shock, bool moving);
+
+// Encode into out[TELEMETRY_FRAME_SIZE]. Returns bytes written, 0 if cap too small.
+size_t telemetry_frame_encode(const TelemetryFrame &f, uint8_t *out, size_t cap);
+
+// Decode a frame received on the gateway side. Returns false on bad version/type/length.
+bool telemetry_frame_decode(const uint8_t *in, size_t len, TelemetryFrame &f);
+
+// Frame type of an encoded frame (TELEMETRY_FRAME_TYPE_*), 0 if unknown version
+uint8_t telemetry_frame_type(const uint8_t *in, size_t len);
+
+// Alert frame codec. Returns bytes written (0 if cap too small) / false on bad input.
+size_t telemetry_alert_encode(const TelemetryAlert &a, uint8_t *out, size_t cap);
+bool telemetry_alert_decode(const uint8_t *in, size_t len, TelemetryAlert &a);
+
+// Batch codec. add() returns false (batch unchanged) when the sample does
+// not fit or the batch already holds TELEMETRY_BATCH_MAX_SAMPLES.
+void telemetry_batch_reset(TelemetryBatch &b);
+bool telemetry_batch_add(TelemetryBatch &b, const TelemetryFrame &f);
+
+// Unpacks up to max_out samples. Returns the sample count, 0 on a malformed frame.
+size_t telemetry_batch_decode(const uint8_t *in, size_t len, TelemetryFrame *out, size_t max_out);
+
+// Send-on-delta encoder. Writes a full reading when the encoder is not
+// primed or heartbeat_ms has passed since the last one, otherwise a delta
+// frame with the fields outside their deadband. Returns 0 (nothing to
+// send) when no field moved and the flags are unchanged.
+void   telemetry_delta_reset(TelemetryDeltaEncoder &e);
+size_t telemetry_delta_encode(TelemetryDeltaEncoder &e, const TelemetryDeadband &db,
+                              uint32_t heartbeat_ms, const TelemetryFrame &f,
+                              uint8_t *out, size_t cap);
+
+// Gateway side: apply a delta frame to the vehicle's last known reading.
+// Returns false on a malformed frame (state untouched).
+bool telemetry_delta_apply(const uint8_t *in, size_t len, TelemetryFrame &state);
+
+// Remember the full reading sealed as epoch/seq (decoded reading frame, or
+// a delta frame already applied)
+void telemetry_history_reset(TelemetryDeltaHistory &h);
+void telemetry_history_put(TelemetryDeltaHistory &h, uint16_t epoch, uint32_t seq, const TelemetryFrame &f);
+
+// Base for the delta frame sealed as epoch/seq: the newest kept reading of
+// the same epoch with a lower seq. false if there is none (orphan delta).
+// Apply the frame on it with telemetry_delta_apply(), then put() the result.
+bool telemetry_history_base(const TelemetryDeltaHistory &h, uint16_t epoch, uint32_t seq,
+                            TelemetryFrame &base);
+
+// Helpers to turn scaled fields back into engineering units (-999 = no data)
+double telemetry_frame_lat(const TelemetryFrame &f);
+double telemetry_frame_lng(const TelemetryFrame &f);
+float  telemetry_frame_temp(const TelemetryFrame &f);
+float  telemetry_frame_hum(const TelemetryFrame &f);
+float  telemetry_frame_accel(const TelemetryFrame &f);
+
+#endif // TELEMETRY_FRAME_H
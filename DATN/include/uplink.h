@@ -0,0 +1,92 @@
+#ifndef UPLINK_H
+#define UPLINK_H
+
+#include <Arduino.h>
+#include "telemetry_frame.h"
+
+/**
+ * LoRa Uplink - periodic telemetry send task
+ *
+ * Snapshots SensorData, encodes a TelemetryFrame, seals it with AES-CCM
+ * (security.h) and writes one Base64 line to the RA-08H TX bridge on
+ * LORA_SER; the bridge puts the raw sealed packet on air.
+ * Uses the globals defined in main.cpp (or the host harness):
+ *   LORA_SER, ldr, g_send_interval_ms
+ *
+ * Every send happens inside the vehicle's TDMA slot (slot_scheduler.h,
+ * slot = vehicle number - 1), once per superframe for telemetry.
+ *
+ * Tamper/shock alerts bypass the periodic schedule: uplink_raise_alert()
+ * queues a short alert frame and notifies the send task, which transmits
+ * it as soon as the vehicle is inside its own TDMA slot (tamper first).
+ *
+ * With a vehicle batch size K > 1 (VehicleConfig) each period only samples
+ * into a TelemetryBatch; the batch goes out as one frame once it holds K
+ * readings or its oldest reading would exceed the configured max latency.
+ *
+ * Otherwise, with a send-on-delta heartbeat set (VehicleConfig), each
+ * period sends only the fields that left their UPLINK_DEADBAND_* band,
+ * skips the period entirely when nothing moved, and sends a full reading
+ * once per heartbeat.
+ *
+ * Every sealed frame is tracked by the store-and-forward backlog
+ * (backlog.h) until a gateway beacon acks it; the send task reads the
+ * beacon lines the bridge passes back on LORA_SER and replays backlogged
+ * frames in the slot time live traffic leaves free.
+ */
+
+#define UPLINK_ALERT_QUEUE_LEN  8
+#define UPLINK_URGENT_MARK      '!'   // line prefix: the TX bridge queues it ahead of telemetry
+
+// Send-on-delta deadbands, wire units (telemetry_frame.h)
+#define UPLINK_DEADBAND_POS_E7  300   // ~3 m, above parked GPS jitter
+#define UPLINK_DEADBAND_TEMP_DC 5     // 0.5 °C
+#define UPLINK_DEADBAND_HUM_DP  10    // 1 %
+#define UPLINK_DEADBAND_ACCEL   50    // mg
+#define UPLINK_DEADBAND_LIGHT   40    // LDR counts
+
+#define UPLINK_ALERT_TAMPER     TF_ALERT_TAMPER
+#define UPLINK_ALERT_SHOCK      TF_ALERT_SHOCK
+
+struct UplinkAlertStats {
+  uint32_t raised;
+  uint32_t sent;
+  uint32_t coalesced;     // shock alerts merged into one already pending
+  uint32_t dropped;       // queue full
+  uint32_t max_wait_ms;   // worst raise -> send latency
+};
+
+struct UplinkDeltaStats {
+  uint32_t full;          // full readings (first, heartbeat, everything moved)
+  uint32_t delta;         // partial frames
+  uint32_t suppressed;    // periods with nothing to send
+  uint32_t bytes_on_air;  // sealed bytes of the above
+};
+
+// Build, seal and write one telemetry frame. Returns the line length sent (0 on error).
+size_t uplink_send_once();
+
+// Sample into the pending batch and send it once it holds batch_size readings,
+// holding it another interval_ms would exceed max_latency_ms, or another
+// reading might not fit max_frame sealed bytes. Send task only.
+size_t uplink_collect(uint8_t batch_size, uint32_t max_latency_ms, uint32_t interval_ms, size_t max_frame);
+
+// Send-on-delta step: sample, then send a full/delta frame or nothing.
+// Send task only. Returns the line length sent (0 if suppressed).
+size_t uplink_send_on_delta(uint32_t heartbeat_ms);
+
+UplinkDeltaStats uplink_delta_stats();
+
+// Send whatever the batch holds (a single reading goes out as a plain frame)
+size_t uplink_flush_batch();
+
+// Queue an alert (UPLINK_ALERT_*) and wake the send task. Task context only.
+// Returns false if the uplink is not started or the queue is full.
+bool uplink_raise_alert(uint8_t type, uint16_t value);
+
+UplinkAlertStats uplink_alert_stats();
+
+// Helper to start the LoRa send task (implemented in uplink.cpp)
+void startLoraUplink(unsigned long stackSize, UBaseType_t priority);
+
+#endif // UPLINK_H
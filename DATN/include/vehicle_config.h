@@ -1,7 +1,7 @@
 #ifndef VEHICLE_CONFIG_H
 #define VEHICLE_CONFIG_H
 #include <Arduino.h>
-#include <EEPROM.h>
+#include "config_store.h"
 
 /**
  * Vehicle Configuration Module
@@ -9,15 +9,41 @@
  * Cho phép cấu hình unique device_id cho mỗi xe trong đoàn.
  * Device ID có thể được set qua:
  * 1. Compile-time macro (VEHICLE_DEVICE_ID)
- * 2. EEPROM storage
+ * 2. Config store (config_store.h, NVS)
  * 3. Runtime via serial command
+ *
+ * begin() reads the config store once; getters return the cached values
+ * and each setter commits one record, only when the value changed.
+ * The first boot after an update from the EEPROM firmware imports the
+ * old EEPROM layout (boot epoch above all, so AEAD nonces never repeat).
  */
 
+// Uplink aggregation defaults (override per vehicle with build flags or the config store)
+#ifndef VEHICLE_BATCH_SIZE
+#define VEHICLE_BATCH_SIZE        1     // readings per uplink, 1 = no batching
+#endif
+#ifndef VEHICLE_BATCH_LATENCY_S
+#define VEHICLE_BATCH_LATENCY_S   10    // oldest buffered reading is sent within this
+#endif
+#ifndef VEHICLE_DELTA_HEARTBEAT_S
+#define VEHICLE_DELTA_HEARTBEAT_S 0     // send-on-delta full-frame period, 0 = every reading in full
+#endif
+#ifndef VEHICLE_SEND_INTERVAL_MS
+#define VEHICLE_SEND_INTERVAL_MS  2000  // reading period (g_send_interval_ms)
+#endif
+#ifndef VEHICLE_TAMPER_THRESHOLD
+#define VEHICLE_TAMPER_THRESHOLD  600   // LDR level (0-1023) that counts as box open
+#endif
+#define VEHICLE_SLOT_AUTO         0xFF  // TDMA slot = vehicle number - 1
+#define VEHICLE_SLOT_NONE         0xFE  // vehicle number past SLOT_COUNT: no slot
+#define VEHICLE_MAC_KEY_MAX       32
+#define VEHICLE_EPOCH_COMMIT_TRIES 3    // boot epoch commit attempts before the uplink is refused
+
 class VehicleConfig {
 public:
     VehicleConfig();
     
-    // Initialize vehicle config (load from EEPROM or use default)
+    // Initialize vehicle config (load from the config store or use default)
     void begin();
     
     // Get device ID (e.g., "VX-01", "VX-02", ...)
@@ -26,7 +52,7 @@ public:
     // Get vehicle name (e.g., "AMMO-VX-01")
     String buildDeviceString();
     
-    // Set device ID in EEPROM
+    // Set device ID (persisted)
     void setDeviceId(const char* id);
     
     // Set device ID from node_id (numeric) - converts to format like "Transport-123"
@@ -35,22 +61,85 @@ public:
     // Get vehicle number (1-99)
     uint8_t getVehicleNumber();
     
-    // Set vehicle number (stored in EEPROM)
+    // Set vehicle number (persisted)
     void setVehicleNumber(uint8_t num);
     
+    // Vehicle number set on this unit (setVehicleNumber / setDeviceIdFromNodeId,
+    // bound to its eFuse MAC), not the default or a config copied from another
+    // unit. The AEAD nonce is vehicle | epoch | seq under a fleet-wide key, so
+    // two units on the same number would repeat nonces: no sealing without it.
+    bool isProvisioned();
+    
+    // Increment and persist the boot counter (AEAD nonce epoch). Returns 0
+    // if the new value could not be committed, or the counter is used up.
+    uint16_t bumpBootEpoch();
+    
+    // Epoch of this boot (uplink AEAD header, SD log header); the first
+    // call bumps the persisted counter, later calls return the same value.
+    // 0 = no usable epoch: nothing may be sealed this boot.
+    uint16_t getBootEpoch();
+    
+    // Readings per batched uplink frame (1..TELEMETRY_BATCH_MAX_SAMPLES)
+    uint8_t getBatchSize();
+    void setBatchSize(uint8_t k);
+    
+    // Upper bound on how long a reading may wait in the batch
+    uint32_t getBatchMaxLatencyMs();
+    void setBatchMaxLatencyS(uint16_t seconds);
+    
+    // Send-on-delta heartbeat (full reading at least this often), 0 = off
+    uint32_t getDeltaHeartbeatMs();
+    void setDeltaHeartbeatS(uint16_t seconds);
+    
+    // Reading period of the send task (ms)
+    uint32_t getSendIntervalMs();
+    void setSendIntervalMs(uint32_t ms);
+    
+    // LDR tamper threshold (0-1023)
+    uint16_t getTamperThreshold();
+    void setTamperThreshold(uint16_t threshold);
+    
+    // TDMA slot (0..SLOT_COUNT-1); VEHICLE_SLOT_AUTO follows the vehicle number.
+    // VEHICLE_SLOT_NONE when that number is past SLOT_COUNT: the uplink
+    // must not start rather than share another vehicle's slot.
+    uint8_t getSlot();
+    void setSlot(uint8_t slot);
+    
+    // Provisioned uplink keys, NULL when the compiled-in ones are used
+    const uint8_t* getAesKey();
+    const uint8_t* getMacKey(size_t& len);
+    void setKeys(const uint8_t aes_key[16], const uint8_t* mac_key, size_t mac_key_len);
+    
 private:
     char device_id[32];
     uint8_t vehicle_num;
+    bool provisioned;
+    uint16_t boot_epoch;
+    uint8_t batch_size;
+    uint16_t batch_latency_s;
+    uint16_t delta_heartbeat_s;
+    uint32_t send_interval_ms;
+    uint16_t tamper_threshold;
+    uint8_t slot;
+    uint8_t aes_key[16];
+    uint8_t mac_key[VEHICLE_MAC_KEY_MAX];
+    uint8_t mac_key_len;
+    bool has_keys;
     
-    // EEPROM layout
-    static const uint16_t EEPROM_SIZE = 256;
-    static const uint16_t ADDR_DEVICE_ID = 0;      // 32 bytes
-    static const uint16_t ADDR_VEHICLE_NUM = 32;   // 1 byte
-    static const uint16_t ADDR_MAGIC = 33;         // 1 byte magic
-    static const uint8_t MAGIC_BYTE = 0xAA;
+    // Legacy EEPROM layout (firmware before the config store), read once
+    static const uint16_t LEGACY_EEPROM_SIZE = 512;
+    static const uint16_t LEGACY_ADDR_VEHICLE_NUM = 32;   // 1 byte
+    static const uint16_t LEGACY_ADDR_MAGIC = 33;         // 1 byte magic
+    static const uint16_t LEGACY_ADDR_BOOT_EPOCH = 34;    // 2 bytes, little-endian
+    static const uint16_t LEGACY_ADDR_BATCH_SIZE = 36;    // 1 byte
+    static const uint16_t LEGACY_ADDR_BATCH_LATENCY = 37; // 2 bytes, seconds, little-endian
+    static const uint16_t LEGACY_ADDR_DELTA_HEARTBEAT = 39; // 2 bytes, seconds, little-endian
+    static const uint8_t LEGACY_MAGIC_BYTE = 0xAA;
     
-    void loadFromEEPROM();
-    void saveToEEPROM();
+    void importLegacyEEPROM();
+    void loadFromStore();
+    void bindToUnit();
+    void commit();
 };
 
 // Global instance
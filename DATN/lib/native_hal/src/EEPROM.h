@@ -0,0 +1,31 @@
+#ifndef NATIVE_HAL_EEPROM_H
+#define NATIVE_HAL_EEPROM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+// EEPROM stand-in: RAM image, erased to 0xFF like a fresh ESP32 partition
+class EEPROMClass {
+public:
+  bool begin(size_t size) {
+    if (_data.size() < size) _data.resize(size, 0xFF);
+    return true;
+  }
+  uint8_t read(int addr) { return (addr >= 0 && (size_t)addr < _data.size()) ? _data[addr] : 0xFF; }
+  void write(int addr, uint8_t val) { if (addr >= 0 && (size_t)addr < _data.size()) _data[addr] = val; }
+  bool commit() { _commits++; return true; }
+  void end() {}
+  size_t length() const { return _data.size(); }
+
+  // Host harness: number of commit() calls so far
+  uint32_t hostCommitCount() const { return _commits; }
+
+private:
+  std::vector<uint8_t> _data;
+  uint32_t _commits = 0;
+};
+
+extern EEPROMClass EEPROM;
+
+#endif // NATIVE_HAL_EEPROM_H
@@ -0,0 +1,41 @@
+#ifndef NATIVE_HAL_FS_H
+#define NATIVE_HAL_FS_H
+
+#include <dirent.h>
+#include <stdio.h>
+#include <string>
+#include "Print.h"
+
+#define FILE_READ   "r"
+#define FILE_WRITE  "w"
+#define FILE_APPEND "a"
+
+// fs::File stand-in backed by a stdio FILE* (or a DIR* for directories)
+class File : public Print {
+public:
+  File() {}
+  File(FILE *fp, const std::string &path) : _fp(fp), _path(path) {}
+  File(DIR *dir, const std::string &path) : _dir(dir), _path(path) {}
+
+  operator bool() const { return _fp != nullptr || _dir != nullptr; }
+  const char *name() const;           // base name, as core 2.x returns it
+  bool isDirectory() const { return _dir != nullptr; }
+  File openNextFile();
+  using Print::write;
+  size_t write(const uint8_t *buf, size_t len) override;
+  size_t read(uint8_t *buf, size_t len) { return _fp ? fread(buf, 1, len, _fp) : 0; }
+  int read() { return _fp ? fgetc(_fp) : -1; }
+  int available();
+  bool seek(uint32_t pos) { return _fp && fseek(_fp, (long)pos, SEEK_SET) == 0; }
+  size_t position() const { return _fp ? (size_t)ftell(_fp) : 0; }
+  size_t size() const;
+  void flush() { if (_fp) fflush(_fp); }
+  void close();
+
+private:
+  FILE *_fp = nullptr;
+  DIR *_dir = nullptr;
+  std::string _path;                  // path on the card
+};
+
+#endif // NATIVE_HAL_FS_H
@@ -0,0 +1,52 @@
+#ifndef NATIVE_HAL_HARDWARESERIAL_H
+#define NATIVE_HAL_HARDWARESERIAL_H
+
+#include <deque>
+#include <mutex>
+#include <string>
+#include "Print.h"
+
+#define SERIAL_8N1 0x800001c
+
+/**
+ * HardwareSerial stand-in.
+ * UART0 (Serial) goes to stdout. Other ports keep their TX bytes in
+ * memory and read RX bytes injected by the host harness.
+ */
+class HardwareSerial : public Print {
+public:
+  explicit HardwareSerial(int uart_nr) : _uart_nr(uart_nr) {}
+
+  void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1, int8_t txPin = -1) {
+    (void)config; (void)rxPin; (void)txPin;
+    _baud = baud;
+  }
+  void end() {}
+
+  int available();
+  int read();
+  int peek();
+  void flush();
+  using Print::write;
+  size_t write(const uint8_t *buf, size_t len) override;
+
+  // ---- Host harness hooks ----
+  void hostInject(const uint8_t *buf, size_t len);
+  void hostInject(const char *s) { hostInject((const uint8_t *)s, strlen(s)); }
+  std::string hostTakeTx();           // returns and clears captured TX bytes
+  void hostEchoTx(bool on) { _echo = on; }
+  void hostMute(bool on) { _mute = on; }   // drop console output (benchmarks)
+
+private:
+  int _uart_nr;
+  unsigned long _baud = 0;
+  bool _echo = false;
+  bool _mute = false;
+  std::mutex _lock;
+  std::deque<uint8_t> _rx;
+  std::string _tx;
+};
+
+extern HardwareSerial Serial;
+
+#endif // NATIVE_HAL_HARDWARESERIAL_H
@@ -0,0 +1,27 @@
+#ifndef NATIVE_HAL_PREFERENCES_H
+#define NATIVE_HAL_PREFERENCES_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+// Preferences (NVS) stand-in: blobs in a process-wide RAM map keyed by
+// namespace/key; a put replaces the whole value, as on the ESP32
+class Preferences {
+public:
+  bool begin(const char *name, bool readOnly = false, const char *partition_label = NULL);
+  void end();
+
+  size_t getBytesLength(const char *key);
+  size_t getBytes(const char *key, void *buf, size_t maxLen);
+  size_t putBytes(const char *key, const void *value, size_t len);
+  bool remove(const char *key);
+  bool clear();
+
+private:
+  std::string _ns;
+  bool _open = false;
+  bool _readOnly = false;
+};
+
+#endif // NATIVE_HAL_PREFERENCES_H
@@ -0,0 +1,33 @@
+#ifndef NATIVE_HAL_SD_H
+#define NATIVE_HAL_SD_H
+
+#include <stdint.h>
+#include "FS.h"
+#include "SPI.h"
+#include "WString.h"
+
+typedef enum { CARD_NONE, CARD_MMC, CARD_SD, CARD_SDHC, CARD_UNKNOWN } sdcard_type_t;
+
+// SD stand-in: paths are resolved under a host directory (host_set_sd_root)
+class SDFS {
+public:
+  bool begin(uint8_t ssPin = 5, SPIClass &spi = _defaultSpi, uint32_t frequency = 4000000);
+  void end() {}
+  sdcard_type_t cardType() { return CARD_SDHC; }
+  uint64_t cardSize() { return 4ULL * 1024 * 1024 * 1024; }
+
+  File open(const char *path, const char *mode = FILE_READ);
+  File open(const String &path, const char *mode = FILE_READ) { return open(path.c_str(), mode); }
+  bool exists(const char *path);
+  bool exists(const String &path) { return exists(path.c_str()); }
+  bool remove(const char *path);
+  bool rename(const char *from, const char *to);
+  bool mkdir(const char *path);
+
+private:
+  static SPIClass _defaultSpi;
+};
+
+extern SDFS SD;
+
+#endif // NATIVE_HAL_SD_H
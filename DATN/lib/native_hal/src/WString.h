@@ -0,0 +1,59 @@
+#ifndef NATIVE_HAL_WSTRING_H
+#define NATIVE_HAL_WSTRING_H
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string>
+
+// Subset of the Arduino String API, backed by std::string
+class String {
+public:
+  String() {}
+  String(const char *s) : _s(s ? s : "") {}
+  String(const char *s, size_t n) : _s(s, n) {}
+  String(const std::string &s) : _s(s) {}
+  String(char c) : _s(1, c) {}
+  String(int v) : _s(std::to_string(v)) {}
+  String(unsigned int v) : _s(std::to_string(v)) {}
+  String(long v) : _s(std::to_string(v)) {}
+  String(unsigned long v) : _s(std::to_string(v)) {}
+
+  const char *c_str() const { return _s.c_str(); }
+  size_t length() const { return _s.size(); }
+  bool reserve(size_t n) { _s.reserve(n); return true; }
+
+  char operator[](size_t i) const { return i < _s.size() ? _s[i] : 0; }
+  bool operator==(const String &o) const { return _s == o._s; }
+  bool operator!=(const String &o) const { return _s != o._s; }
+
+  String &operator+=(const String &o) { _s += o._s; return *this; }
+  String &operator+=(const char *o) { _s += o; return *this; }
+  String &operator+=(char c) { _s += c; return *this; }
+  friend String operator+(const String &a, const String &b) { return String(a._s + b._s); }
+  friend String operator+(const String &a, const char *b) { return String(a._s + b); }
+  friend String operator+(const char *a, const String &b) { return String(a + b._s); }
+
+  bool startsWith(const String &p) const { return _s.compare(0, p._s.size(), p._s) == 0; }
+  bool endsWith(const String &p) const {
+    return _s.size() >= p._s.size() && _s.compare(_s.size() - p._s.size(), p._s.size(), p._s) == 0;
+  }
+  int indexOf(char c, size_t from = 0) const {
+    size_t i = _s.find(c, from);
+    return i == std::string::npos ? -1 : (int)i;
+  }
+  int indexOf(const String &p, size_t from = 0) const {
+    size_t i = _s.find(p._s, from);
+    return i == std::string::npos ? -1 : (int)i;
+  }
+  String substring(size_t from) const { return from < _s.size() ? String(_s.substr(from)) : String(); }
+  String substring(size_t from, size_t to) const {
+    if (from >= _s.size() || to <= from) return String();
+    return String(_s.substr(from, to - from));
+  }
+  long toInt() const { return strtol(_s.c_str(), nullptr, 10); }
+
+private:
+  std::string _s;
+};
+
+#endif // NATIVE_HAL_WSTRING_H
@@ -0,0 +1,23 @@
+#ifndef NATIVE_HAL_WIRE_H
+#define NATIVE_HAL_WIRE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// I2C stand-in: no device ever ACKs (endTransmission() == 2)
+class TwoWire {
+public:
+  bool begin(int sda = -1, int scl = -1, uint32_t freq = 0) { (void)sda; (void)scl; (void)freq; return true; }
+  void setClock(uint32_t freq) { (void)freq; }
+  void beginTransmission(uint8_t addr) { (void)addr; }
+  uint8_t endTransmission(bool stop = true) { (void)stop; return 2; }
+  size_t write(uint8_t b) { (void)b; return 1; }
+  size_t write(const uint8_t *buf, size_t len) { (void)buf; return len; }
+  uint8_t requestFrom(uint8_t addr, uint8_t len, bool stop = true) { (void)addr; (void)len; (void)stop; return 0; }
+  int available() { return 0; }
+  int read() { return -1; }
+};
+
+extern TwoWire Wire;
+
+#endif // NATIVE_HAL_WIRE_H
@@ -0,0 +1,15 @@
+#ifndef NATIVE_HAL_ESP_SYSTEM_H
+#define NATIVE_HAL_ESP_SYSTEM_H
+
+#include <stdint.h>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+
+uint32_t esp_random(void);
+void esp_restart(void);
+
+// Base MAC of the unit (host: a fixed Espressif-style address)
+esp_err_t esp_efuse_mac_get_default(uint8_t* mac);
+
+#endif // NATIVE_HAL_ESP_SYSTEM_H
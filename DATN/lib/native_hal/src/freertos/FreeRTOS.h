@@ -0,0 +1,19 @@
+#ifndef NATIVE_HAL_FREERTOS_H
+#define NATIVE_HAL_FREERTOS_H
+
+#include <stdint.h>
+
+// FreeRTOS stand-in: 1 tick = 1 ms, tasks are detached std::threads
+typedef uint32_t TickType_t;
+typedef int32_t  BaseType_t;
+typedef uint32_t UBaseType_t;
+
+#define portTICK_PERIOD_MS   1
+#define portMAX_DELAY        0xFFFFFFFFUL
+#define pdMS_TO_TICKS(ms)    ((TickType_t)(ms))
+#define pdTRUE               1
+#define pdFALSE              0
+#define pdPASS               1
+#define pdFAIL               0
+
+#endif // NATIVE_HAL_FREERTOS_H
@@ -0,0 +1,12 @@
+#ifndef NATIVE_HAL_FREERTOS_SEMPHR_H
+#define NATIVE_HAL_FREERTOS_SEMPHR_H
+
+#include "FreeRTOS.h"
+
+typedef struct NativeSemaphore *SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
+
+#endif // NATIVE_HAL_FREERTOS_SEMPHR_H
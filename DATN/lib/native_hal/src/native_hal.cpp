@@ -0,0 +1,454 @@
+// Host implementations behind the native_hal stand-in headers.
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <Preferences.h>
+#include <SD.h>
+#include <Wire.h>
+#include <esp_system.h>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <deque>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ===== Time =====
+static const std::chrono::steady_clock::time_point s_boot = std::chrono::steady_clock::now();
+
+unsigned long millis() {
+  return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - s_boot).count();
+}
+
+unsigned long micros() {
+  return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - s_boot).count();
+}
+
+void delay(uint32_t ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+
+void delayMicroseconds(uint32_t us) { std::this_thread::sleep_for(std::chrono::microseconds(us)); }
+
+// ===== GPIO / ADC =====
+static std::mutex s_pin_lock;
+static std::map<uint8_t, uint16_t> s_analog;
+static std::map<uint8_t, uint8_t> s_digital;
+
+void host_set_analog(uint8_t pin, uint16_t raw) {
+  std::lock_guard<std::mutex> g(s_pin_lock);
+  s_analog[pin] = raw;
+}
+
+void pinMode(uint8_t pin, uint8_t mode) { (void)pin; (void)mode; }
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  std::lock_guard<std::mutex> g(s_pin_lock);
+  s_digital[pin] = val;
+}
+
+int digitalRead(uint8_t pin) {
+  std::lock_guard<std::mutex> g(s_pin_lock);
+  auto it = s_digital.find(pin);
+  return it == s_digital.end() ? LOW : it->second;
+}
+
+uint16_t analogRead(uint8_t pin) {
+  std::lock_guard<std::mutex> g(s_pin_lock);
+  auto it = s_analog.find(pin);
+  return it == s_analog.end() ? 4095 : it->second;
+}
+
+void analogSetWidth(uint8_t bits) { (void)bits; }
+
+uint32_t esp_random(void) {
+  static std::mt19937 rng(0xDA7A);
+  return (uint32_t)rng();
+}
+
+void esp_restart(void) { exit(0); }
+
+esp_err_t esp_efuse_mac_get_default(uint8_t* mac) {
+  static const uint8_t host_mac[6] = { 0x24, 0x0A, 0xC4, 0x00, 0xDA, 0x7A };
+  memcpy(mac, host_mac, sizeof(host_mac));
+  return ESP_OK;
+}
+
+// ===== FreeRTOS =====
+struct NativeTask {
+  std::mutex m;
+  std::condition_variable cv;
+  uint32_t notify = 0;
+};
+
+static thread_local NativeTask *s_current_task = nullptr;
+
+static NativeTask *current_task() {
+  // main() and other non-FreeRTOS threads get a task record on first use
+  if (s_current_task == nullptr) s_current_task = new NativeTask();
+  return s_current_task;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stackDepth,
+                       void *param, UBaseType_t priority, TaskHandle_t *handle) {
+  (void)name; (void)stackDepth; (void)priority;
+  NativeTask *task = new NativeTask();
+  if (handle) *handle = task;
+  std::thread([task, fn, param]() {
+    s_current_task = task;
+    fn(param);
+  }).detach();
+  return pdPASS;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) { return current_task(); }
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  if (task == nullptr) return pdFAIL;
+  {
+    std::lock_guard<std::mutex> g(task->m);
+    task->notify++;
+  }
+  task->cv.notify_one();
+  return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken) {
+  xTaskNotifyGive(task);
+  if (woken) *woken = pdFALSE;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+  NativeTask *task = current_task();
+  std::unique_lock<std::mutex> lk(task->m);
+  auto ready = [task]() { return task->notify > 0; };
+  if (ticks == portMAX_DELAY) {
+    task->cv.wait(lk, ready);
+  } else {
+    task->cv.wait_for(lk, std::chrono::milliseconds(ticks), ready);
+  }
+  uint32_t value = task->notify;
+  if (value > 0) task->notify = clearOnExit ? 0 : value - 1;
+  return value;
+}
+
+struct NativeQueue {
+  std::mutex m;
+  std::condition_variable cv;
+  std::deque<std::vector<uint8_t>> items;
+  UBaseType_t length;
+  UBaseType_t itemSize;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+  NativeQueue *q = new NativeQueue();
+  q->length = length;
+  q->itemSize = itemSize;
+  return q;
+}
+
+static BaseType_t queue_send(QueueHandle_t q, const void *item, TickType_t ticks, bool front) {
+  std::unique_lock<std::mutex> lk(q->m);
+  auto has_room = [q]() { return q->items.size() < q->length; };
+  if (!has_room()) {
+    if (ticks == 0) return pdFALSE;
+    if (!q->cv.wait_for(lk, std::chrono::milliseconds(ticks), has_room)) return pdFALSE;
+  }
+  const uint8_t *p = (const uint8_t *)item;
+  std::vector<uint8_t> v(p, p + q->itemSize);
+  if (front) q->items.push_front(std::move(v));
+  else q->items.push_back(std::move(v));
+  q->cv.notify_all();
+  return pdTRUE;
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t q, const void *item, TickType_t ticks) {
+  return queue_send(q, item, ticks, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t q, const void *item, TickType_t ticks) {
+  return queue_send(q, item, ticks, true);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t ticks) {
+  std::unique_lock<std::mutex> lk(q->m);
+  auto has_item = [q]() { return !q->items.empty(); };
+  if (!has_item()) {
+    if (ticks == 0) return pdFALSE;
+    if (ticks == portMAX_DELAY) q->cv.wait(lk, has_item);
+    else if (!q->cv.wait_for(lk, std::chrono::milliseconds(ticks), has_item)) return pdFALSE;
+  }
+  memcpy(item, q->items.front().data(), q->itemSize);
+  q->items.pop_front();
+  q->cv.notify_all();
+  return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q) {
+  std::lock_guard<std::mutex> g(q->m);
+  return (UBaseType_t)q->items.size();
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stackDepth,
+                                   void *param, UBaseType_t priority, TaskHandle_t *handle,
+                                   BaseType_t core) {
+  (void)core;
+  return xTaskCreate(fn, name, stackDepth, param, priority, handle);
+}
+
+void vTaskDelay(TickType_t ticks) { delay(ticks); }
+
+TickType_t xTaskGetTickCount(void) { return (TickType_t)millis(); }
+
+void vTaskDelayUntil(TickType_t *prevWake, TickType_t period) {
+  *prevWake += period;
+  int32_t wait = (int32_t)(*prevWake - xTaskGetTickCount());
+  if (wait > 0) delay((uint32_t)wait);
+}
+
+struct NativeSemaphore {
+  std::timed_mutex m;
+};
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) { return new NativeSemaphore(); }
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks) {
+  if (sem == nullptr) return pdFALSE;
+  if (ticks == portMAX_DELAY) {
+    sem->m.lock();
+    return pdTRUE;
+  }
+  return sem->m.try_lock_for(std::chrono::milliseconds(ticks)) ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+  if (sem == nullptr) return pdFALSE;
+  sem->m.unlock();
+  return pdTRUE;
+}
+
+// ===== Serial =====
+HardwareSerial Serial(0);
+
+int HardwareSerial::available() {
+  std::lock_guard<std::mutex> g(_lock);
+  return (int)_rx.size();
+}
+
+int HardwareSerial::read() {
+  std::lock_guard<std::mutex> g(_lock);
+  if (_rx.empty()) return -1;
+  uint8_t c = _rx.front();
+  _rx.pop_front();
+  return c;
+}
+
+int HardwareSerial::peek() {
+  std::lock_guard<std::mutex> g(_lock);
+  return _rx.empty() ? -1 : _rx.front();
+}
+
+void HardwareSerial::flush() {
+  if (_uart_nr == 0) fflush(stdout);
+}
+
+size_t HardwareSerial::write(const uint8_t *buf, size_t len) {
+  if (_uart_nr == 0) return _mute ? len : fwrite(buf, 1, len, stdout);
+
+  std::lock_guard<std::mutex> g(_lock);
+  _tx.append((const char *)buf, len);
+  if (_echo) fwrite(buf, 1, len, stdout);
+  return len;
+}
+
+void HardwareSerial::hostInject(const uint8_t *buf, size_t len) {
+  std::lock_guard<std::mutex> g(_lock);
+  _rx.insert(_rx.end(), buf, buf + len);
+}
+
+std::string HardwareSerial::hostTakeTx() {
+  std::lock_guard<std::mutex> g(_lock);
+  std::string out;
+  out.swap(_tx);
+  return out;
+}
+
+// ===== Wire / EEPROM =====
+TwoWire Wire;
+EEPROMClass EEPROM;
+
+// ===== Preferences (NVS) =====
+static std::mutex s_nvs_lock;
+static std::map<std::string, std::vector<uint8_t>> s_nvs;
+static std::atomic<bool> s_nvs_tear{false};
+static std::atomic<uint32_t> s_nvs_fail{0};
+
+void host_nvs_tear_next_write() { s_nvs_tear = true; }
+void host_nvs_fail_next_writes(uint32_t n) { s_nvs_fail = n; }
+
+bool Preferences::begin(const char *name, bool readOnly, const char *partition_label) {
+  (void)partition_label;
+  _ns = name;
+  _open = true;
+  _readOnly = readOnly;
+  return true;
+}
+
+void Preferences::end() { _open = false; }
+
+size_t Preferences::getBytesLength(const char *key) {
+  std::lock_guard<std::mutex> g(s_nvs_lock);
+  auto it = s_nvs.find(_ns + "/" + key);
+  return (_open && it != s_nvs.end()) ? it->second.size() : 0;
+}
+
+size_t Preferences::getBytes(const char *key, void *buf, size_t maxLen) {
+  std::lock_guard<std::mutex> g(s_nvs_lock);
+  auto it = s_nvs.find(_ns + "/" + key);
+  if (!_open || it == s_nvs.end() || it->second.size() > maxLen) return 0;
+  memcpy(buf, it->second.data(), it->second.size());
+  return it->second.size();
+}
+
+size_t Preferences::putBytes(const char *key, const void *value, size_t len) {
+  if (!_open || _readOnly) return 0;
+  std::lock_guard<std::mutex> g(s_nvs_lock);
+  uint32_t fail = s_nvs_fail.load();
+  if (fail > 0) {
+    s_nvs_fail = fail - 1;
+    return 0;
+  }
+  std::vector<uint8_t> &v = s_nvs[_ns + "/" + key];
+  v.assign((const uint8_t *)value, (const uint8_t *)value + len);
+  if (s_nvs_tear.exchange(false)) {
+    // Power cut mid-write: the tail never made it and the caller never hears
+    // back. Real NVS would keep the old value; this is the worse case.
+    v.resize(len / 2);
+  }
+  return len;
+}
+
+bool Preferences::remove(const char *key) {
+  if (!_open || _readOnly) return false;
+  std::lock_guard<std::mutex> g(s_nvs_lock);
+  return s_nvs.erase(_ns + "/" + key) > 0;
+}
+
+bool Preferences::clear() {
+  if (!_open || _readOnly) return false;
+  std::lock_guard<std::mutex> g(s_nvs_lock);
+  std::string prefix = _ns + "/";
+  for (auto it = s_nvs.begin(); it != s_nvs.end();) {
+    if (it->first.compare(0, prefix.size(), prefix) == 0) it = s_nvs.erase(it);
+    else ++it;
+  }
+  return true;
+}
+
+// ===== SD =====
+SDFS SD;
+SPIClass SDFS::_defaultSpi;
+static std::string s_sd_root = "./sd_card";
+
+static std::atomic<uint32_t> s_sd_stall_ms{0};
+static std::atomic<uint32_t> s_sd_stall_every{0};
+static std::atomic<uint32_t> s_sd_writes{0};
+
+void host_set_sd_root(const char *path) { s_sd_root = path; }
+
+void host_set_sd_stall(uint32_t ms, uint32_t every_n) {
+  s_sd_stall_ms = ms;
+  s_sd_stall_every = every_n;
+}
+
+static std::string sd_path(const char *path) {
+  std::string p = s_sd_root;
+  if (path[0] != '/') p += '/';
+  return p + path;
+}
+
+bool SDFS::begin(uint8_t ssPin, SPIClass &spi, uint32_t frequency) {
+  (void)ssPin; (void)spi; (void)frequency;
+  ::mkdir(s_sd_root.c_str(), 0755);
+  return true;
+}
+
+File SDFS::open(const char *path, const char *mode) {
+  std::string host = sd_path(path);
+  struct stat st;
+  if (strcmp(mode, FILE_READ) == 0 && stat(host.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+    DIR *dir = opendir(host.c_str());
+    return dir ? File(dir, path) : File();
+  }
+
+  const char *m = mode;
+  if (strcmp(mode, FILE_READ) == 0) m = "rb";
+  else if (strcmp(mode, FILE_WRITE) == 0) m = "wb+";
+  else if (strcmp(mode, FILE_APPEND) == 0) m = "ab+";
+  FILE *fp = fopen(host.c_str(), m);
+  return fp ? File(fp, path) : File();
+}
+
+bool SDFS::exists(const char *path) {
+  struct stat st;
+  return stat(sd_path(path).c_str(), &st) == 0;
+}
+
+bool SDFS::remove(const char *path) { return ::remove(sd_path(path).c_str()) == 0; }
+
+bool SDFS::rename(const char *from, const char *to) {
+  return ::rename(sd_path(from).c_str(), sd_path(to).c_str()) == 0;
+}
+
+bool SDFS::mkdir(const char *path) { return ::mkdir(sd_path(path).c_str(), 0755) == 0; }
+
+size_t File::write(const uint8_t *buf, size_t len) {
+  if (!_fp) return 0;
+  uint32_t every = s_sd_stall_every;
+  if (every > 0 && ++s_sd_writes % every == 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(s_sd_stall_ms.load()));
+  }
+  return fwrite(buf, 1, len, _fp);
+}
+
+const char *File::name() const {
+  size_t slash = _path.rfind('/');
+  return (slash == std::string::npos) ? _path.c_str() : _path.c_str() + slash + 1;
+}
+
+File File::openNextFile() {
+  if (!_dir) return File();
+  for (struct dirent *e = readdir(_dir); e; e = readdir(_dir)) {
+    if (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0) continue;
+    std::string path = _path;
+    if (path.empty() || path.back() != '/') path += '/';
+    path += e->d_name;
+    return SD.open(path.c_str(), FILE_READ);
+  }
+  return File();
+}
+
+void File::close() {
+  if (_fp) { fclose(_fp); _fp = nullptr; }
+  if (_dir) { closedir(_dir); _dir = nullptr; }
+}
+
+size_t File::size() const {
+  if (!_fp) return 0;
+  struct stat st;
+  if (fstat(fileno(_fp), &st) != 0) return 0;
+  return (size_t)st.st_size;
+}
+
+int File::available() {
+  if (!_fp) return 0;
+  return (int)(size() - position());
+}
@@ -0,0 +1,26 @@
+#ifndef NATIVE_HAL_H
+#define NATIVE_HAL_H
+
+#include <stdint.h>
+
+// ---- Host harness hooks (not part of the Arduino API) ----
+
+// Value returned by analogRead(pin) (12-bit raw, default 4095 = dark LDR)
+void host_set_analog(uint8_t pin, uint16_t raw);
+
+// Directory that backs the SD stand-in (default "./sd_card")
+void host_set_sd_root(const char *path);
+
+// Make every n-th File::write() on the SD stand-in sleep ms first, to mimic
+// a card doing wear levelling / garbage collection (0 turns it off)
+void host_set_sd_stall(uint32_t ms, uint32_t every_n);
+
+// Cut the next Preferences::putBytes() short, as a reset in the middle of
+// an NVS write would (only half the value is kept, success is reported)
+void host_nvs_tear_next_write();
+
+// Make the next n Preferences::putBytes() calls fail (return 0, old value
+// kept), as a full or worn-out NVS partition would
+void host_nvs_fail_next_writes(uint32_t n);
+
+#endif // NATIVE_HAL_H
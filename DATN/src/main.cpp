@@ -2,7 +2,6 @@
 #include "security.h"
 
 #include <Wire.h>
-#include <TinyGPSPlus.h>
 #include <esp_system.h>   // For chip ID functions
 
 #include "gps.h"
@@ -11,6 +10,9 @@
 #include "ldr.h"
 #include "vehicle_config.h"
 #include "sensor_Data.h"
+#include "uplink.h"
+#include "slot_scheduler.h"
+#include "backlog.h"
 
 // ===== Pins / Config =====
 #define DHTPIN    14
@@ -35,87 +37,63 @@ LDRModule ldr(LDR_PIN);
 
 HardwareSerial LORA_SER(1); 
 
-volatile uint32_t g_send_interval_ms = 2000; 
+volatile uint32_t g_send_interval_ms = VEHICLE_SEND_INTERVAL_MS;
 volatile bool g_tamper_alert = false;        
 
-#define FORCE_NODE_ID 1  // Set to 1 for Transport-1, 2 for Transport-2, etc. | 0 = auto-increment from EEPROM
+// Per-unit build flag: -DFORCE_NODE_ID=<n> provisions this unit as Transport-n.
+// 0 keeps the number already provisioned on this unit. There is no shared
+// default: the number is part of every AEAD nonce under the fleet key.
+#ifndef FORCE_NODE_ID
+#define FORCE_NODE_ID 0
+#endif
 
 void detectOrGenerateNodeId(HardwareSerial &lora_uart) {
   (void)lora_uart; 
   
-  if (FORCE_NODE_ID > 0 && FORCE_NODE_ID <= 100) {
+  if (FORCE_NODE_ID > 0 && FORCE_NODE_ID <= 99) {
     Serial.printf("[SYNC] FORCE_NODE_ID enabled - Using Transport-%d (override mode)\r\n", FORCE_NODE_ID);
     gVehicleConfig.setDeviceIdFromNodeId(FORCE_NODE_ID);
     return;
   }
   
-  Serial.println("[SYNC] Auto-assigning node_id from EEPROM counter...");
-  
-  const uint8_t MAGIC_BYTE = 0xAA;
-  uint8_t magic = EEPROM.read(1);
-  
-  if (magic != MAGIC_BYTE) {
-    Serial.println("[SYNC] Old EEPROM detected - resetting counter to 0");
-    EEPROM.write(0, 0);
-    EEPROM.write(1, MAGIC_BYTE);
-    EEPROM.commit();
-  }
-  
-  uint8_t counter = EEPROM.read(0);
-  
-  if (counter == 0 || counter == 0xFF) {
-    counter = 1;
-  }
-  
-  uint8_t node_id = counter;
-  
-  // Increment counter for next device
-  counter++;
-  if (counter > 100) counter = 1;  // Wrap around after 100
-  
-  // Save incremented counter for next device
-  EEPROM.write(0, counter);
-  EEPROM.write(1, MAGIC_BYTE);  // Keep magic byte
-  EEPROM.commit();
-  
-  Serial.printf("[SYNC] Assigned node_id = %u (Transport-%u)\r\n", node_id, node_id);
-  Serial.printf("[SYNC] Next device will get node_id = %u\r\n", counter);
-  
-  gVehicleConfig.setDeviceIdFromNodeId(node_id);
-}
-
-static uint32_t getVehicleLoraSendDelayMs() {
-  uint8_t veh_num = gVehicleConfig.getVehicleNumber();
-  const uint32_t slot_ms = 250;
-  static const uint8_t slot_order[8] = { 0, 4, 2, 6, 1, 5, 3, 7 };
-
-  if (veh_num == 0) {
-    return 0;
+  // A counter in the unit's own store handed #1 to every fresh unit, which
+  // repeats nonces across the fleet; an unprovisioned unit stays silent
+  if (gVehicleConfig.isProvisioned()) {
+    Serial.printf("[SYNC] Using provisioned vehicle #%u\r\n", gVehicleConfig.getVehicleNumber());
+  } else {
+    Serial.println("[SYNC] *** ERROR: no vehicle number provisioned on this unit, uplink will NOT start. "
+                   "Flash it once with -DFORCE_NODE_ID=<n> ***");
   }
-
-  uint8_t slot_index = (veh_num - 1) % 8;
-  return slot_order[slot_index] * slot_ms;
 }
 
 // --- FreeRTOS Task: GPS Reader ---
+// Sleeps on the GPS UART event queue and wakes once per NMEA sentence;
+// one fix per receiver epoch (GPS_RATE_HZ) comes out of gps.read()
 void TaskGPS(void *pvParameters) {
-  TickType_t xLastWakeTime = xTaskGetTickCount();
-  const TickType_t xPeriod = pdMS_TO_TICKS(100);
-
   for (;;) {
-    gps.read();
+    GpsFix fix;
+    if (!gps.read(fix, 2000)) continue;
+
+    if (fix.valid) {
+      GpsSample sample;
+      sample.lat = fix.lat;
+      sample.lng = fix.lng;
+      sample.sats = fix.sats;
+      sample.speed = fix.speed_kmh;
+      sample.utc_ms = fix.utc_ms;
+      sensor_data_publish_gps(sample);
+    }
 
-    if (gps.updated()) {
-      if (xSemaphoreTake(sensorDataMutex, pdMS_TO_TICKS(10)) == pdTRUE) {
-        sensorData.lat = gps.latitude();
-        sensorData.lng = gps.longitude();
-        sensorData.sats = gps.satellites();
-        sensorData.speed = gps.gpsObject().speed.kmph();
-        xSemaphoreGive(sensorDataMutex);
+    // Feed UTC to the TDMA scheduler: the PPS edge marks the second exactly,
+    // otherwise back-date the epoch's first sentence by its typical latency
+    if (fix.utc_ms != 0) {
+      uint32_t pps_ms;
+      if (gps.lastPps(pps_ms) && (uint32_t)(fix.rx_ms - pps_ms) < 1000) {
+        gSlotScheduler.syncUtc(fix.utc_ms - (fix.utc_ms % 1000), pps_ms, true);
+      } else {
+        gSlotScheduler.syncUtc(fix.utc_ms, fix.rx_ms - GPS_NMEA_LATENCY_MS, false);
       }
     }
-
-    vTaskDelayUntil(&xLastWakeTime, xPeriod);
   }
 }
 
@@ -131,94 +109,15 @@ void TaskTamperMonitor(void *pvParameters) {
       uint16_t light_level = ldr.getLightLevel();
 
       Serial.println("[TAMPER ALERT] BOX OPENED!");
-    }
-
-    vTaskDelayUntil(&xLastWakeTime, xPeriod);
-  }
-}
-
-void TaskLoraSend(void *pv) {
-  delay(100);
-  while (LORA_SER.available()) LORA_SER.read();
-
-  TickType_t xLastWakeTime = xTaskGetTickCount();
-
-  uint32_t send_delay = getVehicleLoraSendDelayMs();
-  if (send_delay > 0) {
-    Serial.printf("[SYNC] Slot offset: %lums\r\n", (unsigned long)send_delay);
-    vTaskDelay(pdMS_TO_TICKS(send_delay));
-    xLastWakeTime = xTaskGetTickCount();
-  }
-
-  const TickType_t xInterval = pdMS_TO_TICKS(g_send_interval_ms);
-
-  for (;;) {
-    SensorData localData = {}; 
-
-    if (xSemaphoreTake(sensorDataMutex, pdMS_TO_TICKS(10)) == pdTRUE) {
-      localData = sensorData;   // snapshot toàn bộ struct
-      xSemaphoreGive(sensorDataMutex);
-    }
-
-    // extract ra biến local
-    float temp = localData.temp;
-    float hum = localData.hum;
-    float accel_g = localData.accel;
-    double lat = localData.lat;
-    double lng = localData.lng;
-    uint32_t sats = localData.sats;
-
-    if (isnan(temp) || temp < -100 || temp > 150) {
-      Serial.println("[DHT11-ERROR] Sensor read failed (no valid data)");
-      temp = -999.0f;
-    }
-    if (isnan(hum) || hum < 0 || hum > 100) {
-      hum = -999.0f;
-    }
-    if (accel_g < -900.0f) {
-        Serial.println("[ADXL345-ERROR] Sensor data unavailable");
-        accel_g = -999.0f;
-    }
-
-    // read tamper/light status
-    uint16_t light_level = ldr.readSmoothed();
-    bool is_tamper = ldr.getTamperState();
-
-    uint32_t ts = millis();
-    char payload[320];
-    int n = snprintf(payload, sizeof(payload),
-      "{\"v\":\"%s\",\"ts\":%lu,\"t\":%.1f,\"h\":%.1f,\"a\":%.2f,\"l\":%u,\"x\":%d,\"la\":%.5f,\"lo\":%.5f}",
-      gVehicleConfig.getDeviceId(),
-      (unsigned long)ts,
-      isnan(temp) ? -999.0F : temp,
-      isnan(hum) ? -999.0F : hum,
-      (accel_g < -900.0f) ? -999.0F : accel_g,
-      light_level,
-      is_tamper ? 1 : 0,
-      lat,
-      lng
-    );
-
-    if (n > 0) {
-      String jsonPayload(payload);
-      String signature = hmacSha256(jsonPayload);
-      String signedJson = jsonPayload;
-      if (signedJson.endsWith("}")) {
-        signedJson = signedJson.substring(0, signedJson.length() - 1);
+      if (!uplink_raise_alert(UPLINK_ALERT_TAMPER, light_level)) {
+        Serial.println("[TAMPER ALERT] Alert queue full - reported in next frame");
       }
-      signedJson += ",\"sig\":\"" + signature + "\"}";
-
-      String securePayload = encryptDataToAESBase64(signedJson);
-      LORA_SER.println(securePayload); 
-      LORA_SER.flush();
-      Serial.print("[ESP32->LORA] AES-128 CBC + BASE64 payload sent (len: ");
-      Serial.print(securePayload.length());
-      Serial.println(")");
-    } else {
-      Serial.printf("[ERROR] snprintf failed! n=%d\r\n", n);
+    } else if (!tamper && g_tamper_alert) {
+      // Box closed again: re-arm so the next opening raises a new alert
+      g_tamper_alert = false;
     }
 
-    vTaskDelayUntil(&xLastWakeTime, xInterval);
+    vTaskDelayUntil(&xLastWakeTime, xPeriod);
   }
 }
 
@@ -226,28 +125,19 @@ void setup() {
   Serial.begin(115200);
   delay(2000);
   
-  EEPROM.begin(512); 
   Serial.println("[INIT] Initializing modules...");
 
-  sensorDataMutex = xSemaphoreCreateMutex();
-  if (sensorDataMutex == NULL) {
-    Serial.println("[ERROR] Failed to create sensorDataMutex!");
-  }
-
-  if (sensorDataMutex != NULL) {
-    if (xSemaphoreTake(sensorDataMutex, pdMS_TO_TICKS(10)) == pdTRUE) {
-      sensorData.temp = -999.0f;
-      sensorData.hum = -999.0f;
-      sensorData.accel = -999.0f;
-      sensorData.shock_detected = false;
-      sensorData.is_moving = false;
-      xSemaphoreGive(sensorDataMutex);
-    }
-  }
+  sensor_data_init();
 
+  // Single read of the config store; keys and intervals below come from it
   gVehicleConfig.begin();
   Serial.printf("[INIT] Vehicle ID (default): %s\r\n", gVehicleConfig.getDeviceId());
 
+  size_t mac_key_len;
+  const uint8_t* mac_key = gVehicleConfig.getMacKey(mac_key_len);
+  securityBegin(gVehicleConfig.getAesKey(), mac_key, mac_key_len);
+  g_send_interval_ms = gVehicleConfig.getSendIntervalMs();
+
   Wire.begin();
 
   dht.begin();
@@ -256,6 +146,7 @@ void setup() {
   }
   
   Serial.println("[INIT] Starting LoRa UART...");
+  LORA_SER.setRxBufferSize(1024);  // bridge debug output + beacon lines between send-task wakeups
   LORA_SER.begin(LORA_BAUD, SERIAL_8N1, LORA_RX, LORA_TX);
   delay(100);
   while (LORA_SER.available()) LORA_SER.read(); 
@@ -265,17 +156,22 @@ void setup() {
   Serial.printf("[INIT] Final Vehicle ID: %s\r\n", gVehicleConfig.getDeviceId());
   
   ldr.begin();
-  ldr.setTamperThreshold(600);  
-  Serial.println("[INIT] LDR tamper detection initialized (threshold=600)");
+  ldr.setTamperThreshold(gVehicleConfig.getTamperThreshold());
+  Serial.printf("[INIT] LDR tamper detection initialized (threshold=%u)\r\n", gVehicleConfig.getTamperThreshold());
+
 
+  // Unacked frames spill to the spiffs flash partition: this firmware does
+  // not mount the SD card (call sd_init() before this to use /backlog.bin)
+  backlog_begin();
+  startBacklog(4096, 0);
 
+  // Uplink first: its alert queue must exist before tamper/shock producers run
+  startLoraUplink(4096, 1);
   xTaskCreate(TaskTamperMonitor,    "TamperMon",  2048, NULL, 2, NULL);
   startDhtTask(2048, 1);        
   startAdxlTelemetry(4096, 1);  
-  xTaskCreate(TaskLoraSend, "LoraSend", 4096, NULL, 1, NULL);
-  xTaskCreate(TaskGPS, "TaskGPS", 4096, NULL, 1, NULL); // Create GPS task
-
-  gps.begin();
+  gps.begin();   // installs the UART driver + event queue TaskGPS blocks on
+  xTaskCreate(TaskGPS, "TaskGPS", 4096, NULL, 2, NULL); // high enough to stamp sentences on arrival
   
   Serial.printf("\r\n[INIT] All systems initialized\r\n");
   Serial.printf("[INIT] Starting patrol mode...\r\n");
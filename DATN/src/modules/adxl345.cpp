@@ -1,6 +1,7 @@
 #include "adxl345.h"
 #include "vehicle_config.h"
 #include "sensor_Data.h"
+#include "uplink.h"
 #include <math.h>
 
 extern VehicleConfig gVehicleConfig;
@@ -11,6 +12,24 @@ static const uint8_t DEVICE_ADDRESS = 0x53; // ALT ADDRESS = GND
 static const uint8_t REG_DATA_FORMAT = 0x31;
 static const uint8_t REG_POWER_CTRL  = 0x2D;
 static const uint8_t REG_INT_ENABLE  = 0x2E;
+static const uint8_t REG_DEVID       = 0x00;
+static const uint8_t REG_THRESH_TAP  = 0x1D;
+static const uint8_t REG_DUR         = 0x21;
+static const uint8_t REG_LATENT      = 0x22;
+static const uint8_t REG_WINDOW      = 0x23;
+static const uint8_t REG_THRESH_ACT  = 0x24;
+static const uint8_t REG_THRESH_INACT = 0x25;
+static const uint8_t REG_TIME_INACT  = 0x26;
+static const uint8_t REG_ACT_INACT_CTL = 0x27;
+static const uint8_t REG_TAP_AXES    = 0x2A;
+static const uint8_t REG_BW_RATE     = 0x2C;
+static const uint8_t REG_INT_MAP     = 0x2F;
+static const uint8_t REG_INT_SOURCE  = 0x30;
+static const uint8_t REG_FIFO_CTL    = 0x38;
+static const uint8_t REG_FIFO_STATUS = 0x39;
+
+static const uint8_t DEVID_ADXL345   = 0xE5;
+static const uint8_t FIFO_MODE_STREAM = 0x80;
 
 static const uint8_t REG_DATAX0 = 0x32;
 static const uint8_t REG_DATAX1 = 0x33;
@@ -30,16 +49,17 @@ static void writeRegister(uint8_t device, uint8_t reg, uint8_t val) {
   Wire.endTransmission();
 }
 
-static void readRegister(uint8_t device, uint8_t startReg, uint8_t numBytes, uint8_t *outValues) {
+static bool readRegister(uint8_t device, uint8_t startReg, uint8_t numBytes, uint8_t *outValues) {
   Wire.beginTransmission(device);
   Wire.write(startReg);
-  Wire.endTransmission();
+  if (Wire.endTransmission() != 0) return false;
 
   uint8_t received = Wire.requestFrom(device, numBytes);
   uint8_t i = 0;
   while (Wire.available() && i < received && i < numBytes) {
     outValues[i++] = Wire.read();
   }
+  return i == numBytes;
 }
 
 // Đọc 6 byte và ghép thành x,y,z (signed 16-bit, little endian)
@@ -67,7 +87,7 @@ bool ADXLModule::begin() {
   writeRegister(DEVICE_ADDRESS, REG_DATA_FORMAT, 0x0B); // FULL_RES=1, Range=±16g
   writeRegister(DEVICE_ADDRESS, REG_POWER_CTRL,  0x08); // Measure=1
   delay(100);  // Critical: wait for sensor to boot
-  writeRegister(DEVICE_ADDRESS, REG_INT_ENABLE,  0x80); // Data Ready int (optional)
+  // Interrupts are set up by beginFifoStream()/beginEvents() once INT1 is wired
   return true;
 }
 
@@ -107,11 +127,150 @@ void ADXLModule::getRawLSB(int16_t &x_lsb, int16_t &y_lsb, int16_t &z_lsb) {
   z_lsb = z;
 }
 
+bool ADXLModule::beginFifoStream(uint16_t rate_hz, uint8_t watermark) {
+  uint8_t devid = 0;
+  if (!readRegister(DEVICE_ADDRESS, REG_DEVID, 1, &devid) || devid != DEVID_ADXL345) {
+    return false;
+  }
+  if (watermark < 1) watermark = 1;
+  if (watermark > 31) watermark = 31;
+
+  // 31-entry bursts at 400-800 Hz x 6 bytes per entry need fast-mode I2C
+  Wire.setClock(400000);
+
+  writeRegister(DEVICE_ADDRESS, REG_POWER_CTRL,  0x00);                  // Standby while configuring
+  writeRegister(DEVICE_ADDRESS, REG_DATA_FORMAT, 0x0B);                  // FULL_RES=1, Range=±16g, INT active high
+  writeRegister(DEVICE_ADDRESS, REG_BW_RATE, rate_hz >= 800 ? 0x0D : 0x0C); // 800 Hz / 400 Hz
+  writeRegister(DEVICE_ADDRESS, REG_FIFO_CTL, 0x00);                     // Bypass: flush old entries
+  writeRegister(DEVICE_ADDRESS, REG_FIFO_CTL, FIFO_MODE_STREAM | watermark);
+  writeRegister(DEVICE_ADDRESS, REG_INT_MAP, 0x00);                      // All interrupts -> INT1
+  int_enable = ADXL_INT_WATERMARK;
+  writeRegister(DEVICE_ADDRESS, REG_INT_ENABLE, int_enable);
+  writeRegister(DEVICE_ADDRESS, REG_POWER_CTRL,  0x08);                  // Measure=1
+  return true;
+}
+
+// THRESH_TAP / THRESH_ACT / THRESH_INACT scale: 62.5 mg/LSB
+static uint8_t g_to_thresh(float g) {
+  float lsb = g / 0.0625f + 0.5f;
+  if (lsb < 1) return 1;
+  if (lsb > 255) return 255;
+  return (uint8_t)lsb;
+}
+
+bool ADXLModule::beginEvents(float shock_g, float motion_g, uint8_t inactivity_s) {
+  uint8_t devid = 0;
+  if (!readRegister(DEVICE_ADDRESS, REG_DEVID, 1, &devid) || devid != DEVID_ADXL345) {
+    return false;
+  }
+
+  // Single tap = shock: any spike over shock_g shorter than DUR (max 159 ms).
+  // Tap compares raw axis values, so gravity on Z adds up to 1 g.
+  writeRegister(DEVICE_ADDRESS, REG_THRESH_TAP, g_to_thresh(shock_g));
+  writeRegister(DEVICE_ADDRESS, REG_DUR, 0xFF);        // 625 us/LSB
+  writeRegister(DEVICE_ADDRESS, REG_LATENT, 0x00);     // no double tap
+  writeRegister(DEVICE_ADDRESS, REG_WINDOW, 0x00);
+  writeRegister(DEVICE_ADDRESS, REG_TAP_AXES, 0x07);   // X, Y, Z
+
+  // Activity/inactivity, AC-coupled on all axes (gravity removed in hardware)
+  writeRegister(DEVICE_ADDRESS, REG_THRESH_ACT, g_to_thresh(motion_g));
+  writeRegister(DEVICE_ADDRESS, REG_THRESH_INACT, g_to_thresh(motion_g));
+  writeRegister(DEVICE_ADDRESS, REG_TIME_INACT, inactivity_s);   // 1 s/LSB
+  writeRegister(DEVICE_ADDRESS, REG_ACT_INACT_CTL, 0xFF);
+
+  int_enable |= ADXL_INT_SINGLE_TAP | ADXL_INT_ACTIVITY | ADXL_INT_INACTIVITY;
+  writeRegister(DEVICE_ADDRESS, REG_INT_MAP, 0x00);                      // All interrupts -> INT1
+  writeRegister(DEVICE_ADDRESS, REG_INT_ENABLE, int_enable);
+  return true;
+}
+
+uint8_t ADXLModule::readIntSource() {
+  uint8_t src = 0;
+  if (!readRegister(DEVICE_ADDRESS, REG_INT_SOURCE, 1, &src)) return 0;
+  return src;
+}
+
+void ADXLModule::setWatermarkInt(bool on) {
+  uint8_t next = on ? (int_enable | ADXL_INT_WATERMARK) : (int_enable & ~ADXL_INT_WATERMARK);
+  if (next == int_enable) return;
+  int_enable = next;
+  writeRegister(DEVICE_ADDRESS, REG_INT_ENABLE, int_enable);
+}
+
+uint8_t ADXLModule::fifoEntries() {
+  uint8_t status = 0;
+  if (!readRegister(DEVICE_ADDRESS, REG_FIFO_STATUS, 1, &status)) return 0;
+  return status & 0x3F;
+}
+
+uint8_t ADXLModule::readFifo(float (*xyz)[3], uint8_t max) {
+  uint8_t n = fifoEntries();
+  if (n > max) n = max;
+
+  // Each 6-byte read of DATAX0..DATAZ1 pops one FIFO entry
+  for (uint8_t i = 0; i < n; i++) {
+    uint8_t buf[6];
+    if (!readRegister(DEVICE_ADDRESS, REG_DATAX0, 6, buf)) return i;
+    xyz[i][0] = (int16_t)((int16_t)buf[1] << 8 | buf[0]) * G_PER_LSB;
+    xyz[i][1] = (int16_t)((int16_t)buf[3] << 8 | buf[2]) * G_PER_LSB;
+    xyz[i][2] = (int16_t)((int16_t)buf[5] << 8 | buf[4]) * G_PER_LSB;
+  }
+  return n;
+}
+
 static const float SHOCK_G_THRESHOLD = 2.5f;
 static const float MOTION_G_THRESHOLD = 0.15f;
 
+// Gravity estimate time constant; matches the original alpha=0.9 at 20 Hz
+static const float GRAVITY_TAU_S = 0.45f;
+
+// Remove static gravity using HIGH-PASS FILTER
+struct MotionFilter {
+  float gx, gy, gz;
+  float alpha;
+
+  void setRate(float rate_hz) {
+    float dt = 1.0f / rate_hz;
+    alpha = GRAVITY_TAU_S / (GRAVITY_TAU_S + dt);
+  }
+
+  // Returns dynamic acceleration magnitude in g
+  float update(float ax, float ay, float az) {
+    // Ước lượng gravity (low-pass filter)
+    gx = alpha * gx + (1 - alpha) * ax;
+    gy = alpha * gy + (1 - alpha) * ay;
+    gz = alpha * gz + (1 - alpha) * az;
+
+    // Loại bỏ gravity component
+    float dx = ax - gx;
+    float dy = ay - gy;
+    float dz = az - gz;
+
+    // Gia tốc động thực sự (high-pass filtered)
+    return sqrtf(dx*dx + dy*dy + dz*dz);
+  }
+};
+
+// Shock events published with the motion group (single writer: the ADXL task)
+struct ShockLog {
+  uint32_t count;
+  uint32_t ts_ms;
+  float peak_g;
+
+  void record(uint32_t ts, float peak) {
+    count++;
+    ts_ms = ts;
+    peak_g = peak;
+    uplink_raise_alert(UPLINK_ALERT_SHOCK, (uint16_t)fminf(peak * 1000.0f, 65534.0f));
+  }
+};
+
 void TaskADXLData(void *pvParameters) {
   (void)pvParameters;
+  MotionFilter filter = { 0, 0, 0, 0.9f };
+  ShockLog log = { 0, 0, 0.0f };
+  bool was_shock = false;
+
   for (;;) {
     float ax = 0.0f, ay = 0.0f, az = 0.0f;
     bool ok = adxl.read(ax, ay, az);
@@ -120,37 +279,124 @@ void TaskADXLData(void *pvParameters) {
     bool moving = false;
 
     if (ok) {
-      // Remove static gravity using HIGH-PASS FILTER
-      static float gx = 0, gy = 0, gz = 0;
-      const float alpha = 0.9f;
-
-      // Ước lượng gravity (low-pass filter)
-      gx = alpha * gx + (1 - alpha) * ax;
-      gy = alpha * gy + (1 - alpha) * ay;
-      gz = alpha * gz + (1 - alpha) * az;
-
-      // Loại bỏ gravity component
-      float dx = ax - gx;
-      float dy = ay - gy;
-      float dz = az - gz;
-
-      // Gia tốc động thực sự (high-pass filtered)
-      dynamic_g = sqrtf(dx*dx + dy*dy + dz*dz);
+      dynamic_g = filter.update(ax, ay, az);
       shock = (dynamic_g >= SHOCK_G_THRESHOLD);
       moving = (dynamic_g >= MOTION_G_THRESHOLD);
     }
 
-    if (xSemaphoreTake(sensorDataMutex, pdMS_TO_TICKS(10)) == pdTRUE) {
-      sensorData.accel = dynamic_g;
-      sensorData.shock_detected = shock;
-      sensorData.is_moving = moving;
-      xSemaphoreGive(sensorDataMutex);
-    }
+    if (shock && !was_shock) log.record(millis(), dynamic_g);
+    was_shock = shock;
+
+    sensor_data_publish_motion(MotionSample{ dynamic_g, shock, moving, log.count, log.ts_ms, log.peak_g });
 
     vTaskDelay(pdMS_TO_TICKS(50));
   }
 }
 
+// ---------- FIFO stream mode + INT1 events ----------
+static TaskHandle_t s_fifoTask = NULL;
+static volatile uint32_t s_int1_ms = 0;   // time of the latest INT1 edge
+
+static void IRAM_ATTR adxlInt1Isr() {
+  s_int1_ms = millis();
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(s_fifoTask, &woken);
+  if (woken) portYIELD_FROM_ISR();
+}
+
+void TaskADXLFifo(void *pvParameters) {
+  (void)pvParameters;
+  MotionFilter filter = { 0, 0, 0, 0 };
+  filter.setRate(ADXL_FIFO_RATE_HZ);
+
+  // Fallback poll for a missed INT1 edge: one watermark period plus 10 ms
+  // of ISR/scheduling slack. After a missed edge INT1 stays high and never
+  // edges again, so this poll is all that drains the FIFO, and it has to
+  // come about when the 32 entries fill (80 ms at 400 Hz, watermark 31):
+  // a longer wait drops that many more samples. A poll that beats a merely
+  // late edge only costs one early, shorter drain.
+  const TickType_t xTimeout = pdMS_TO_TICKS(1000 * ADXL_FIFO_WATERMARK / ADXL_FIFO_RATE_HZ + 10);
+  // Parked: only TAP/ACTIVITY wake the task, plus a 1 s health check
+  const TickType_t xIdleTimeout = pdMS_TO_TICKS(1000);
+  static float samples[32][3];
+
+  ShockLog log = { 0, 0, 0.0f };
+  bool moving = true;
+  bool was_shock = false;
+
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, moving ? xTimeout : xIdleTimeout);
+
+    // Reading INT_SOURCE clears the tap/activity latches so INT1 can fall
+    uint8_t src = adxl.readIntSource();
+    if (src & ADXL_INT_ACTIVITY) {
+      moving = true;
+      adxl.setWatermarkInt(true);
+    }
+    if (src & ADXL_INT_INACTIVITY) {
+      moving = false;
+      adxl.setWatermarkInt(false);
+    }
+
+    float peak_g = 0.0f;
+    uint16_t total = 0;
+    uint8_t n;
+
+    // INT1 stays high while entries >= watermark, so drain until empty
+    // or the next edge could be missed.
+    while ((n = adxl.readFifo(samples, 32)) > 0) {
+      for (uint8_t i = 0; i < n; i++) {
+        float dynamic_g = filter.update(samples[i][0], samples[i][1], samples[i][2]);
+        if (dynamic_g > peak_g) peak_g = dynamic_g;
+      }
+      total += n;
+      if (total >= 64) break;   // don't starve other tasks if the bus is saturated
+    }
+
+    if (total == 0) {
+      // Timed out with nothing in the FIFO: sensor gone or not sampling
+      if (adxl.fifoEntries() == 0 && digitalRead(ADXL_INT1_PIN) == LOW) {
+        sensor_data_publish_motion(MotionSample{ -999.0f, false, false, log.count, log.ts_ms, log.peak_g });
+      }
+      continue;
+    }
+
+    // The FIFO holds the 32 samples around the tap, so the batch peak is
+    // the shock magnitude. The INT1 timestamp is exact when parked and
+    // within one watermark period while streaming (INT1 is shared).
+    // One impact spans several batches: count and alert on the rising
+    // edge only, as the polling task does.
+    bool tapped = (src & ADXL_INT_SINGLE_TAP) != 0;
+    bool shock = tapped || peak_g >= SHOCK_G_THRESHOLD;
+    if (shock && !was_shock) log.record(tapped ? s_int1_ms : millis(), peak_g);
+    was_shock = shock;
+
+    // Publish the batch peak so short spikes between uplinks are not averaged away
+    sensor_data_publish_motion(MotionSample{
+      peak_g,
+      shock,
+      moving || peak_g >= MOTION_G_THRESHOLD,
+      log.count,
+      log.ts_ms,
+      log.peak_g
+    });
+  }
+}
+
 void startAdxlTelemetry(unsigned long stackSize, UBaseType_t priority) {
+#if ADXL_USE_FIFO_STREAM
+  if (adxl.beginFifoStream(ADXL_FIFO_RATE_HZ, ADXL_FIFO_WATERMARK)) {
+    adxl.beginEvents(SHOCK_G_THRESHOLD, MOTION_G_THRESHOLD, ADXL_INACTIVITY_S);
+    // One notch above the other sensor tasks so the FIFO is drained before it wraps
+    xTaskCreate(TaskADXLFifo, "ADXL FIFO", stackSize, NULL, priority + 1, &s_fifoTask);
+    pinMode(ADXL_INT1_PIN, INPUT);
+    attachInterrupt(digitalPinToInterrupt(ADXL_INT1_PIN), adxlInt1Isr, RISING);
+    xTaskNotifyGive(s_fifoTask);   // drain anything queued before the ISR was attached
+    Serial.printf("[ADXL] FIFO stream mode: %d Hz, watermark %d, tap/activity events, INT1=GPIO%d\r\n",
+                  ADXL_FIFO_RATE_HZ, ADXL_FIFO_WATERMARK, ADXL_INT1_PIN);
+    return;
+  }
+  Serial.println("[ADXL] FIFO stream mode unavailable, falling back to 50 ms polling");
+#endif
   xTaskCreate(TaskADXLData, "ADXL Data", stackSize, NULL, priority, NULL);
 }
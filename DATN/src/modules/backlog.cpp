@@ -0,0 +1,453 @@
+#include "backlog.h"
+#include "local_memory.h"
+#include "sd_log_format.h"
+#include <atomic>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+#include "esp_partition.h"
+#define BACKLOG_FLASH_SECTOR 4096   // erase unit of the SPI flash
+#endif
+
+struct BacklogFrame {
+  uint8_t len;
+  uint8_t tries;
+  uint8_t pkt[FRAME_MAX_SEALED];
+};
+
+struct InflightFrame {
+  bool used;
+  uint8_t vehicle;
+  uint16_t epoch;
+  uint32_t seq;
+  uint32_t sent_ms;
+  BacklogFrame f;
+};
+
+static void put_u32(uint8_t* p, uint32_t v) {
+  p[0] = (uint8_t)(v >> 0);
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t get_u32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// ===== Storage: fixed slots on the card or in a flash partition =====
+
+class BacklogStore {
+public:
+  virtual ~BacklogStore() {}
+  virtual const char* name() const = 0;
+  virtual uint32_t slots() const = 0;
+  virtual uint32_t slotsPerErase() const { return 1; }   // slots wiped together before reuse
+  virtual bool read(uint32_t slot, uint32_t off, uint8_t* buf, size_t n) = 0;
+  virtual bool write(uint32_t slot, uint32_t off, const uint8_t* buf, size_t n) = 0;
+  virtual bool erase(uint32_t first_slot) { (void)first_slot; return true; }
+};
+
+class SdBacklogStore : public BacklogStore {
+public:
+  bool open() {
+    if (!SD.exists(BACKLOG_SD_PATH)) {
+      // Preallocate once so slots never move and writes never grow the file
+      File f = SD.open(BACKLOG_SD_PATH, FILE_WRITE);
+      if (!f) return false;
+      uint8_t blank[BACKLOG_SLOT_SIZE];
+      memset(blank, 0xFF, sizeof(blank));
+      for (uint32_t i = 0; i < BACKLOG_SD_SLOTS; i++) {
+        if (f.write(blank, sizeof(blank)) != sizeof(blank)) {
+          f.close();
+          SD.remove(BACKLOG_SD_PATH);
+          return false;
+        }
+      }
+      f.close();
+    }
+    _file = SD.open(BACKLOG_SD_PATH, "r+");
+    return (bool)_file;
+  }
+
+  const char* name() const override { return "SD " BACKLOG_SD_PATH; }
+  uint32_t slots() const override { return BACKLOG_SD_SLOTS; }
+
+  bool read(uint32_t slot, uint32_t off, uint8_t* buf, size_t n) override {
+    return _file.seek(slot * BACKLOG_SLOT_SIZE + off) && _file.read(buf, n) == n;
+  }
+
+  bool write(uint32_t slot, uint32_t off, const uint8_t* buf, size_t n) override {
+    if (!_file.seek(slot * BACKLOG_SLOT_SIZE + off) || _file.write(buf, n) != n) return false;
+    _file.flush();
+    return true;
+  }
+
+private:
+  File _file;
+};
+
+#ifdef ESP_PLATFORM
+class FlashBacklogStore : public BacklogStore {
+public:
+  bool open() {
+    _part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_SPIFFS, NULL);
+    if (_part == NULL) return false;
+    _slots = (_part->size / BACKLOG_FLASH_SECTOR) * (BACKLOG_FLASH_SECTOR / BACKLOG_SLOT_SIZE);
+    return _slots > 0;
+  }
+
+  const char* name() const override { return "flash partition"; }
+  uint32_t slots() const override { return _slots; }
+  uint32_t slotsPerErase() const override { return BACKLOG_FLASH_SECTOR / BACKLOG_SLOT_SIZE; }
+
+  bool read(uint32_t slot, uint32_t off, uint8_t* buf, size_t n) override {
+    return esp_partition_read(_part, slot * BACKLOG_SLOT_SIZE + off, buf, n) == ESP_OK;
+  }
+
+  bool write(uint32_t slot, uint32_t off, const uint8_t* buf, size_t n) override {
+    return esp_partition_write(_part, slot * BACKLOG_SLOT_SIZE + off, buf, n) == ESP_OK;
+  }
+
+  bool erase(uint32_t first_slot) override {
+    return esp_partition_erase_range(_part, first_slot * BACKLOG_SLOT_SIZE, BACKLOG_FLASH_SECTOR) == ESP_OK;
+  }
+
+private:
+  const esp_partition_t* _part = NULL;
+  uint32_t _slots = 0;
+};
+#endif
+
+static SdBacklogStore s_sdStore;
+#ifdef ESP_PLATFORM
+static FlashBacklogStore s_flashStore;
+#endif
+static BacklogStore* s_store = NULL;
+
+// Ring state, backlog task only
+static uint32_t s_head = 0;        // next slot to write
+static uint32_t s_tail = 0;        // oldest slot that may still be pending
+static uint32_t s_nextId = 1;
+
+static QueueHandle_t s_spillQueue = NULL;
+static QueueHandle_t s_readyQueue = NULL;
+
+// Send task only
+static InflightFrame s_inflight[BACKLOG_INFLIGHT];
+static BacklogFrame s_held;        // peeked replay, len 0 = none
+static uint32_t s_lastReplayMs = 0;
+static uint32_t s_ackTimeoutMs = 3 * BACKLOG_BEACON_MS;
+static uint32_t s_linkTimeoutMs = BACKLOG_BEACON_MS * 5 / 2;
+static bool s_begun = false;
+
+static std::atomic<uint32_t> s_lastBeaconMs(0);
+static std::atomic<bool> s_beaconSeen(false);
+
+static std::atomic<uint32_t> s_tracked(0), s_acked(0), s_spilled(0), s_spillDropped(0),
+                             s_stored(0), s_pending(0), s_overwritten(0), s_replayed(0),
+                             s_expired(0), s_storeErrors(0), s_beacons(0);
+
+static bool slot_pending(uint32_t slot) {
+  uint8_t hdr[3];
+  if (!s_store->read(slot, 0, hdr, sizeof(hdr))) return false;
+  return (hdr[0] | (hdr[1] << 8)) == BACKLOG_SLOT_MAGIC && hdr[2] == 0xFF;
+}
+
+// Rebuild head/tail/pending from the slot headers (boot, backlog task)
+static void ring_scan() {
+  uint32_t n = s_store->slots();
+  uint32_t maxId = 0, minPendingId = UINT32_MAX, pending = 0;
+  s_head = 0;
+  s_tail = 0;
+
+  for (uint32_t i = 0; i < n; i++) {
+    uint8_t hdr[BACKLOG_SLOT_HDR_SIZE];
+    if (!s_store->read(i, 0, hdr, sizeof(hdr))) {
+      s_storeErrors++;
+      continue;
+    }
+    if ((hdr[0] | (hdr[1] << 8)) != BACKLOG_SLOT_MAGIC) continue;
+
+    uint32_t id = get_u32(&hdr[8]);
+    if (id >= maxId) {
+      maxId = id;
+      s_head = (i + 1) % n;
+    }
+    if (hdr[2] == 0xFF) {
+      pending++;
+      if (id < minPendingId) {
+        minPendingId = id;
+        s_tail = i;
+      }
+    }
+  }
+  s_nextId = maxId + 1;
+  if (pending == 0) s_tail = s_head;
+  s_pending = pending;
+}
+
+static void ring_push(const BacklogFrame& f) {
+  uint32_t n = s_store->slots();
+  uint32_t per = s_store->slotsPerErase();
+
+  if (s_head % per == 0) {
+    // Reusing this erase unit: whatever is still pending in it is lost
+    for (uint32_t k = 0; k < per; k++) {
+      if (slot_pending(s_head + k)) {
+        s_pending--;
+        s_overwritten++;
+      }
+    }
+    if (!s_store->erase(s_head)) s_storeErrors++;
+    if (s_tail - s_head < per) s_tail = (s_head + per) % n;
+  }
+  if (s_pending == 0) s_tail = s_head;
+
+  uint8_t slot[BACKLOG_SLOT_SIZE];
+  memset(slot, 0xFF, BACKLOG_SLOT_HDR_SIZE);
+  slot[0] = (uint8_t)(BACKLOG_SLOT_MAGIC & 0xFF);
+  slot[1] = (uint8_t)(BACKLOG_SLOT_MAGIC >> 8);
+  put_u32(&slot[8], s_nextId++);
+  slot[12] = f.len;
+  slot[13] = f.tries;
+  memcpy(&slot[BACKLOG_SLOT_HDR_SIZE], f.pkt, f.len);
+  put_u32(&slot[4], sdlog_crc32(&slot[8], BACKLOG_SLOT_HDR_SIZE - 8 + f.len));
+
+  if (s_store->write(s_head, 0, slot, BACKLOG_SLOT_HDR_SIZE + f.len)) {
+    s_stored++;
+    s_pending++;
+  } else {
+    s_storeErrors++;
+  }
+  s_head = (s_head + 1) % n;
+}
+
+// Oldest pending frame, marked replayed on the way out
+static bool ring_pop(BacklogFrame& f) {
+  uint32_t n = s_store->slots();
+  for (uint32_t steps = 0; s_pending > 0 && steps < n; steps++) {
+    uint32_t i = s_tail;
+    s_tail = (s_tail + 1) % n;
+
+    uint8_t slot[BACKLOG_SLOT_SIZE];
+    if (!s_store->read(i, 0, slot, BACKLOG_SLOT_HDR_SIZE)) {
+      s_storeErrors++;
+      continue;
+    }
+    if ((slot[0] | (slot[1] << 8)) != BACKLOG_SLOT_MAGIC || slot[2] != 0xFF) continue;
+
+    static const uint8_t done = 0x00;
+    s_store->write(i, 2, &done, 1);
+    s_pending--;
+
+    uint8_t len = slot[12];
+    if (len < AEAD_OVERHEAD || len > FRAME_MAX_SEALED ||
+        !s_store->read(i, BACKLOG_SLOT_HDR_SIZE, &slot[BACKLOG_SLOT_HDR_SIZE], len) ||
+        get_u32(&slot[4]) != sdlog_crc32(&slot[8], BACKLOG_SLOT_HDR_SIZE - 8 + len)) {
+      s_storeErrors++;
+      continue;
+    }
+    f.len = len;
+    f.tries = slot[13];
+    memcpy(f.pkt, &slot[BACKLOG_SLOT_HDR_SIZE], len);
+    return true;
+  }
+  if (s_pending > 0) s_pending = 0;   // headers disagree with the count, start clean
+  return false;
+}
+
+static void TaskBacklog(void* pv) {
+  (void)pv;
+  ring_scan();
+  Serial.printf("[BACKLOG] %s: %lu slots, %lu pending\r\n", s_store->name(),
+                (unsigned long)s_store->slots(), (unsigned long)s_pending.load());
+
+  for (;;) {
+    BacklogFrame f;
+    if (xQueueReceive(s_spillQueue, &f, pdMS_TO_TICKS(500)) == pdPASS) {
+      ring_push(f);
+    }
+    // Read ahead only while the gateway is reachable
+    while (backlog_link_up(millis()) && s_pending > 0 &&
+           uxQueueMessagesWaiting(s_readyQueue) < BACKLOG_READY_QUEUE_LEN && ring_pop(f)) {
+      xQueueSend(s_readyQueue, &f, 0);
+    }
+  }
+}
+
+bool backlog_begin(uint32_t beacon_ms) {
+  s_ackTimeoutMs = 3 * beacon_ms;
+  s_linkTimeoutMs = beacon_ms * 5 / 2;
+  memset(s_inflight, 0, sizeof(s_inflight));
+  s_held.len = 0;
+  s_begun = true;
+
+  if (sd_ready() && s_sdStore.open()) {
+    s_store = &s_sdStore;
+  }
+#ifdef ESP_PLATFORM
+  else if (s_flashStore.open()) {
+    s_store = &s_flashStore;
+  }
+#endif
+  if (s_store == NULL) {
+    Serial.println("[BACKLOG] No storage, unacked frames are only kept in RAM");
+    return false;
+  }
+
+  if (s_spillQueue == NULL) s_spillQueue = xQueueCreate(BACKLOG_SPILL_QUEUE_LEN, sizeof(BacklogFrame));
+  if (s_readyQueue == NULL) s_readyQueue = xQueueCreate(BACKLOG_READY_QUEUE_LEN, sizeof(BacklogFrame));
+  return true;
+}
+
+void startBacklog(unsigned long stackSize, UBaseType_t priority) {
+  if (s_store == NULL) return;
+  xTaskCreate(TaskBacklog, "Backlog", stackSize, NULL, priority, NULL);
+}
+
+// Hand an unacked frame to the backlog task (or give it up)
+static void spill(InflightFrame& e) {
+  e.used = false;
+  if (e.f.tries >= BACKLOG_MAX_TRIES) {
+    s_expired++;
+    return;
+  }
+  if (s_spillQueue == NULL || xQueueSend(s_spillQueue, &e.f, 0) != pdPASS) {
+    s_spillDropped++;
+    return;
+  }
+  s_spilled++;
+}
+
+static void track(const BacklogFrame& f, uint32_t now_ms) {
+  InflightFrame* slot = NULL;
+  InflightFrame* oldest = NULL;
+  for (InflightFrame& e : s_inflight) {
+    if (!e.used) {
+      slot = &e;
+      break;
+    }
+    if (oldest == NULL || (int32_t)(e.sent_ms - oldest->sent_ms) < 0) oldest = &e;
+  }
+  if (slot == NULL) {
+    // More in flight than the table holds: the oldest goes to storage early
+    spill(*oldest);
+    slot = oldest;
+  }
+
+  slot->used = true;
+  slot->vehicle = f.pkt[0];
+  slot->epoch = (uint16_t)(f.pkt[1] | (f.pkt[2] << 8));
+  slot->seq = get_u32(&f.pkt[3]);
+  slot->sent_ms = now_ms;
+  slot->f = f;
+}
+
+void backlog_track(const uint8_t* pkt, size_t len, uint32_t now_ms) {
+  if (!s_begun || len < AEAD_OVERHEAD || len > FRAME_MAX_SEALED) return;
+  BacklogFrame f;
+  f.len = (uint8_t)len;
+  f.tries = 0;
+  memcpy(f.pkt, pkt, len);
+  track(f, now_ms);
+  s_tracked++;
+}
+
+static void ack(uint8_t vehicle, uint16_t epoch, uint32_t seq) {
+  for (InflightFrame& e : s_inflight) {
+    if (e.used && e.vehicle == vehicle && e.epoch == epoch && e.seq == seq) {
+      e.used = false;
+      s_acked++;
+      return;
+    }
+  }
+}
+
+// "@ACK <vehicle> <epoch> <top> <bits hex> [<epoch>:<seq> ...]"
+static void on_ack(const char* p) {
+  char* end;
+  uint8_t vehicle = (uint8_t)strtoul(p, &end, 10);
+  uint16_t epoch = (uint16_t)strtoul(end, &end, 10);
+  uint32_t top = strtoul(end, &end, 10);
+  uint32_t bits = strtoul(end, &end, 16);
+
+  ack(vehicle, epoch, top);
+  for (uint32_t k = 0; k < 32; k++) {
+    if (bits & (1UL << k)) ack(vehicle, epoch, top - 1 - k);
+  }
+
+  for (;;) {
+    while (*end == ' ') end++;
+    if (*end < '0' || *end > '9') break;
+    uint16_t e = (uint16_t)strtoul(end, &end, 10);
+    if (*end != ':') break;
+    uint32_t s = strtoul(end + 1, &end, 10);
+    ack(vehicle, e, s);
+  }
+}
+
+void backlog_on_line(const char* line, uint32_t now_ms) {
+  if (!s_begun) return;
+  if (strncmp(line, "@BCN", 4) == 0) {
+    s_lastBeaconMs = now_ms;
+    s_beaconSeen = true;
+    s_beacons++;
+  } else if (strncmp(line, "@ACK ", 5) == 0) {
+    on_ack(line + 5);
+  }
+}
+
+void backlog_service(uint32_t now_ms) {
+  if (!s_begun) return;
+  for (InflightFrame& e : s_inflight) {
+    if (e.used && now_ms - e.sent_ms >= s_ackTimeoutMs) spill(e);
+  }
+}
+
+const uint8_t* backlog_peek(uint32_t now_ms, size_t& len) {
+  len = 0;
+  if (!s_begun || s_readyQueue == NULL || !backlog_link_up(now_ms)) return NULL;
+  if (now_ms - s_lastReplayMs < BACKLOG_DRAIN_INTERVAL_MS) return NULL;
+  if (s_held.len == 0 && xQueueReceive(s_readyQueue, &s_held, 0) != pdPASS) return NULL;
+  len = s_held.len;
+  return s_held.pkt;
+}
+
+void backlog_replayed(uint32_t now_ms) {
+  if (s_held.len == 0) return;
+  s_lastReplayMs = now_ms;
+  s_held.tries++;
+  track(s_held, now_ms);
+  s_held.len = 0;
+  s_replayed++;
+}
+
+bool backlog_link_up(uint32_t now_ms) {
+  return s_beaconSeen && now_ms - s_lastBeaconMs < s_linkTimeoutMs;
+}
+
+bool backlog_link_lost(uint32_t now_ms) {
+  return s_beaconSeen && !backlog_link_up(now_ms);
+}
+
+BacklogStats backlog_stats() {
+  BacklogStats st;
+  st.tracked = s_tracked;
+  st.acked = s_acked;
+  st.inflight = 0;
+  for (const InflightFrame& e : s_inflight) {
+    if (e.used) st.inflight++;
+  }
+  st.spilled = s_spilled;
+  st.spill_dropped = s_spillDropped;
+  st.stored = s_stored;
+  st.pending = s_pending;
+  st.overwritten = s_overwritten;
+  st.replayed = s_replayed;
+  st.expired = s_expired;
+  st.store_errors = s_storeErrors;
+  st.beacons = s_beacons;
+  return st;
+}
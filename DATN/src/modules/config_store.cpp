@@ -0,0 +1,250 @@
+#include "config_store.h"
+#include "sd_log_format.h"
+#include <Preferences.h>
+#include <string.h>
+
+ConfigStore gConfigStore;
+
+static Preferences s_prefs;
+static bool s_prefsOpen = false;
+static SemaphoreHandle_t s_lock = NULL;
+
+static const char* const COPY_KEY[2] = { "rec0", "rec1" };
+
+static void put_u16(uint8_t* p, uint16_t v) {
+  p[0] = (uint8_t)(v >> 0);
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t* p, uint32_t v) {
+  p[0] = (uint8_t)(v >> 0);
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+static uint16_t get_u16(const uint8_t* p) {
+  return (uint16_t)p[0] | ((uint16_t)p[1] << 8);
+}
+
+static uint32_t get_u32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Payload length of a stored copy, or -1 if it fails any check
+static int record_check(const uint8_t* rec, size_t size) {
+  if (size < CONFIG_STORE_HDR_SIZE + 4) return -1;
+  if (get_u16(&rec[0]) != CONFIG_STORE_MAGIC || rec[2] != CONFIG_STORE_VERSION) return -1;
+
+  uint16_t len = get_u16(&rec[8]);
+  if (len > CONFIG_STORE_PAYLOAD_MAX || size != (size_t)CONFIG_STORE_HDR_SIZE + len + 4) return -1;
+  if (get_u32(&rec[CONFIG_STORE_HDR_SIZE + len]) != sdlog_crc32(rec, CONFIG_STORE_HDR_SIZE + len)) return -1;
+
+  // Entries must tile the payload exactly
+  uint16_t off = 0;
+  while (off < len) {
+    if (off + 2 > len || off + 2 + rec[CONFIG_STORE_HDR_SIZE + off + 1] > len) return -1;
+    off += 2 + rec[CONFIG_STORE_HDR_SIZE + off + 1];
+  }
+  return len;
+}
+
+ConfigStore::ConfigStore() : _gen(0), _len(0), _dirty(false) {
+  memset(_rec, 0, sizeof(_rec));
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+void ConfigStore::lock() {
+  if (s_lock) xSemaphoreTake(s_lock, portMAX_DELAY);
+}
+
+void ConfigStore::unlock() {
+  if (s_lock) xSemaphoreGive(s_lock);
+}
+
+bool ConfigStore::begin() {
+  if (!s_lock) s_lock = xSemaphoreCreateMutex();
+  lock();
+
+  if (!s_prefsOpen) s_prefsOpen = s_prefs.begin(CONFIG_STORE_NAMESPACE, false);
+
+  // Both copies, the newer generation wins (serial-number compare, so the
+  // counter may wrap)
+  uint8_t copy[CONFIG_STORE_RECORD_MAX];
+  bool found = false;
+  _stats.valid_copies = 0;
+  for (int i = 0; i < 2 && s_prefsOpen; i++) {
+    size_t n = s_prefs.getBytesLength(COPY_KEY[i]);
+    if (n == 0 || n > sizeof(copy) || s_prefs.getBytes(COPY_KEY[i], copy, n) != n) continue;
+
+    int len = record_check(copy, n);
+    if (len < 0) {
+      Serial.printf("[CONFIG] Copy %s failed its check, ignored\r\n", COPY_KEY[i]);
+      continue;
+    }
+    _stats.valid_copies++;
+
+    uint32_t gen = get_u32(&copy[4]);
+    if (!found || (int32_t)(gen - _gen) > 0) {
+      memcpy(_rec, copy, n);
+      _gen = gen;
+      _len = (uint16_t)len;
+      found = true;
+    }
+  }
+
+  if (!found) {
+    _gen = 0;
+    _len = 0;
+  }
+  _dirty = false;
+  _stats.generation = _gen;
+  unlock();
+  return found;
+}
+
+int ConfigStore::find(ConfigKey key) {
+  uint16_t off = 0;
+  while (off + 2 <= _len) {
+    const uint8_t* e = &_rec[CONFIG_STORE_HDR_SIZE + off];
+    if (e[0] == key) return off;
+    off += 2 + e[1];
+  }
+  return -1;
+}
+
+int ConfigStore::get(ConfigKey key, void* out, size_t cap) {
+  lock();
+  int off = find(key);
+  int len = -1;
+  if (off >= 0) {
+    const uint8_t* e = &_rec[CONFIG_STORE_HDR_SIZE + off];
+    len = e[1];
+    memcpy(out, &e[2], (size_t)len < cap ? (size_t)len : cap);
+  }
+  unlock();
+  return len;
+}
+
+bool ConfigStore::getU8(ConfigKey key, uint8_t& v) {
+  return get(key, &v, 1) == 1;
+}
+
+bool ConfigStore::getU16(ConfigKey key, uint16_t& v) {
+  uint8_t b[2];
+  if (get(key, b, sizeof(b)) != sizeof(b)) return false;
+  v = get_u16(b);
+  return true;
+}
+
+bool ConfigStore::getU32(ConfigKey key, uint32_t& v) {
+  uint8_t b[4];
+  if (get(key, b, sizeof(b)) != sizeof(b)) return false;
+  v = get_u32(b);
+  return true;
+}
+
+bool ConfigStore::set(ConfigKey key, const void* data, size_t len) {
+  if (len > 255) return false;
+
+  lock();
+  uint8_t* payload = &_rec[CONFIG_STORE_HDR_SIZE];
+  int off = find(key);
+  if (off >= 0) {
+    uint8_t old = payload[off + 1];
+    if (old == len && memcmp(&payload[off + 2], data, len) == 0) {
+      unlock();
+      return true;   // unchanged: nothing to write
+    }
+    if (_len - (2 + old) + 2 + len > CONFIG_STORE_PAYLOAD_MAX) {
+      unlock();
+      return false;
+    }
+    // Drop the old entry, the new one goes at the end
+    memmove(&payload[off], &payload[off + 2 + old], _len - off - 2 - old);
+    _len -= 2 + old;
+  } else if (_len + 2 + len > CONFIG_STORE_PAYLOAD_MAX) {
+    unlock();
+    return false;
+  }
+
+  payload[_len] = key;
+  payload[_len + 1] = (uint8_t)len;
+  memcpy(&payload[_len + 2], data, len);
+  _len += 2 + len;
+  _dirty = true;
+  unlock();
+  return true;
+}
+
+bool ConfigStore::setU8(ConfigKey key, uint8_t v) {
+  return set(key, &v, 1);
+}
+
+bool ConfigStore::setU16(ConfigKey key, uint16_t v) {
+  uint8_t b[2];
+  put_u16(b, v);
+  return set(key, b, sizeof(b));
+}
+
+bool ConfigStore::setU32(ConfigKey key, uint32_t v) {
+  uint8_t b[4];
+  put_u32(b, v);
+  return set(key, b, sizeof(b));
+}
+
+void ConfigStore::remove(ConfigKey key) {
+  lock();
+  int off = find(key);
+  if (off >= 0) {
+    uint8_t* payload = &_rec[CONFIG_STORE_HDR_SIZE];
+    uint8_t old = payload[off + 1];
+    memmove(&payload[off], &payload[off + 2 + old], _len - off - 2 - old);
+    _len -= 2 + old;
+    _dirty = true;
+  }
+  unlock();
+}
+
+bool ConfigStore::commit() {
+  lock();
+  if (!_dirty) {
+    _stats.skipped++;
+    unlock();
+    return true;
+  }
+  if (!s_prefsOpen) {
+    unlock();
+    return false;
+  }
+
+  // Generation g lives in copy g % 2, so this overwrites the older copy
+  uint32_t gen = _gen + 1;
+  put_u16(&_rec[0], CONFIG_STORE_MAGIC);
+  _rec[2] = CONFIG_STORE_VERSION;
+  _rec[3] = 0;
+  put_u32(&_rec[4], gen);
+  put_u16(&_rec[8], _len);
+  put_u16(&_rec[10], 0);
+  put_u32(&_rec[CONFIG_STORE_HDR_SIZE + _len], sdlog_crc32(_rec, CONFIG_STORE_HDR_SIZE + _len));
+
+  size_t size = CONFIG_STORE_HDR_SIZE + _len + 4;
+  bool ok = s_prefs.putBytes(COPY_KEY[gen & 1], _rec, size) == size;
+  if (ok) {
+    _gen = gen;
+    _dirty = false;
+    _stats.generation = gen;
+    _stats.commits++;
+  }
+  unlock();
+
+  if (!ok) Serial.println("[CONFIG] Commit failed, change kept in RAM only");
+  return ok;
+}
+
+ConfigStoreStats ConfigStore::stats() {
+  lock();
+  ConfigStoreStats s = _stats;
+  unlock();
+  return s;
+}
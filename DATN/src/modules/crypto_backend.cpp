@@ -0,0 +1,458 @@
+#include "crypto_backend.h"
+#include <string.h>
+#include "mbedtls/version.h"
+
+#ifdef ESP_PLATFORM
+#include "sdkconfig.h"
+#endif
+
+// mbedTLS 2.x (ESP-IDF 4.x) only has the *_ret SHA-256 names without warnings
+#if MBEDTLS_VERSION_NUMBER < 0x03000000
+#define sha256_starts(ctx)           mbedtls_sha256_starts_ret((ctx), 0)
+#define sha256_update(ctx, d, n)     mbedtls_sha256_update_ret((ctx), (d), (n))
+#define sha256_finish(ctx, out)      mbedtls_sha256_finish_ret((ctx), (out))
+#else
+#define sha256_starts(ctx)           mbedtls_sha256_starts((ctx), 0)
+#define sha256_update(ctx, d, n)     mbedtls_sha256_update((ctx), (d), (n))
+#define sha256_finish(ctx, out)      mbedtls_sha256_finish((ctx), (out))
+#endif
+
+const char* crypto_backend_name(CryptoBackend b) {
+    if (b == CRYPTO_BACKEND_SW) return "sw";
+    return crypto_backend_hw_accelerated() ? "hw" : "hw(mbedtls-cpu)";
+}
+
+bool crypto_backend_hw_accelerated() {
+#if defined(CONFIG_MBEDTLS_HARDWARE_AES) && defined(CONFIG_MBEDTLS_HARDWARE_SHA)
+    return true;
+#else
+    return false;
+#endif
+}
+
+// ===== SOFTWARE AES-128 (T-table, one table + rotations = 2 KB RAM) =====
+static uint8_t  s_fsb[256];
+static uint8_t  s_rsb[256];
+static uint32_t s_ft[256];
+static uint32_t s_rt[256];
+static uint8_t  s_rcon[10];
+static bool     s_tables_ready = false;
+
+#define ROTL8(x)   (((x) << 8) | ((x) >> 24))
+#define ROTL16(x)  (((x) << 16) | ((x) >> 16))
+#define ROTL24(x)  (((x) << 24) | ((x) >> 8))
+#define XTIME(x)   ((uint8_t)(((x) << 1) ^ (((x) & 0x80) ? 0x1B : 0x00)))
+
+static uint32_t get_le32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void put_le32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+// Built once from GF(2^8) arithmetic instead of carrying constant tables.
+// First call comes from crypto_aes_init() during setup(), before any task runs.
+static void soft_aes_gen_tables() {
+    if (s_tables_ready) return;
+
+    uint8_t pow_t[256];
+    uint8_t log_t[256];
+    uint8_t x = 1;
+    for (int i = 0; i < 256; i++) {
+        pow_t[i] = x;
+        log_t[x] = (uint8_t)i;
+        x ^= XTIME(x);
+    }
+
+    x = 1;
+    for (int i = 0; i < 10; i++) {
+        s_rcon[i] = x;
+        x = XTIME(x);
+    }
+
+    s_fsb[0x00] = 0x63;
+    s_rsb[0x63] = 0x00;
+    for (int i = 1; i < 256; i++) {
+        uint8_t inv = pow_t[255 - log_t[i]];
+        uint8_t y = inv, s = inv;
+        for (int k = 0; k < 4; k++) {
+            y = (uint8_t)((y << 1) | (y >> 7));
+            s ^= y;
+        }
+        s ^= 0x63;
+        s_fsb[i] = s;
+        s_rsb[s] = (uint8_t)i;
+    }
+
+    for (int i = 0; i < 256; i++) {
+        uint8_t f = s_fsb[i];
+        uint8_t f2 = XTIME(f);
+        s_ft[i] = (uint32_t)f2 | ((uint32_t)f << 8) | ((uint32_t)f << 16) | ((uint32_t)(f2 ^ f) << 24);
+
+        uint8_t r = s_rsb[i];
+        uint8_t r2 = XTIME(r), r4 = XTIME(r2), r8 = XTIME(r4);
+        uint8_t m9 = r8 ^ r, mb = r8 ^ r2 ^ r, md = r8 ^ r4 ^ r, me = r8 ^ r4 ^ r2;
+        s_rt[i] = (uint32_t)me | ((uint32_t)m9 << 8) | ((uint32_t)md << 16) | ((uint32_t)mb << 24);
+    }
+
+    s_tables_ready = true;
+}
+
+static uint32_t rt_word(uint32_t w) {
+    return s_rt[s_fsb[w & 0xFF]]
+         ^ ROTL8(s_rt[s_fsb[(w >> 8) & 0xFF]])
+         ^ ROTL16(s_rt[s_fsb[(w >> 16) & 0xFF]])
+         ^ ROTL24(s_rt[s_fsb[w >> 24]]);
+}
+
+static void soft_aes_setkey(uint32_t enc[44], uint32_t dec[44], const uint8_t key[16]) {
+    for (int i = 0; i < 4; i++) enc[i] = get_le32(key + 4 * i);
+
+    uint32_t* rk = enc;
+    for (int i = 0; i < 10; i++, rk += 4) {
+        uint32_t t = rk[3];
+        rk[4] = rk[0] ^ s_rcon[i]
+              ^ ((uint32_t)s_fsb[(t >> 8) & 0xFF])
+              ^ ((uint32_t)s_fsb[(t >> 16) & 0xFF] << 8)
+              ^ ((uint32_t)s_fsb[t >> 24] << 16)
+              ^ ((uint32_t)s_fsb[t & 0xFF] << 24);
+        rk[5] = rk[1] ^ rk[4];
+        rk[6] = rk[2] ^ rk[5];
+        rk[7] = rk[3] ^ rk[6];
+    }
+
+    // Equivalent inverse cipher: reversed round keys, InvMixColumns on the middle ones
+    for (int j = 0; j < 4; j++) dec[j] = enc[40 + j];
+    for (int r = 1; r < 10; r++) {
+        for (int j = 0; j < 4; j++) dec[4 * r + j] = rt_word(enc[40 - 4 * r + j]);
+    }
+    for (int j = 0; j < 4; j++) dec[40 + j] = enc[j];
+}
+
+#define FT(a, b, c, d) \
+    (s_ft[(a) & 0xFF] ^ ROTL8(s_ft[((b) >> 8) & 0xFF]) ^ ROTL16(s_ft[((c) >> 16) & 0xFF]) ^ ROTL24(s_ft[(d) >> 24]))
+#define RT(a, b, c, d) \
+    (s_rt[(a) & 0xFF] ^ ROTL8(s_rt[((b) >> 8) & 0xFF]) ^ ROTL16(s_rt[((c) >> 16) & 0xFF]) ^ ROTL24(s_rt[(d) >> 24]))
+#define FSB(a, b, c, d) \
+    ((uint32_t)s_fsb[(a) & 0xFF] ^ ((uint32_t)s_fsb[((b) >> 8) & 0xFF] << 8) ^ \
+     ((uint32_t)s_fsb[((c) >> 16) & 0xFF] << 16) ^ ((uint32_t)s_fsb[(d) >> 24] << 24))
+#define RSB(a, b, c, d) \
+    ((uint32_t)s_rsb[(a) & 0xFF] ^ ((uint32_t)s_rsb[((b) >> 8) & 0xFF] << 8) ^ \
+     ((uint32_t)s_rsb[((c) >> 16) & 0xFF] << 16) ^ ((uint32_t)s_rsb[(d) >> 24] << 24))
+
+static void soft_aes_encrypt_block(const uint32_t rk[44], const uint8_t in[16], uint8_t out[16]) {
+    uint32_t x0 = get_le32(in)      ^ rk[0];
+    uint32_t x1 = get_le32(in + 4)  ^ rk[1];
+    uint32_t x2 = get_le32(in + 8)  ^ rk[2];
+    uint32_t x3 = get_le32(in + 12) ^ rk[3];
+
+    for (int r = 1; r < 10; r++) {
+        const uint32_t* k = rk + 4 * r;
+        uint32_t y0 = k[0] ^ FT(x0, x1, x2, x3);
+        uint32_t y1 = k[1] ^ FT(x1, x2, x3, x0);
+        uint32_t y2 = k[2] ^ FT(x2, x3, x0, x1);
+        uint32_t y3 = k[3] ^ FT(x3, x0, x1, x2);
+        x0 = y0; x1 = y1; x2 = y2; x3 = y3;
+    }
+
+    put_le32(out,      rk[40] ^ FSB(x0, x1, x2, x3));
+    put_le32(out + 4,  rk[41] ^ FSB(x1, x2, x3, x0));
+    put_le32(out + 8,  rk[42] ^ FSB(x2, x3, x0, x1));
+    put_le32(out + 12, rk[43] ^ FSB(x3, x0, x1, x2));
+}
+
+static void soft_aes_decrypt_block(const uint32_t rk[44], const uint8_t in[16], uint8_t out[16]) {
+    uint32_t x0 = get_le32(in)      ^ rk[0];
+    uint32_t x1 = get_le32(in + 4)  ^ rk[1];
+    uint32_t x2 = get_le32(in + 8)  ^ rk[2];
+    uint32_t x3 = get_le32(in + 12) ^ rk[3];
+
+    for (int r = 1; r < 10; r++) {
+        const uint32_t* k = rk + 4 * r;
+        uint32_t y0 = k[0] ^ RT(x0, x3, x2, x1);
+        uint32_t y1 = k[1] ^ RT(x1, x0, x3, x2);
+        uint32_t y2 = k[2] ^ RT(x2, x1, x0, x3);
+        uint32_t y3 = k[3] ^ RT(x3, x2, x1, x0);
+        x0 = y0; x1 = y1; x2 = y2; x3 = y3;
+    }
+
+    put_le32(out,      rk[40] ^ RSB(x0, x3, x2, x1));
+    put_le32(out + 4,  rk[41] ^ RSB(x1, x0, x3, x2));
+    put_le32(out + 8,  rk[42] ^ RSB(x2, x1, x0, x3));
+    put_le32(out + 12, rk[43] ^ RSB(x3, x2, x1, x0));
+}
+
+// ===== AES dispatch =====
+void crypto_aes_init(CryptoAes& a, CryptoBackend b, const uint8_t key[16]) {
+    a.backend = b;
+    if (b == CRYPTO_BACKEND_SW) {
+        soft_aes_gen_tables();
+        soft_aes_setkey(a.sw_enc, a.sw_dec, key);
+    } else {
+        mbedtls_aes_init(&a.hw_enc);
+        mbedtls_aes_init(&a.hw_dec);
+        mbedtls_aes_setkey_enc(&a.hw_enc, key, 128);
+        mbedtls_aes_setkey_dec(&a.hw_dec, key, 128);
+    }
+}
+
+void crypto_aes_free(CryptoAes& a) {
+    if (a.backend == CRYPTO_BACKEND_HW) {
+        mbedtls_aes_free(&a.hw_enc);
+        mbedtls_aes_free(&a.hw_dec);
+    }
+    memset(a.sw_enc, 0, sizeof(a.sw_enc));
+    memset(a.sw_dec, 0, sizeof(a.sw_dec));
+}
+
+void crypto_aes_cbc_encrypt(CryptoAes& a, uint8_t iv[16], const uint8_t* in, uint8_t* out, size_t len) {
+    if (a.backend == CRYPTO_BACKEND_HW) {
+        mbedtls_aes_crypt_cbc(&a.hw_enc, MBEDTLS_AES_ENCRYPT, len, iv, in, out);
+        return;
+    }
+    for (size_t off = 0; off + 16 <= len; off += 16) {
+        uint8_t blk[16];
+        for (int i = 0; i < 16; i++) blk[i] = in[off + i] ^ iv[i];
+        soft_aes_encrypt_block(a.sw_enc, blk, out + off);
+        memcpy(iv, out + off, 16);
+    }
+}
+
+void crypto_aes_cbc_decrypt(CryptoAes& a, uint8_t iv[16], const uint8_t* in, uint8_t* out, size_t len) {
+    if (a.backend == CRYPTO_BACKEND_HW) {
+        mbedtls_aes_crypt_cbc(&a.hw_dec, MBEDTLS_AES_DECRYPT, len, iv, in, out);
+        return;
+    }
+    for (size_t off = 0; off + 16 <= len; off += 16) {
+        uint8_t saved[16];
+        uint8_t blk[16];
+        memcpy(saved, in + off, 16);
+        soft_aes_decrypt_block(a.sw_dec, saved, blk);
+        for (int i = 0; i < 16; i++) out[off + i] = blk[i] ^ iv[i];
+        memcpy(iv, saved, 16);
+    }
+}
+
+void crypto_aes_ctr(CryptoAes& a, uint8_t counter[16], const uint8_t* in, uint8_t* out, size_t len) {
+    if (a.backend == CRYPTO_BACKEND_HW) {
+        size_t nc_off = 0;
+        uint8_t stream[16];
+        mbedtls_aes_crypt_ctr(&a.hw_enc, len, &nc_off, counter, stream, in, out);
+        return;
+    }
+    for (size_t off = 0; off < len; off += 16) {
+        uint8_t stream[16];
+        soft_aes_encrypt_block(a.sw_enc, counter, stream);
+        for (int i = 15; i >= 0; i--) {
+            if (++counter[i] != 0) break;
+        }
+        size_t n = (len - off < 16) ? len - off : 16;
+        for (size_t i = 0; i < n; i++) out[off + i] = in[off + i] ^ stream[i];
+    }
+}
+
+// ===== SOFTWARE SHA-256 (FIPS 180-4) =====
+static const uint32_t K256[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROTR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void soft_sha256_block(uint32_t h[8], const uint8_t p[64]) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = ((uint32_t)p[4 * i] << 24) | ((uint32_t)p[4 * i + 1] << 16)
+             | ((uint32_t)p[4 * i + 2] << 8) | (uint32_t)p[4 * i + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ROTR32(w[i - 15], 7) ^ ROTR32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ROTR32(w[i - 2], 17) ^ ROTR32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3];
+    uint32_t e = h[4], f = h[5], g = h[6], k = h[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = k + (ROTR32(e, 6) ^ ROTR32(e, 11) ^ ROTR32(e, 25))
+                    + ((e & f) ^ (~e & g)) + K256[i] + w[i];
+        uint32_t t2 = (ROTR32(a, 2) ^ ROTR32(a, 13) ^ ROTR32(a, 22))
+                    + ((a & b) ^ (a & c) ^ (b & c));
+        k = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+    h[4] += e; h[5] += f; h[6] += g; h[7] += k;
+}
+
+static void soft_sha256_starts(CryptoSoftSha256& s) {
+    static const uint32_t iv[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    memcpy(s.h, iv, sizeof(iv));
+    s.total = 0;
+    s.buf_len = 0;
+}
+
+static void soft_sha256_update(CryptoSoftSha256& s, const uint8_t* data, size_t len) {
+    s.total += len;
+    if (s.buf_len > 0) {
+        size_t n = 64 - s.buf_len;
+        if (n > len) n = len;
+        memcpy(s.buf + s.buf_len, data, n);
+        s.buf_len += n;
+        data += n;
+        len -= n;
+        if (s.buf_len < 64) return;
+        soft_sha256_block(s.h, s.buf);
+        s.buf_len = 0;
+    }
+    while (len >= 64) {
+        soft_sha256_block(s.h, data);
+        data += 64;
+        len -= 64;
+    }
+    memcpy(s.buf, data, len);
+    s.buf_len = len;
+}
+
+static void soft_sha256_finish(CryptoSoftSha256& s, uint8_t out[32]) {
+    uint64_t bits = s.total * 8;
+    uint8_t pad[72];
+    size_t pad_len = (s.buf_len < 56) ? 56 - s.buf_len : 120 - s.buf_len;
+    memset(pad, 0, sizeof(pad));
+    pad[0] = 0x80;
+    for (int i = 0; i < 8; i++) pad[pad_len + i] = (uint8_t)(bits >> (56 - 8 * i));
+    soft_sha256_update(s, pad, pad_len + 8);
+
+    for (int i = 0; i < 8; i++) {
+        out[4 * i]     = (uint8_t)(s.h[i] >> 24);
+        out[4 * i + 1] = (uint8_t)(s.h[i] >> 16);
+        out[4 * i + 2] = (uint8_t)(s.h[i] >> 8);
+        out[4 * i + 3] = (uint8_t)s.h[i];
+    }
+}
+
+// ===== SHA-256 dispatch =====
+void crypto_sha256_init(CryptoSha256& s, CryptoBackend b) {
+    s.backend = b;
+    mbedtls_sha256_init(&s.hw);
+    memset(&s.sw, 0, sizeof(s.sw));
+}
+
+void crypto_sha256_free(CryptoSha256& s) {
+    mbedtls_sha256_free(&s.hw);
+}
+
+void crypto_sha256_starts(CryptoSha256& s) {
+    if (s.backend == CRYPTO_BACKEND_HW) sha256_starts(&s.hw);
+    else soft_sha256_starts(s.sw);
+}
+
+void crypto_sha256_update(CryptoSha256& s, const uint8_t* data, size_t len) {
+    if (s.backend == CRYPTO_BACKEND_HW) sha256_update(&s.hw, data, len);
+    else soft_sha256_update(s.sw, data, len);
+}
+
+void crypto_sha256_finish(CryptoSha256& s, uint8_t out[32]) {
+    if (s.backend == CRYPTO_BACKEND_HW) sha256_finish(&s.hw, out);
+    else soft_sha256_finish(s.sw, out);
+}
+
+void crypto_sha256_clone(CryptoSha256& dst, const CryptoSha256& src) {
+    dst.backend = src.backend;
+    if (src.backend == CRYPTO_BACKEND_HW) mbedtls_sha256_clone(&dst.hw, &src.hw);
+    else dst.sw = src.sw;
+}
+
+// ===== HMAC-SHA256 =====
+#define SHA256_BLOCK 64
+
+// Hash one padded key block into dst (software states only: a clone is
+// a plain struct copy there)
+static void prime_hmac_state(CryptoSha256& dst, const uint8_t block[SHA256_BLOCK]) {
+    crypto_sha256_init(dst, CRYPTO_BACKEND_SW);
+    crypto_sha256_starts(dst);
+    crypto_sha256_update(dst, block, SHA256_BLOCK);
+}
+
+void crypto_hmac_init(CryptoHmac& h, CryptoBackend b, const uint8_t* key, size_t key_len) {
+    // RFC 2104: keys longer than a block are hashed first
+    uint8_t hashed[32];
+    if (key_len > SHA256_BLOCK) {
+        CryptoSha256 tmp;
+        crypto_sha256_init(tmp, b);
+        crypto_sha256_starts(tmp);
+        crypto_sha256_update(tmp, key, key_len);
+        crypto_sha256_finish(tmp, hashed);
+        crypto_sha256_free(tmp);
+        key = hashed;
+        key_len = sizeof(hashed);
+    }
+
+    h.backend = b;
+    memset(h.ipad, 0x36, sizeof(h.ipad));
+    memset(h.opad, 0x5C, sizeof(h.opad));
+    for (size_t i = 0; i < key_len; i++) {
+        h.ipad[i] ^= key[i];
+        h.opad[i] ^= key[i];
+    }
+    memset(hashed, 0, sizeof(hashed));
+
+    if (b == CRYPTO_BACKEND_SW) {
+        // The primed states are all the SW path needs
+        prime_hmac_state(h.inner, h.ipad);
+        prime_hmac_state(h.outer, h.opad);
+        memset(h.ipad, 0, sizeof(h.ipad));
+        memset(h.opad, 0, sizeof(h.opad));
+    } else {
+        crypto_sha256_init(h.inner, b);
+        crypto_sha256_init(h.outer, b);
+    }
+}
+
+void crypto_hmac_free(CryptoHmac& h) {
+    crypto_sha256_free(h.inner);
+    crypto_sha256_free(h.outer);
+    memset(&h.inner.sw, 0, sizeof(h.inner.sw));
+    memset(&h.outer.sw, 0, sizeof(h.outer.sw));
+    memset(h.ipad, 0, sizeof(h.ipad));
+    memset(h.opad, 0, sizeof(h.opad));
+}
+
+void crypto_hmac_sha256(const CryptoHmac& h, const uint8_t* data, size_t len, uint8_t out[32]) {
+    CryptoSha256 ctx;
+    uint8_t inner_hash[32];
+
+    crypto_sha256_init(ctx, h.backend);
+    if (h.backend == CRYPTO_BACKEND_HW) {
+        // One extra block per hash, but both stay on the engine
+        crypto_sha256_starts(ctx);
+        crypto_sha256_update(ctx, h.ipad, SHA256_BLOCK);
+        crypto_sha256_update(ctx, data, len);
+        crypto_sha256_finish(ctx, inner_hash);
+
+        crypto_sha256_starts(ctx);
+        crypto_sha256_update(ctx, h.opad, SHA256_BLOCK);
+    } else {
+        crypto_sha256_clone(ctx, h.inner);
+        crypto_sha256_update(ctx, data, len);
+        crypto_sha256_finish(ctx, inner_hash);
+
+        crypto_sha256_clone(ctx, h.outer);
+    }
+    crypto_sha256_update(ctx, inner_hash, sizeof(inner_hash));
+    crypto_sha256_finish(ctx, out);
+    crypto_sha256_free(ctx);
+}
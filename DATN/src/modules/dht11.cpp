@@ -59,13 +59,7 @@ void TaskDHT11(void *pvParameters) {
       h = -999.0f;
     }
 
-    if (xSemaphoreTake(sensorDataMutex, pdMS_TO_TICKS(10)) == pdTRUE) {
-      sensorData.temp = t;
-      sensorData.hum = h;
-      xSemaphoreGive(sensorDataMutex);
-    } else {
-      Serial.println("[DHT11] Failed to lock sensorDataMutex");
-    }
+    sensor_data_publish_env(EnvSample{ t, h });
 
     // Debug output (every 5s)
     if (t != -999.0f && h != -999.0f) {
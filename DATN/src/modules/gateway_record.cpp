@@ -0,0 +1,149 @@
+#include "gateway_record.h"
+#include <string.h>
+
+uint16_t gateway_crc16(const uint8_t *data, size_t len) {
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (int b = 0; b < 8; b++) {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+size_t gateway_cobs_decode(const uint8_t *in, size_t len, uint8_t *out) {
+  size_t i = 0, o = 0;
+  while (i < len) {
+    uint8_t code = in[i++];
+    if (code == 0 || i + code - 1 > len) return 0;
+    for (uint8_t k = 1; k < code; k++) {
+      if (in[i] == 0) return 0;
+      out[o++] = in[i++];
+    }
+    // A short block stands for a zero, except at the very end
+    if (code < 0xFF && i < len) out[o++] = 0;
+  }
+  return o;
+}
+
+static uint16_t get_u16(const uint8_t *p) {
+  return (uint16_t)p[0] | ((uint16_t)p[1] << 8);
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+  return (uint32_t)p[0]
+       | ((uint32_t)p[1] << 8)
+       | ((uint32_t)p[2] << 16)
+       | ((uint32_t)p[3] << 24);
+}
+
+static bool known_type(uint8_t t) {
+  return t == GW_RECORD_PACKET || t == GW_RECORD_RAW;
+}
+
+bool gateway_record_parse(const uint8_t *rec, size_t len, GatewayRecord &out) {
+  if (len < GW_RECORD_HDR_SIZE + 2 || !known_type(rec[0])) return false;
+
+  uint16_t n = get_u16(rec + 13);
+  if (n > GW_RECORD_MAX_PAYLOAD || len != (size_t)GW_RECORD_HDR_SIZE + n + 2) return false;
+  if (gateway_crc16(rec, len - 2) != get_u16(rec + len - 2)) return false;
+
+  out.type = rec[0];
+  out.node = rec[1];
+  out.seq = get_u32(rec + 2);
+  out.ts_ms = get_u32(rec + 6);
+  out.rssi = (int16_t)get_u16(rec + 10);
+  out.snr = (int8_t)rec[12];
+  out.len = n;
+  out.payload = rec + GW_RECORD_HDR_SIZE;
+  return true;
+}
+
+static void put_le(uint8_t *p, uint32_t v, int n) {
+  for (int i = 0; i < n; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+size_t gateway_record_encode(const GatewayRecord &r, uint8_t *out, size_t cap) {
+  if (r.len > GW_RECORD_MAX_PAYLOAD || cap < GW_RECORD_MAX_WIRE) return 0;
+
+  uint8_t rec[GW_RECORD_MAX_SIZE];
+  rec[0] = r.type;
+  rec[1] = r.node;
+  put_le(rec + 2, r.seq, 4);
+  put_le(rec + 6, r.ts_ms, 4);
+  put_le(rec + 10, (uint16_t)r.rssi, 2);
+  rec[12] = (uint8_t)r.snr;
+  put_le(rec + 13, r.len, 2);
+  memcpy(rec + GW_RECORD_HDR_SIZE, r.payload, r.len);
+  size_t n = GW_RECORD_HDR_SIZE + r.len;
+  put_le(rec + n, gateway_crc16(rec, n), 2);
+  n += 2;
+
+  // COBS, same as cobs_encode() in the gateway
+  size_t code_pos = 0, o = 1;
+  uint8_t code = 1;
+  for (size_t i = 0; i < n; i++) {
+    if (rec[i] == 0) {
+      out[code_pos] = code;
+      code_pos = o++;
+      code = 1;
+      continue;
+    }
+    out[o++] = rec[i];
+    if (++code == 0xFF) {
+      out[code_pos] = code;
+      code_pos = o++;
+      code = 1;
+    }
+  }
+  out[code_pos] = code;
+  out[o++] = 0x00;
+  return o;
+}
+
+void GatewayRecordReader::reset() {
+  _len = 0;
+  _overflow = false;
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+bool GatewayRecordReader::push(uint8_t byte, GatewayRecord &out) {
+  if (byte != 0) {
+    if (_len < sizeof(_buf)) {
+      _buf[_len++] = byte;
+    } else {
+      _overflow = true;
+    }
+    return false;
+  }
+
+  // Delimiter: decode in place, then start the next frame
+  size_t len = _len;
+  bool overflow = _overflow;
+  _len = 0;
+  _overflow = false;
+
+  if (overflow) {
+    _stats.overflow++;
+    return false;
+  }
+  if (len == 0) return false;   // back-to-back delimiters
+
+  size_t n = gateway_cobs_decode(_buf, len, _buf);
+  if (n == 0) {
+    _stats.bad_cobs++;
+    return false;
+  }
+  if (n >= GW_RECORD_HDR_SIZE + 2 && known_type(_buf[0]) &&
+      gateway_crc16(_buf, n - 2) != get_u16(_buf + n - 2)) {
+    _stats.bad_crc++;
+    return false;
+  }
+  if (!gateway_record_parse(_buf, n, out)) {
+    _stats.bad_format++;
+    return false;
+  }
+  _stats.records++;
+  return true;
+}
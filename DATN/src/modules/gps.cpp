@@ -1,92 +1,238 @@
 #include "gps.h"
 #include <Arduino.h>
+#include "driver/uart.h"
+
+#define GPS_UART ((uart_port_t)GPS_UART_PORT)
+
+static volatile uint32_t s_ppsMs = 0;
+static volatile bool s_ppsSeen = false;
+
+static void IRAM_ATTR onPps() {
+  s_ppsMs = millis();
+  s_ppsSeen = true;
+}
+
+// UBX frame: sync, class, id, length, payload, 8-bit Fletcher checksum
+static void ubx_send(uint8_t cls, uint8_t id, const uint8_t* payload, uint16_t len) {
+  uint8_t hdr[6] = { 0xB5, 0x62, cls, id, (uint8_t)len, (uint8_t)(len >> 8) };
+  uint8_t ck[2] = { 0, 0 };
+  for (int i = 2; i < 6; i++) {
+    ck[0] += hdr[i];
+    ck[1] += ck[0];
+  }
+  for (uint16_t i = 0; i < len; i++) {
+    ck[0] += payload[i];
+    ck[1] += ck[0];
+  }
+  uart_write_bytes(GPS_UART, (const char*)hdr, sizeof(hdr));
+  if (len) uart_write_bytes(GPS_UART, (const char*)payload, len);
+  uart_write_bytes(GPS_UART, (const char*)ck, sizeof(ck));
+  uart_wait_tx_done(GPS_UART, pdMS_TO_TICKS(100));
+}
+
+// CFG-PRT for UART1 of the receiver: 8N1, UBX+NMEA in, NMEA out only (no
+// UBX ACKs mixed into the sentence stream)
+static void ubx_set_port(uint32_t baud) {
+  uint8_t p[20] = { 0 };
+  p[0] = 1;                                   // portID UART1
+  p[4] = 0xD0; p[5] = 0x08;                   // mode: 8 bit, no parity, 1 stop
+  p[8] = (uint8_t)baud; p[9] = (uint8_t)(baud >> 8);
+  p[10] = (uint8_t)(baud >> 16); p[11] = (uint8_t)(baud >> 24);
+  p[12] = 0x03;                               // inProtoMask: UBX | NMEA
+  p[14] = 0x02;                               // outProtoMask: NMEA
+  ubx_send(0x06, 0x00, p, sizeof(p));
+}
 
 GPSNeo6M::GPSNeo6M(int rxPin, int txPin, long baud)
-  : _rxPin(rxPin), _txPin(txPin), _baud(baud), _serial(2) {}
+  : _rxPin(rxPin), _txPin(txPin), _baud(baud), _events(NULL) {
+  memset(&_last, 0, sizeof(_last));
+  memset(&_stats, 0, sizeof(_stats));
+}
 
 void GPSNeo6M::begin() {
-  _serial.begin(_baud, SERIAL_8N1, _rxPin, _txPin);
-  Serial.println("=== GPS NEO-6M Init ===");
+  uart_config_t cfg;
+  memset(&cfg, 0, sizeof(cfg));
+  cfg.baud_rate = (int)_baud;
+  cfg.data_bits = UART_DATA_8_BITS;
+  cfg.parity = UART_PARITY_DISABLE;
+  cfg.stop_bits = UART_STOP_BITS_1;
+  cfg.flow_ctrl = UART_HW_FLOWCTRL_DISABLE;
+
+  uart_driver_install(GPS_UART, GPS_UART_RX_BUF, 0, GPS_UART_QUEUE_LEN, &_events, 0);
+  uart_param_config(GPS_UART, &cfg);
+  uart_set_pin(GPS_UART, _txPin, _rxPin, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+
+  // One UART_PATTERN_DET event per '\n' (single-character pattern, no idle gap needed)
+  uart_enable_pattern_det_baud_intr(GPS_UART, '\n', 1, 9, 0, 0);
+  uart_pattern_queue_reset(GPS_UART, GPS_UART_QUEUE_LEN);
+
+  configureReceiver();
+
+  if (GPS_PPS_PIN >= 0) {
+    pinMode(GPS_PPS_PIN, INPUT);
+    attachInterrupt(digitalPinToInterrupt(GPS_PPS_PIN), onPps, RISING);
+  }
+  Serial.printf("=== GPS NEO-6M Init (%d Hz, %ld baud) ===\r\n", GPS_RATE_HZ,
+                GPS_FAST_BAUD ? (long)GPS_FAST_BAUD : _baud);
   Serial.println("Waiting for GPS signal...");
 }
 
-void GPSNeo6M::read() {
-  // ⚠️ DEBUG: Set to 1 to see raw NMEA, 0 to disable
-  #define GPS_DEBUG_RAW 0
-  
-  while (_serial.available() > 0) {
-    char c = _serial.read();
-    _gps.encode(c);
-    
-    #if GPS_DEBUG_RAW
-    // Capture raw NMEA output (debug only)
-    static char nmea_buffer[200];
-    static uint16_t nmea_idx = 0;
-    if (c == '\n') {
-      nmea_buffer[nmea_idx] = '\0';
-      Serial.printf("[GPS-RAW] %s", nmea_buffer);
-      nmea_idx = 0;
-    } else if (nmea_idx < sizeof(nmea_buffer) - 1) {
-      nmea_buffer[nmea_idx++] = c;
-    }
-    #endif
+void GPSNeo6M::configureReceiver() {
+  if (GPS_FAST_BAUD && GPS_FAST_BAUD != _baud) {
+    ubx_set_port(GPS_FAST_BAUD);            // receiver on its power-up baud
+    delay(100);
+    uart_set_baudrate(GPS_UART, GPS_FAST_BAUD);
+    ubx_set_port(GPS_FAST_BAUD);            // receiver already on the fast baud (ESP32-only reset)
+    delay(100);
   }
-}
 
-void GPSNeo6M::printLocation() {
-  if (_gps.location.isUpdated()) {
-    Serial.print("Latitude : ");  Serial.println(_gps.location.lat(), 6);
-    Serial.print("Longitude: ");  Serial.println(_gps.location.lng(), 6);
-    Serial.print("Satellites: "); Serial.println(_gps.satellites.value());
-    printTimestamp();
-    Serial.println("-----------------------");
+  // NMEA output: GGA (0x00) and RMC (0x04) every epoch, GLL/GSA/GSV/VTG off
+  static const uint8_t msgs[6][2] = {
+    { 0x00, 1 }, { 0x01, 0 }, { 0x02, 0 }, { 0x03, 0 }, { 0x04, 1 }, { 0x05, 0 },
+  };
+  for (int i = 0; i < 6; i++) {
+    uint8_t p[3] = { 0xF0, msgs[i][0], msgs[i][1] };
+    ubx_send(0x06, 0x01, p, sizeof(p));
   }
+
+  // CFG-RATE: measurement period, 1 measurement per fix, GPS time reference
+  uint16_t period = (uint16_t)(1000 / GPS_RATE_HZ);
+  uint8_t rate[6] = { (uint8_t)period, (uint8_t)(period >> 8), 1, 0, 1, 0 };
+  ubx_send(0x06, 0x08, rate, sizeof(rate));
+
+  // Whatever arrived across the baud switch is not a whole line
+  delay(50);
+  flushInput();
 }
 
-void GPSNeo6M::printTimestamp() {
-	if (_gps.time.isValid() && _gps.date.isValid()) {
-		char buf[32];
-		snprintf(buf, sizeof(buf), "%04d-%02d-%02d %02d:%02d:%02d UTC",
-			_gps.date.year(), _gps.date.month(), _gps.date.day(),
-			_gps.time.hour(), _gps.time.minute(), _gps.time.second());
-		Serial.print("Timestamp : ");
-		Serial.println(buf);
-	} else {
-		Serial.println("Timestamp : (no fix)");
-	}
+void GPSNeo6M::flushInput() {
+  uart_flush_input(GPS_UART);
+  uart_pattern_queue_reset(GPS_UART, GPS_UART_QUEUE_LEN);
+  if (_events) xQueueReset(_events);
 }
 
-bool GPSNeo6M::buildTimestamp(char* buf, size_t n) {
-  if (_gps.time.isValid() && _gps.date.isValid()) {
-    snprintf(buf, n, "%04d-%02d-%02d %02d:%02d:%02d",
-             _gps.date.year(), _gps.date.month(), _gps.date.day(),
-             _gps.time.hour(), _gps.time.minute(), _gps.time.second());
-    return true;
+bool GPSNeo6M::read(GpsFix& fix, uint32_t timeout_ms) {
+  if (_events == NULL) {
+    delay(timeout_ms);
+    return false;
+  }
+
+  uart_event_t ev;
+  while (xQueueReceive(_events, &ev, pdMS_TO_TICKS(timeout_ms)) == pdTRUE) {
+    _stats.events++;
+    switch (ev.type) {
+      case UART_PATTERN_DET: {
+        uint32_t rx_ms = millis();
+        int pos = uart_pattern_pop_pos(GPS_UART);
+        if (pos < 0) {
+          // Pattern positions were lost: the buffer no longer splits into lines
+          _stats.overflows++;
+          flushInput();
+          break;
+        }
+
+        size_t n = (size_t)pos + 1;   // through the '\n'
+        if (n > sizeof(_line)) {
+          _stats.overlong++;
+          while (n > 0) {
+            int got = uart_read_bytes(GPS_UART, (uint8_t*)_line, n < sizeof(_line) ? n : sizeof(_line), 0);
+            if (got <= 0) break;
+            n -= (size_t)got;
+          }
+          break;
+        }
+
+        if (uart_read_bytes(GPS_UART, (uint8_t*)_line, n, 0) == (int)n && _nmea.feed(_line, n, rx_ms)) {
+          fix = _nmea.fix();
+          _last = fix;
+          return true;
+        }
+        break;
+      }
+
+      case UART_FIFO_OVF:
+      case UART_BUFFER_FULL:
+        _stats.overflows++;
+        flushInput();
+        break;
+
+      default:
+        break;   // UART_DATA without a newline yet, line errors
+    }
   }
   return false;
 }
 
+bool GPSNeo6M::buildTimestamp(char* buf, size_t n) {
+  if (_last.utc_ms == 0) return false;
+
+  uint32_t days = (uint32_t)(_last.utc_ms / 86400000ULL);
+  uint32_t sec = (uint32_t)(_last.utc_ms % 86400000ULL) / 1000;
+  uint16_t y = 2000;
+  for (;;) {
+    uint16_t ylen = (y % 4 == 0) ? 366 : 365;
+    if (days < ylen) break;
+    days -= ylen;
+    y++;
+  }
+  static const uint8_t mlen[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+  uint8_t m = 0;
+  while (m < 11) {
+    uint8_t len = mlen[m] + ((m == 1 && y % 4 == 0) ? 1 : 0);
+    if (days < len) break;
+    days -= len;
+    m++;
+  }
+  snprintf(buf, n, "%04u-%02u-%02lu %02lu:%02lu:%02lu", y, m + 1, (unsigned long)days + 1,
+           (unsigned long)(sec / 3600), (unsigned long)(sec / 60 % 60), (unsigned long)(sec % 60));
+  return true;
+}
+
+void GPSNeo6M::printLocation() {
+  if (!_last.valid) return;
+
+  char ts[24];
+  Serial.print("Latitude : ");  Serial.println(_last.lat, 6);
+  Serial.print("Longitude: ");  Serial.println(_last.lng, 6);
+  Serial.print("Satellites: "); Serial.println(_last.sats);
+  Serial.print("Timestamp : "); Serial.println(buildTimestamp(ts, sizeof(ts)) ? ts : "(no fix)");
+  Serial.println("-----------------------");
+}
+
+bool GPSNeo6M::lastPps(uint32_t& local_ms) {
+  if (GPS_PPS_PIN < 0 || !s_ppsSeen) return false;
+  local_ms = s_ppsMs;
+  return true;
+}
+
+GpsStats GPSNeo6M::stats() {
+  GpsStats s = _stats;
+  s.nmea = _nmea.stats();
+  return s;
+}
+
 // ⚠️ DEBUG: Print GPS stats to troubleshoot connection issues
 void GPSNeo6M::printDebugStats() {
   static uint32_t last_print = 0;
   uint32_t now = millis();
   if (now - last_print < 3000) return;  // Print every 3s
   last_print = now;
-  
-  uint32_t bytes_available = _serial.available();
-  uint32_t chars_processed = _gps.charsProcessed();
-  uint32_t sentences_with_fix = _gps.sentencesWithFix();
-  bool has_fix = hasFix();
-  
+
+  GpsStats s = stats();
+  size_t buffered = 0;
+  uart_get_buffered_data_len(GPS_UART, &buffered);
+
   Serial.println("\n╔═══ GPS DEBUG STATS ═══╗");
-  Serial.printf("║ Serial Bytes Waiting: %lu\r\n", bytes_available);
-  Serial.printf("║ Chars Processed: %lu\r\n", chars_processed);
-  Serial.printf("║ Sentences with Fix: %lu\r\n", sentences_with_fix);
-  Serial.printf("║ Location Valid: %s\r\n", _gps.location.isValid() ? "YES" : "NO");
-  Serial.printf("║ Satellites: %d\r\n", _gps.satellites.value());
-  Serial.printf("║ Has Fix: %s\r\n", has_fix ? "YES" : "NO");
-  if (has_fix) {
-    Serial.printf("║ Lat/Lng: %.6f, %.6f\r\n", _gps.location.lat(), _gps.location.lng());
+  Serial.printf("║ UART Bytes Waiting: %u\r\n", (unsigned)buffered);
+  Serial.printf("║ Sentences: %lu (RMC %lu, GGA %lu, other %lu, bad %lu)\r\n",
+                (unsigned long)s.nmea.sentences, (unsigned long)s.nmea.rmc, (unsigned long)s.nmea.gga,
+                (unsigned long)s.nmea.ignored, (unsigned long)s.nmea.bad);
+  Serial.printf("║ Fixes: %lu, overflows %lu, overlong %lu\r\n", (unsigned long)s.nmea.fixes,
+                (unsigned long)s.overflows, (unsigned long)s.overlong);
+  Serial.printf("║ Satellites: %u\r\n", _last.sats);
+  Serial.printf("║ Has Fix: %s\r\n", hasFix() ? "YES" : "NO");
+  if (_last.valid) {
+    Serial.printf("║ Lat/Lng: %.6f, %.6f\r\n", _last.lat, _last.lng);
   }
   Serial.println("╚═══════════════════════╝\n");
 }
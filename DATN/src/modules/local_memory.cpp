@@ -1,4 +1,6 @@
 #include "local_memory.h"
+#include "sd_log_format.h"
+#include "vehicle_config.h"
 #include <SPI.h>
 #include <SD.h>
 #include "FS.h"
@@ -7,23 +9,59 @@ static SPIClass sdSPI(VSPI);
 static File     s_logFile;
 static bool     s_ready = false;
 
-static uint32_t s_lines = 0;
-static const uint32_t SYNC_EVERY = 25;
+// Double buffer of SDLOG_BLOCK_SIZE blocks: producers fill blocks in
+// s_buf[s_active], the writer task seals and writes s_buf[s_pending].
+// s_lock only guards record copies and index swaps, never I/O.
+static const uint32_t SD_LOG_BLOCKS_PER_BUF = SD_LOG_BUF_SIZE / SDLOG_BLOCK_SIZE;
 
-// Tạo tên file /data_0001.csv, /data_0002.csv, ...
+static uint8_t  s_buf[2][SD_LOG_BUF_SIZE] __attribute__((aligned(4)));
+static uint32_t s_blocks[2] = {0, 0};   // blocks begun in each buffer, the last may be partial
+static uint8_t  s_active = 0;
+static int8_t   s_pending = -1;      // buffer handed to the writer, -1 = none
+static uint32_t s_firstMs = 0;       // when the oldest record entered the active buffer
+static bool     s_flushReq = false;
+static uint32_t s_seq = 0;           // per file, counts dropped samples too
+static uint32_t s_blockNo = 0;       // next block number in the file
+static uint32_t s_written = 0;       // blocks handed to the card so far
+static SdLogStats s_stats;
+static SemaphoreHandle_t s_lock = NULL;
+static TaskHandle_t s_writerTask = NULL;
+
+// The writer wakes this often to enforce SD_LOG_FLUSH_MS on a quiet log
+static const uint32_t SD_LOG_POLL_MS = SD_LOG_FLUSH_MS / 4;
+
+struct SdLine {
+  char name[SD_LINE_NAME_MAX];
+  char data[SD_LINE_DATA_MAX];
+};
+static QueueHandle_t s_lineQueue = NULL;
+static File s_lineFile;              // writer-owned, kept open between lines
+static char s_lineName[SD_LINE_NAME_MAX] = "";
+
+// Tên file log tiếp theo: lớn hơn mọi /log_NNNN.bin đang có trên thẻ, kể cả
+// khi các file cũ đã bị xoá bớt, để không ghi đè/nối vào log của lần boot trước
 static String make_next_filename() {
-  static int fileIndex = 1;  // Tạo một chỉ số file tự động tăng
+  unsigned maxIndex = 0;
+  File root = SD.open("/");
+  if (root) {
+    for (File f = root.openNextFile(); f; f = root.openNextFile()) {
+      const char* name = f.name();
+      const char* slash = strrchr(name, '/');
+      if (slash) name = slash + 1;
+      unsigned idx;
+      char ext[5];
+      if (sscanf(name, "log_%u.%4s", &idx, ext) == 2 && strcmp(ext, "bin") == 0 && idx > maxIndex) {
+        maxIndex = idx;
+      }
+      f.close();
+    }
+    root.close();
+  }
   char name[20];
-  snprintf(name, sizeof(name), "/data_%04d.csv", fileIndex++);
+  snprintf(name, sizeof(name), "/log_%04u.bin", maxIndex + 1);
   return String(name);
 }
 
-static void write_header_if_new(File& f) {
-  if (f && f.size() == 0) {
-    f.println("ts_ms,lat,lng,sats,temperature,humidity,ax,ay,az");  // header cho log CSV
-  }
-}
-
 // Khởi tạo SD
 bool sd_init(uint8_t csPin) {
   // Bắt CS ở mức HIGH trước khi init
@@ -59,62 +97,239 @@ bool sd_init(uint8_t csPin) {
 
   // Kiểm tra lỗi mở file
   String fname = make_next_filename();
-  s_logFile = SD.open(fname, FILE_APPEND);
+  s_logFile = SD.open(fname, FILE_WRITE);
   if (!s_logFile) {
     Serial.println("[SD] Open log FAILED — cannot open file for writing");
     return false;
   }
-  Serial.print("[SD] Logging to "); Serial.println(fname);
 
-  // Đảm bảo viết header lần đầu tiên
-  write_header_if_new(s_logFile);
+  // Header một sector: device id + boot epoch, các block nằm ngay sau
+  SdLogHeader hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.epoch = gVehicleConfig.getBootEpoch();
+  hdr.vehicle = gVehicleConfig.getVehicleNumber();
+  hdr.created_ms = millis();
+  strncpy(hdr.device_id, gVehicleConfig.getDeviceId(), SDLOG_DEVICE_ID_MAX);
+  sdlog_header_encode(hdr, s_buf[0]);
+  if (s_logFile.write(s_buf[0], SDLOG_BLOCK_SIZE) != SDLOG_BLOCK_SIZE) {
+    Serial.println("[SD] Open log FAILED — cannot write header");
+    s_logFile.close();
+    return false;
+  }
   s_logFile.flush();
+  Serial.printf("[SD] Logging to %s (epoch %u)\r\n", fname.c_str(), hdr.epoch);
 
+  if (s_lock == NULL) s_lock = xSemaphoreCreateMutex();
+  if (s_lineQueue == NULL) s_lineQueue = xQueueCreate(SD_LINE_QUEUE_LEN, sizeof(SdLine));
+  s_blocks[0] = s_blocks[1] = 0;
+  s_active = 0;
+  s_pending = -1;
+  s_seq = 0;
+  s_blockNo = 0;
   s_ready = true;
-  s_lines = 0;
   return true;
 }
 
-bool sd_append_csv(uint32_t ts_ms, double lat, double lng, uint32_t sats, float temp, float hum, float ax, float ay, float az) {
-  if (!s_ready || !s_logFile) return false;
+bool sd_ready() {
+  return s_ready;
+}
+
+// Hand the active buffer to the writer; caller holds s_lock
+static void buf_swap() {
+  s_pending = s_active;
+  s_active ^= 1;
+  s_blocks[s_active] = 0;
+}
+
+// Block the next record goes into, NULL when the active buffer is full
+static uint8_t* buf_block(uint32_t ts_ms) {
+  uint32_t n = s_blocks[s_active];
+  if (n > 0) {
+    uint8_t* blk = s_buf[s_active] + (n - 1) * SDLOG_BLOCK_SIZE;
+    if (!sdlog_block_full(blk)) return blk;
+  }
+  if (n == SD_LOG_BLOCKS_PER_BUF) return NULL;
+
+  if (n == 0) s_firstMs = millis();
+  uint8_t* blk = s_buf[s_active] + n * SDLOG_BLOCK_SIZE;
+  sdlog_block_begin(blk, s_blockNo++, s_seq, ts_ms);
+  s_blocks[s_active] = n + 1;
+  return blk;
+}
+
+// Never blocks on the card: with both buffers full the record is dropped
+// (its seq is still used up, so readers see the gap).
+static bool sd_log_append(const SdLogRecord& r) {
+  if (!s_ready) return false;
+
+  bool wake = false;
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  uint8_t* blk = buf_block(r.ts_ms);
+  if (blk == NULL && s_pending < 0) {
+    buf_swap();
+    wake = true;
+    blk = buf_block(r.ts_ms);
+  }
+  if (blk == NULL) {
+    s_seq++;
+    s_stats.dropped_rows++;
+    s_stats.dropped_bytes += SDLOG_RECORD_SIZE;
+    xSemaphoreGive(s_lock);
+    return false;
+  }
+
+  sdlog_block_put(blk, r);
+  s_seq++;
+  s_stats.rows++;
+  s_stats.bytes += SDLOG_RECORD_SIZE;
+
+  // Hand a full buffer over right away so the writer starts early
+  if (s_pending < 0 && s_blocks[s_active] == SD_LOG_BLOCKS_PER_BUF && sdlog_block_full(blk)) {
+    buf_swap();
+    wake = true;
+  }
+  xSemaphoreGive(s_lock);
+
+  if (wake && s_writerTask != NULL) xTaskNotifyGive(s_writerTask);
+  return true;
+}
 
-  // Ghi dữ liệu vào file CSV
-  s_logFile.print(ts_ms); s_logFile.print(',');
-  s_logFile.print(lat, 6); s_logFile.print(',');
-  s_logFile.print(lng, 6); s_logFile.print(',');
-  s_logFile.print(sats); s_logFile.print(',');
-  s_logFile.print(temp); s_logFile.print(',');
-  s_logFile.print(hum); s_logFile.print(',');
-  s_logFile.print(ax); s_logFile.print(',');
-  s_logFile.print(ay); s_logFile.print(',');
-  s_logFile.println(az);
+// Seal and write the pending buffer, first handing over a partial one that
+// is due. Returns false when there was nothing to write.
+static bool sd_write_pending() {
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  bool partial = false;
+  if (s_pending < 0 && s_blocks[s_active] > 0 &&
+      (s_flushReq || millis() - s_firstMs >= SD_LOG_FLUSH_MS - SD_LOG_POLL_MS)) {
+    buf_swap();
+    partial = true;
+  }
+  if (s_pending < 0 || partial) s_flushReq = false;
+  int8_t idx = s_pending;
+  uint32_t blocks = (idx >= 0) ? s_blocks[idx] : 0;
+  xSemaphoreGive(s_lock);
+  if (idx < 0) return false;
 
-  if (++s_lines >= SYNC_EVERY) {
-    s_logFile.flush();  // Đảm bảo dữ liệu được ghi vào thẻ SD sau mỗi `SYNC_EVERY` dòng
-    s_lines = 0;
+  // CRC here rather than on the producer's task
+  for (uint32_t i = 0; i < blocks; i++) {
+    uint8_t* blk = s_buf[idx] + i * SDLOG_BLOCK_SIZE;
+    sdlog_block_seal(blk, sdlog_block_full(blk) ? 0 : SDLOG_BLOCK_FLUSHED);
   }
+
+  size_t len = blocks * SDLOG_BLOCK_SIZE;
+  uint32_t t0 = millis();
+  size_t w = s_logFile.write(s_buf[idx], len);
+  s_logFile.flush();
+  uint32_t dt = millis() - t0;
+
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  s_stats.writes++;
+  if (partial) s_stats.partial_writes++;
+  if (w != len) s_stats.write_errors++;
+  if (dt > SD_LOG_SLOW_WRITE_MS) s_stats.slow_writes++;
+  if (dt > s_stats.max_write_ms) s_stats.max_write_ms = dt;
+  s_written += blocks;
+  s_blocks[idx] = 0;
+  s_pending = -1;
+  xSemaphoreGive(s_lock);
   return true;
 }
 
-// Ghi dữ liệu vào file text
+static void sd_write_lines() {
+  SdLine l;
+  bool wrote = false;
+  while (xQueueReceive(s_lineQueue, &l, 0) == pdPASS) {
+    if (!s_lineFile || strcmp(l.name, s_lineName) != 0) {
+      if (s_lineFile) s_lineFile.close();
+      s_lineFile = SD.open(l.name, FILE_APPEND);
+      memcpy(s_lineName, l.name, sizeof(s_lineName));
+      if (!s_lineFile) {
+        Serial.printf("[SD] Failed to open file %s for writing.\r\n", l.name);
+        s_lineName[0] = '\0';
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        s_stats.write_errors++;
+        xSemaphoreGive(s_lock);
+        continue;
+      }
+    }
+    s_lineFile.println(l.data);
+    wrote = true;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_stats.lines++;
+    xSemaphoreGive(s_lock);
+  }
+  if (wrote) s_lineFile.flush();
+}
+
+static void TaskSdWriter(void *pv) {
+  (void)pv;
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(SD_LOG_POLL_MS));
+    while (sd_write_pending()) {}
+    sd_write_lines();
+  }
+}
+
+void startSdLogger(unsigned long stackSize, UBaseType_t priority) {
+  if (!s_ready) {
+    Serial.println("[SD] Logger not started (no card)");
+    return;
+  }
+  xTaskCreate(TaskSdWriter, "SD Writer", stackSize, NULL, priority, &s_writerTask);
+}
+
+bool sd_append_sample(uint32_t ts_ms, double lat, double lng, uint32_t sats, float temp, float hum, float ax, float ay, float az) {
+  SdLogRecord r;
+  sdlog_record_fill(r, ts_ms, lat, lng, sats, temp, hum, ax, ay, az);
+  return sd_log_append(r);
+}
+
+// Ghi dữ liệu vào file text (task writer mở/ghi, không chặn task gọi)
 bool sd_append_line(const char* filename, const char* data) {
-  File file = SD.open(filename, FILE_WRITE);
-  if (file) {
-    file.println(data);
-    file.close();
-    Serial.println("[SD] Data written successfully.");
-    return true;
-  } else {
-    Serial.print("[SD] Failed to open file ");
-    Serial.print(filename);
-    Serial.println(" for writing.");
-    // In chi tiết lỗi
-    Serial.println("[SD] Error: Failed to write data.");
+  if (!s_ready || s_lineQueue == NULL) return false;
+
+  SdLine l;
+  snprintf(l.name, sizeof(l.name), "%s", filename);
+  snprintf(l.data, sizeof(l.data), "%s", data);
+  if (xQueueSend(s_lineQueue, &l, 0) != pdPASS) {
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_stats.lines_dropped++;
+    xSemaphoreGive(s_lock);
     return false;
   }
+  if (s_writerTask != NULL) xTaskNotifyGive(s_writerTask);
+  return true;
 }
 
 // Ép flush (trước khi reset/deep sleep)
-void sd_flush() {
-  if (s_logFile) s_logFile.flush();
+bool sd_flush(uint32_t wait_ms) {
+  if (!s_ready) return false;
+
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  uint32_t target = s_written + s_blocks[s_active] + (s_pending >= 0 ? s_blocks[s_pending] : 0);
+  s_flushReq = true;
+  xSemaphoreGive(s_lock);
+  if (s_writerTask != NULL) xTaskNotifyGive(s_writerTask);
+
+  uint32_t start = millis();
+  for (;;) {
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    bool done = (int32_t)(s_written - target) >= 0;
+    xSemaphoreGive(s_lock);
+    if (done) return true;
+    if (millis() - start >= wait_ms) return false;
+    vTaskDelay(pdMS_TO_TICKS(10));
+  }
+}
+
+SdLogStats sd_log_stats() {
+  SdLogStats st;
+  if (s_lock == NULL) {
+    memset(&st, 0, sizeof(st));
+    return st;
+  }
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  st = s_stats;
+  xSemaphoreGive(s_lock);
+  return st;
 }
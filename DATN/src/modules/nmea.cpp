@@ -0,0 +1,268 @@
+#include "nmea.h"
+#include <string.h>
+
+// ---- field helpers: everything works on [f, f + n) inside the line ----
+
+struct FieldIter {
+  const char* p;
+  const char* end;   // the '*' before the checksum
+};
+
+static bool next_field(FieldIter& it, const char*& f, size_t& n) {
+  if (it.p > it.end) return false;
+  const char* c = (const char*)memchr(it.p, ',', (size_t)(it.end - it.p));
+  if (c == NULL) c = it.end;
+  f = it.p;
+  n = (size_t)(c - it.p);
+  it.p = c + 1;
+  return true;
+}
+
+static int hex_val(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+static bool parse_digits(const char* f, size_t n, uint32_t& v) {
+  if (n == 0 || n > 9) return false;
+  v = 0;
+  for (size_t i = 0; i < n; i++) {
+    if (f[i] < '0' || f[i] > '9') return false;
+    v = v * 10 + (uint32_t)(f[i] - '0');
+  }
+  return true;
+}
+
+// "123.4567" -> integer part, fraction digits and their divisor (10^k)
+static bool parse_decimal(const char* f, size_t n, uint32_t& ip, uint32_t& frac, uint32_t& div) {
+  const char* dot = (const char*)memchr(f, '.', n);
+  size_t ni = dot ? (size_t)(dot - f) : n;
+  frac = 0;
+  div = 1;
+  if (!parse_digits(f, ni, ip)) return false;
+  if (dot) {
+    size_t nf = n - ni - 1;
+    if (nf > 7) nf = 7;   // beyond 1e-7 is noise for every field we read
+    if (nf > 0 && !parse_digits(dot + 1, nf, frac)) return false;
+    for (size_t i = 0; i < nf; i++) div *= 10;
+  }
+  return true;
+}
+
+static bool parse_float(const char* f, size_t n, float& v) {
+  uint32_t ip, frac, div;
+  if (!parse_decimal(f, n, ip, frac, div)) return false;
+  v = (float)ip + (float)frac / (float)div;
+  return true;
+}
+
+// "hhmmss" or "hhmmss.sss" -> ms of day
+static bool parse_time(const char* f, size_t n, int32_t& tod) {
+  uint32_t hh, mm, ss, frac, div;
+  if (n < 6 || !parse_digits(f, 2, hh) || !parse_digits(f + 2, 2, mm)) return false;
+  if (!parse_decimal(f + 4, n - 4, ss, frac, div)) return false;
+  if (hh > 23 || mm > 59 || ss > 60) return false;
+  tod = (int32_t)(((hh * 60 + mm) * 60 + ss) * 1000 + frac * 1000 / div);
+  return true;
+}
+
+// "ddmm.mmmm" / "dddmm.mmmm" + hemisphere -> signed degrees
+static bool parse_coord(const char* f, size_t n, const char* h, size_t hn, double& deg) {
+  uint32_t ip, frac, div;
+  if (hn != 1 || !parse_decimal(f, n, ip, frac, div)) return false;
+  double minutes = (double)(ip % 100) + (double)frac / (double)div;
+  if (minutes >= 60.0) return false;
+  deg = (double)(ip / 100) + minutes / 60.0;
+  if (*h == 'S' || *h == 'W') deg = -deg;
+  else if (*h != 'N' && *h != 'E') return false;
+  return true;
+}
+
+// Days since 2000-01-01 (proleptic Gregorian, valid 2000..2099)
+static uint32_t days_since_2000(uint16_t y, uint8_t m, uint8_t d) {
+  static const uint16_t cum[12] = { 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334 };
+  uint32_t yy = y - 2000;
+  uint32_t days = yy * 365 + (yy + 3) / 4 + cum[m - 1] + (d - 1);
+  if (m > 2 && (yy % 4) == 0) days++;
+  return days;
+}
+
+uint64_t nmea_utc_ms(uint16_t year, uint8_t month, uint8_t day, uint32_t ms_of_day) {
+  return (uint64_t)days_since_2000(year, month, day) * 86400000ULL + ms_of_day;
+}
+
+// ---- parser ----
+
+NmeaParser::NmeaParser()
+  : _curTod(-1), _curRmc(false), _curGga(false), _curDone(false), _dateDays(0), _dateTod(-1) {
+  memset(&_cur, 0, sizeof(_cur));
+  memset(&_out, 0, sizeof(_out));
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+// Hand _cur out once, with the UTC from this epoch's RMC date or the last one
+bool NmeaParser::complete() {
+  if (_curTod < 0 || _curDone) return false;
+
+  _out = _cur;
+  _out.utc_ms = 0;
+  if (_dateTod >= 0) {
+    // GGA-only epoch after midnight, date still from the day before
+    uint32_t days = _dateDays + ((_curTod < _dateTod) ? 1 : 0);
+    _out.utc_ms = (uint64_t)days * 86400000ULL + (uint32_t)_curTod;
+  }
+  _curDone = true;
+  _stats.fixes++;
+  return true;
+}
+
+void NmeaParser::startEpoch(int32_t tod, uint32_t rx_ms) {
+  memset(&_cur, 0, sizeof(_cur));
+  _cur.rx_ms = rx_ms;
+  _curTod = tod;
+  _curRmc = false;
+  _curGga = false;
+  _curDone = false;
+}
+
+bool NmeaParser::feed(const char* line, size_t len, uint32_t rx_ms) {
+  _stats.sentences++;
+
+  const char* end = line + len;
+  while (end > line && (end[-1] == '\n' || end[-1] == '\r')) end--;
+  const char* s = (const char*)memchr(line, '$', (size_t)(end - line));
+  if (s == NULL || end - s < 10) {   // "$GPRMC,*hh"
+    _stats.bad++;
+    return false;
+  }
+
+  // Talker (GP, GN, ...) is not checked, the sentence type is
+  bool rmc = memcmp(s + 3, "RMC,", 4) == 0;
+  bool gga = memcmp(s + 3, "GGA,", 4) == 0;
+  if (!rmc && !gga) {
+    _stats.ignored++;
+    return false;
+  }
+
+  uint8_t sum = 0;
+  for (const char* p = s + 1; p < end - 3; p++) sum ^= (uint8_t)*p;
+  int hi = hex_val(end[-2]), lo = hex_val(end[-1]);
+  if (end[-3] != '*' || hi < 0 || lo < 0 || sum != (uint8_t)(hi << 4 | lo)) {
+    _stats.bad++;
+    return false;
+  }
+
+  FieldIter it = { s + 7, end - 3 };
+  const char* f;
+  size_t n;
+  int32_t tod;
+  if (!next_field(it, f, n) || n == 0) {
+    // Receiver without time yet: nothing to stamp a fix with
+    if (rmc) _stats.rmc++;
+    else _stats.gga++;
+    return false;
+  }
+  if (!parse_time(f, n, tod)) {
+    _stats.bad++;
+    return false;
+  }
+
+  // A new epoch completes the previous one if it is still open
+  bool done = false;
+  if (tod != _curTod) {
+    done = complete();
+    startEpoch(tod, rx_ms);
+  }
+
+  bool ok = rmc ? parseRmc(it.p, it.end, tod) : parseGga(it.p, it.end, tod);
+  if (!ok) {
+    _stats.bad++;
+    return done;
+  }
+  if (rmc) {
+    _stats.rmc++;
+    _curRmc = true;
+  } else {
+    _stats.gga++;
+    _curGga = true;
+  }
+
+  if (_curRmc && _curGga) done = complete() || done;
+  return done;
+}
+
+// status, lat, N/S, lng, E/W, speed (kn), course, date, ...
+bool NmeaParser::parseRmc(const char* p, const char* end, int32_t& tod) {
+  FieldIter it = { p, end };
+  const char *st, *la, *ns, *lo, *ew, *sp, *co, *da;
+  size_t nst, nla, nns, nlo, new_, nsp, nco, nda;
+  if (!next_field(it, st, nst) || !next_field(it, la, nla) || !next_field(it, ns, nns) ||
+      !next_field(it, lo, nlo) || !next_field(it, ew, new_) || !next_field(it, sp, nsp) ||
+      !next_field(it, co, nco) || !next_field(it, da, nda)) {
+    return false;
+  }
+
+  bool valid = (nst == 1 && *st == 'A');
+  double lat = 0.0, lng = 0.0;
+  if (valid && (!parse_coord(la, nla, ns, nns, lat) || !parse_coord(lo, nlo, ew, new_, lng))) return false;
+
+  float speed = 0.0f, course = 0.0f;
+  if (nsp > 0 && !parse_float(sp, nsp, speed)) return false;
+  if (nco > 0 && !parse_float(co, nco, course)) return false;
+
+  // ddmmyy; a receiver still searching sends it empty or years before 2000
+  if (nda == 6) {
+    uint32_t dd, mo, yy;
+    if (!parse_digits(da, 2, dd) || !parse_digits(da + 2, 2, mo) || !parse_digits(da + 4, 2, yy)) return false;
+    if (dd >= 1 && dd <= 31 && mo >= 1 && mo <= 12 && yy < 80) {
+      _dateDays = days_since_2000((uint16_t)(2000 + yy), (uint8_t)mo, (uint8_t)dd);
+      _dateTod = tod;
+    }
+  }
+
+  _cur.valid = valid;
+  if (valid) {
+    _cur.lat = lat;
+    _cur.lng = lng;
+  }
+  _cur.speed_kmh = speed * 1.852f;
+  _cur.course_deg = course;
+  return true;
+}
+
+// lat, N/S, lng, E/W, quality, sats, hdop, ...
+bool NmeaParser::parseGga(const char* p, const char* end, int32_t& tod) {
+  (void)tod;
+  FieldIter it = { p, end };
+  const char *la, *ns, *lo, *ew, *q, *sv, *hd;
+  size_t nla, nns, nlo, new_, nq, nsv, nhd;
+  if (!next_field(it, la, nla) || !next_field(it, ns, nns) || !next_field(it, lo, nlo) ||
+      !next_field(it, ew, new_) || !next_field(it, q, nq) || !next_field(it, sv, nsv) ||
+      !next_field(it, hd, nhd)) {
+    return false;
+  }
+
+  uint32_t quality = 0, sats = 0;
+  float hdop = 0.0f;
+  if (nq > 0 && !parse_digits(q, nq, quality)) return false;
+  if (nsv > 0 && !parse_digits(sv, nsv, sats)) return false;
+  if (nhd > 0 && !parse_float(hd, nhd, hdop)) return false;
+
+  double lat = 0.0, lng = 0.0;
+  if (quality > 0 && (!parse_coord(la, nla, ns, nns, lat) || !parse_coord(lo, nlo, ew, new_, lng))) return false;
+
+  _cur.quality = (uint8_t)quality;
+  _cur.sats = (uint8_t)(sats > 255 ? 255 : sats);
+  _cur.hdop = hdop;
+  // RMC status decides validity when the epoch has one
+  if (!_curRmc) {
+    _cur.valid = quality > 0;
+    if (quality > 0) {
+      _cur.lat = lat;
+      _cur.lng = lng;
+    }
+  }
+  return true;
+}
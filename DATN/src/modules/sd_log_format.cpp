@@ -0,0 +1,196 @@
+#include "sd_log_format.h"
+#include "telemetry_frame.h"
+#include <math.h>
+#include <string.h>
+
+static void put_u16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)(v >> 0);
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)(v >> 0);
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+static uint16_t get_u16(const uint8_t *p) {
+  return (uint16_t)p[0] | ((uint16_t)p[1] << 8);
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+  return (uint32_t)p[0]
+       | ((uint32_t)p[1] << 8)
+       | ((uint32_t)p[2] << 16)
+       | ((uint32_t)p[3] << 24);
+}
+
+// Round and clamp a scaled value into [lo, hi]
+static long scale_clamp(double v, double scale, long lo, long hi) {
+  double s = v * scale;
+  if (s <= (double)lo) return lo;
+  if (s >= (double)hi) return hi;
+  return lround(s);
+}
+
+// CRC-32 (IEEE, reflected), nibble table: small and fast enough for one
+// block per 20 records on the writer task
+uint32_t sdlog_crc32(const uint8_t *data, size_t len) {
+  static const uint32_t tbl[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+  };
+  uint32_t crc = 0xFFFFFFFF;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    crc = (crc >> 4) ^ tbl[crc & 0x0F];
+    crc = (crc >> 4) ^ tbl[crc & 0x0F];
+  }
+  return ~crc;
+}
+
+static int16_t axis_mg(float g) {
+  return isnan(g) ? (int16_t)TF_INVALID_I16 : (int16_t)scale_clamp(g, 1000.0, INT16_MIN + 1, INT16_MAX);
+}
+
+void sdlog_record_fill(SdLogRecord &r, uint32_t ts_ms, double lat, double lng, uint32_t sats,
+                       float temp, float hum, float ax, float ay, float az) {
+  r.seq = 0;
+  r.ts_ms = ts_ms;
+  r.lat_e7 = (int32_t)scale_clamp(lat, 1e7, -900000000L, 900000000L);
+  r.lng_e7 = (int32_t)scale_clamp(lng, 1e7, -1800000000L, 1800000000L);
+  r.temp_dc = (isnan(temp) || temp < -900.0f)
+            ? (int16_t)TF_INVALID_I16
+            : (int16_t)scale_clamp(temp, 10.0, INT16_MIN + 1, INT16_MAX);
+  r.hum_dp = (isnan(hum) || hum < 0.0f)
+           ? (uint16_t)TF_INVALID_U16
+           : (uint16_t)scale_clamp(hum, 10.0, 0, 1000);
+  r.ax_mg = axis_mg(ax);
+  r.ay_mg = axis_mg(ay);
+  r.az_mg = axis_mg(az);
+  r.sats = (sats > 255) ? 255 : (uint8_t)sats;
+  r.flags = 0;
+}
+
+void sdlog_header_encode(const SdLogHeader &h, uint8_t *out) {
+  memset(out, 0, SDLOG_BLOCK_SIZE);
+  memcpy(out, SDLOG_MAGIC, 4);
+  out[4] = SDLOG_VERSION;
+  out[5] = SDLOG_RECORD_SIZE;
+  put_u16(&out[6], SDLOG_BLOCK_SIZE);
+  put_u16(&out[8], h.epoch);
+  out[10] = h.vehicle;
+  out[11] = SDLOG_RECORDS_PER_BLOCK;
+  put_u32(&out[12], h.created_ms);
+  memcpy(&out[16], h.device_id, strnlen(h.device_id, SDLOG_DEVICE_ID_MAX));
+  put_u32(&out[SDLOG_CRC_OFFSET], sdlog_crc32(out, SDLOG_CRC_OFFSET));
+}
+
+bool sdlog_header_decode(const uint8_t *in, SdLogHeader &h) {
+  if (memcmp(in, SDLOG_MAGIC, 4) != 0) return false;
+  if (get_u32(&in[SDLOG_CRC_OFFSET]) != sdlog_crc32(in, SDLOG_CRC_OFFSET)) return false;
+  if (in[5] != SDLOG_RECORD_SIZE || get_u16(&in[6]) != SDLOG_BLOCK_SIZE ||
+      in[11] != SDLOG_RECORDS_PER_BLOCK) {
+    return false;
+  }
+
+  h.version = in[4];
+  h.epoch = get_u16(&in[8]);
+  h.vehicle = in[10];
+  h.created_ms = get_u32(&in[12]);
+  memcpy(h.device_id, &in[16], SDLOG_DEVICE_ID_MAX);
+  h.device_id[SDLOG_DEVICE_ID_MAX] = '\0';
+  return true;
+}
+
+void sdlog_block_begin(uint8_t *blk, uint32_t block_no, uint32_t first_seq, uint32_t first_ts_ms) {
+  memset(blk, 0, SDLOG_BLOCK_SIZE);
+  put_u16(&blk[0], SDLOG_BLOCK_MAGIC);
+  put_u32(&blk[4], block_no);
+  put_u32(&blk[8], first_seq);
+  put_u32(&blk[12], first_ts_ms);
+}
+
+bool sdlog_block_full(const uint8_t *blk) {
+  return blk[2] >= SDLOG_RECORDS_PER_BLOCK;
+}
+
+bool sdlog_block_put(uint8_t *blk, const SdLogRecord &r) {
+  if (sdlog_block_full(blk)) return false;
+
+  uint8_t *p = blk + SDLOG_BLOCK_HDR_SIZE + blk[2] * SDLOG_RECORD_SIZE;
+  put_u32(&p[0], r.ts_ms);
+  put_u32(&p[4], (uint32_t)r.lat_e7);
+  put_u32(&p[8], (uint32_t)r.lng_e7);
+  put_u16(&p[12], (uint16_t)r.temp_dc);
+  put_u16(&p[14], r.hum_dp);
+  put_u16(&p[16], (uint16_t)r.ax_mg);
+  put_u16(&p[18], (uint16_t)r.ay_mg);
+  put_u16(&p[20], (uint16_t)r.az_mg);
+  p[22] = r.sats;
+  p[23] = r.flags;
+  blk[2]++;
+  return true;
+}
+
+void sdlog_block_seal(uint8_t *blk, uint8_t flags) {
+  blk[3] = flags;
+  put_u32(&blk[SDLOG_CRC_OFFSET], sdlog_crc32(blk, SDLOG_CRC_OFFSET));
+}
+
+bool sdlog_block_decode(const uint8_t *blk, SdLogBlock &b) {
+  if (get_u16(&blk[0]) != SDLOG_BLOCK_MAGIC) return false;
+  if (blk[2] == 0 || blk[2] > SDLOG_RECORDS_PER_BLOCK) return false;
+  if (get_u32(&blk[SDLOG_CRC_OFFSET]) != sdlog_crc32(blk, SDLOG_CRC_OFFSET)) return false;
+
+  b.count = blk[2];
+  b.flags = blk[3];
+  b.block_no = get_u32(&blk[4]);
+  b.first_seq = get_u32(&blk[8]);
+  b.first_ts_ms = get_u32(&blk[12]);
+  b.records = blk + SDLOG_BLOCK_HDR_SIZE;
+  return true;
+}
+
+void sdlog_block_record(const SdLogBlock &b, uint8_t k, SdLogRecord &r) {
+  const uint8_t *p = b.records + k * SDLOG_RECORD_SIZE;
+  r.seq = b.first_seq + k;
+  r.ts_ms = get_u32(&p[0]);
+  r.lat_e7 = (int32_t)get_u32(&p[4]);
+  r.lng_e7 = (int32_t)get_u32(&p[8]);
+  r.temp_dc = (int16_t)get_u16(&p[12]);
+  r.hum_dp = get_u16(&p[14]);
+  r.ax_mg = (int16_t)get_u16(&p[16]);
+  r.ay_mg = (int16_t)get_u16(&p[18]);
+  r.az_mg = (int16_t)get_u16(&p[20]);
+  r.sats = p[22];
+  r.flags = p[23];
+}
+
+uint32_t sdlog_seek(SdLogReadBlock read, void *ctx, uint32_t nblocks,
+                    SdLogKey kind, uint32_t key, uint8_t *scratch) {
+  uint32_t lo = 0, hi = nblocks, found = 0;
+  SdLogBlock b;
+
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+
+    // First good block at or after mid; none left means the answer is below
+    uint32_t probe = mid;
+    while (probe < hi && !(read(ctx, probe, scratch) && sdlog_block_decode(scratch, b))) probe++;
+    if (probe == hi) {
+      hi = mid;
+      continue;
+    }
+
+    uint32_t first = (kind == SDLOG_KEY_SEQ) ? b.first_seq : b.first_ts_ms;
+    if (first <= key) {
+      found = probe;
+      lo = probe + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return found;
+}
@@ -1,7 +1,5 @@
 #include "security.h"
-#include "mbedtls/aes.h"
 #include "mbedtls/base64.h"
-#include "mbedtls/md.h"
 
 // ===== AES-128 CBC ENCRYPTION CONFIG =====
 static const uint8_t aes_key[16] = {
@@ -15,44 +13,202 @@ static const uint8_t aes_iv[16] = {
 
 #define HMAC_SECRET "datn_252_secret_key"
 
-String encryptDataToAESBase64(const String& jsonStr) {
-    mbedtls_aes_context aes;
+CryptoSession gCryptoSession;
+
+void securityBegin(const uint8_t* key, const uint8_t* mac_key, size_t mac_key_len) {
+    if (key == NULL || mac_key == NULL || mac_key_len == 0) {
+        key = aes_key;
+        mac_key = (const uint8_t*)HMAC_SECRET;
+        mac_key_len = strlen(HMAC_SECRET);
+    }
+    gCryptoSession.begin(key, aes_iv, mac_key, mac_key_len);
+}
+
+// ===== CRYPTO SESSION =====
+CryptoSession::CryptoSession() : _backend(CRYPTO_DEFAULT_BACKEND), _ready(false) {
+    memset(_iv, 0, sizeof(_iv));
+}
+
+CryptoSession::~CryptoSession() {
+    end();
+}
+
+void CryptoSession::begin(const uint8_t key[16], const uint8_t iv[16],
+                          const uint8_t* mac_key, size_t mac_key_len,
+                          CryptoBackend backend) {
+    end();
+    _backend = backend;
+    crypto_aes_init(_aes, backend, key);
+    crypto_hmac_init(_mac, backend, mac_key, mac_key_len);
+    memcpy(_iv, iv, sizeof(_iv));
+    _ready = true;
+}
+
+void CryptoSession::end() {
+    if (!_ready) return;
+    _ready = false;
+    crypto_aes_free(_aes);
+    crypto_hmac_free(_mac);
+}
+
+void CryptoSession::hmac(const uint8_t* data, size_t len, uint8_t out[32]) {
+    crypto_hmac_sha256(_mac, data, len, out);
+}
+
+size_t CryptoSession::encrypt(const uint8_t* in, size_t len, uint8_t* out, size_t cap) {
+    size_t pad = 16 - (len % 16);
+    size_t enc_len = len + pad;
+    if (enc_len > cap) return 0;
+
+    if (out != in) memmove(out, in, len);
+    memset(out + len, (int)pad, pad);
+
+    uint8_t iv[16];
+    memcpy(iv, _iv, sizeof(iv));
+    crypto_aes_cbc_encrypt(_aes, iv, out, out, enc_len);
+    return enc_len;
+}
+
+bool CryptoSession::decrypt(const uint8_t* in, size_t len, uint8_t* out, size_t& out_len) {
+    out_len = 0;
+    if (len == 0 || (len % 16) != 0) return false;
+
     uint8_t iv[16];
-    memcpy(iv, aes_iv, sizeof(iv));
+    memcpy(iv, _iv, sizeof(iv));
+    crypto_aes_cbc_decrypt(_aes, iv, in, out, len);
+
+    // PKCS#7 padding
+    uint8_t pad = out[len - 1];
+    if (pad == 0 || pad > 16 || pad > len) return false;
+    for (size_t i = len - pad; i < len; i++) {
+        if (out[i] != pad) return false;
+    }
+    out_len = len - pad;
+    return true;
+}
+
+// ===== AES-128 CCM (RFC 3610, L = 2, M = AEAD_TAG_LEN) =====
+static void put_header(uint8_t* p, const AeadHeader& h) {
+    p[0] = h.vehicle;
+    p[1] = (uint8_t)(h.epoch);
+    p[2] = (uint8_t)(h.epoch >> 8);
+    p[3] = (uint8_t)(h.seq);
+    p[4] = (uint8_t)(h.seq >> 8);
+    p[5] = (uint8_t)(h.seq >> 16);
+    p[6] = (uint8_t)(h.seq >> 24);
+}
+
+// A_0 counter block; the 13-byte nonce is the header plus zero padding
+static void ccm_counter0(uint8_t ctr[16], const uint8_t hdr[AEAD_HDR_LEN]) {
+    memset(ctr, 0, 16);
+    ctr[0] = 0x01;                                      // L - 1
+    memcpy(ctr + 1, hdr, AEAD_HDR_LEN);
+}
+
+// CBC-MAC over B_0 | len(a) | a | pad | m | pad in a single CBC pass
+static void ccm_mac(CryptoAes& aes, const uint8_t hdr[AEAD_HDR_LEN],
+                    const uint8_t* msg, size_t len, uint8_t mac[16]) {
+    uint8_t buf[16 + 16 + FRAME_MAX_PLAIN + 16];
+    size_t p = 0;
+
+    buf[p++] = 0x40 | (((AEAD_TAG_LEN - 2) / 2) << 3) | 0x01;   // Adata | M' | L'
+    memcpy(buf + p, hdr, AEAD_HDR_LEN);
+    memset(buf + p + AEAD_HDR_LEN, 0, AEAD_NONCE_LEN - AEAD_HDR_LEN);
+    p += AEAD_NONCE_LEN;
+    buf[p++] = (uint8_t)(len >> 8);
+    buf[p++] = (uint8_t)len;
 
-    size_t input_len = jsonStr.length();
-    size_t pad = 16 - (input_len % 16);
-    size_t enc_len = input_len + pad;
+    buf[p++] = 0;
+    buf[p++] = AEAD_HDR_LEN;
+    memcpy(buf + p, hdr, AEAD_HDR_LEN);
+    p += AEAD_HDR_LEN;
+    memset(buf + p, 0, 16 - (p % 16));
+    p = 32;
 
-    uint8_t buf[enc_len];
-    memcpy(buf, jsonStr.c_str(), input_len);
-    memset(buf + input_len, pad, pad);
+    memcpy(buf + p, msg, len);
+    p += len;
+    if (p % 16) {
+        memset(buf + p, 0, 16 - (p % 16));
+        p += 16 - (p % 16);
+    }
+
+    uint8_t iv[16] = { 0 };
+    crypto_aes_cbc_encrypt(aes, iv, buf, buf, p);
+    memcpy(mac, iv, 16);
+}
+
+size_t CryptoSession::seal(const AeadHeader& hdr, const uint8_t* frame, size_t len, uint8_t* out, size_t cap) {
+    if (!_ready || len > FRAME_MAX_PLAIN || cap < len + AEAD_OVERHEAD) return 0;
+
+    put_header(out, hdr);
+
+    uint8_t mac[16];
+    ccm_mac(_aes, out, frame, len, mac);
+
+    // One CTR pass: block 0 encrypts the tag (S_0), the rest the frame (S_1..)
+    uint8_t buf[16 + FRAME_MAX_PLAIN];
+    memcpy(buf, mac, 16);
+    memcpy(buf + 16, frame, len);
+    uint8_t ctr[16];
+    ccm_counter0(ctr, out);
+    crypto_aes_ctr(_aes, ctr, buf, buf, 16 + len);
+
+    memcpy(out + AEAD_HDR_LEN, buf + 16, len);
+    memcpy(out + AEAD_HDR_LEN + len, buf, AEAD_TAG_LEN);
+    return len + AEAD_OVERHEAD;
+}
+
+bool CryptoSession::open(const uint8_t* pkt, size_t len, AeadHeader& hdr, uint8_t* out, size_t cap, size_t& out_len) {
+    out_len = 0;
+    if (!_ready || len < AEAD_OVERHEAD) return false;
+    size_t frame_len = len - AEAD_OVERHEAD;
+    if (frame_len > FRAME_MAX_PLAIN || frame_len > cap) return false;
+
+    uint8_t buf[16 + FRAME_MAX_PLAIN];
+    memset(buf, 0, 16);
+    memcpy(buf, pkt + AEAD_HDR_LEN + frame_len, AEAD_TAG_LEN);
+    memcpy(buf + 16, pkt + AEAD_HDR_LEN, frame_len);
+    uint8_t ctr[16];
+    ccm_counter0(ctr, pkt);
+    crypto_aes_ctr(_aes, ctr, buf, buf, 16 + frame_len);
+
+    uint8_t mac[16];
+    ccm_mac(_aes, pkt, buf + 16, frame_len, mac);
+    uint8_t diff = 0;
+    for (size_t i = 0; i < AEAD_TAG_LEN; i++) {
+        diff |= mac[i] ^ buf[i];
+    }
+    if (diff != 0) return false;
+
+    hdr.vehicle = pkt[0];
+    hdr.epoch = (uint16_t)pkt[1] | ((uint16_t)pkt[2] << 8);
+    hdr.seq = (uint32_t)pkt[3] | ((uint32_t)pkt[4] << 8)
+            | ((uint32_t)pkt[5] << 16) | ((uint32_t)pkt[6] << 24);
+    memcpy(out, buf + 16, frame_len);
+    out_len = frame_len;
+    return true;
+}
 
-    uint8_t output[enc_len];
+// ===== LEGACY STRING API (JSON payloads) =====
+// Bounded by the old ~200-byte JSON uplink; longer input is rejected
+#define JSON_MAX_PLAIN 256
 
-    mbedtls_aes_init(&aes);
-    mbedtls_aes_setkey_enc(&aes, aes_key, 128);
-    mbedtls_aes_crypt_cbc(&aes, MBEDTLS_AES_ENCRYPT, enc_len, iv, buf, output);
-    mbedtls_aes_free(&aes);
+String encryptDataToAESBase64(const String& jsonStr) {
+    uint8_t buf[JSON_MAX_PLAIN + 16];
+    size_t enc_len = gCryptoSession.encrypt((const uint8_t*)jsonStr.c_str(), jsonStr.length(),
+                                            buf, sizeof(buf));
+    if (enc_len == 0) return String();
 
-    unsigned char base64_buf[512];
+    unsigned char base64_buf[4 * ((JSON_MAX_PLAIN + 16 + 2) / 3) + 1];
     size_t base64_len = 0;
-    mbedtls_base64_encode(base64_buf, sizeof(base64_buf), &base64_len, output, enc_len);
+    mbedtls_base64_encode(base64_buf, sizeof(base64_buf), &base64_len, buf, enc_len);
 
     return String((char*)base64_buf, base64_len);
 }
 
 String hmacSha256(const String &message) {
-    unsigned char output[32];
-    mbedtls_md_context_t ctx;
-    const mbedtls_md_info_t *info = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
-
-    mbedtls_md_init(&ctx);
-    mbedtls_md_setup(&ctx, info, 1);
-    mbedtls_md_hmac_starts(&ctx, (const unsigned char*)HMAC_SECRET, strlen(HMAC_SECRET));
-    mbedtls_md_hmac_update(&ctx, (const unsigned char*)message.c_str(), message.length());
-    mbedtls_md_hmac_finish(&ctx, output);
-    mbedtls_md_free(&ctx);
+    uint8_t output[32];
+    gCryptoSession.hmac((const uint8_t*)message.c_str(), message.length(), output);
 
     static const char hexDigits[] = "0123456789abcdef";
     char hex_output[65];
@@ -64,4 +220,38 @@ String hmacSha256(const String &message) {
     hex_output[64] = '\0';
 
     return String(hex_output);
-}
\ No newline at end of file
+}
+
+// ===== BINARY FRAME (telemetry_frame.h) =====
+size_t sealFrame(const AeadHeader& hdr, const uint8_t* frame, size_t len, uint8_t* out, size_t cap) {
+    return gCryptoSession.seal(hdr, frame, len, out, cap);
+}
+
+bool openFrame(const uint8_t* pkt, size_t len, AeadHeader& hdr, uint8_t* out, size_t cap, size_t& out_len) {
+    return gCryptoSession.open(pkt, len, hdr, out, cap, out_len);
+}
+
+size_t sealFrameToBase64(const AeadHeader& hdr, const uint8_t* frame, size_t len, char* out, size_t cap) {
+    uint8_t pkt[FRAME_MAX_SEALED];
+    size_t pkt_len = gCryptoSession.seal(hdr, frame, len, pkt, sizeof(pkt));
+    if (pkt_len == 0) return 0;
+    return sealedToBase64(pkt, pkt_len, out, cap);
+}
+
+size_t sealedToBase64(const uint8_t* pkt, size_t pkt_len, char* out, size_t cap) {
+    size_t b64_len = 0;
+    if (mbedtls_base64_encode((unsigned char*)out, cap, &b64_len, pkt, pkt_len) != 0) {
+        return 0;
+    }
+    return b64_len;
+}
+
+bool openFrameFromBase64(const char* b64, size_t b64_len, AeadHeader& hdr, uint8_t* out, size_t cap, size_t& out_len) {
+    out_len = 0;
+    uint8_t pkt[FRAME_MAX_SEALED];
+    size_t pkt_len = 0;
+    if (mbedtls_base64_decode(pkt, sizeof(pkt), &pkt_len, (const unsigned char*)b64, b64_len) != 0) {
+        return false;
+    }
+    return gCryptoSession.open(pkt, pkt_len, hdr, out, cap, out_len);
+}
@@ -1,4 +1,42 @@
 #include "sensor_Data.h"
 
-SensorData sensorData;
-SemaphoreHandle_t sensorDataMutex;
\ No newline at end of file
+static SeqLock<GpsSample>    s_gps;
+static SeqLock<EnvSample>    s_env;
+static SeqLock<MotionSample> s_motion;
+
+void sensor_data_init() {
+    s_gps.write(GpsSample{ 0.0, 0.0, 0, 0.0f, 0 });
+    s_env.write(EnvSample{ -999.0f, -999.0f });
+    s_motion.write(MotionSample{ -999.0f, false, false, 0, 0, 0.0f });
+}
+
+void sensor_data_publish_gps(const GpsSample& s) { s_gps.write(s); }
+
+void sensor_data_publish_env(const EnvSample& s) { s_env.write(s); }
+
+void sensor_data_publish_motion(const MotionSample& s) { s_motion.write(s); }
+
+GpsSample sensor_data_snapshot_gps() {
+    return s_gps.read();
+}
+
+SensorData sensor_data_snapshot() {
+    GpsSample g = s_gps.read();
+    EnvSample e = s_env.read();
+    MotionSample m = s_motion.read();
+
+    SensorData d;
+    d.lat = g.lat;
+    d.lng = g.lng;
+    d.sats = g.sats;
+    d.speed = g.speed;
+    d.temp = e.temp;
+    d.hum = e.hum;
+    d.accel = m.accel;
+    d.shock_detected = m.shock_detected;
+    d.is_moving = m.is_moving;
+    d.shock_count = m.shock_count;
+    d.shock_ts_ms = m.shock_ts_ms;
+    d.shock_peak_g = m.shock_peak_g;
+    return d;
+}
@@ -0,0 +1,130 @@
+#include "slot_scheduler.h"
+
+SlotScheduler gSlotScheduler;
+
+uint32_t lora_airtime_ms(size_t payload_len, uint8_t sf, uint32_t bw_hz, uint8_t cr, uint16_t preamble) {
+  // All in microseconds to stay in integers
+  uint32_t t_sym_us = (uint32_t)(((uint64_t)1000000 << sf) / bw_hz);
+  int de = (t_sym_us > 16000) ? 1 : 0;                      // low data rate optimize
+
+  int32_t num = 8 * (int32_t)payload_len - 4 * sf + 28 + 16;
+  int32_t den = 4 * (sf - 2 * de);
+  int32_t blocks = (num > 0) ? (num + den - 1) / den : 0;
+  uint32_t n_payload = 8 + (uint32_t)blocks * (cr + 4);
+
+  uint32_t t_pre_us = (preamble * 4 + 17) * t_sym_us / 4;   // (preamble + 4.25) symbols
+  return (t_pre_us + n_payload * t_sym_us + 999) / 1000;
+}
+
+static uint32_t frame_airtime_ms(size_t sealed_len) {
+  return lora_airtime_ms(sealed_len + SLOT_BRIDGE_OVERHEAD, SLOT_LORA_SF, SLOT_LORA_BW_HZ,
+                         SLOT_LORA_CR, SLOT_LORA_PREAMBLE);
+}
+
+SlotScheduler::SlotScheduler() {
+  memset(&_plan, 0, sizeof(_plan));
+  memset(&_writer, 0, sizeof(_writer));
+  _sync.write(_writer);
+}
+
+void SlotScheduler::configure(uint16_t n_slots, uint16_t slot, size_t max_frame, uint32_t min_frame_ms) {
+  if (n_slots == 0) n_slots = 1;
+
+  _plan.n_slots = n_slots;
+  _plan.slot = slot % n_slots;
+  _plan.airtime_ms = frame_airtime_ms(max_frame);
+
+  // Beacon slot: largest beacon, guards on both sides, gateway timing error
+  uint32_t beacon = lora_airtime_ms(SLOT_BEACON_PAYLOAD_MAX + SLOT_BRIDGE_OVERHEAD, SLOT_LORA_SF,
+                                    SLOT_LORA_BW_HZ, SLOT_LORA_CR, SLOT_LORA_PREAMBLE)
+                  + 2 * SLOT_GUARD_FREE_MS + SLOT_BEACON_GUARD_MS;
+  _plan.beacon_ms = (beacon + 9) / 10 * 10;
+
+  // Worst case guard on both sides, rounded up to 10 ms; wider when the
+  // slots and the beacon slot leave room inside min_frame_ms
+  uint32_t need = _plan.airtime_ms + SLOT_TX_LATENCY_MS + 2 * SLOT_GUARD_FREE_MS;
+  need = (need + 9) / 10 * 10;
+  uint32_t spread = (min_frame_ms > _plan.beacon_ms) ? (min_frame_ms - _plan.beacon_ms) / n_slots : 0;
+  _plan.slot_ms = (spread > need) ? spread : need;
+  _plan.frame_ms = _plan.slot_ms * n_slots + _plan.beacon_ms;
+
+  Serial.printf("[TDMA] %u slots x %lums + beacon %lums (frame %lums), slot %u, airtime %lums\r\n",
+                _plan.n_slots, (unsigned long)_plan.slot_ms, (unsigned long)_plan.beacon_ms,
+                (unsigned long)_plan.frame_ms, _plan.slot, (unsigned long)_plan.airtime_ms);
+}
+
+void SlotScheduler::syncUtc(uint64_t utc_ms, uint32_t local_ms, bool pps) {
+  int64_t offset = (int64_t)utc_ms - (int64_t)local_ms;
+  int64_t err = offset - _writer.offset_ms;
+
+  // Step on the first fix or after a jump; otherwise filter the NMEA jitter
+  if (!_writer.valid || err > SLOT_SLEW_MAX_MS || err < -SLOT_SLEW_MAX_MS) {
+    _writer.offset_ms = offset;
+    Serial.printf("[TDMA] GPS time %s (%s)\r\n", _writer.valid ? "re-synced" : "acquired",
+                  pps ? "PPS" : "NMEA");
+  } else {
+    _writer.offset_ms += pps ? err : err / 4;
+  }
+  _writer.last_local_ms = local_ms;
+  _writer.valid = true;
+  _writer.pps = pps;
+  _sync.write(_writer);
+}
+
+bool SlotScheduler::synced(uint32_t now) const {
+  SlotSync s = _sync.read();
+  return s.valid && (uint32_t)(now - s.last_local_ms) < SLOT_SYNC_STALE_MS;
+}
+
+uint32_t SlotScheduler::guardMs(uint32_t now) const {
+  SlotSync s = _sync.read();
+  if (!s.valid) return SLOT_GUARD_FREE_MS;
+
+  uint32_t age = now - s.last_local_ms;
+  uint32_t guard = (s.pps ? SLOT_GUARD_PPS_MS : SLOT_GUARD_NMEA_MS)
+                 + (uint32_t)((uint64_t)age * SLOT_DRIFT_PPM / 1000000);
+
+  // Past this the guard eats the whole window; the slot still opens on time
+  uint32_t cap = (_plan.slot_ms - _plan.airtime_ms - SLOT_TX_LATENCY_MS) / 2;
+  return (guard < cap) ? guard : cap;
+}
+
+uint64_t SlotScheduler::globalMs(const SlotSync& s, uint32_t now) const {
+  // Free-running before the first fix: the local clock is the reference
+  return s.valid ? (uint64_t)((int64_t)now + s.offset_ms) : (uint64_t)now;
+}
+
+bool SlotScheduler::canStart(uint32_t now, uint32_t airtime_ms) const {
+  if (_plan.frame_ms == 0) return true;
+
+  SlotSync s = _sync.read();
+  uint32_t guard = guardMs(now);
+  uint32_t phase = (uint32_t)(globalMs(s, now) % _plan.frame_ms);
+  uint32_t open = _plan.slot * _plan.slot_ms;
+  uint32_t close = open + _plan.slot_ms;
+
+  return phase >= open + guard
+      && phase + airtime_ms + SLOT_TX_LATENCY_MS + guard <= close;
+}
+
+size_t SlotScheduler::maxFrameBytes(uint32_t now) const {
+  uint32_t budget = _plan.slot_ms - SLOT_TX_LATENCY_MS - 2 * guardMs(now);
+  size_t len = 0;
+  while (len < 255 - SLOT_BRIDGE_OVERHEAD && frame_airtime_ms(len + 1) <= budget) len++;
+  return len;
+}
+
+uint64_t SlotScheduler::frameIndex(uint32_t now) const {
+  if (_plan.frame_ms == 0) return 0;
+  return globalMs(_sync.read(), now) / _plan.frame_ms;
+}
+
+uint32_t SlotScheduler::nextWindowOpen(uint32_t now) const {
+  if (_plan.frame_ms == 0) return now;
+
+  SlotSync s = _sync.read();
+  uint32_t phase = (uint32_t)(globalMs(s, now) % _plan.frame_ms);
+  uint32_t open = _plan.slot * _plan.slot_ms + guardMs(now);
+  uint32_t wait = (open > phase) ? open - phase : open + _plan.frame_ms - phase;
+  return now + wait;
+}
@@ -0,0 +1,392 @@
+#include "telemetry_frame.h"
+#include <math.h>
+#include <string.h>
+
+static void put_u16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)(v >> 0);
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)(v >> 0);
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+static uint16_t get_u16(const uint8_t *p) {
+  return (uint16_t)p[0] | ((uint16_t)p[1] << 8);
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+  return (uint32_t)p[0]
+       | ((uint32_t)p[1] << 8)
+       | ((uint32_t)p[2] << 16)
+       | ((uint32_t)p[3] << 24);
+}
+
+// Round and clamp a scaled value into [lo, hi]
+static long scale_clamp(double v, double scale, long lo, long hi) {
+  double s = v * scale;
+  if (s <= (double)lo) return lo;
+  if (s >= (double)hi) return hi;
+  return lround(s);
+}
+
+void telemetry_frame_fill(TelemetryFrame &f, uint8_t vehicle, uint32_t ts_ms,
+                          double lat, double lng, uint32_t sats,
+                          float temp, float hum, float accel_g,
+                          uint16_t light, bool tamper, bool shock, bool moving) {
+  f.vehicle = vehicle;
+  f.flags = (tamper ? TF_FLAG_TAMPER : 0)
+          | (shock  ? TF_FLAG_SHOCK  : 0)
+          | (moving ? TF_FLAG_MOVING : 0);
+  f.sats = (sats > TF_SATS_MAX) ? TF_SATS_MAX : (uint8_t)sats;
+  f.ts_ms = ts_ms;
+  f.lat_e7 = (int32_t)scale_clamp(lat, 1e7, -900000000L, 900000000L);
+  f.lng_e7 = (int32_t)scale_clamp(lng, 1e7, -1800000000L, 1800000000L);
+
+  // -999 (or NaN) keeps meaning "no data" on the wire
+  f.temp_dc = (isnan(temp) || temp < -900.0f)
+            ? (int16_t)TF_INVALID_I16
+            : (int16_t)scale_clamp(temp, 10.0, INT16_MIN + 1, INT16_MAX);
+  f.hum_dp = (isnan(hum) || hum < 0.0f)
+           ? (uint16_t)TF_INVALID_U16
+           : (uint16_t)scale_clamp(hum, 10.0, 0, 1000);
+  f.accel_mg = (isnan(accel_g) || accel_g < 0.0f)
+             ? (uint16_t)TF_INVALID_U16
+             : (uint16_t)scale_clamp(accel_g, 1000.0, 0, TF_INVALID_U16 - 1);
+  f.light = light;
+}
+
+size_t telemetry_frame_encode(const TelemetryFrame &f, uint8_t *out, size_t cap) {
+  if (out == NULL || cap < TELEMETRY_FRAME_SIZE) return 0;
+
+  uint8_t sats = (f.sats > TF_SATS_MAX) ? TF_SATS_MAX : f.sats;
+
+  out[0] = (uint8_t)((TELEMETRY_FRAME_VERSION << 4) | TELEMETRY_FRAME_TYPE_READING);
+  out[1] = f.vehicle;
+  out[2] = (uint8_t)((f.flags & TF_FLAG_MASK) | (sats << TF_SATS_SHIFT));
+  put_u32(&out[3],  f.ts_ms);
+  put_u32(&out[7],  (uint32_t)f.lat_e7);
+  put_u32(&out[11], (uint32_t)f.lng_e7);
+  put_u16(&out[15], (uint16_t)f.temp_dc);
+  put_u16(&out[17], f.hum_dp);
+  put_u16(&out[19], f.accel_mg);
+  put_u16(&out[21], f.light);
+  return TELEMETRY_FRAME_SIZE;
+}
+
+bool telemetry_frame_decode(const uint8_t *in, size_t len, TelemetryFrame &f) {
+  if (in == NULL || len < TELEMETRY_FRAME_SIZE) return false;
+  if ((in[0] >> 4) != TELEMETRY_FRAME_VERSION) return false;
+  if ((in[0] & 0x0F) != TELEMETRY_FRAME_TYPE_READING) return false;
+
+  f.vehicle  = in[1];
+  f.flags    = in[2] & TF_FLAG_MASK;
+  f.sats     = in[2] >> TF_SATS_SHIFT;
+  f.ts_ms    = get_u32(&in[3]);
+  f.lat_e7   = (int32_t)get_u32(&in[7]);
+  f.lng_e7   = (int32_t)get_u32(&in[11]);
+  f.temp_dc  = (int16_t)get_u16(&in[15]);
+  f.hum_dp   = get_u16(&in[17]);
+  f.accel_mg = get_u16(&in[19]);
+  f.light    = get_u16(&in[21]);
+  return true;
+}
+
+uint8_t telemetry_frame_type(const uint8_t *in, size_t len) {
+  if (in == NULL || len < 1) return 0;
+  if ((in[0] >> 4) != TELEMETRY_FRAME_VERSION) return 0;
+  return in[0] & 0x0F;
+}
+
+size_t telemetry_alert_encode(const TelemetryAlert &a, uint8_t *out, size_t cap) {
+  if (out == NULL || cap < TELEMETRY_ALERT_SIZE) return 0;
+
+  out[0] = (uint8_t)((TELEMETRY_FRAME_VERSION << 4) | TELEMETRY_FRAME_TYPE_ALERT);
+  out[1] = a.vehicle;
+  out[2] = a.type;
+  put_u32(&out[3],  a.ts_ms);
+  put_u16(&out[7],  a.value);
+  put_u32(&out[9],  (uint32_t)a.lat_e7);
+  put_u32(&out[13], (uint32_t)a.lng_e7);
+  return TELEMETRY_ALERT_SIZE;
+}
+
+bool telemetry_alert_decode(const uint8_t *in, size_t len, TelemetryAlert &a) {
+  if (len < TELEMETRY_ALERT_SIZE) return false;
+  if (telemetry_frame_type(in, len) != TELEMETRY_FRAME_TYPE_ALERT) return false;
+
+  a.vehicle = in[1];
+  a.type    = in[2];
+  a.ts_ms   = get_u32(&in[3]);
+  a.value   = get_u16(&in[7]);
+  a.lat_e7  = (int32_t)get_u32(&in[9]);
+  a.lng_e7  = (int32_t)get_u32(&in[13]);
+  return true;
+}
+
+// ===== BATCH FRAME =====
+static uint32_t zigzag(int32_t v) {
+  return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static int32_t unzigzag(uint32_t v) {
+  return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+// LEB128, at most 5 bytes. Returns bytes written, 0 if it does not fit.
+static size_t put_varint(uint8_t *p, size_t cap, uint32_t v) {
+  size_t n = 0;
+  do {
+    if (n >= cap) return 0;
+    uint8_t b = v & 0x7F;
+    v >>= 7;
+    p[n++] = v ? (uint8_t)(b | 0x80) : b;
+  } while (v);
+  return n;
+}
+
+static size_t get_varint(const uint8_t *p, size_t len, uint32_t &v) {
+  v = 0;
+  for (size_t n = 0; n < len && n < 5; n++) {
+    v |= (uint32_t)(p[n] & 0x7F) << (7 * n);
+    if ((p[n] & 0x80) == 0) return n + 1;
+  }
+  return 0;
+}
+
+static uint8_t flags_byte(const TelemetryFrame &f) {
+  uint8_t sats = (f.sats > TF_SATS_MAX) ? TF_SATS_MAX : f.sats;
+  return (uint8_t)((f.flags & TF_FLAG_MASK) | (sats << TF_SATS_SHIFT));
+}
+
+void telemetry_batch_reset(TelemetryBatch &b) {
+  b.len = 0;
+  b.count = 0;
+}
+
+bool telemetry_batch_add(TelemetryBatch &b, const TelemetryFrame &f) {
+  if (b.count >= TELEMETRY_BATCH_MAX_SAMPLES) return false;
+
+  if (b.count == 0) {
+    // The reading layout from offset 2 on is exactly the absolute sample
+    uint8_t tmp[TELEMETRY_FRAME_SIZE];
+    telemetry_frame_encode(f, tmp, sizeof(tmp));
+    b.buf[0] = (uint8_t)((TELEMETRY_FRAME_VERSION << 4) | TELEMETRY_FRAME_TYPE_BATCH);
+    b.buf[1] = f.vehicle;
+    memcpy(&b.buf[3], &tmp[2], TELEMETRY_FRAME_SIZE - 2);
+    b.len = TELEMETRY_BATCH_HDR_SIZE;
+  } else {
+    const TelemetryFrame &p = b.last;
+    uint32_t deltas[7] = {
+      zigzag((int32_t)(f.ts_ms - p.ts_ms)),
+      zigzag((int32_t)((uint32_t)f.lat_e7 - (uint32_t)p.lat_e7)),
+      zigzag((int32_t)((uint32_t)f.lng_e7 - (uint32_t)p.lng_e7)),
+      zigzag((int16_t)(uint16_t)(f.temp_dc - p.temp_dc)),
+      zigzag((int16_t)(uint16_t)(f.hum_dp - p.hum_dp)),
+      zigzag((int16_t)(uint16_t)(f.accel_mg - p.accel_mg)),
+      zigzag((int16_t)(uint16_t)(f.light - p.light)),
+    };
+
+    size_t pos = b.len;
+    if (pos >= sizeof(b.buf)) return false;
+    b.buf[pos++] = flags_byte(f);
+    for (int i = 0; i < 7; i++) {
+      size_t n = put_varint(&b.buf[pos], sizeof(b.buf) - pos, deltas[i]);
+      if (n == 0) return false;   // b.len untouched, the sample is simply not added
+      pos += n;
+    }
+    b.len = pos;
+  }
+
+  b.last = f;
+  b.count++;
+  b.buf[2] = b.count;
+  return true;
+}
+
+size_t telemetry_batch_decode(const uint8_t *in, size_t len, TelemetryFrame *out, size_t max_out) {
+  if (in == NULL || out == NULL || len < TELEMETRY_BATCH_HDR_SIZE) return 0;
+  if (telemetry_frame_type(in, len) != TELEMETRY_FRAME_TYPE_BATCH) return 0;
+
+  size_t count = in[2];
+  if (count == 0 || count > max_out) return 0;
+
+  // Rebuild sample 0 as a reading frame and reuse its decoder
+  uint8_t tmp[TELEMETRY_FRAME_SIZE];
+  tmp[0] = (uint8_t)((TELEMETRY_FRAME_VERSION << 4) | TELEMETRY_FRAME_TYPE_READING);
+  tmp[1] = in[1];
+  memcpy(&tmp[2], &in[3], TELEMETRY_FRAME_SIZE - 2);
+  telemetry_frame_decode(tmp, sizeof(tmp), out[0]);
+
+  size_t pos = TELEMETRY_BATCH_HDR_SIZE;
+  for (size_t k = 1; k < count; k++) {
+    if (pos >= len) return 0;
+    TelemetryFrame &f = out[k];
+    f = out[k - 1];
+    f.flags = in[pos] & TF_FLAG_MASK;
+    f.sats  = in[pos] >> TF_SATS_SHIFT;
+    pos++;
+
+    int32_t d[7];
+    for (int i = 0; i < 7; i++) {
+      uint32_t v;
+      size_t n = get_varint(&in[pos], len - pos, v);
+      if (n == 0) return 0;
+      d[i] = unzigzag(v);
+      pos += n;
+    }
+    f.ts_ms   += (uint32_t)d[0];
+    f.lat_e7   = (int32_t)((uint32_t)f.lat_e7 + (uint32_t)d[1]);
+    f.lng_e7   = (int32_t)((uint32_t)f.lng_e7 + (uint32_t)d[2]);
+    f.temp_dc  = (int16_t)(uint16_t)(f.temp_dc + d[3]);
+    f.hum_dp   = (uint16_t)(f.hum_dp + d[4]);
+    f.accel_mg = (uint16_t)(f.accel_mg + d[5]);
+    f.light    = (uint16_t)(f.light + d[6]);
+  }
+  return count;
+}
+
+// ===== DELTA FRAME =====
+static bool moved_i32(int32_t cur, int32_t sent, int32_t band) {
+  int64_t d = (int64_t)cur - (int64_t)sent;
+  return d > band || d < -(int64_t)band;
+}
+
+// invalid is the "no data" marker: any transition to or from it counts
+static bool moved_u16(uint16_t cur, uint16_t sent, uint16_t band, uint16_t invalid) {
+  if ((cur == invalid) != (sent == invalid)) return true;
+  int32_t d = (int32_t)cur - (int32_t)sent;
+  return d > band || d < -(int32_t)band;
+}
+
+// Signed fields (temperature): the difference is taken in int32 so a zero
+// crossing is a small step, not a wrap through 65535
+static bool moved_i16(int16_t cur, int16_t sent, uint16_t band, int16_t invalid) {
+  if ((cur == invalid) != (sent == invalid)) return true;
+  int32_t d = (int32_t)cur - (int32_t)sent;
+  return d > band || d < -(int32_t)band;
+}
+
+void telemetry_delta_reset(TelemetryDeltaEncoder &e) {
+  e.sent = TelemetryFrame();
+  e.primed = false;
+  e.last_full_ms = 0;
+}
+
+size_t telemetry_delta_encode(TelemetryDeltaEncoder &e, const TelemetryDeadband &db,
+                              uint32_t heartbeat_ms, const TelemetryFrame &f,
+                              uint8_t *out, size_t cap) {
+  if (out == NULL || cap < TELEMETRY_DELTA_MAX_SIZE) return 0;
+
+  uint8_t has = 0;
+  if (moved_i32(f.lat_e7, e.sent.lat_e7, db.pos_e7)) has |= TF_HAS_LAT;
+  if (moved_i32(f.lng_e7, e.sent.lng_e7, db.pos_e7)) has |= TF_HAS_LNG;
+  if (moved_i16(f.temp_dc, e.sent.temp_dc, db.temp_dc, TF_INVALID_I16)) has |= TF_HAS_TEMP;
+  if (moved_u16(f.hum_dp, e.sent.hum_dp, db.hum_dp, TF_INVALID_U16)) has |= TF_HAS_HUM;
+  if (moved_u16(f.accel_mg, e.sent.accel_mg, db.accel_mg, TF_INVALID_U16)) has |= TF_HAS_ACCEL;
+  if (moved_u16(f.light, e.sent.light, db.light, TF_INVALID_U16)) has |= TF_HAS_LIGHT;
+
+  // Heartbeat, or everything moved anyway: a full reading is smaller
+  if (!e.primed || f.ts_ms - e.last_full_ms >= heartbeat_ms || has == TF_HAS_ALL) {
+    e.sent = f;
+    e.last_full_ms = f.ts_ms;
+    e.primed = true;
+    return telemetry_frame_encode(f, out, cap);
+  }
+
+  // Satellite count alone is not worth a frame; tamper/shock/moving are
+  if (has == 0 && (f.flags & TF_FLAG_MASK) == (e.sent.flags & TF_FLAG_MASK)) return 0;
+
+  out[0] = (uint8_t)((TELEMETRY_FRAME_VERSION << 4) | TELEMETRY_FRAME_TYPE_DELTA);
+  out[1] = f.vehicle;
+  out[2] = flags_byte(f);
+  put_u32(&out[3], f.ts_ms);
+  out[7] = has;
+  size_t pos = TELEMETRY_DELTA_HDR_SIZE;
+
+  if (has & TF_HAS_LAT)   { put_u32(&out[pos], (uint32_t)f.lat_e7);  pos += 4; e.sent.lat_e7 = f.lat_e7; }
+  if (has & TF_HAS_LNG)   { put_u32(&out[pos], (uint32_t)f.lng_e7);  pos += 4; e.sent.lng_e7 = f.lng_e7; }
+  if (has & TF_HAS_TEMP)  { put_u16(&out[pos], (uint16_t)f.temp_dc); pos += 2; e.sent.temp_dc = f.temp_dc; }
+  if (has & TF_HAS_HUM)   { put_u16(&out[pos], f.hum_dp);            pos += 2; e.sent.hum_dp = f.hum_dp; }
+  if (has & TF_HAS_ACCEL) { put_u16(&out[pos], f.accel_mg);          pos += 2; e.sent.accel_mg = f.accel_mg; }
+  if (has & TF_HAS_LIGHT) { put_u16(&out[pos], f.light);             pos += 2; e.sent.light = f.light; }
+  e.sent.flags = f.flags;
+  e.sent.sats = f.sats;
+  return pos;
+}
+
+bool telemetry_delta_apply(const uint8_t *in, size_t len, TelemetryFrame &state) {
+  if (in == NULL || len < TELEMETRY_DELTA_HDR_SIZE) return false;
+  if (telemetry_frame_type(in, len) != TELEMETRY_FRAME_TYPE_DELTA) return false;
+
+  uint8_t has = in[7];
+  size_t need = TELEMETRY_DELTA_HDR_SIZE
+              + ((has & TF_HAS_LAT)   ? 4 : 0) + ((has & TF_HAS_LNG)   ? 4 : 0)
+              + ((has & TF_HAS_TEMP)  ? 2 : 0) + ((has & TF_HAS_HUM)   ? 2 : 0)
+              + ((has & TF_HAS_ACCEL) ? 2 : 0) + ((has & TF_HAS_LIGHT) ? 2 : 0);
+  if ((has & ~TF_HAS_ALL) != 0 || len < need) return false;
+
+  state.vehicle = in[1];
+  state.flags   = in[2] & TF_FLAG_MASK;
+  state.sats    = in[2] >> TF_SATS_SHIFT;
+  state.ts_ms   = get_u32(&in[3]);
+  size_t pos = TELEMETRY_DELTA_HDR_SIZE;
+
+  if (has & TF_HAS_LAT)   { state.lat_e7   = (int32_t)get_u32(&in[pos]); pos += 4; }
+  if (has & TF_HAS_LNG)   { state.lng_e7   = (int32_t)get_u32(&in[pos]); pos += 4; }
+  if (has & TF_HAS_TEMP)  { state.temp_dc  = (int16_t)get_u16(&in[pos]); pos += 2; }
+  if (has & TF_HAS_HUM)   { state.hum_dp   = get_u16(&in[pos]);          pos += 2; }
+  if (has & TF_HAS_ACCEL) { state.accel_mg = get_u16(&in[pos]);          pos += 2; }
+  if (has & TF_HAS_LIGHT) { state.light    = get_u16(&in[pos]);          pos += 2; }
+  return true;
+}
+
+void telemetry_history_reset(TelemetryDeltaHistory &h) {
+  memset(&h, 0, sizeof(h));
+}
+
+void telemetry_history_put(TelemetryDeltaHistory &h, uint16_t epoch, uint32_t seq, const TelemetryFrame &f) {
+  // A replayed full reading that is already kept needs no second entry
+  for (uint8_t i = 0; i < h.used; i++) {
+    if (h.epoch[i] == epoch && h.seq[i] == seq) {
+      h.f[i] = f;
+      return;
+    }
+  }
+  h.f[h.next] = f;
+  h.epoch[h.next] = epoch;
+  h.seq[h.next] = seq;
+  h.next = (uint8_t)((h.next + 1) % TELEMETRY_DELTA_HISTORY);
+  if (h.used < TELEMETRY_DELTA_HISTORY) h.used++;
+}
+
+bool telemetry_history_base(const TelemetryDeltaHistory &h, uint16_t epoch, uint32_t seq,
+                            TelemetryFrame &base) {
+  int best = -1;
+  for (uint8_t i = 0; i < h.used; i++) {
+    if (h.epoch[i] != epoch || (int32_t)(h.seq[i] - seq) >= 0) continue;
+    if (best < 0 || (int32_t)(h.seq[i] - h.seq[best]) > 0) best = i;
+  }
+  if (best < 0) return false;
+  base = h.f[best];
+  return true;
+}
+
+double telemetry_frame_lat(const TelemetryFrame &f) { return f.lat_e7 / 1e7; }
+
+double telemetry_frame_lng(const TelemetryFrame &f) { return f.lng_e7 / 1e7; }
+
+float telemetry_frame_temp(const TelemetryFrame &f) {
+  return (f.temp_dc == (int16_t)TF_INVALID_I16) ? -999.0f : f.temp_dc / 10.0f;
+}
+
+float telemetry_frame_hum(const TelemetryFrame &f) {
+  return (f.hum_dp == TF_INVALID_U16) ? -999.0f : f.hum_dp / 10.0f;
+}
+
+float telemetry_frame_accel(const TelemetryFrame &f) {
+  return (f.accel_mg == TF_INVALID_U16) ? -999.0f : f.accel_mg / 1000.0f;
+}
@@ -0,0 +1,432 @@
+#include "uplink.h"
+#include "security.h"
+#include "ldr.h"
+#include "vehicle_config.h"
+#include "sensor_Data.h"
+#include "telemetry_frame.h"
+#include "slot_scheduler.h"
+#include "backlog.h"
+#include <HardwareSerial.h>
+#include <atomic>
+
+// Globals owned by main.cpp (or the native host harness)
+extern HardwareSerial LORA_SER;
+extern LDRModule ldr;
+extern volatile uint32_t g_send_interval_ms;
+
+struct PendingAlert {
+  uint8_t type;
+  uint16_t value;
+  uint32_t ts_ms;
+};
+
+static QueueHandle_t s_alertQueue = NULL;
+static TaskHandle_t s_sendTask = NULL;
+static std::atomic<bool> s_shockPending(false);
+static UplinkAlertStats s_alertStats = { 0, 0, 0, 0, 0 };   // written by the send task only
+static std::atomic<uint32_t> s_raised(0), s_coalesced(0), s_dropped(0);
+
+// AEAD nonce state: epoch bumped once per boot, seq per sealed frame.
+// Only the send task seals, so no locking.
+static uint16_t s_epoch = 0;
+static uint32_t s_seq = 0;
+
+// Write an already sealed packet to the TX bridge as one Base64 line
+static size_t uplink_write_packet(const uint8_t* pkt, size_t pkt_len, bool urgent) {
+  char line[FRAME_MAX_B64];
+  size_t line_len = sealedToBase64(pkt, pkt_len, line, sizeof(line));
+  if (line_len == 0) {
+    Serial.println("[ERROR] sealedToBase64 failed!");
+    return 0;
+  }
+
+  if (urgent) LORA_SER.write((uint8_t)UPLINK_URGENT_MARK);
+  LORA_SER.write((const uint8_t*)line, line_len);
+  LORA_SER.println();
+  LORA_SER.flush();
+  return line_len;
+}
+
+// Seal a frame on the stack, send it and keep it until the gateway acks it
+static size_t uplink_write_sealed(const uint8_t* payload, size_t n, bool urgent) {
+  AeadHeader hdr = { gVehicleConfig.getVehicleNumber(), s_epoch, s_seq++ };
+  uint8_t pkt[FRAME_MAX_SEALED];
+  size_t pkt_len = sealFrame(hdr, payload, n, pkt, sizeof(pkt));
+  if (pkt_len == 0) {
+    Serial.println("[ERROR] sealFrame failed!");
+    return 0;
+  }
+
+  size_t line_len = uplink_write_packet(pkt, pkt_len, urgent);
+  if (line_len > 0) backlog_track(pkt, pkt_len, millis());
+  return line_len;
+}
+
+// Bridge -> ESP32 lines share the bridge's debug console; only "@" lines
+// (gateway beacons) are ours. Send task only.
+static void uplink_poll_bridge(uint32_t now) {
+  static char line[BACKLOG_LINE_MAX];
+  static size_t len = 0;
+  static bool overflow = false;
+
+  while (LORA_SER.available()) {
+    char c = (char)LORA_SER.read();
+    if (c == '\r') continue;
+    if (c != '\n') {
+      if (len < sizeof(line) - 1) line[len++] = c;
+      else overflow = true;
+      continue;
+    }
+    line[len] = '\0';
+    if (!overflow && line[0] == '@') backlog_on_line(line, now);
+    len = 0;
+    overflow = false;
+  }
+}
+
+// Snapshot the sensors into a reading frame
+static void uplink_sample(TelemetryFrame &frame) {
+  SensorData localData = sensor_data_snapshot();   // snapshot toàn bộ struct
+
+  // extract ra biến local
+  float temp = localData.temp;
+  float hum = localData.hum;
+  float accel_g = localData.accel;
+  double lat = localData.lat;
+  double lng = localData.lng;
+  uint32_t sats = localData.sats;
+
+  if (isnan(temp) || temp < -100 || temp > 150) {
+    Serial.println("[DHT11-ERROR] Sensor read failed (no valid data)");
+    temp = -999.0f;
+  }
+  if (isnan(hum) || hum < 0 || hum > 100) {
+    hum = -999.0f;
+  }
+  if (accel_g < -900.0f) {
+      Serial.println("[ADXL345-ERROR] Sensor data unavailable");
+      accel_g = -999.0f;
+  }
+
+  // read tamper/light status
+  uint16_t light_level = ldr.readSmoothed();
+  bool is_tamper = ldr.getTamperState();
+
+  // Shock events are counted by the ADXL task; report any since the last send
+  static uint32_t last_shock_count = 0;
+  bool shock = localData.shock_detected || (localData.shock_count != last_shock_count);
+  last_shock_count = localData.shock_count;
+
+  uint32_t ts = millis();
+  telemetry_frame_fill(frame, gVehicleConfig.getVehicleNumber(), ts,
+                       lat, lng, sats, temp, hum, accel_g,
+                       light_level, is_tamper,
+                       shock, localData.is_moving);
+}
+
+static size_t uplink_send_reading(const TelemetryFrame &frame) {
+  uint8_t payload[TELEMETRY_FRAME_SIZE];
+  size_t n = telemetry_frame_encode(frame, payload, sizeof(payload));
+
+  if (n == 0) {
+    Serial.println("[ERROR] telemetry_frame_encode failed!");
+    return 0;
+  }
+
+  size_t line_len = uplink_write_sealed(payload, n, false);
+  Serial.printf("[ESP32->LORA] Binary frame AES-128 CCM sent (%u bytes on air)\r\n",
+                (unsigned)(n + AEAD_OVERHEAD));
+  return line_len;
+}
+
+size_t uplink_send_once() {
+  TelemetryFrame frame;
+  uplink_sample(frame);
+  return uplink_send_reading(frame);
+}
+
+// Send-on-delta state (send task only)
+static TelemetryDeltaEncoder s_delta;
+static UplinkDeltaStats s_deltaStats = { 0, 0, 0, 0 };
+static const TelemetryDeadband s_deadband = {
+  UPLINK_DEADBAND_POS_E7, UPLINK_DEADBAND_TEMP_DC, UPLINK_DEADBAND_HUM_DP,
+  UPLINK_DEADBAND_ACCEL, UPLINK_DEADBAND_LIGHT
+};
+
+size_t uplink_send_on_delta(uint32_t heartbeat_ms) {
+  TelemetryFrame frame;
+  uplink_sample(frame);
+
+  uint8_t payload[TELEMETRY_DELTA_MAX_SIZE];
+  size_t n = telemetry_delta_encode(s_delta, s_deadband, heartbeat_ms, frame, payload, sizeof(payload));
+  if (n == 0) {
+    s_deltaStats.suppressed++;
+    return 0;
+  }
+
+  size_t line_len = uplink_write_sealed(payload, n, false);
+  if (line_len == 0) return 0;
+
+  bool full = telemetry_frame_type(payload, n) == TELEMETRY_FRAME_TYPE_READING;
+  if (full) s_deltaStats.full++;
+  else s_deltaStats.delta++;
+  s_deltaStats.bytes_on_air += n + AEAD_OVERHEAD;
+  Serial.printf("[ESP32->LORA] %s frame sent (%u bytes on air)\r\n",
+                full ? "Full" : "Delta", (unsigned)(n + AEAD_OVERHEAD));
+  return line_len;
+}
+
+UplinkDeltaStats uplink_delta_stats() {
+  return s_deltaStats;
+}
+
+// Readings waiting for the next batched uplink (send task only)
+static TelemetryBatch s_batch;
+static uint32_t s_batchFirstMs = 0;
+
+size_t uplink_flush_batch() {
+  if (s_batch.count == 0) return 0;
+
+  size_t line_len;
+  if (s_batch.count == 1) {
+    // A lone reading is cheaper as a plain frame
+    line_len = uplink_send_reading(s_batch.last);
+  } else {
+    line_len = uplink_write_sealed(s_batch.buf, s_batch.len, false);
+    Serial.printf("[ESP32->LORA] Batch of %u readings sent (%u bytes on air, %u B/reading)\r\n",
+                  s_batch.count, (unsigned)(s_batch.len + AEAD_OVERHEAD),
+                  (unsigned)((s_batch.len + AEAD_OVERHEAD) / s_batch.count));
+  }
+  telemetry_batch_reset(s_batch);
+  return line_len;
+}
+
+size_t uplink_collect(uint8_t batch_size, uint32_t max_latency_ms, uint32_t interval_ms, size_t max_frame) {
+  TelemetryFrame frame;
+  uplink_sample(frame);
+
+  size_t line_len = 0;
+  if (!telemetry_batch_add(s_batch, frame)) {
+    // Frame full before K readings: ship what we have and start over
+    line_len = uplink_flush_batch();
+    telemetry_batch_add(s_batch, frame);
+  }
+  if (s_batch.count == 1) s_batchFirstMs = frame.ts_ms;
+
+  // Flush now if waiting for the next sample would break the latency bound
+  uint32_t age = frame.ts_ms - s_batchFirstMs;
+  bool slot_full = s_batch.len + TELEMETRY_BATCH_SAMPLE_MAX + AEAD_OVERHEAD > max_frame;
+  if (s_batch.count >= batch_size || age + interval_ms > max_latency_ms || slot_full) {
+    line_len += uplink_flush_batch();
+  }
+  return line_len;
+}
+
+bool uplink_raise_alert(uint8_t type, uint16_t value) {
+  if (s_alertQueue == NULL) return false;
+  s_raised++;
+
+  // A burst of shocks only needs one alert on air; the periodic frame
+  // still carries the shock flag and the ADXL task keeps the count.
+  if (type == UPLINK_ALERT_SHOCK && s_shockPending.exchange(true)) {
+    s_coalesced++;
+    return true;
+  }
+
+  PendingAlert a = { type, value, (uint32_t)millis() };
+  BaseType_t ok = (type == UPLINK_ALERT_TAMPER)
+                ? xQueueSendToFront(s_alertQueue, &a, 0)
+                : xQueueSendToBack(s_alertQueue, &a, 0);
+  if (ok != pdPASS) {
+    if (type == UPLINK_ALERT_SHOCK) s_shockPending = false;
+    s_dropped++;
+    return false;
+  }
+
+  if (s_sendTask != NULL) xTaskNotifyGive(s_sendTask);
+  return true;
+}
+
+UplinkAlertStats uplink_alert_stats() {
+  UplinkAlertStats st = s_alertStats;
+  st.raised = s_raised;
+  st.coalesced = s_coalesced;
+  st.dropped = s_dropped;
+  return st;
+}
+
+static size_t uplink_send_alert(const PendingAlert &pa) {
+  if (pa.type == UPLINK_ALERT_SHOCK) s_shockPending = false;
+
+  GpsSample gps = sensor_data_snapshot_gps();
+
+  TelemetryAlert alert;
+  alert.vehicle = gVehicleConfig.getVehicleNumber();
+  alert.type = pa.type;
+  alert.ts_ms = pa.ts_ms;
+  alert.value = pa.value;
+  alert.lat_e7 = (int32_t)lround(gps.lat * 1e7);
+  alert.lng_e7 = (int32_t)lround(gps.lng * 1e7);
+
+  uint8_t payload[TELEMETRY_ALERT_SIZE];
+  size_t n = telemetry_alert_encode(alert, payload, sizeof(payload));
+  if (n == 0) return 0;
+
+  size_t line_len = uplink_write_sealed(payload, n, true);
+  if (line_len == 0) return 0;
+
+  uint32_t waited = (uint32_t)millis() - pa.ts_ms;
+  s_alertStats.sent++;
+  if (waited > s_alertStats.max_wait_ms) s_alertStats.max_wait_ms = waited;
+  Serial.printf("[ESP32->LORA] ALERT type=%u value=%u sent after %lums\r\n",
+                pa.type, pa.value, (unsigned long)waited);
+  return line_len;
+}
+
+// Airtime of a sealed frame on the bridge, for the slot fit check
+static uint32_t uplink_airtime_ms(size_t payload_len) {
+  return lora_airtime_ms(payload_len + AEAD_OVERHEAD + SLOT_BRIDGE_OVERHEAD, SLOT_LORA_SF,
+                         SLOT_LORA_BW_HZ, SLOT_LORA_CR, SLOT_LORA_PREAMBLE);
+}
+
+void TaskLoraSend(void *pv) {
+  (void)pv;
+  delay(100);
+  while (LORA_SER.available()) LORA_SER.read();
+
+  // Convoy-wide plan; batches are still cut to what the window carries
+  gSlotScheduler.configure(SLOT_COUNT, gVehicleConfig.getSlot(), SLOT_PAYLOAD_MAX, SLOT_FRAME_MIN_MS);
+  const SlotPlan& plan = gSlotScheduler.plan();
+
+  // Our own reading period in superframes, and the largest reading we send
+  uint32_t every = (g_send_interval_ms + plan.frame_ms / 2) / plan.frame_ms;
+  if (every == 0) every = 1;
+  uint32_t reading_airtime = (gVehicleConfig.getBatchSize() > 1)
+                               ? plan.airtime_ms : uplink_airtime_ms(TELEMETRY_FRAME_SIZE);
+
+  // The superframe is convoy-wide, so the reading period snaps to it
+  uint32_t period = every * plan.frame_ms;
+  uint32_t off = (period > g_send_interval_ms) ? period - g_send_interval_ms : g_send_interval_ms - period;
+  if (off > g_send_interval_ms / 20) {
+    Serial.printf("[TDMA] *** WARNING: send interval %lums NOT honoured: readings every %lums "
+                  "(%u-slot superframe %lums). Fewer SLOT_COUNT or a longer interval fixes it ***\r\n",
+                  (unsigned long)g_send_interval_ms, (unsigned long)period, plan.n_slots,
+                  (unsigned long)plan.frame_ms);
+  }
+  uint32_t replay_need = reading_airtime + uplink_airtime_ms(TELEMETRY_FRAME_SIZE)
+                       + 2 * SLOT_TX_LATENCY_MS + 2 * SLOT_GUARD_FREE_MS;
+  if (every == 1 && replay_need > plan.slot_ms) {
+    Serial.printf("[TDMA] Slot %lums holds no backlog replay beside a reading: replays only go "
+                  "out in superframes without one\r\n", (unsigned long)plan.slot_ms);
+  }
+
+  uint64_t last_frame = UINT64_MAX;
+  uint32_t last_periodic = millis() - every * plan.frame_ms;
+  uint32_t busy_until = millis();   // previous frame still on air until then
+  bool periodic_starved = false;    // an alert took the slot the last reading was due in
+
+  for (;;) {
+    uint32_t now = millis();
+    uplink_poll_bridge(now);
+    backlog_service(now);
+
+    // Delta frames assume the gateway holds the last full reading; after a
+    // link loss start again from a full one
+    if (backlog_link_lost(now)) telemetry_delta_reset(s_delta);
+
+    if ((int32_t)(now - busy_until) >= 0 &&
+        gSlotScheduler.canStart(now, uplink_airtime_ms(TELEMETRY_ALERT_SIZE))) {
+      // One periodic send every `every` superframes; the time guard stops a
+      // backwards re-sync from sending the same frame twice
+      uint64_t frame = gSlotScheduler.frameIndex(now);
+      bool periodic_due = frame != last_frame && (last_frame == UINT64_MAX || frame - last_frame >= every) &&
+                          now - last_periodic >= every * plan.frame_ms - plan.frame_ms / 2;
+      bool periodic_fits = gSlotScheduler.canStart(now, reading_airtime);
+
+      // Alerts go first, but only while our slot is open, and not twice in
+      // a row ahead of an overdue reading
+      PendingAlert pa;
+      if (!(periodic_due && periodic_fits && periodic_starved) &&
+          xQueueReceive(s_alertQueue, &pa, 0) == pdPASS) {
+        uplink_send_alert(pa);
+        busy_until = now + uplink_airtime_ms(TELEMETRY_ALERT_SIZE) + SLOT_TX_LATENCY_MS;
+        if (periodic_due) periodic_starved = true;
+        continue;
+      }
+
+      // Backlog replay: never instead of a due reading, only in what is left
+      // of the window (after this superframe's reading when the slot is wide
+      // enough, or in a slot batching or send-on-delta left empty).
+      size_t bl_len = 0;
+      const uint8_t* bl = !periodic_due ? backlog_peek(now, bl_len) : NULL;
+      if (bl != NULL && gSlotScheduler.canStart(now, uplink_airtime_ms(bl_len - AEAD_OVERHEAD)) &&
+          uplink_write_packet(bl, bl_len, false) > 0) {
+        backlog_replayed(now);
+        busy_until = now + uplink_airtime_ms(bl_len - AEAD_OVERHEAD) + SLOT_TX_LATENCY_MS;
+        continue;
+      }
+
+      if (periodic_due && periodic_fits) {
+        periodic_starved = false;
+        last_frame = frame;
+        last_periodic = now;
+
+        uint8_t k = gVehicleConfig.getBatchSize();
+        uint32_t heartbeat = gVehicleConfig.getDeltaHeartbeatMs();
+        size_t sent;
+        if (k > 1) {
+          sent = uplink_collect(k, gVehicleConfig.getBatchMaxLatencyMs(), plan.frame_ms,
+                                gSlotScheduler.maxFrameBytes(now));
+        } else {
+          uplink_flush_batch();   // batching turned off at runtime
+          if (heartbeat > 0) {
+            sent = uplink_send_on_delta(heartbeat);
+          } else {
+            telemetry_delta_reset(s_delta);
+            sent = uplink_send_once();
+          }
+        }
+        if (sent > 0) busy_until = now + reading_airtime + SLOT_TX_LATENCY_MS;
+        continue;
+      }
+
+    }
+
+    // Sleep until our next TX window (or the end of the frame on air),
+    // an alert notification wakes us early
+    uint32_t wake = gSlotScheduler.nextWindowOpen(now);
+    if ((int32_t)(busy_until - now) > 0 && (int32_t)(busy_until - wake) < 0) wake = busy_until;
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wake - now));
+  }
+}
+
+void startLoraUplink(unsigned long stackSize, UBaseType_t priority) {
+  if (s_alertQueue == NULL) {
+    s_alertQueue = xQueueCreate(UPLINK_ALERT_QUEUE_LEN, sizeof(PendingAlert));
+  }
+  if (!gVehicleConfig.isProvisioned()) {
+    // The vehicle number is the per-unit part of the nonce; a default one
+    // is shared with every other unprovisioned unit under the same key
+    Serial.println("[SYNC] Vehicle number not provisioned on this unit, uplink NOT started");
+    return;
+  }
+  if (gVehicleConfig.getSlot() == VEHICLE_SLOT_NONE) {
+    // Sending anyway would collide with another vehicle every superframe
+    Serial.printf("[TDMA] Vehicle #%u has no slot among %u, uplink NOT started\r\n",
+                  gVehicleConfig.getVehicleNumber(), (unsigned)SLOT_COUNT);
+    return;
+  }
+  if (s_epoch == 0) {
+    s_epoch = gVehicleConfig.getBootEpoch();
+    if (s_epoch == 0) {
+      // Sealing under an epoch that is not on flash would repeat nonces
+      // after the next reset; alerts just queue up and are dropped
+      Serial.println("[SYNC] No boot epoch, uplink NOT started");
+      return;
+    }
+    Serial.printf("[SYNC] Boot epoch: %u\r\n", s_epoch);
+  }
+  telemetry_batch_reset(s_batch);
+  telemetry_delta_reset(s_delta);
+  xTaskCreate(TaskLoraSend, "LoraSend", stackSize, NULL, priority, &s_sendTask);
+}
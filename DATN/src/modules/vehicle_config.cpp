@@ -1,10 +1,30 @@
 #include "vehicle_config.h"
+#include "telemetry_frame.h"
+#include "slot_scheduler.h"
+#include <EEPROM.h>
+#include <esp_system.h>
 
 // Global instance
 VehicleConfig gVehicleConfig;
 
-VehicleConfig::VehicleConfig() : vehicle_num(1) {
+// Loud boot/config message for a vehicle number the convoy plan has no slot for
+static void warn_no_slot(uint8_t vehicle_num) {
+    Serial.printf("[VEHICLE] *** ERROR: vehicle #%u has no TDMA slot (SLOT_COUNT %u), uplink will NOT start. "
+                  "Build the convoy with -DSLOT_COUNT=%u or use setSlot() ***\r\n",
+                  vehicle_num, (unsigned)SLOT_COUNT, vehicle_num);
+}
+
+static void unit_mac(uint8_t mac[6]) {
+    if (esp_efuse_mac_get_default(mac) != ESP_OK) memset(mac, 0, 6);
+}
+
+VehicleConfig::VehicleConfig()
+    : vehicle_num(1), provisioned(false), boot_epoch(0), batch_size(VEHICLE_BATCH_SIZE), batch_latency_s(VEHICLE_BATCH_LATENCY_S),
+      delta_heartbeat_s(VEHICLE_DELTA_HEARTBEAT_S), send_interval_ms(VEHICLE_SEND_INTERVAL_MS),
+      tamper_threshold(VEHICLE_TAMPER_THRESHOLD), slot(VEHICLE_SLOT_AUTO), mac_key_len(0), has_keys(false) {
     memset(device_id, 0, sizeof(device_id));
+    memset(aes_key, 0, sizeof(aes_key));
+    memset(mac_key, 0, sizeof(mac_key));
     // Default device ID based on compile-time macro if available
     #ifdef VEHICLE_DEVICE_ID
         strncpy(device_id, VEHICLE_DEVICE_ID, sizeof(device_id) - 1);
@@ -14,21 +34,20 @@ VehicleConfig::VehicleConfig() : vehicle_num(1) {
 }
 
 void VehicleConfig::begin() {
-    EEPROM.begin(EEPROM_SIZE);
-    delay(10);
-    
-    // Check if EEPROM has been initialized
-    uint8_t magic = EEPROM.read(ADDR_MAGIC);
-    if (magic == MAGIC_BYTE) {
-        // Load from EEPROM
-        loadFromEEPROM();
-    } else {
-        // First time: save default values
-        Serial.println("[VEHICLE] First boot - initializing EEPROM with defaults");
-        saveToEEPROM();
+    // One read of the store; everything below works on the RAM copy
+    if (!gConfigStore.begin()) {
+        Serial.println("[VEHICLE] No stored config - importing EEPROM / using defaults");
+        importLegacyEEPROM();
     }
+    loadFromStore();
     
-    Serial.printf("[VEHICLE] Initialized: %s (Vehicle #%d)\r\n", device_id, vehicle_num);
+    Serial.printf("[VEHICLE] Initialized: %s (Vehicle #%d, config gen %lu)\r\n", device_id, vehicle_num,
+                  (unsigned long)gConfigStore.stats().generation);
+    if (getSlot() == VEHICLE_SLOT_NONE) warn_no_slot(vehicle_num);
+}
+
+void VehicleConfig::commit() {
+    gConfigStore.commit();
 }
 
 const char* VehicleConfig::getDeviceId() {
@@ -48,12 +67,23 @@ void VehicleConfig::setDeviceId(const char* id) {
     strncpy(device_id, id, sizeof(device_id) - 1);
     device_id[sizeof(device_id) - 1] = '\0';
     
-    saveToEEPROM();
+    gConfigStore.set(CFG_DEVICE_ID, device_id, strlen(device_id));
+    commit();
     Serial.printf("[VEHICLE] Device ID updated to: %s\r\n", device_id);
 }
 
 void VehicleConfig::setDeviceIdFromNodeId(uint8_t node_id) {
+    // Binary uplink frames carry the vehicle number instead of the
+    // device_id string, so keep both identities in sync.
+    if (node_id >= 1 && node_id <= 99) {
+        vehicle_num = node_id;
+        gConfigStore.setU8(CFG_VEHICLE_NUM, vehicle_num);
+        bindToUnit();
+        if (getSlot() == VEHICLE_SLOT_NONE) warn_no_slot(vehicle_num);
+    }
+    
     // Convert numeric node_id to string format: "Transport-123"
+    // (committed together with the vehicle number)
     char buf[32];
     snprintf(buf, sizeof(buf), "Transport-%d", (int)node_id);
     setDeviceId(buf);
@@ -68,6 +98,9 @@ void VehicleConfig::setVehicleNumber(uint8_t num) {
     if (num < 1 || num > 99) return;
     
     vehicle_num = num;
+    gConfigStore.setU8(CFG_VEHICLE_NUM, vehicle_num);
+    bindToUnit();
+    if (getSlot() == VEHICLE_SLOT_NONE) warn_no_slot(vehicle_num);
     
     // Also update device_id based on number
     char buf[32];
@@ -75,34 +108,251 @@ void VehicleConfig::setVehicleNumber(uint8_t num) {
     setDeviceId(buf);
 }
 
-void VehicleConfig::loadFromEEPROM() {
-    // Load device_id (32 bytes)
-    for (int i = 0; i < 31; i++) {
-        device_id[i] = EEPROM.read(ADDR_DEVICE_ID + i);
-        if (device_id[i] == 0) break;
+bool VehicleConfig::isProvisioned() {
+    return provisioned;
+}
+
+void VehicleConfig::bindToUnit() {
+    // Committed with the vehicle number by the caller's setDeviceId()
+    uint8_t mac[6];
+    unit_mac(mac);
+    gConfigStore.set(CFG_VEHICLE_UNIT, mac, sizeof(mac));
+    provisioned = true;
+}
+
+uint16_t VehicleConfig::bumpBootEpoch() {
+    uint16_t epoch = 0;
+    gConfigStore.getU16(CFG_BOOT_EPOCH, epoch);
+    
+    // The epoch is the top of every CCM nonce under the vehicle key, so it
+    // must not wrap: after 0xFFFE boots (decades at a few boots a day) the
+    // counter stays used up and the uplink refuses to start until the
+    // vehicle gets new keys and a cleared CFG_BOOT_EPOCH.
+    if (epoch >= 0xFFFE) {
+        Serial.println("[VEHICLE] ERROR: boot epochs used up, re-key this vehicle");
+        return 0;
     }
-    device_id[31] = '\0';
+    epoch++;
     
-    // Load vehicle number
-    vehicle_num = EEPROM.read(ADDR_VEHICLE_NUM);
-    if (vehicle_num == 0 || vehicle_num > 99) {
-        vehicle_num = 1;  // Safety check
+    // Must be on flash before the first frame uses it: a reset before the
+    // commit lands just hands the same epoch to the next boot, unused. An
+    // epoch that never made it to flash would be handed out again next
+    // boot with fresh sequence numbers, so it is never returned.
+    gConfigStore.setU16(CFG_BOOT_EPOCH, epoch);
+    for (uint8_t i = 0; i < VEHICLE_EPOCH_COMMIT_TRIES; i++) {
+        if (gConfigStore.commit()) return epoch;
+        delay(20);
     }
+    Serial.println("[VEHICLE] ERROR: boot epoch not persisted");
+    return 0;
+}
+
+uint16_t VehicleConfig::getBootEpoch() {
+    if (boot_epoch == 0) boot_epoch = bumpBootEpoch();
+    return boot_epoch;
+}
+
+uint8_t VehicleConfig::getBatchSize() {
+    return batch_size;
+}
+
+void VehicleConfig::setBatchSize(uint8_t k) {
+    if (k < 1 || k > TELEMETRY_BATCH_MAX_SAMPLES) return;
+    
+    batch_size = k;
+    gConfigStore.setU8(CFG_BATCH_SIZE, batch_size);
+    commit();
+    Serial.printf("[VEHICLE] Batch size: %u readings/uplink\r\n", batch_size);
+}
+
+uint32_t VehicleConfig::getBatchMaxLatencyMs() {
+    return (uint32_t)batch_latency_s * 1000UL;
+}
+
+void VehicleConfig::setBatchMaxLatencyS(uint16_t seconds) {
+    if (seconds == 0 || seconds == 0xFFFF) return;
+    
+    batch_latency_s = seconds;
+    gConfigStore.setU16(CFG_BATCH_LATENCY_S, batch_latency_s);
+    commit();
+    Serial.printf("[VEHICLE] Batch max latency: %us\r\n", batch_latency_s);
+}
+
+uint32_t VehicleConfig::getDeltaHeartbeatMs() {
+    return (uint32_t)delta_heartbeat_s * 1000UL;
 }
 
-void VehicleConfig::saveToEEPROM() {
-    // Save device_id (32 bytes)
-    for (int i = 0; i < 31; i++) {
-        EEPROM.write(ADDR_DEVICE_ID + i, device_id[i]);
+void VehicleConfig::setDeltaHeartbeatS(uint16_t seconds) {
+    if (seconds == 0xFFFF) return;
+    
+    delta_heartbeat_s = seconds;
+    gConfigStore.setU16(CFG_DELTA_HEARTBEAT_S, delta_heartbeat_s);
+    commit();
+    Serial.printf("[VEHICLE] Send-on-delta heartbeat: %us%s\r\n", delta_heartbeat_s,
+                  delta_heartbeat_s ? "" : " (off)");
+}
+
+uint32_t VehicleConfig::getSendIntervalMs() {
+    return send_interval_ms;
+}
+
+void VehicleConfig::setSendIntervalMs(uint32_t ms) {
+    if (ms < 100 || ms > 3600000UL) return;
+    
+    send_interval_ms = ms;
+    gConfigStore.setU32(CFG_SEND_INTERVAL_MS, send_interval_ms);
+    commit();
+    Serial.printf("[VEHICLE] Send interval: %lums (applies after reboot)\r\n", (unsigned long)send_interval_ms);
+}
+
+uint16_t VehicleConfig::getTamperThreshold() {
+    return tamper_threshold;
+}
+
+void VehicleConfig::setTamperThreshold(uint16_t threshold) {
+    if (threshold == 0 || threshold > 1023) return;
+    
+    tamper_threshold = threshold;
+    gConfigStore.setU16(CFG_TAMPER_THRESHOLD, tamper_threshold);
+    commit();
+    Serial.printf("[VEHICLE] Tamper threshold: %u\r\n", tamper_threshold);
+}
+
+uint8_t VehicleConfig::getSlot() {
+    if (slot != VEHICLE_SLOT_AUTO) return slot;
+    // Wrapping would put this vehicle on another one's slot
+    if (vehicle_num < 1 || vehicle_num > SLOT_COUNT) return VEHICLE_SLOT_NONE;
+    return (uint8_t)(vehicle_num - 1);
+}
+
+void VehicleConfig::setSlot(uint8_t s) {
+    if (s != VEHICLE_SLOT_AUTO && s >= SLOT_COUNT) return;
+    
+    slot = s;
+    if (slot == VEHICLE_SLOT_AUTO) gConfigStore.remove(CFG_SLOT);
+    else gConfigStore.setU8(CFG_SLOT, slot);
+    commit();
+    Serial.printf("[VEHICLE] TDMA slot: %u%s (applies after reboot)\r\n", getSlot(),
+                  slot == VEHICLE_SLOT_AUTO ? " (auto)" : "");
+}
+
+const uint8_t* VehicleConfig::getAesKey() {
+    return has_keys ? aes_key : NULL;
+}
+
+const uint8_t* VehicleConfig::getMacKey(size_t& len) {
+    len = has_keys ? mac_key_len : 0;
+    return has_keys ? mac_key : NULL;
+}
+
+void VehicleConfig::setKeys(const uint8_t key[16], const uint8_t* mac, size_t mac_len) {
+    if (key == NULL || mac == NULL || mac_len == 0 || mac_len > VEHICLE_MAC_KEY_MAX) return;
+    
+    memcpy(aes_key, key, sizeof(aes_key));
+    memcpy(mac_key, mac, mac_len);
+    mac_key_len = (uint8_t)mac_len;
+    has_keys = true;
+    gConfigStore.set(CFG_AES_KEY, aes_key, sizeof(aes_key));
+    gConfigStore.set(CFG_MAC_KEY, mac_key, mac_key_len);
+    commit();
+    Serial.println("[VEHICLE] Uplink keys provisioned (apply after reboot)");
+}
+
+void VehicleConfig::loadFromStore() {
+    // Device ID
+    int n = gConfigStore.get(CFG_DEVICE_ID, device_id, sizeof(device_id) - 1);
+    if (n > 0) {
+        device_id[n < (int)sizeof(device_id) ? n : (int)sizeof(device_id) - 1] = '\0';
     }
-    EEPROM.write(ADDR_DEVICE_ID + 31, 0);  // Null terminator
     
-    // Save vehicle number
-    EEPROM.write(ADDR_VEHICLE_NUM, vehicle_num);
+    // Vehicle number
+    uint8_t num;
+    if (gConfigStore.getU8(CFG_VEHICLE_NUM, num) && num >= 1 && num <= 99) {
+        vehicle_num = num;
+        
+        // Only counts as provisioned on the unit it was set on; an imported
+        // EEPROM number (every old unit was forced to #1) does not
+        uint8_t mac[6], unit[6];
+        unit_mac(mac);
+        provisioned = gConfigStore.get(CFG_VEHICLE_UNIT, unit, sizeof(unit)) == (int)sizeof(unit) &&
+                      memcmp(unit, mac, sizeof(mac)) == 0;
+        if (!provisioned) {
+            Serial.printf("[VEHICLE] Vehicle #%u was not provisioned on this unit\r\n", vehicle_num);
+        }
+    }
     
-    // Save magic byte
-    EEPROM.write(ADDR_MAGIC, MAGIC_BYTE);
+    // Batch / delta settings (missing keys keep the defaults)
+    uint8_t k;
+    if (gConfigStore.getU8(CFG_BATCH_SIZE, k) && k >= 1 && k <= TELEMETRY_BATCH_MAX_SAMPLES) {
+        batch_size = k;
+    }
+    uint16_t lat_s;
+    if (gConfigStore.getU16(CFG_BATCH_LATENCY_S, lat_s) && lat_s != 0 && lat_s != 0xFFFF) {
+        batch_latency_s = lat_s;
+    }
+    uint16_t hb_s;
+    if (gConfigStore.getU16(CFG_DELTA_HEARTBEAT_S, hb_s) && hb_s != 0xFFFF) {
+        delta_heartbeat_s = hb_s;
+    }
+    
+    // Sensing / TDMA
+    uint32_t ms;
+    if (gConfigStore.getU32(CFG_SEND_INTERVAL_MS, ms) && ms >= 100 && ms <= 3600000UL) {
+        send_interval_ms = ms;
+    }
+    uint16_t thr;
+    if (gConfigStore.getU16(CFG_TAMPER_THRESHOLD, thr) && thr >= 1 && thr <= 1023) {
+        tamper_threshold = thr;
+    }
+    uint8_t s;
+    if (gConfigStore.getU8(CFG_SLOT, s)) {
+        if (s < SLOT_COUNT) {
+            slot = s;
+        } else {
+            Serial.printf("[VEHICLE] Stored TDMA slot %u is past SLOT_COUNT %u, ignored\r\n",
+                          s, (unsigned)SLOT_COUNT);
+        }
+    }
+    
+    // Keys: both or neither
+    int mac_len = gConfigStore.get(CFG_MAC_KEY, mac_key, sizeof(mac_key));
+    if (gConfigStore.get(CFG_AES_KEY, aes_key, sizeof(aes_key)) == (int)sizeof(aes_key) &&
+        mac_len > 0 && mac_len <= VEHICLE_MAC_KEY_MAX) {
+        mac_key_len = (uint8_t)mac_len;
+        has_keys = true;
+    }
+}
+
+void VehicleConfig::importLegacyEEPROM() {
+    EEPROM.begin(LEGACY_EEPROM_SIZE);
+    
+    // The boot epoch was written on every boot, magic or not; losing it
+    // would restart the nonce counter under the same key
+    uint16_t epoch = (uint16_t)EEPROM.read(LEGACY_ADDR_BOOT_EPOCH)
+                   | ((uint16_t)EEPROM.read(LEGACY_ADDR_BOOT_EPOCH + 1) << 8);
+    if (epoch != 0 && epoch != 0xFFFF) {
+        gConfigStore.setU16(CFG_BOOT_EPOCH, epoch);
+        Serial.printf("[VEHICLE] Imported boot epoch %u from EEPROM\r\n", epoch);
+    }
+    
+    // Bytes 0..31 (device_id) were shared with main.cpp's node counter,
+    // so only the settings past them are worth keeping
+    if (EEPROM.read(LEGACY_ADDR_MAGIC) == LEGACY_MAGIC_BYTE) {
+        uint8_t num = EEPROM.read(LEGACY_ADDR_VEHICLE_NUM);
+        if (num >= 1 && num <= 99) gConfigStore.setU8(CFG_VEHICLE_NUM, num);
+    
+        uint8_t k = EEPROM.read(LEGACY_ADDR_BATCH_SIZE);
+        if (k >= 1 && k <= TELEMETRY_BATCH_MAX_SAMPLES) gConfigStore.setU8(CFG_BATCH_SIZE, k);
+    
+        uint16_t lat_s = (uint16_t)EEPROM.read(LEGACY_ADDR_BATCH_LATENCY)
+                       | ((uint16_t)EEPROM.read(LEGACY_ADDR_BATCH_LATENCY + 1) << 8);
+        if (lat_s != 0 && lat_s != 0xFFFF) gConfigStore.setU16(CFG_BATCH_LATENCY_S, lat_s);
+    
+        uint16_t hb_s = (uint16_t)EEPROM.read(LEGACY_ADDR_DELTA_HEARTBEAT)
+                      | ((uint16_t)EEPROM.read(LEGACY_ADDR_DELTA_HEARTBEAT + 1) << 8);
+        if (hb_s != 0xFFFF) gConfigStore.setU16(CFG_DELTA_HEARTBEAT_S, hb_s);
+    }
     
-    EEPROM.commit();
-    delay(10);
+    EEPROM.end();
+    commit();
 }
@@ -0,0 +1,498 @@
+// Gateway capture/replay harness for [env:gw_replay]
+//
+// Builds hardened_pingpong_rx.c on the host against the SDK stand-ins in
+// sdk/ and pushes traffic through parse_and_validate_packet() on a virtual
+// clock, so node table, replay window and validation cost can be sized
+// off-air.
+//
+//   .pio/build/gw_replay/program --synth 32 --count 100000     32 virtual vehicles
+//   .pio/build/gw_replay/program --capture capture.bin         replay a gateway capture
+//   ... --rate 200                  packets/s (default: every vehicle each 2 s,
+//                                   or the capture's own timestamps)
+//   ... --loss 5 --reorder 10 --depth 8 --replay 2 --seed 7    impairments (percent)
+//   ... --old-session 1             replay a vehicle's first two seqs (seq < WINDOW_SIZE)
+//                                   back to back, like a capture of an earlier bridge
+//                                   session: must not restart the window
+//   ... --write out.bin             save the delivered traffic as a capture
+//   ... --verbose                   keep the gateway's own log lines
+//
+// A capture is the link byte stream of a gateway built with GW_CAPTURE_RAW=1
+// (`cat /dev/ttyUSB1 > capture.bin`); only its GW_REC_RAW records are used.
+// Table and window sizes are compile time: -DNODE_POOL_SIZE=32 -DWINDOW_SIZE=256.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+
+#include "radio.h"
+#include "timer.h"
+#include "tremo_uart.h"
+
+uint32_t gw_replay_now_ms = 0;
+uart_t gw_replay_uart[2];
+const struct Radio_s Radio;
+
+static int verbose = 0;
+static FILE* write_file = NULL;
+
+// The gateway's printf goes here so its per-packet lines can be muted
+static int gw_replay_log(const char* fmt, ...);
+
+// Link pads are board build flags on the gateway; the host UART ignores them
+#define GW_LINK_GPIO_PORT GPIOA
+#define GW_LINK_RX_PIN    GPIO_PIN_4
+#define GW_LINK_TX_PIN    GPIO_PIN_5
+#define GW_LINK_IOMUX     0
+
+#define printf gw_replay_log
+#include "../../hardened_pingpong_rx.c"
+#undef printf
+
+static int gw_replay_log(const char* fmt, ...)
+{
+    if (!verbose) return 0;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vprintf(fmt, ap);
+    va_end(ap);
+    return n;
+}
+
+void gw_replay_uart_send(uart_t* uart, uint8_t data)
+{
+    if (uart == GW_LINK_UART && write_file) fputc(data, write_file);
+}
+
+// === Deterministic PRNG (xorshift32) ===
+static uint32_t rng_state = 1;
+
+static uint32_t rng(void)
+{
+    uint32_t x = rng_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return rng_state = x;
+}
+
+static int chance(double percent)
+{
+    return percent > 0 && (rng() % 100000) < (uint32_t)(percent * 1000);
+}
+
+typedef struct {
+    uint8_t  buf[BUFFER_SIZE];
+    uint16_t len;
+    int16_t  rssi;
+    int8_t   snr;
+    uint32_t t_ms;
+    uint8_t  dup;           // injected replay: 1 = recent frame, 2 = old-session pair
+} Frame_t;
+
+// === Sources ===
+static uint32_t synth_vehicles = 0;
+static uint16_t synth_len = 38;     // sealed telemetry reading
+static uint32_t synth_seq[NODE_ID_SPACE];
+static FILE*    capture = NULL;
+static uint64_t frames_total = 0;
+static double   rate = 0;           // packets/s, 0 = source timing
+static double   vclock_ms = 0;
+
+static void synth_frame(Frame_t* f, uint64_t k)
+{
+    uint8_t node = (uint8_t)(1 + k % synth_vehicles);
+    uint32_t seq = synth_seq[node]++;
+    uint16_t n = synth_len;
+
+    f->buf[0] = node;
+    f->buf[1] = (uint8_t)(seq >> 0);
+    f->buf[2] = (uint8_t)(seq >> 8);
+    f->buf[3] = (uint8_t)(seq >> 16);
+    f->buf[4] = (uint8_t)(seq >> 24);
+    f->buf[5] = (uint8_t)(n >> 0);
+    f->buf[6] = (uint8_t)(n >> 8);
+    for (uint16_t i = 0; i < n; i++) f->buf[7 + i] = (uint8_t)rng();
+    if (n >= AEAD_OVERHEAD) {
+        // AEAD header of a sealed frame: vehicle, epoch 1, vehicle seq
+        f->buf[7] = node;
+        f->buf[8] = 1;
+        f->buf[9] = 0;
+        memcpy(&f->buf[10], &f->buf[1], 4);
+    }
+    uint16_t tag = compute_auth_tag(node, seq, &f->buf[7], n);
+    f->buf[7 + n] = (uint8_t)(tag >> 0);
+    f->buf[8 + n] = (uint8_t)(tag >> 8);
+    f->len = (uint16_t)(9 + n);
+    f->rssi = (int16_t)(-60 - (int)(rng() % 60));
+    f->snr = (int8_t)(rng() % 20 - 8);
+    f->t_ms = 0;
+}
+
+// Undo COBS in place. Returns the decoded length, 0 if malformed.
+static uint16_t cobs_decode(uint8_t* buf, uint16_t len)
+{
+    uint16_t i = 0, o = 0;
+    while (i < len) {
+        uint8_t code = buf[i++];
+        if (code == 0 || i + code - 1 > len) return 0;
+        for (uint8_t k = 1; k < code; k++) buf[o++] = buf[i++];
+        if (code < 0xFF && i < len) buf[o++] = 0;
+    }
+    return o;
+}
+
+// Next GW_REC_RAW record of the capture, CRC-checked. 0 at end of file.
+static int capture_frame(Frame_t* f)
+{
+    static uint8_t wire[GW_COBS_MAX];
+    uint16_t n = 0;
+    int c;
+
+    while ((c = fgetc(capture)) != EOF) {
+        if (c != 0) {
+            if (n < sizeof(wire)) wire[n++] = (uint8_t)c;
+            continue;
+        }
+        uint16_t len = cobs_decode(wire, n);
+        n = 0;
+        if (len < GW_REC_HDR_SIZE + 2 || wire[0] != GW_REC_RAW) continue;
+        uint16_t plen = (uint16_t)(wire[13] | (wire[14] << 8));
+        if (plen > BUFFER_SIZE || len != GW_REC_HDR_SIZE + plen + 2) continue;
+        uint16_t crc = (uint16_t)(wire[len - 2] | (wire[len - 1] << 8));
+        if (crc16_update(0xFFFF, wire, (uint16_t)(len - 2)) != crc) continue;
+
+        memcpy(f->buf, &wire[GW_REC_HDR_SIZE], plen);
+        f->len = plen;
+        f->t_ms = (uint32_t)wire[6] | ((uint32_t)wire[7] << 8) | ((uint32_t)wire[8] << 16) | ((uint32_t)wire[9] << 24);
+        f->rssi = (int16_t)(wire[10] | (wire[11] << 8));
+        f->snr = (int8_t)wire[12];
+        return 1;
+    }
+    return 0;
+}
+
+static int next_frame(Frame_t* f, uint64_t k)
+{
+    if (capture) {
+        if (!capture_frame(f)) return 0;
+    } else {
+        if (k >= frames_total) return 0;
+        synth_frame(f, k);
+    }
+    f->dup = 0;
+    if (rate > 0 || !capture) {
+        vclock_ms += 1000.0 / rate;
+        f->t_ms = (uint32_t)vclock_ms;
+    }
+    return 1;
+}
+
+// === Accepted (node, seq) set, to tell leaked replays from late originals ===
+static uint64_t* seen_keys;
+static uint64_t  seen_mask;
+
+static int seen_insert(uint8_t node, uint32_t seq)
+{
+    uint64_t key = ((uint64_t)node << 32 | seq) + 1;
+    uint64_t h = (key * 0x9E3779B97F4A7C15ULL) & seen_mask;
+    while (seen_keys[h] != 0) {
+        if (seen_keys[h] == key) return 0;
+        h = (h + 1) & seen_mask;
+    }
+    seen_keys[h] = key;
+    return 1;
+}
+
+// === Delivery ===
+typedef struct {
+    uint64_t delivered, originals, dups;
+    uint64_t accepted, rejected;
+    uint64_t orig_rejected;     // genuine traffic lost to validation
+    uint64_t dup_accepted;      // replay of a frame never accepted (original lost)
+    uint64_t dup_leaked;        // replay accepted twice: anti-replay failure
+    uint64_t old_pairs;         // old-session pairs injected
+    uint64_t old_accepted;      // old-session frames accepted
+    uint64_t old_resync;        // window restarts they forced
+    uint32_t last_ms;
+} ReplayStats_t;
+
+static ReplayStats_t st;
+static uint32_t* cost_ns;
+static uint64_t  cost_cap;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void deliver(const Frame_t* f)
+{
+    static ParsedPacket_t pkt;
+
+    // Held (reordered) frames arrive late, never back in time
+    if ((int32_t)(f->t_ms - st.last_ms) > 0) st.last_ms = f->t_ms;
+    gw_replay_now_ms = st.last_ms;
+    RssiValue = (int8_t)f->rssi;
+    SnrValue = f->snr;
+
+    if (write_file) {
+        gw_emit_record(GW_REC_RAW, 0, 0, gw_replay_now_ms, f->rssi, f->snr, f->buf, f->len);
+    }
+
+    uint64_t t0 = now_ns();
+    parse_and_validate_packet(f->buf, f->len, &pkt);
+    uint64_t dt = now_ns() - t0;
+    if (st.delivered < cost_cap) cost_ns[st.delivered] = (uint32_t)(dt > UINT32_MAX ? UINT32_MAX : dt);
+
+    st.delivered++;
+    if (f->dup) st.dups++;
+    else st.originals++;
+
+    if (pkt.valid) {
+        st.accepted++;
+        int first = seen_insert(pkt.node_id, pkt.seq);
+        if (f->dup == 2) st.old_accepted++;
+        if (f->dup) {
+            if (first) st.dup_accepted++;
+            else st.dup_leaked++;
+        }
+    } else {
+        st.rejected++;
+        if (!f->dup) st.orig_rejected++;
+        if (verbose) printf("[DROP] node=%u seq=%lu: %s\n", (unsigned)pkt.node_id,
+                            (unsigned long)pkt.seq, pkt.reject_reason);
+    }
+}
+
+// === Impairments ===
+#define HISTORY_LEN   256
+#define HOLD_MAX      64
+
+static double loss_pct = 0, reorder_pct = 0, replay_pct = 0, old_session_pct = 0;
+static uint32_t reorder_depth = 4;
+static uint64_t lost = 0;
+
+static Frame_t history[HISTORY_LEN];
+static uint64_t history_n = 0;
+static Frame_t held[HOLD_MAX];
+static uint32_t held_left[HOLD_MAX];
+static uint32_t held_n = 0;
+
+// Per node: the first two consecutive low seqs seen, and the latest low one
+static Frame_t old_pair[NODE_ID_SPACE][2];
+static uint8_t old_pair_ok[NODE_ID_SPACE];
+static Frame_t old_last[NODE_ID_SPACE];
+static uint8_t old_last_ok[NODE_ID_SPACE];
+
+static uint32_t frame_seq(const Frame_t* f)
+{
+    return get_le32(&f->buf[1]);
+}
+
+static void old_session_note(const Frame_t* f)
+{
+    uint8_t node = f->buf[0];
+    uint32_t seq = frame_seq(f);
+    if (f->len < 9 || old_pair_ok[node] || seq >= WINDOW_SIZE) return;
+    if (old_last_ok[node] && seq == frame_seq(&old_last[node]) + 1) {
+        old_pair[node][0] = old_last[node];
+        old_pair[node][1] = *f;
+        old_pair_ok[node] = 1;
+        return;
+    }
+    old_last[node] = *f;
+    old_last_ok[node] = 1;
+}
+
+// Both frames of the pair: the first would be held, the second would confirm
+// a bridge reboot if the gateway took it on trust
+static void old_session_inject(const Frame_t* f)
+{
+    uint8_t node = f->buf[0];
+    if (!old_pair_ok[node]) return;
+    uint32_t resync = rx_stats.resync;
+    for (int i = 0; i < 2; i++) {
+        Frame_t copy = old_pair[node][i];
+        copy.dup = 2;
+        copy.t_ms = f->t_ms;
+        deliver(&copy);
+    }
+    st.old_pairs++;
+    st.old_resync += rx_stats.resync - resync;
+}
+
+// Count down the held frames, release those whose turn has come
+static void release_held(uint32_t now_ms, int flush)
+{
+    for (uint32_t i = 0; i < held_n;) {
+        if (flush || --held_left[i] == 0) {
+            held[i].t_ms = now_ms;
+            deliver(&held[i]);
+            held[i] = held[held_n - 1];
+            held_left[i] = held_left[held_n - 1];
+            held_n--;
+        } else {
+            i++;
+        }
+    }
+}
+
+static void impair_and_deliver(Frame_t* f)
+{
+    if (chance(loss_pct)) {
+        lost++;
+        return;
+    }
+
+    if (held_n < HOLD_MAX && chance(reorder_pct)) {
+        held[held_n] = *f;
+        held_left[held_n] = 1 + rng() % reorder_depth;
+        held_n++;
+    } else {
+        deliver(f);
+        release_held(f->t_ms, 0);
+    }
+
+    history[history_n++ % HISTORY_LEN] = *f;
+    if (chance(replay_pct)) {
+        uint64_t span = history_n < HISTORY_LEN ? history_n : HISTORY_LEN;
+        Frame_t copy = history[(history_n - 1 - rng() % span) % HISTORY_LEN];
+        copy.dup = 1;
+        copy.t_ms = f->t_ms;
+        deliver(&copy);
+    }
+
+    old_session_note(f);
+    if (chance(old_session_pct)) old_session_inject(f);
+}
+
+static int cmp_u32(const void* a, const void* b)
+{
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char** argv)
+{
+    const char* capture_path = NULL;
+    const char* write_path = NULL;
+    uint32_t seed = 1;
+    frames_total = 100000;
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (!strcmp(a, "--verbose")) { verbose = 1; continue; }
+        if (!v) break;
+        if (!strcmp(a, "--synth")) synth_vehicles = (uint32_t)strtoul(v, NULL, 10);
+        else if (!strcmp(a, "--capture")) capture_path = v;
+        else if (!strcmp(a, "--count")) frames_total = strtoull(v, NULL, 10);
+        else if (!strcmp(a, "--len")) synth_len = (uint16_t)strtoul(v, NULL, 10);
+        else if (!strcmp(a, "--rate")) rate = atof(v);
+        else if (!strcmp(a, "--loss")) loss_pct = atof(v);
+        else if (!strcmp(a, "--reorder")) reorder_pct = atof(v);
+        else if (!strcmp(a, "--depth")) reorder_depth = (uint32_t)strtoul(v, NULL, 10);
+        else if (!strcmp(a, "--replay")) replay_pct = atof(v);
+        else if (!strcmp(a, "--old-session")) old_session_pct = atof(v);
+        else if (!strcmp(a, "--seed")) seed = (uint32_t)strtoul(v, NULL, 10);
+        else if (!strcmp(a, "--write")) write_path = v;
+        else continue;
+        i++;
+    }
+
+    if (capture_path) {
+        capture = fopen(capture_path, "rb");
+        if (!capture) {
+            perror(capture_path);
+            return 1;
+        }
+    } else {
+        if (synth_vehicles == 0) synth_vehicles = 8;
+        if (synth_vehicles > NODE_ID_SPACE - 1) synth_vehicles = NODE_ID_SPACE - 1;
+        if (synth_len > CHUNK_MAX) synth_len = CHUNK_MAX;
+        if (rate <= 0) rate = synth_vehicles / 2.0;     // every vehicle each 2 s
+    }
+    if (write_path) {
+        write_file = fopen(write_path, "wb");
+        if (!write_file) {
+            perror(write_path);
+            return 1;
+        }
+    }
+    if (reorder_depth == 0) reorder_depth = 1;
+    rng_state = seed ? seed : 1;
+
+    // Sized for the synthetic count; a longer capture only stops recording costs
+    cost_cap = frames_total * 2 + 1024;
+    cost_ns = (uint32_t*)malloc(cost_cap * sizeof(uint32_t));
+    seen_mask = 1;
+    while (seen_mask < cost_cap * 2) seen_mask <<= 1;
+    seen_keys = (uint64_t*)calloc(seen_mask, sizeof(uint64_t));
+    seen_mask -= 1;
+    if (!cost_ns || !seen_keys) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    per_node_init();
+    gw_link_init();
+
+    Frame_t f;
+    uint64_t k = 0;
+    while (next_frame(&f, k)) {
+        impair_and_deliver(&f);
+        k++;
+    }
+    release_held(st.last_ms, 1);
+
+    if (capture) fclose(capture);
+    if (write_file) fclose(write_file);
+
+    printf("[REPLAY] source: %s, %llu frames over %.1f s virtual time\n",
+           capture ? capture_path : "synthetic", (unsigned long long)k, st.last_ms / 1000.0);
+    if (!capture) {
+        printf("[REPLAY] %u vehicles, %u-byte payload, %.1f packets/s\n",
+               synth_vehicles, synth_len, rate);
+    }
+    printf("[REPLAY] impairments: loss %.1f%% (%llu), reorder %.1f%% depth %u, replay %.1f%%, seed %u\n",
+           loss_pct, (unsigned long long)lost, reorder_pct, reorder_depth, replay_pct, seed);
+    printf("[REPLAY] delivered %llu (original %llu, replayed %llu): accepted %llu, rejected %llu\n",
+           (unsigned long long)st.delivered, (unsigned long long)st.originals,
+           (unsigned long long)st.dups, (unsigned long long)st.accepted, (unsigned long long)st.rejected);
+    printf("[REPLAY] rejects: replay=%lu old=%lu jump=%lu auth=%lu len=%lu full=%lu | resync=%lu\n",
+           (unsigned long)rx_stats.replay, (unsigned long)rx_stats.too_old,
+           (unsigned long)rx_stats.jump_held, (unsigned long)rx_stats.auth_fail,
+           (unsigned long)rx_stats.bad_len, (unsigned long)node_table_full,
+           (unsigned long)rx_stats.resync);
+    printf("[REPLAY] originals rejected %llu (%.3f%%), replays accepted %llu (original lost), leaked %llu\n",
+           (unsigned long long)st.orig_rejected,
+           st.originals ? 100.0 * st.orig_rejected / st.originals : 0.0,
+           (unsigned long long)st.dup_accepted, (unsigned long long)st.dup_leaked);
+    if (old_session_pct > 0) {
+        printf("[REPLAY] old-session %.1f%%: %llu pairs, accepted %llu, forced resyncs %llu\n",
+               old_session_pct, (unsigned long long)st.old_pairs,
+               (unsigned long long)st.old_accepted, (unsigned long long)st.old_resync);
+    }
+    printf("[REPLAY] node table: %u/%u active, %lu evicted | window %u | %u B RAM\n",
+           node_count, NODE_POOL_SIZE, (unsigned long)node_evictions, WINDOW_SIZE,
+           (unsigned)(sizeof(node_index) + sizeof(node_states)));
+
+    uint64_t n = st.delivered < cost_cap ? st.delivered : cost_cap;
+    if (n > 0) {
+        uint64_t sum = 0;
+        for (uint64_t i = 0; i < n; i++) sum += cost_ns[i];
+        qsort(cost_ns, n, sizeof(uint32_t), cmp_u32);
+        printf("[REPLAY] parse_and_validate_packet: mean %.0f ns, p50 %u ns, p99 %u ns, max %u ns\n",
+               (double)sum / n, cost_ns[n / 2], cost_ns[n * 99 / 100], cost_ns[n - 1]);
+    }
+    if (write_path) printf("[REPLAY] wrote delivered traffic to %s\n", write_path);
+
+    free(cost_ns);
+    free(seen_keys);
+    return (st.dup_leaked || st.old_resync) ? 2 : 0;
+}
@@ -0,0 +1,4 @@
+// Host stand-in for the ASR6601 SDK (tools/gw_replay only)
+#pragma once
+
+static inline void delay_ms(unsigned ms) { (void)ms; }
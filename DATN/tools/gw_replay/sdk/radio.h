@@ -0,0 +1,33 @@
+// Host stand-in for the ASR6601 SDK (tools/gw_replay only)
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum { MODEM_FSK, MODEM_LORA } RadioModems_t;
+
+typedef struct {
+    void (*TxDone)(void);
+    void (*TxTimeout)(void);
+    void (*RxDone)(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr);
+    void (*RxTimeout)(void);
+    void (*RxError)(void);
+} RadioEvents_t;
+
+struct Radio_s {
+    void (*Init)(RadioEvents_t *events);
+    void (*SetChannel)(uint32_t freq);
+    void (*SetTxConfig)(RadioModems_t modem, int8_t power, uint32_t fdev, uint32_t bandwidth,
+                        uint32_t datarate, uint8_t coderate, uint16_t preamble_len, bool fix_len,
+                        bool crc_on, bool freq_hop_on, uint8_t hop_period, bool iq_inverted,
+                        uint32_t timeout);
+    void (*SetRxConfig)(RadioModems_t modem, uint32_t bandwidth, uint32_t datarate, uint8_t coderate,
+                        uint32_t bandwidth_afc, uint16_t preamble_len, uint16_t symb_timeout,
+                        bool fix_len, uint8_t payload_len, bool crc_on, bool freq_hop_on,
+                        uint8_t hop_period, bool iq_inverted, bool rx_continuous);
+    void (*Send)(uint8_t *buffer, uint8_t size);
+    void (*Sleep)(void);
+    void (*Rx)(uint32_t timeout);
+    void (*IrqProcess)(void);
+};
+
+extern const struct Radio_s Radio;
@@ -0,0 +1,11 @@
+// Host stand-in for the ASR6601 SDK (tools/gw_replay only): the replay
+// harness drives the clock, so the gateway code sees virtual time.
+#pragma once
+#include <stdint.h>
+
+typedef uint32_t TimerTime_t;
+
+extern uint32_t gw_replay_now_ms;
+
+static inline TimerTime_t TimerGetCurrentTime(void) { return gw_replay_now_ms; }
+static inline TimerTime_t TimerGetElapsedTime(TimerTime_t past) { return gw_replay_now_ms - past; }
@@ -0,0 +1,10 @@
+// Host stand-in for the ASR6601 SDK (tools/gw_replay only)
+#pragma once
+#include <stdint.h>
+
+typedef struct { int id; } gpio_t;
+#define GPIOA ((gpio_t *)0)
+#define GPIO_PIN_4 4
+#define GPIO_PIN_5 5
+
+static inline void gpio_set_iomux(gpio_t *port, uint8_t pin, uint32_t func) { (void)port; (void)pin; (void)func; }
@@ -0,0 +1,7 @@
+// Host stand-in for the ASR6601 SDK (tools/gw_replay only)
+#pragma once
+#include <stdbool.h>
+
+#define RCC_PERIPHERAL_UART1 1
+
+static inline void rcc_enable_peripheral_clk(int periph, bool on) { (void)periph; (void)on; }
@@ -0,0 +1,5 @@
+// Host stand-in for the ASR6601 SDK (tools/gw_replay only)
+#pragma once
+#include <stdint.h>
+
+static inline void system_get_chip_id(uint32_t *id) { id[0] = 0; id[1] = 0; }
@@ -0,0 +1,25 @@
+// Host stand-in for the ASR6601 SDK (tools/gw_replay only): the link UART
+// goes to gw_replay_uart_send(), everything else is a no-op.
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct { int id; } uart_t;
+typedef struct {
+    uint32_t baudrate;
+    int data_width, stop_bits, parity, flow_control, mode, fifo_mode;
+} uart_config_t;
+
+extern uart_t gw_replay_uart[2];
+#define UART0 (&gw_replay_uart[0])
+#define UART1 (&gw_replay_uart[1])
+
+enum { UART_DATA_WIDTH_8, UART_STOP_BITS_1, UART_PARITY_NO, UART_FLOW_CONTROL_DISABLED,
+       UART_MODE_TX, UART_MODE_TXRX };
+
+void gw_replay_uart_send(uart_t *uart, uint8_t data);
+
+static inline void uart_config_init(uart_config_t *cfg) { (void)cfg; }
+static inline void uart_init(uart_t *uart, uart_config_t *cfg) { (void)uart; (void)cfg; }
+static inline void uart_cmd(uart_t *uart, bool on) { (void)uart; (void)on; }
+static inline void uart_send_data(uart_t *uart, uint8_t data) { gw_replay_uart_send(uart, data); }
@@ -0,0 +1,605 @@
+// Host harness for [env:native]
+//
+// Runs the real firmware modules (sensor_Data, ldr, security,
+// vehicle_config, config_store, telemetry_frame, uplink, local_memory,
+// nmea) on Linux against the native_hal stand-ins.
+//
+//   .pio/build/native/program                 run TaskLoraSend for 10 s
+//   .pio/build/native/program --run 30        run for 30 s
+//   .pio/build/native/program --alerts        also raise tamper/shock alerts
+//   .pio/build/native/program --batch 5       batch 5 readings per uplink
+//   .pio/build/native/program --delta 30      send-on-delta, 30 s heartbeat
+//   .pio/build/native/program --gps           feed NMEA-like UTC time to the TDMA scheduler
+//   .pio/build/native/program --bench 10000   time uplink_send_once()
+//   .pio/build/native/program --sdlog 20000   SD logger under 150 ms card stalls
+//   .pio/build/native/program --backlog 30    30 s dead zone, then replay the SD backlog
+//   .pio/build/native/program --delta 20 --backlog 30
+//                                             same with send-on-delta; checks every replayed
+//                                             delta is rebuilt on the reading sealed before it
+//   .pio/build/native/program --config 200    200 reboots, config writes cut by power loss
+//   .pio/build/native/program --nmea 600      600 GPS epochs at 10 Hz through the NMEA parser
+
+#include <Arduino.h>
+
+#include <chrono>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "backlog.h"
+#include "config_store.h"
+#include "ldr.h"
+#include "local_memory.h"
+#include "nmea.h"
+#include "security.h"
+#include "sensor_Data.h"
+#include "slot_scheduler.h"
+#include "telemetry_frame.h"
+#include "uplink.h"
+#include "vehicle_config.h"
+
+// Globals that main.cpp owns on the ESP32
+HardwareSerial LORA_SER(1);
+LDRModule ldr(35);
+volatile uint32_t g_send_interval_ms = 2000;
+volatile bool g_tamper_alert = false;
+
+static void seed_sensor_data() {
+  sensor_data_init();
+  sensor_data_publish_gps(GpsSample{ 10.762622, 106.660172, 8, 42.0f, 0 });
+  sensor_data_publish_env(EnvSample{ 27.4f, 61.0f });
+  sensor_data_publish_motion(MotionSample{ 0.03f, false, true, 0, 0, 0.0f });
+}
+
+// Recent readings per vehicle by epoch/seq, as ingestd keeps them for delta frames
+static TelemetryDeltaHistory s_history[256];
+
+static void print_reading(const char *tag, const AeadHeader &hdr, const TelemetryFrame &f) {
+  Serial.printf("[HOST] #%u.%lu %sveh=%u ts=%lu t=%.1f h=%.1f a=%.3f l=%u la=%.6f lo=%.6f sats=%u flags=0x%02X\r\n",
+                hdr.epoch, (unsigned long)hdr.seq, tag, f.vehicle, (unsigned long)f.ts_ms,
+                telemetry_frame_temp(f), telemetry_frame_hum(f), telemetry_frame_accel(f),
+                f.light, telemetry_frame_lat(f), telemetry_frame_lng(f), f.sats, f.flags);
+}
+
+static bool same_reading(const TelemetryFrame &a, const TelemetryFrame &b) {
+  return a.vehicle == b.vehicle && a.flags == b.flags && a.sats == b.sats && a.ts_ms == b.ts_ms &&
+         a.lat_e7 == b.lat_e7 && a.lng_e7 == b.lng_e7 && a.temp_dc == b.temp_dc &&
+         a.hum_dp == b.hum_dp && a.accel_mg == b.accel_mg && a.light == b.light;
+}
+
+// Gateway end of the store-and-forward backlog (--backlog): loses every
+// line inside the dead zone, drops duplicates as the ingest side does and
+// acks the rest in beacons laid out like hardened_pingpong_rx.c's
+struct HostGateway {
+  bool on = false;
+  bool dead = false;
+  bool ack_valid = false;
+  uint16_t ack_epoch = 0;
+  uint32_t ack_top = 0;
+  uint32_t ack_bits = 0;
+  std::vector<std::pair<uint16_t, uint32_t>> ack_old;
+  std::set<uint64_t> sent, delivered;
+  uint32_t lost_lines = 0, dups = 0, beacons = 0;
+  uint32_t readings = 0, last_ts = 0, max_gap_ms = 0;   // live readings, by sample time
+  // What the vehicle sealed, rebuilt in seal order: the value every
+  // reading must come out as at the gateway, whatever order it arrives in
+  TelemetryFrame sealed_state;
+  bool sealed_known = false;
+  std::map<uint64_t, TelemetryFrame> truth;
+  uint32_t rebuilt = 0, wrong = 0;
+};
+static HostGateway s_gw;
+
+static void gw_ack(uint16_t epoch, uint32_t seq) {
+  if (!s_gw.ack_valid || (int16_t)(epoch - s_gw.ack_epoch) > 0) {
+    s_gw.ack_valid = true;
+    s_gw.ack_epoch = epoch;
+    s_gw.ack_top = seq;
+    s_gw.ack_bits = 0;
+    return;
+  }
+  int32_t d = (int32_t)(seq - s_gw.ack_top);
+  if (epoch == s_gw.ack_epoch && d > 0) {
+    s_gw.ack_bits = (d > 32) ? 0 : (d == 32) ? (1UL << 31) : ((s_gw.ack_bits << d) | (1UL << (d - 1)));
+    s_gw.ack_top = seq;
+  } else if (epoch == s_gw.ack_epoch && d < 0 && d >= -32) {
+    s_gw.ack_bits |= 1UL << (-d - 1);
+  } else if (d != 0 || epoch != s_gw.ack_epoch) {
+    s_gw.ack_old.push_back({ epoch, seq });
+  }
+}
+
+// false: the line never reaches the gateway, or is a duplicate
+static bool gw_receive(const std::string &line) {
+  uint8_t raw[FRAME_MAX_PLAIN];
+  size_t raw_len = 0;
+  AeadHeader hdr;
+  if (!openFrameFromBase64(line.c_str(), line.size(), hdr, raw, sizeof(raw), raw_len)) return true;
+
+  uint64_t key = ((uint64_t)hdr.epoch << 32) | hdr.seq;
+  uint8_t type = telemetry_frame_type(raw, raw_len);
+  if (s_gw.sent.insert(key).second && raw_len >= 7 &&
+      (type == TELEMETRY_FRAME_TYPE_READING || type == TELEMETRY_FRAME_TYPE_DELTA)) {
+    // First time this reading was sealed: the gap to the one before shows
+    // a superframe whose reading was never taken
+    uint32_t ts = raw[3] | (uint32_t)raw[4] << 8 | (uint32_t)raw[5] << 16 | (uint32_t)raw[6] << 24;
+    if (s_gw.readings > 0 && ts - s_gw.last_ts > s_gw.max_gap_ms) s_gw.max_gap_ms = ts - s_gw.last_ts;
+    s_gw.last_ts = ts;
+    s_gw.readings++;
+
+    if (type == TELEMETRY_FRAME_TYPE_READING) {
+      s_gw.sealed_known = telemetry_frame_decode(raw, raw_len, s_gw.sealed_state);
+    } else if (s_gw.sealed_known) {
+      telemetry_delta_apply(raw, raw_len, s_gw.sealed_state);
+    }
+    if (s_gw.sealed_known) s_gw.truth[key] = s_gw.sealed_state;
+  }
+  if (s_gw.dead) {
+    s_gw.lost_lines++;
+    return false;
+  }
+  if (!s_gw.delivered.insert(key).second) {
+    s_gw.dups++;
+    return false;
+  }
+  gw_ack(hdr.epoch, hdr.seq);
+  return true;
+}
+
+// What the TX bridge prints for one beacon (up to 4 late acks), plus its own chatter
+static void gw_beacon() {
+  char line[BACKLOG_LINE_MAX];
+  snprintf(line, sizeof(line), "[TX SECURE] Node=42, seq=%lu, AUTH=0xBEEF\r\n@BCN %lu -71 8\r\n",
+           (unsigned long)s_gw.beacons, (unsigned long)s_gw.beacons);
+  LORA_SER.hostInject(line);
+  s_gw.beacons++;
+  if (!s_gw.ack_valid) return;
+
+  int n = snprintf(line, sizeof(line), "@ACK %u %u %lu %08lX", gVehicleConfig.getVehicleNumber(),
+                   s_gw.ack_epoch, (unsigned long)s_gw.ack_top, (unsigned long)s_gw.ack_bits);
+  size_t k = 0;
+  for (; k < s_gw.ack_old.size() && k < 4; k++) {
+    n += snprintf(line + n, sizeof(line) - n, " %u:%lu", s_gw.ack_old[k].first,
+                  (unsigned long)s_gw.ack_old[k].second);
+  }
+  s_gw.ack_old.erase(s_gw.ack_old.begin(), s_gw.ack_old.begin() + k);
+  snprintf(line + n, sizeof(line) - n, "\r\n");
+  LORA_SER.hostInject(line);
+}
+
+// Decode every line the uplink wrote, the same way the gateway side does
+static uint32_t drain_and_verify(bool print) {
+  std::string tx = LORA_SER.hostTakeTx();
+  uint32_t ok = 0;
+  size_t start = 0;
+
+  while (start < tx.size()) {
+    size_t end = tx.find('\n', start);
+    if (end == std::string::npos) break;
+    std::string line = tx.substr(start, end - start);
+    start = end + 1;
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    if (!line.empty() && line[0] == UPLINK_URGENT_MARK) line.erase(0, 1);
+    if (line.empty()) continue;
+    if (s_gw.on && !gw_receive(line)) continue;
+
+    uint8_t raw[FRAME_MAX_PLAIN];
+    size_t raw_len = 0;
+    AeadHeader hdr;
+    TelemetryFrame f;
+    TelemetryAlert a;
+    TelemetryFrame batch[TELEMETRY_BATCH_MAX_SAMPLES];
+    size_t batch_n = 0;
+    if (!openFrameFromBase64(line.c_str(), line.size(), hdr, raw, sizeof(raw), raw_len)) {
+      Serial.printf("[HOST] FAILED to open line (%u chars)\r\n", (unsigned)line.size());
+    } else if (telemetry_alert_decode(raw, raw_len, a)) {
+      ok++;
+      if (print) {
+        Serial.printf("[HOST] #%u.%lu ALERT veh=%u type=%u value=%u ts=%lu rx_delay=%lums\r\n",
+                      hdr.epoch, (unsigned long)hdr.seq, a.vehicle, a.type, a.value, (unsigned long)a.ts_ms,
+                      (unsigned long)(millis() - a.ts_ms));
+      }
+    } else if ((batch_n = telemetry_batch_decode(raw, raw_len, batch, TELEMETRY_BATCH_MAX_SAMPLES)) > 0) {
+      ok += batch_n;
+      if (print) {
+        Serial.printf("[HOST] #%u.%lu BATCH veh=%u n=%u (%u bytes)\r\n",
+                      hdr.epoch, (unsigned long)hdr.seq, raw[1], (unsigned)batch_n, (unsigned)raw_len);
+        for (size_t k = 0; k < batch_n; k++) {
+          const TelemetryFrame &b = batch[k];
+          Serial.printf("[HOST]   [%u] ts=%lu t=%.1f h=%.1f a=%.3f l=%u la=%.6f lo=%.6f sats=%u flags=0x%02X\r\n",
+                        (unsigned)k, (unsigned long)b.ts_ms,
+                        telemetry_frame_temp(b), telemetry_frame_hum(b), telemetry_frame_accel(b),
+                        b.light, telemetry_frame_lat(b), telemetry_frame_lng(b), b.sats, b.flags);
+        }
+      }
+    } else if (telemetry_frame_decode(raw, raw_len, f)) {
+      ok++;
+      telemetry_history_put(s_history[f.vehicle], hdr.epoch, hdr.seq, f);
+      if (print) print_reading("", hdr, f);
+    } else if (telemetry_frame_type(raw, raw_len) == TELEMETRY_FRAME_TYPE_DELTA) {
+      uint8_t veh = raw[1];
+      if (!telemetry_history_base(s_history[veh], hdr.epoch, hdr.seq, f)) {
+        Serial.printf("[HOST] #%u.%lu delta for veh=%u without an earlier reading, dropped\r\n",
+                      hdr.epoch, (unsigned long)hdr.seq, veh);
+      } else if (telemetry_delta_apply(raw, raw_len, f)) {
+        ok++;
+        telemetry_history_put(s_history[veh], hdr.epoch, hdr.seq, f);
+        if (s_gw.on) {
+          auto it = s_gw.truth.find(((uint64_t)hdr.epoch << 32) | hdr.seq);
+          s_gw.rebuilt++;
+          if (it == s_gw.truth.end() || !same_reading(it->second, f)) {
+            s_gw.wrong++;
+            print_reading("WRONG BASE ", hdr, f);
+          }
+        }
+        if (print) {
+          char tag[24];
+          snprintf(tag, sizeof(tag), "DELTA has=0x%02X ", raw[7]);
+          print_reading(tag, hdr, f);
+        }
+      } else {
+        Serial.printf("[HOST] #%u.%lu malformed delta frame\r\n", hdr.epoch, (unsigned long)hdr.seq);
+      }
+    } else {
+      Serial.printf("[HOST] Unknown frame type 0x%X\r\n", telemetry_frame_type(raw, raw_len));
+    }
+  }
+  return ok;
+}
+
+static void run_tasks(uint32_t seconds, bool alerts, bool gps_time) {
+  startLoraUplink(4096, 1);
+
+  // Pretend UTC runs 12345 ms ahead of millis(), seen with up to 100 ms jitter
+  const uint64_t utc_base = 815011200000ULL + 12345;
+  uint32_t last_fix = 0;
+
+  uint32_t verified = 0;
+  uint32_t start = millis();
+  uint32_t tick = 0;
+  while (millis() - start < seconds * 1000UL) {
+    delay(50);
+    if (gps_time && millis() - last_fix >= 1000) {
+      last_fix = millis();
+      gSlotScheduler.syncUtc(utc_base + last_fix, last_fix - (uint32_t)(rand() % 100), false);
+    }
+    // Random-phase events so alerts land both inside and outside our slot
+    if (alerts && (++tick % 23) == 0) {
+      if (tick % 2) {
+        uplink_raise_alert(UPLINK_ALERT_TAMPER, 900);
+      } else {
+        for (int i = 0; i < 3; i++) uplink_raise_alert(UPLINK_ALERT_SHOCK, 2500 + i);
+      }
+    }
+    verified += drain_and_verify(true);
+  }
+
+  Serial.printf("[HOST] TDMA %s, guard %lums\r\n", gSlotScheduler.synced(millis()) ? "GPS-synced" : "free-running",
+                (unsigned long)gSlotScheduler.guardMs(millis()));
+
+  UplinkAlertStats st = uplink_alert_stats();
+  Serial.printf("[HOST] %lu readings/alerts verified in %lu s\r\n", (unsigned long)verified, (unsigned long)seconds);
+  Serial.printf("[HOST] alerts raised=%lu sent=%lu coalesced=%lu dropped=%lu max_wait=%lums\r\n",
+                (unsigned long)st.raised, (unsigned long)st.sent, (unsigned long)st.coalesced,
+                (unsigned long)st.dropped, (unsigned long)st.max_wait_ms);
+
+  UplinkDeltaStats ds = uplink_delta_stats();
+  if (ds.full + ds.delta + ds.suppressed > 0) {
+    uint32_t periods = ds.full + ds.delta + ds.suppressed;
+    Serial.printf("[HOST] send-on-delta full=%lu delta=%lu suppressed=%lu, %lu bytes on air vs %lu always-full (%.0f%%)\r\n",
+                  (unsigned long)ds.full, (unsigned long)ds.delta, (unsigned long)ds.suppressed,
+                  (unsigned long)ds.bytes_on_air,
+                  (unsigned long)(periods * (TELEMETRY_FRAME_SIZE + AEAD_OVERHEAD)),
+                  100.0 * ds.bytes_on_air / (periods * (TELEMETRY_FRAME_SIZE + AEAD_OVERHEAD)));
+  }
+}
+
+static void run_bench(uint32_t iterations) {
+  Serial.hostMute(true);
+  auto t0 = std::chrono::steady_clock::now();
+  size_t bytes = 0;
+  for (uint32_t i = 0; i < iterations; i++) {
+    bytes += uplink_send_once();
+    if ((i & 0xFF) == 0xFF) LORA_SER.hostTakeTx();
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  Serial.hostMute(false);
+
+  uint32_t verified = drain_and_verify(false);
+  double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+  Serial.printf("[BENCH] uplink_send_once: %lu iters, %.0f ns/op, %.1f bytes/op, last batch verified=%lu\r\n",
+                (unsigned long)iterations, ns / iterations,
+                iterations ? (double)bytes / iterations : 0.0, (unsigned long)verified);
+}
+
+// One row per ms from a "sensor" task while every 4th card write stalls
+// 150 ms; the producer must never wait for the card
+static void run_sdlog(uint32_t rows) {
+  host_set_sd_stall(150, 4);
+  if (!sd_init(5)) return;
+  startSdLogger(4096, 0);
+
+  double max_us = 0;
+  for (uint32_t i = 0; i < rows; i++) {
+    auto t0 = std::chrono::steady_clock::now();
+    sd_append_sample(millis(), 10.762622, 106.660172, 8, 27.4f, 61.0f, 0.01f, -0.02f, 0.98f);
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+    if (us > max_us) max_us = us;
+    delay(1);
+  }
+  bool flushed = sd_flush(2000);
+
+  SdLogStats st = sd_log_stats();
+  Serial.printf("[SDLOG] rows=%lu bytes=%lu dropped=%lu/%lu bytes, writes=%lu partial=%lu errors=%lu\r\n",
+                (unsigned long)st.rows, (unsigned long)st.bytes, (unsigned long)st.dropped_rows,
+                (unsigned long)st.dropped_bytes, (unsigned long)st.writes,
+                (unsigned long)st.partial_writes, (unsigned long)st.write_errors);
+  Serial.printf("[SDLOG] slow writes=%lu max write=%lums, max append=%.0fus, flushed=%s\r\n",
+                (unsigned long)st.slow_writes, (unsigned long)st.max_write_ms, max_us,
+                flushed ? "yes" : "no");
+}
+
+// Live uplink through a dead zone: 10 s in range, dead_s s with every line
+// lost and no beacons, then back in range until the backlog drained.
+// Beacons every second so the run stays short (the gateway default is 10 s).
+// With send-on-delta on, temperature and humidity step at different rates
+// so most frames are deltas carrying only some of the fields.
+static void run_backlog(uint32_t dead_s) {
+  bool delta = gVehicleConfig.getDeltaHeartbeatMs() > 0;
+  if (!sd_init(5)) return;
+  SD.remove(BACKLOG_SD_PATH);
+  backlog_begin(1000);
+  startBacklog(4096, 0);
+  s_gw.on = true;
+  startLoraUplink(4096, 1);
+
+  uint32_t start = millis();
+  // Worst case drain: one replay per superframe, next to that superframe's reading
+  uint32_t total_ms = (10 + 2 * dead_s + 30) * 1000UL;
+  uint32_t last_beacon = start;
+  uint32_t verified = 0;
+  while (millis() - start < total_ms) {
+    delay(50);
+    uint32_t t = millis() - start;
+    bool dead = t >= 10000 && t < 10000 + dead_s * 1000UL;
+    if (dead != s_gw.dead) {
+      BacklogStats st = backlog_stats();
+      Serial.printf("[HOST] t=%lus link %s, backlog pending=%lu inflight=%lu\r\n", (unsigned long)(t / 1000),
+                    dead ? "LOST" : "back", (unsigned long)st.pending, (unsigned long)st.inflight);
+    }
+    s_gw.dead = dead;
+    if (delta) {
+      sensor_data_publish_env(EnvSample{ 25.0f + (float)(t / 4000 % 6), 60.0f + 2.0f * (float)(t / 7000 % 5) });
+    }
+    if (!dead && millis() - last_beacon >= 1000) {
+      last_beacon = millis();
+      gw_beacon();
+    }
+    verified += drain_and_verify(false);
+
+    // Done once everything sealed so far made it through
+    if (!dead && t > 10000 + dead_s * 1000UL && s_gw.delivered.size() == s_gw.sent.size()) {
+      Serial.printf("[HOST] t=%lus backlog drained\r\n", (unsigned long)(t / 1000));
+      break;
+    }
+  }
+
+  BacklogStats st = backlog_stats();
+  uint32_t missing = 0;
+  for (uint64_t k : s_gw.sent) {
+    if (!s_gw.delivered.count(k)) missing++;
+  }
+  Serial.printf("[HOST] frames: %lu sealed, %lu delivered, %lu missing; lines lost in dead zone=%lu, duplicates=%lu\r\n",
+                (unsigned long)s_gw.sent.size(), (unsigned long)s_gw.delivered.size(), (unsigned long)missing,
+                (unsigned long)s_gw.lost_lines, (unsigned long)s_gw.dups);
+  Serial.printf("[HOST] backlog tracked=%lu acked=%lu inflight=%lu spilled=%lu (dropped %lu) stored=%lu pending=%lu "
+                "replayed=%lu expired=%lu overwritten=%lu errors=%lu beacons=%lu\r\n",
+                (unsigned long)st.tracked, (unsigned long)st.acked, (unsigned long)st.inflight,
+                (unsigned long)st.spilled, (unsigned long)st.spill_dropped, (unsigned long)st.stored,
+                (unsigned long)st.pending, (unsigned long)st.replayed, (unsigned long)st.expired,
+                (unsigned long)st.overwritten, (unsigned long)st.store_errors, (unsigned long)st.beacons);
+  Serial.printf("[HOST] %lu readings/alerts verified\r\n", (unsigned long)verified);
+  // Send-on-delta skips quiet periods on purpose, so gaps only count without it
+  uint32_t frame_ms = gSlotScheduler.plan().frame_ms;
+  Serial.printf("[HOST] %lu live readings, largest gap %lums (superframe %lums): %s\r\n",
+                (unsigned long)s_gw.readings, (unsigned long)s_gw.max_gap_ms, (unsigned long)frame_ms,
+                delta ? "send-on-delta" : s_gw.max_gap_ms < frame_ms * 3 / 2 ? "none skipped" : "READINGS SKIPPED");
+  if (delta) {
+    Serial.printf("[HOST] %lu delta frames rebuilt, %lu on the wrong base\r\n",
+                  (unsigned long)s_gw.rebuilt, (unsigned long)s_gw.wrong);
+  }
+}
+
+// Config store across reboots: each boot reloads the store and bumps the
+// epoch, then changes the tamper threshold; every 5th change is cut off
+// mid-write. After the next boot the threshold must be the last change
+// that completed and the epoch must be new. Every 7th boot the epoch
+// commit fails once and must go through on a retry; every 11th it fails
+// every try and the boot must get no epoch at all.
+static void run_config(uint32_t boots) {
+  uint16_t expect_thr = gVehicleConfig.getTamperThreshold();
+  uint16_t last_epoch = gVehicleConfig.getBootEpoch();
+  uint32_t cuts = 0, lost = 0, reused = 0, boot_writes = 0;
+  uint32_t refused = 0, wrong_refusals = 0;
+  double max_us = 0;
+
+  for (uint32_t i = 0; i < boots; i++) {
+    VehicleConfig cfg;
+    uint32_t c0 = gConfigStore.stats().commits;
+    auto t0 = std::chrono::steady_clock::now();
+    cfg.begin();
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+    if (us > max_us) max_us = us;
+    cfg.setDeviceIdFromNodeId(1);   // as main.cpp does on every boot
+    bool fail_all = (i % 11) == 10;
+    if (fail_all) host_nvs_fail_next_writes(VEHICLE_EPOCH_COMMIT_TRIES);
+    else if ((i % 7) == 6) host_nvs_fail_next_writes(1);
+    uint16_t epoch = cfg.getBootEpoch();
+    boot_writes += gConfigStore.stats().commits - c0;
+
+    if (cfg.getTamperThreshold() != expect_thr) lost++;
+    if (epoch == 0) {
+      refused++;
+      if (!fail_all) wrong_refusals++;
+    } else {
+      if (fail_all) wrong_refusals++;
+      if ((int16_t)(epoch - last_epoch) <= 0) reused++;
+      last_epoch = epoch;
+    }
+
+    uint16_t thr = (uint16_t)(100 + (i * 37) % 900);
+    bool cut = (i % 5) == 4;
+    if (cut) {
+      host_nvs_tear_next_write();
+      cuts++;
+    }
+    cfg.setTamperThreshold(thr);
+    if (!cut) expect_thr = thr;
+  }
+
+  ConfigStoreStats st = gConfigStore.stats();
+  Serial.printf("[CONFIG] %lu boots, %lu writes cut mid-way: %lu values lost, %lu epochs reused\r\n",
+                (unsigned long)boots, (unsigned long)cuts, (unsigned long)lost, (unsigned long)reused);
+  Serial.printf("[CONFIG] %lu boots refused an unpersisted epoch (%lu unexpected)\r\n",
+                (unsigned long)refused, (unsigned long)wrong_refusals);
+  Serial.printf("[CONFIG] %.2f writes per boot, boot read max %.0fus, gen %lu, commits %lu, skipped %lu\r\n",
+                boots ? (double)boot_writes / boots : 0.0, max_us, (unsigned long)st.generation,
+                (unsigned long)st.commits, (unsigned long)st.skipped);
+}
+
+// NMEA sentence with checksum and CRLF, as the receiver sends it
+static std::string nmea_line(const char *body) {
+  uint8_t sum = 0;
+  for (const char *p = body; *p; p++) sum ^= (uint8_t)*p;
+  char tail[8];
+  snprintf(tail, sizeof(tail), "*%02X\r\n", sum);
+  return std::string("$") + body + tail;
+}
+
+static void nmea_coord(char *buf, size_t n, double deg, int deg_digits) {
+  double a = deg < 0 ? -deg : deg;
+  int d = (int)a;
+  snprintf(buf, n, "%0*d%08.5f", deg_digits, d, (a - d) * 60.0);
+}
+
+// NEO-6M style stream at 10 Hz across midnight: RMC + GGA per epoch, GSV
+// noise once a second, a GGA with a bad checksum every 50th epoch and no
+// RMC every 25th (those epochs complete when the next one starts). Split at '\n' the way the UART pattern detect does.
+static void run_nmea(uint32_t epochs) {
+  const uint32_t step_ms = 100;
+  const uint32_t start_tod = 86400000UL - epochs * step_ms / 2;   // midnight halfway
+  const uint64_t base = nmea_utc_ms(2025, 10, 17, start_tod);
+
+  std::string stream;
+  std::vector<double> lat(epochs), lng(epochs);
+  uint32_t expect = 0;
+  for (uint32_t k = 0; k < epochs; k++) {
+    uint64_t utc = base + (uint64_t)k * step_ms;
+    uint32_t tod = (uint32_t)(utc % 86400000ULL);
+    uint32_t day = (uint32_t)(utc / 86400000ULL) == (uint32_t)(base / 86400000ULL) ? 17 : 18;
+    lat[k] = 10.762622 + k * 1e-6;
+    lng[k] = 106.660172 - k * 1e-6;
+
+    char t[16], la[16], lo[16], body[96];
+    snprintf(t, sizeof(t), "%02lu%02lu%02lu.%02lu", (unsigned long)(tod / 3600000), (unsigned long)(tod / 60000 % 60),
+             (unsigned long)(tod / 1000 % 60), (unsigned long)(tod % 1000 / 10));
+    nmea_coord(la, sizeof(la), lat[k], 2);
+    nmea_coord(lo, sizeof(lo), lng[k], 3);
+    if (k % 25 != 24) {
+      snprintf(body, sizeof(body), "GPRMC,%s,A,%s,N,%s,E,12.5,87.3,%02lu1025,,,A", t, la, lo, (unsigned long)day);
+      stream += nmea_line(body);
+    }
+    snprintf(body, sizeof(body), "GPGGA,%s,%s,N,%s,E,1,%02lu,0.92,12.3,M,2.1,M,,", t, la, lo, (unsigned long)(8 + k % 4));
+    std::string gga = nmea_line(body);
+    bool gga_ok = (k % 50 != 10);
+    if (!gga_ok) gga[gga.size() - 3] ^= 1;   // flip a checksum digit
+    stream += gga;
+    // The last epoch only completes if it has both sentences
+    if (k + 1 < epochs || (k % 25 != 24 && gga_ok)) expect++;
+    if (k % 10 == 0) stream += nmea_line("GPGSV,3,1,11,01,40,083,46,02,17,308,41,12,07,344,39,14,22,228,45");
+  }
+
+  NmeaParser parser;
+  uint32_t lines = 0, fixes = 0, wrong = 0;
+  double total_us = 0;
+  size_t from = 0;
+  while (from < stream.size()) {
+    size_t nl = stream.find('\n', from);
+    size_t n = nl - from + 1;
+    auto t0 = std::chrono::steady_clock::now();
+    bool done = parser.feed(stream.data() + from, n, millis());
+    total_us += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+    lines++;
+    from = nl + 1;
+    if (!done) continue;
+
+    const GpsFix &f = parser.fix();
+    fixes++;
+    uint64_t k = (f.utc_ms - base) / step_ms;
+    if (f.utc_ms < base || (f.utc_ms - base) % step_ms != 0 || k >= epochs || !f.valid ||
+        fabs(f.lat - lat[k]) > 1e-6 || fabs(f.lng - lng[k]) > 1e-6) {
+      wrong++;
+    }
+  }
+
+  const NmeaStats &st = parser.stats();
+  Serial.printf("[NMEA] %lu epochs, %lu lines: rmc=%lu gga=%lu ignored=%lu bad=%lu\r\n",
+                (unsigned long)epochs, (unsigned long)lines, (unsigned long)st.rmc, (unsigned long)st.gga,
+                (unsigned long)st.ignored, (unsigned long)st.bad);
+  Serial.printf("[NMEA] %lu/%lu fixes (%lu wrong time/position), %.2fus per line\r\n",
+                (unsigned long)fixes, (unsigned long)expect, (unsigned long)wrong, lines ? total_us / lines : 0.0);
+}
+
+int main(int argc, char **argv) {
+  uint32_t run_s = 10;
+  uint32_t bench_iters = 0;
+  bool alerts = false;
+  uint8_t batch = 0;
+  int delta_s = -1;
+  bool gps_time = false;
+  uint32_t sd_rows = 0;
+  uint32_t dead_s = 0;
+  uint32_t config_boots = 0;
+  uint32_t nmea_epochs = 0;
+
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    if (a == "--run" && i + 1 < argc) run_s = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    else if (a == "--bench" && i + 1 < argc) bench_iters = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    else if (a == "--alerts") alerts = true;
+    else if (a == "--batch" && i + 1 < argc) batch = (uint8_t)strtoul(argv[++i], nullptr, 10);
+    else if (a == "--gps") gps_time = true;
+    else if (a == "--delta" && i + 1 < argc) delta_s = (int)strtoul(argv[++i], nullptr, 10);
+    else if (a == "--sdlog" && i + 1 < argc) sd_rows = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    else if (a == "--backlog" && i + 1 < argc) dead_s = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    else if (a == "--config" && i + 1 < argc) config_boots = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    else if (a == "--nmea" && i + 1 < argc) nmea_epochs = (uint32_t)strtoul(argv[++i], nullptr, 10);
+  }
+
+  gVehicleConfig.begin();
+  securityBegin();
+  gVehicleConfig.setDeviceIdFromNodeId(1);
+  if (batch > 0) gVehicleConfig.setBatchSize(batch);
+  if (delta_s >= 0) gVehicleConfig.setDeltaHeartbeatS((uint16_t)delta_s);
+  seed_sensor_data();
+
+  LORA_SER.begin(115200);
+  ldr.begin();
+  ldr.setTamperThreshold(600);
+
+  if (nmea_epochs > 0) {
+    run_nmea(nmea_epochs);
+  } else if (config_boots > 0) {
+    run_config(config_boots);
+  } else if (sd_rows > 0) {
+    run_sdlog(sd_rows);
+  } else if (dead_s > 0) {
+    run_backlog(dead_s);
+  } else if (bench_iters > 0) {
+    run_bench(bench_iters);
+  } else {
+    run_tasks(run_s, alerts, gps_time);
+  }
+  return 0;
+}
@@ -0,0 +1,583 @@
+// Gateway ingest daemon for [env:ingestd] (Linux)
+//
+// Reads the RX gateway's binary record stream (gateway_record.h) from a
+// serial port, a pty, a capture file or stdin, opens every sealed frame
+// with the project keys (security.cpp), and batch-inserts readings and
+// alerts into a local SQLite database.
+//
+//   .pio/build/ingestd/program --db telemetry.db --serial /dev/ttyUSB1
+//   .pio/build/ingestd/program --db telemetry.db --file capture.bin   backfill
+//   .pio/build/ingestd/program --synth 200000 capture.bin             make a test capture
+//
+// A capture is the raw link byte stream (e.g. `cat /dev/ttyUSB1 > capture.bin`).
+//
+// One reader thread decodes into a bounded row queue, one writer thread
+// drains it in transactions of up to --batch rows. Backpressure: a file is
+// read no faster than the writer commits; a live port cannot be paused, so
+// rows that find the queue full are dropped and counted. Rows are keyed by
+// (vehicle, boot epoch, seq, sample index) and inserted with OR IGNORE, so
+// replaying an overlapping capture never duplicates data.
+
+#include <Arduino.h>
+#include <sqlite3.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "gateway_record.h"
+#include "security.h"
+#include "telemetry_frame.h"
+
+#define INGEST_READ_CHUNK     65536
+#define INGEST_QUEUE_DEFAULT  65536
+#define INGEST_BATCH_DEFAULT  2000
+#define INGEST_STATS_S        5
+
+enum RowKind : uint8_t { ROW_READING, ROW_ALERT };
+
+struct Row {
+  RowKind kind;
+  uint8_t idx;              // sample index inside a batch frame
+  AeadHeader hdr;
+  uint8_t node;
+  int16_t rssi;
+  int8_t snr;
+  uint32_t gw_ts_ms;
+  int64_t ingest_ms;        // host wall clock
+  TelemetryFrame f;
+  TelemetryAlert a;
+};
+
+// Reader thread side, published to the writer after every read chunk
+struct ReaderCounters {
+  GatewayReaderStats link;  // records with a good CRC, framing errors
+  uint64_t raw;             // GW_RECORD_RAW capture records, not stored
+  uint64_t auth_fail;       // AES-CCM tag mismatch
+  uint64_t bad_frame;       // opened, but not a known telemetry frame
+  uint64_t delta_orphan;    // delta with no earlier reading of its vehicle/epoch kept
+  uint64_t rows;            // rows handed to the queue
+  uint64_t dropped;         // queue full on a live source
+};
+
+// Writer thread side
+struct WriterCounters {
+  uint64_t inserted = 0;
+  uint64_t duplicate = 0;   // already in the database
+  uint64_t commits = 0;
+  double commit_ms = 0;
+};
+
+static volatile sig_atomic_t g_stop = 0;
+static std::mutex g_stats_m;
+static ReaderCounters g_reader_stats;
+
+static void on_signal(int) { g_stop = 1; }
+
+static int64_t wall_ms() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// ===== ROW QUEUE =====
+
+class RowQueue {
+public:
+  RowQueue(size_t cap, bool block) : _cap(cap), _block(block) {}
+
+  // Producer. Returns the number of rows dropped (non-blocking mode only).
+  size_t push(std::vector<Row> &rows) {
+    size_t dropped = 0;
+    std::unique_lock<std::mutex> lk(_m);
+    for (Row &r : rows) {
+      if (_q.size() >= _cap) {
+        if (!_block) {
+          dropped++;
+          continue;
+        }
+        _not_full.wait(lk, [&] { return _q.size() < _cap || _closed; });
+        if (_closed) break;
+      }
+      _q.push_back(r);
+      if (_q.size() > _hwm) _hwm = _q.size();
+    }
+    lk.unlock();
+    _not_empty.notify_one();
+    rows.clear();
+    return dropped;
+  }
+
+  // Consumer: up to max rows, waiting at most wait_ms. False once closed and empty.
+  bool pop(std::vector<Row> &out, size_t max, uint32_t wait_ms) {
+    std::unique_lock<std::mutex> lk(_m);
+    _not_empty.wait_for(lk, std::chrono::milliseconds(wait_ms), [&] { return !_q.empty() || _closed; });
+    while (!_q.empty() && out.size() < max) {
+      out.push_back(_q.front());
+      _q.pop_front();
+    }
+    bool more = !_q.empty() || !_closed;
+    lk.unlock();
+    _not_full.notify_all();
+    return more || !out.empty();
+  }
+
+  void close() {
+    std::lock_guard<std::mutex> lk(_m);
+    _closed = true;
+    _not_empty.notify_all();
+    _not_full.notify_all();
+  }
+
+  size_t depth() {
+    std::lock_guard<std::mutex> lk(_m);
+    return _q.size();
+  }
+
+  size_t highWater() {
+    std::lock_guard<std::mutex> lk(_m);
+    return _hwm;
+  }
+
+private:
+  std::mutex _m;
+  std::condition_variable _not_empty, _not_full;
+  std::deque<Row> _q;
+  size_t _cap;
+  size_t _hwm = 0;
+  bool _block;
+  bool _closed = false;
+};
+
+// ===== STORE =====
+
+static const char *SCHEMA =
+  "PRAGMA journal_mode=WAL;"
+  "PRAGMA synchronous=NORMAL;"
+  "CREATE TABLE IF NOT EXISTS readings("
+  " vehicle INTEGER NOT NULL, epoch INTEGER NOT NULL, seq INTEGER NOT NULL, idx INTEGER NOT NULL,"
+  " ts_ms INTEGER, lat_e7 INTEGER, lng_e7 INTEGER, temp_dc INTEGER, hum_dp INTEGER,"
+  " accel_mg INTEGER, light INTEGER, flags INTEGER, sats INTEGER,"
+  " node INTEGER, rssi INTEGER, snr INTEGER, gw_ts_ms INTEGER, ingest_ms INTEGER,"
+  " PRIMARY KEY(vehicle, epoch, seq, idx)) WITHOUT ROWID;"
+  "CREATE TABLE IF NOT EXISTS alerts("
+  " vehicle INTEGER NOT NULL, epoch INTEGER NOT NULL, seq INTEGER NOT NULL,"
+  " type INTEGER, value INTEGER, ts_ms INTEGER, lat_e7 INTEGER, lng_e7 INTEGER,"
+  " node INTEGER, rssi INTEGER, snr INTEGER, gw_ts_ms INTEGER, ingest_ms INTEGER,"
+  " PRIMARY KEY(vehicle, epoch, seq)) WITHOUT ROWID;"
+  "CREATE INDEX IF NOT EXISTS readings_by_time ON readings(ingest_ms);";
+
+class Store {
+public:
+  ~Store() { close(); }
+
+  bool open(const char *path) {
+    if (sqlite3_open(path, &_db) != SQLITE_OK) return fail("open");
+    if (sqlite3_exec(_db, SCHEMA, nullptr, nullptr, nullptr) != SQLITE_OK) return fail("schema");
+    const char *ins_reading =
+      "INSERT OR IGNORE INTO readings VALUES(?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?)";
+    const char *ins_alert =
+      "INSERT OR IGNORE INTO alerts VALUES(?,?,?,?,?,?,?,?,?,?,?,?,?)";
+    if (sqlite3_prepare_v2(_db, ins_reading, -1, &_reading, nullptr) != SQLITE_OK) return fail("prepare");
+    if (sqlite3_prepare_v2(_db, ins_alert, -1, &_alert, nullptr) != SQLITE_OK) return fail("prepare");
+    return true;
+  }
+
+  void close() {
+    if (_reading) sqlite3_finalize(_reading);
+    if (_alert) sqlite3_finalize(_alert);
+    if (_db) sqlite3_close(_db);
+    _reading = _alert = nullptr;
+    _db = nullptr;
+  }
+
+  // One transaction for the whole batch. Returns false on a database error.
+  bool write(const std::vector<Row> &rows, uint64_t &inserted, uint64_t &duplicate) {
+    if (sqlite3_exec(_db, "BEGIN", nullptr, nullptr, nullptr) != SQLITE_OK) return fail("begin");
+    for (const Row &r : rows) {
+      sqlite3_stmt *st = (r.kind == ROW_READING) ? bindReading(r) : bindAlert(r);
+      if (sqlite3_step(st) != SQLITE_DONE) {
+        sqlite3_reset(st);
+        sqlite3_exec(_db, "ROLLBACK", nullptr, nullptr, nullptr);
+        return fail("insert");
+      }
+      if (sqlite3_changes(_db) > 0) inserted++;
+      else duplicate++;
+      sqlite3_reset(st);
+    }
+    if (sqlite3_exec(_db, "COMMIT", nullptr, nullptr, nullptr) != SQLITE_OK) return fail("commit");
+    return true;
+  }
+
+private:
+  sqlite3 *_db = nullptr;
+  sqlite3_stmt *_reading = nullptr;
+  sqlite3_stmt *_alert = nullptr;
+
+  bool fail(const char *what) {
+    fprintf(stderr, "[INGEST] sqlite %s: %s\n", what, _db ? sqlite3_errmsg(_db) : "out of memory");
+    return false;
+  }
+
+  // "No data" sentinels become NULL so SQL aggregates skip them
+  static void bindOrNull(sqlite3_stmt *st, int col, bool valid, int64_t v) {
+    if (valid) sqlite3_bind_int64(st, col, v);
+    else sqlite3_bind_null(st, col);
+  }
+
+  static void bindLink(sqlite3_stmt *st, int col, const Row &r) {
+    sqlite3_bind_int(st, col + 0, r.node);
+    sqlite3_bind_int(st, col + 1, r.rssi);
+    sqlite3_bind_int(st, col + 2, r.snr);
+    sqlite3_bind_int64(st, col + 3, r.gw_ts_ms);
+    sqlite3_bind_int64(st, col + 4, r.ingest_ms);
+  }
+
+  sqlite3_stmt *bindReading(const Row &r) {
+    const TelemetryFrame &f = r.f;
+    sqlite3_stmt *st = _reading;
+    sqlite3_bind_int(st, 1, r.hdr.vehicle);
+    sqlite3_bind_int(st, 2, r.hdr.epoch);
+    sqlite3_bind_int64(st, 3, r.hdr.seq);
+    sqlite3_bind_int(st, 4, r.idx);
+    sqlite3_bind_int64(st, 5, f.ts_ms);
+    sqlite3_bind_int64(st, 6, f.lat_e7);
+    sqlite3_bind_int64(st, 7, f.lng_e7);
+    bindOrNull(st, 8, f.temp_dc != TF_INVALID_I16, f.temp_dc);
+    bindOrNull(st, 9, f.hum_dp != TF_INVALID_U16, f.hum_dp);
+    bindOrNull(st, 10, f.accel_mg != TF_INVALID_U16, f.accel_mg);
+    sqlite3_bind_int(st, 11, f.light);
+    sqlite3_bind_int(st, 12, f.flags);
+    sqlite3_bind_int(st, 13, f.sats);
+    bindLink(st, 14, r);
+    return st;
+  }
+
+  sqlite3_stmt *bindAlert(const Row &r) {
+    const TelemetryAlert &a = r.a;
+    sqlite3_stmt *st = _alert;
+    sqlite3_bind_int(st, 1, r.hdr.vehicle);
+    sqlite3_bind_int(st, 2, r.hdr.epoch);
+    sqlite3_bind_int64(st, 3, r.hdr.seq);
+    sqlite3_bind_int(st, 4, a.type);
+    sqlite3_bind_int(st, 5, a.value);
+    sqlite3_bind_int64(st, 6, a.ts_ms);
+    sqlite3_bind_int64(st, 7, a.lat_e7);
+    sqlite3_bind_int64(st, 8, a.lng_e7);
+    bindLink(st, 9, r);
+    return st;
+  }
+};
+
+// ===== DECODE =====
+
+// Recent readings per vehicle by epoch/seq, the bases delta frames apply to
+// (zero-initialized = empty)
+static TelemetryDeltaHistory s_history[256];
+
+static void decode_record(const GatewayRecord &rec, std::vector<Row> &rows, ReaderCounters &c) {
+  if (rec.type != GW_RECORD_PACKET) {
+    c.raw++;
+    return;
+  }
+
+  uint8_t raw[FRAME_MAX_PLAIN];
+  size_t raw_len = 0;
+  Row r;
+  memset(&r, 0, sizeof(r));
+  if (!openFrame(rec.payload, rec.len, r.hdr, raw, sizeof(raw), raw_len)) {
+    c.auth_fail++;
+    return;
+  }
+  r.node = rec.node;
+  r.rssi = rec.rssi;
+  r.snr = rec.snr;
+  r.gw_ts_ms = rec.ts_ms;
+  r.ingest_ms = wall_ms();
+
+  TelemetryFrame batch[TELEMETRY_BATCH_MAX_SAMPLES];
+  size_t n = 0;
+  switch (telemetry_frame_type(raw, raw_len)) {
+  case TELEMETRY_FRAME_TYPE_READING:
+    if (!telemetry_frame_decode(raw, raw_len, r.f)) break;
+    r.kind = ROW_READING;
+    telemetry_history_put(s_history[r.f.vehicle], r.hdr.epoch, r.hdr.seq, r.f);
+    rows.push_back(r);
+    return;
+  case TELEMETRY_FRAME_TYPE_ALERT:
+    if (!telemetry_alert_decode(raw, raw_len, r.a)) break;
+    r.kind = ROW_ALERT;
+    rows.push_back(r);
+    return;
+  case TELEMETRY_FRAME_TYPE_BATCH:
+    n = telemetry_batch_decode(raw, raw_len, batch, TELEMETRY_BATCH_MAX_SAMPLES);
+    if (n == 0) break;
+    r.kind = ROW_READING;
+    for (size_t k = 0; k < n; k++) {
+      r.idx = (uint8_t)k;
+      r.f = batch[k];
+      rows.push_back(r);
+    }
+    return;
+  case TELEMETRY_FRAME_TYPE_DELTA:
+    // A backlog replay arrives after newer live frames: rebuild it on the
+    // reading sealed before it, not on the last one that arrived
+    if (raw_len < 2) break;
+    if (!telemetry_history_base(s_history[raw[1]], r.hdr.epoch, r.hdr.seq, r.f)) {
+      c.delta_orphan++;
+      return;
+    }
+    if (!telemetry_delta_apply(raw, raw_len, r.f)) break;
+    telemetry_history_put(s_history[raw[1]], r.hdr.epoch, r.hdr.seq, r.f);
+    r.kind = ROW_READING;
+    rows.push_back(r);
+    return;
+  }
+  c.bad_frame++;
+}
+
+// ===== SOURCES =====
+
+static speed_t baud_const(uint32_t baud) {
+  switch (baud) {
+  case 9600: return B9600;
+  case 57600: return B57600;
+  case 230400: return B230400;
+  case 460800: return B460800;
+  case 921600: return B921600;
+  default: return B115200;
+  }
+}
+
+static int open_serial(const char *path, uint32_t baud) {
+  int fd = ::open(path, O_RDONLY | O_NOCTTY);
+  if (fd < 0) return -1;
+  struct termios tio;
+  if (tcgetattr(fd, &tio) == 0) {
+    cfmakeraw(&tio);
+    cfsetispeed(&tio, baud_const(baud));
+    cfsetospeed(&tio, baud_const(baud));
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cc[VMIN] = 1;
+    tio.c_cc[VTIME] = 1;      // return 100 ms after the last byte of a burst
+    tcsetattr(fd, TCSANOW, &tio);
+  }
+  return fd;
+}
+
+// Stops on EOF, a read error or a signal; the writer drains what is queued
+static void reader_loop(int fd, RowQueue &q) {
+  static uint8_t buf[INGEST_READ_CHUNK];
+  GatewayRecordReader reader;
+  ReaderCounters c;
+  memset(&c, 0, sizeof(c));
+  std::vector<Row> rows;
+  rows.reserve(INGEST_READ_CHUNK / 16);
+
+  while (!g_stop) {
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    int pr = poll(&pfd, 1, 200);
+    if (pr == 0 || (pr < 0 && errno == EINTR)) continue;
+
+    ssize_t n = ::read(fd, buf, sizeof(buf));
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) break;          // EOF or port gone
+
+    GatewayRecord rec;
+    for (ssize_t i = 0; i < n; i++) {
+      if (reader.push(buf[i], rec)) decode_record(rec, rows, c);
+    }
+    c.rows += rows.size();
+    c.dropped += q.push(rows);
+    c.link = reader.stats();
+
+    std::lock_guard<std::mutex> lk(g_stats_m);
+    g_reader_stats = c;
+  }
+  q.close();
+}
+
+static ReaderCounters reader_stats() {
+  std::lock_guard<std::mutex> lk(g_stats_m);
+  return g_reader_stats;
+}
+
+// ===== STATS =====
+
+static void print_stats(const char *tag, const ReaderCounters &c, const WriterCounters &w,
+                        RowQueue &q, size_t cap, uint64_t d_records, uint64_t d_rows, double dt_s) {
+  const GatewayReaderStats &rs = c.link;
+  fprintf(stderr,
+          "[INGEST] %s %.0f rec/s %.0f rows/s | records %llu rows %llu inserted %llu dup %llu | "
+          "queue %zu/%zu hwm %zu dropped %llu | commit %.2f ms avg | "
+          "bad: crc %u cobs %u fmt %u ovf %u auth %llu frame %llu orphan %llu | raw %llu\n",
+          tag, d_records / dt_s, d_rows / dt_s,
+          (unsigned long long)rs.records, (unsigned long long)c.rows,
+          (unsigned long long)w.inserted, (unsigned long long)w.duplicate,
+          q.depth(), cap, q.highWater(), (unsigned long long)c.dropped,
+          w.commits ? w.commit_ms / w.commits : 0.0,
+          rs.bad_crc, rs.bad_cobs, rs.bad_format, rs.overflow,
+          (unsigned long long)c.auth_fail, (unsigned long long)c.bad_frame,
+          (unsigned long long)c.delta_orphan, (unsigned long long)c.raw);
+}
+
+// ===== SYNTHETIC CAPTURE =====
+
+// Readings from 8 vehicles every 2 s, one alert and one batch in every 50
+static int write_synth(uint32_t count, const char *path) {
+  FILE *out = fopen(path, "wb");
+  if (!out) {
+    perror(path);
+    return 1;
+  }
+  uint8_t frame[FRAME_MAX_PLAIN], pkt[FRAME_MAX_SEALED], wire[GW_RECORD_MAX_WIRE];
+  uint32_t seq[9] = { 0 };
+
+  for (uint32_t i = 0; i < count; i++) {
+    uint8_t veh = (uint8_t)(1 + i % 8);
+    uint32_t ts = (i / 8) * 2000;
+    TelemetryFrame f;
+    telemetry_frame_fill(f, veh, ts, 10.76 + i * 1e-6, 106.66 - i * 1e-6, 9,
+                         25.0f + (i % 50) * 0.1f, 60.0f, 0.02f, (uint16_t)(400 + i % 100),
+                         false, false, true);
+    size_t len;
+    if (i % 50 == 7) {
+      TelemetryAlert a = { veh, TF_ALERT_SHOCK, ts, 2500, f.lat_e7, f.lng_e7 };
+      len = telemetry_alert_encode(a, frame, sizeof(frame));
+    } else if (i % 50 == 23) {
+      TelemetryBatch b;
+      telemetry_batch_reset(b);
+      for (int k = 0; k < 5; k++) {
+        f.ts_ms = ts + k * 2000;
+        f.temp_dc += 1;
+        telemetry_batch_add(b, f);
+      }
+      memcpy(frame, b.buf, b.len);
+      len = b.len;
+    } else {
+      len = telemetry_frame_encode(f, frame, sizeof(frame));
+    }
+
+    AeadHeader hdr = { veh, 1, seq[veh]++ };
+    size_t pkt_len = sealFrame(hdr, frame, len, pkt, sizeof(pkt));
+    GatewayRecord rec = { GW_RECORD_PACKET, veh, i, ts, (int16_t)(-60 - (int)(i % 50)), 7, (uint16_t)pkt_len, pkt };
+    size_t w = gateway_record_encode(rec, wire, sizeof(wire));
+    fwrite(wire, 1, w, out);
+  }
+  fclose(out);
+  fprintf(stderr, "[INGEST] wrote %lu records to %s\n", (unsigned long)count, path);
+  return 0;
+}
+
+// ===== MAIN =====
+
+int main(int argc, char **argv) {
+  const char *db_path = "telemetry.db";
+  const char *serial = nullptr;
+  const char *file = nullptr;
+  uint32_t baud = 115200;
+  size_t queue_cap = INGEST_QUEUE_DEFAULT;
+  size_t batch_max = INGEST_BATCH_DEFAULT;
+  uint32_t stats_s = INGEST_STATS_S;
+  uint32_t synth = 0;
+
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    if (a == "--db" && i + 1 < argc) db_path = argv[++i];
+    else if (a == "--serial" && i + 1 < argc) serial = argv[++i];
+    else if (a == "--file" && i + 1 < argc) file = argv[++i];
+    else if (a == "--baud" && i + 1 < argc) baud = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    else if (a == "--queue" && i + 1 < argc) queue_cap = strtoul(argv[++i], nullptr, 10);
+    else if (a == "--batch" && i + 1 < argc) batch_max = strtoul(argv[++i], nullptr, 10);
+    else if (a == "--stats" && i + 1 < argc) stats_s = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    else if (a == "--synth" && i + 2 < argc) {
+      synth = (uint32_t)strtoul(argv[++i], nullptr, 10);
+      file = argv[++i];
+    }
+  }
+  if (queue_cap == 0) queue_cap = 1;
+  if (batch_max == 0) batch_max = 1;
+  if (stats_s == 0) stats_s = INGEST_STATS_S;
+
+  securityBegin();
+  if (synth > 0) return write_synth(synth, file);
+
+  // A tty is live (drop on overload), anything else is replayed (block)
+  int fd = -1;
+  if (serial) fd = open_serial(serial, baud);
+  else if (file && strcmp(file, "-") != 0) fd = ::open(file, O_RDONLY);
+  else fd = STDIN_FILENO;
+  if (fd < 0) {
+    perror(serial ? serial : file);
+    return 1;
+  }
+  bool live = isatty(fd);
+
+  Store store;
+  if (!store.open(db_path)) return 1;
+
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = on_signal;
+  sigaction(SIGINT, &sa, nullptr);
+  sigaction(SIGTERM, &sa, nullptr);
+
+  fprintf(stderr, "[INGEST] %s %s -> %s (queue %zu, batch %zu, %s)\n",
+          serial ? "serial" : "file", serial ? serial : (file ? file : "stdin"), db_path,
+          queue_cap, batch_max, live ? "drop when full" : "block when full");
+
+  RowQueue q(queue_cap, !live);
+  WriterCounters w;
+  std::thread rd([&] { reader_loop(fd, q); });
+
+  // Writer: this thread
+  auto t0 = std::chrono::steady_clock::now();
+  auto t_last = t0;
+  uint64_t last_records = 0, last_rows = 0;
+  std::vector<Row> batch;
+  batch.reserve(batch_max);
+  bool ok = true;
+
+  while (q.pop(batch, batch_max, 200)) {
+    if (!batch.empty()) {
+      auto b0 = std::chrono::steady_clock::now();
+      ok = store.write(batch, w.inserted, w.duplicate);
+      w.commit_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - b0).count();
+      w.commits++;
+      batch.clear();
+      if (!ok) {
+        g_stop = 1;
+        break;
+      }
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    double dt = std::chrono::duration<double>(now - t_last).count();
+    if (dt >= stats_s) {
+      ReaderCounters c = reader_stats();
+      print_stats("", c, w, q, queue_cap, c.link.records - last_records, c.rows - last_rows, dt);
+      last_records = c.link.records;
+      last_rows = c.rows;
+      t_last = now;
+    }
+  }
+
+  q.close();
+  rd.join();
+  if (fd != STDIN_FILENO) ::close(fd);
+
+  ReaderCounters c = reader_stats();
+  double total_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  print_stats("total", c, w, q, queue_cap, c.link.records, c.rows, total_s > 0 ? total_s : 1);
+  return ok ? 0 : 1;
+}
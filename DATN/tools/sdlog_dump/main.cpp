@@ -0,0 +1,273 @@
+// SD log converter for [env:sdlog_dump] (host)
+//
+// Reads a binary log pulled off the vehicle's card (/log_NNNN.bin,
+// sd_log_format.h), checks every block CRC and writes CSV or one raw
+// little-endian array per column. Seeks straight to the wanted range with
+// a binary search over the fixed-size blocks instead of scanning the file.
+//
+//   .pio/build/sdlog_dump/program log_0007.bin --info
+//   .pio/build/sdlog_dump/program log_0007.bin --last-min 10 > tail.csv
+//   .pio/build/sdlog_dump/program log_0007.bin --since-seq 120000 --csv out.csv
+//   .pio/build/sdlog_dump/program log_0007.bin --from-ms 600000 --to-ms 900000 --columns out/
+//
+// --columns writes <dir>/<column>.<type> (numpy.fromfile friendly) and
+// <dir>/schema.txt; "no data" values stay as the sentinels in the schema.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <string>
+
+#include "sd_log_format.h"
+#include "telemetry_frame.h"
+
+struct LogFile {
+  FILE *fp;
+  uint32_t nblocks;
+  uint32_t reads;
+};
+
+static bool read_block(void *ctx, uint32_t block, uint8_t *out) {
+  LogFile *lf = (LogFile *)ctx;
+  lf->reads++;
+  if (fseek(lf->fp, (long)SDLOG_BLOCK_SIZE * (block + 1), SEEK_SET) != 0) return false;
+  return fread(out, 1, SDLOG_BLOCK_SIZE, lf->fp) == SDLOG_BLOCK_SIZE;
+}
+
+// ts of the newest record, from the last block that passes its CRC
+static bool last_ts(LogFile &lf, uint32_t &ts) {
+  uint8_t blk[SDLOG_BLOCK_SIZE];
+  SdLogBlock b;
+  for (uint32_t i = lf.nblocks; i-- > 0;) {
+    if (read_block(&lf, i, blk) && sdlog_block_decode(blk, b)) {
+      SdLogRecord r;
+      sdlog_block_record(b, b.count - 1, r);
+      ts = r.ts_ms;
+      return true;
+    }
+  }
+  return false;
+}
+
+// ---- output ----
+
+struct Column {
+  const char *name;
+  const char *type;
+  FILE *fp;
+};
+
+class Sink {
+public:
+  virtual ~Sink() {}
+  virtual void put(const SdLogRecord &r) = 0;
+};
+
+static void csv_value(FILE *fp, int32_t v, int32_t invalid, double scale, int prec) {
+  if (v != invalid) fprintf(fp, "%.*f", prec, v / scale);
+  fputc(',', fp);
+}
+
+class CsvSink : public Sink {
+public:
+  explicit CsvSink(FILE *fp) : _fp(fp) {
+    fprintf(_fp, "seq,ts_ms,lat,lng,sats,temperature,humidity,ax,ay,az\n");
+  }
+  void put(const SdLogRecord &r) override {
+    fprintf(_fp, "%lu,%lu,%.7f,%.7f,%u,", (unsigned long)r.seq, (unsigned long)r.ts_ms,
+            r.lat_e7 / 1e7, r.lng_e7 / 1e7, r.sats);
+    csv_value(_fp, r.temp_dc, TF_INVALID_I16, 10.0, 1);
+    csv_value(_fp, r.hum_dp, TF_INVALID_U16, 10.0, 1);
+    csv_value(_fp, r.ax_mg, TF_INVALID_I16, 1000.0, 3);
+    csv_value(_fp, r.ay_mg, TF_INVALID_I16, 1000.0, 3);
+    if (r.az_mg != TF_INVALID_I16) fprintf(_fp, "%.3f", r.az_mg / 1000.0);
+    fputc('\n', _fp);
+  }
+
+private:
+  FILE *_fp;
+};
+
+class ColumnSink : public Sink {
+public:
+  ColumnSink(const std::string &dir, const SdLogHeader &h) : _dir(dir) {
+    ::mkdir(dir.c_str(), 0755);
+    for (Column &c : _cols) {
+      std::string path = dir + "/" + c.name + "." + c.type;
+      c.fp = fopen(path.c_str(), "wb");
+      if (!c.fp) perror(path.c_str());
+    }
+
+    std::string path = dir + "/schema.txt";
+    FILE *fp = fopen(path.c_str(), "w");
+    if (!fp) return;
+    fprintf(fp, "device_id %s\nvehicle %u\nepoch %u\n", h.device_id, h.vehicle, h.epoch);
+    fprintf(fp, "# one little-endian array per file, same row count\n");
+    fprintf(fp, "seq.u32      record seq (gaps = dropped on the vehicle)\n");
+    fprintf(fp, "ts_ms.u32    millis() on the vehicle\n");
+    fprintf(fp, "lat_e7.i32   degrees * 1e7\n");
+    fprintf(fp, "lng_e7.i32   degrees * 1e7\n");
+    fprintf(fp, "temp_dc.i16  0.1 C, %d = no data\n", TF_INVALID_I16);
+    fprintf(fp, "hum_dp.u16   0.1 %%, %u = no data\n", TF_INVALID_U16);
+    fprintf(fp, "ax_mg.i16    mg, %d = no data (ay_mg, az_mg alike)\n", TF_INVALID_I16);
+    fprintf(fp, "sats.u8\n");
+    fclose(fp);
+  }
+
+  ~ColumnSink() override {
+    for (Column &c : _cols) {
+      if (c.fp) fclose(c.fp);
+    }
+  }
+
+  void put(const SdLogRecord &r) override {
+    w(0, &r.seq, 4);
+    w(1, &r.ts_ms, 4);
+    w(2, &r.lat_e7, 4);
+    w(3, &r.lng_e7, 4);
+    w(4, &r.temp_dc, 2);
+    w(5, &r.hum_dp, 2);
+    w(6, &r.ax_mg, 2);
+    w(7, &r.ay_mg, 2);
+    w(8, &r.az_mg, 2);
+    w(9, &r.sats, 1);
+  }
+
+private:
+  // Host is little endian (x86, ARM), so fields go out as they are
+  void w(int i, const void *p, size_t n) {
+    if (_cols[i].fp) fwrite(p, 1, n, _cols[i].fp);
+  }
+
+  std::string _dir;
+  Column _cols[10] = {
+    { "seq", "u32", nullptr },     { "ts_ms", "u32", nullptr },  { "lat_e7", "i32", nullptr },
+    { "lng_e7", "i32", nullptr },  { "temp_dc", "i16", nullptr }, { "hum_dp", "u16", nullptr },
+    { "ax_mg", "i16", nullptr },   { "ay_mg", "i16", nullptr },  { "az_mg", "i16", nullptr },
+    { "sats", "u8", nullptr },
+  };
+};
+
+int main(int argc, char **argv) {
+  const char *path = nullptr;
+  const char *csv_path = nullptr;
+  const char *col_dir = nullptr;
+  bool info = false;
+  bool have_seq = false, have_from = false, have_last = false;
+  uint32_t since_seq = 0, from_ms = 0, to_ms = UINT32_MAX, last_min = 0;
+
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    if (a == "--info") info = true;
+    else if (a == "--since-seq" && i + 1 < argc) { since_seq = (uint32_t)strtoul(argv[++i], nullptr, 10); have_seq = true; }
+    else if (a == "--from-ms" && i + 1 < argc) { from_ms = (uint32_t)strtoul(argv[++i], nullptr, 10); have_from = true; }
+    else if (a == "--to-ms" && i + 1 < argc) to_ms = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    else if (a == "--last-min" && i + 1 < argc) { last_min = (uint32_t)strtoul(argv[++i], nullptr, 10); have_last = true; }
+    else if (a == "--csv" && i + 1 < argc) csv_path = argv[++i];
+    else if (a == "--columns" && i + 1 < argc) col_dir = argv[++i];
+    else if (a[0] != '-') path = argv[i];
+  }
+  if (!path) {
+    fprintf(stderr, "usage: %s log.bin [--info] [--since-seq N | --from-ms T | --last-min M] "
+                    "[--to-ms T] [--csv out.csv | --columns dir]\n", argv[0]);
+    return 1;
+  }
+
+  LogFile lf = { fopen(path, "rb"), 0, 0 };
+  if (!lf.fp) {
+    perror(path);
+    return 1;
+  }
+  uint8_t blk[SDLOG_BLOCK_SIZE];
+  SdLogHeader hdr;
+  if (fread(blk, 1, SDLOG_BLOCK_SIZE, lf.fp) != SDLOG_BLOCK_SIZE || !sdlog_header_decode(blk, hdr)) {
+    fprintf(stderr, "%s: not an SD log (bad header)\n", path);
+    return 1;
+  }
+  fseek(lf.fp, 0, SEEK_END);
+  long size = ftell(lf.fp);
+  lf.nblocks = (uint32_t)(size / SDLOG_BLOCK_SIZE) - 1;   // a torn last sector is ignored
+
+  // Start block from the index, then filter records inside it
+  uint32_t start = 0;
+  if (have_last) {
+    uint32_t newest;
+    if (last_ts(lf, newest)) {
+      from_ms = (newest > last_min * 60000UL) ? newest - last_min * 60000UL : 0;
+      have_from = true;
+    }
+  }
+  if (have_seq) start = sdlog_seek(read_block, &lf, lf.nblocks, SDLOG_KEY_SEQ, since_seq, blk);
+  else if (have_from) start = sdlog_seek(read_block, &lf, lf.nblocks, SDLOG_KEY_TS, from_ms, blk);
+  uint32_t seek_reads = lf.reads;
+
+  FILE *out = stdout;
+  Sink *sink = nullptr;
+  if (!info) {
+    if (col_dir) {
+      sink = new ColumnSink(col_dir, hdr);
+    } else {
+      if (csv_path) out = fopen(csv_path, "w");
+      if (!out) {
+        perror(csv_path);
+        return 1;
+      }
+      sink = new CsvSink(out);
+    }
+  }
+
+  uint32_t rows = 0, bad = 0, flushed = 0, gaps = 0, lost = 0;
+  uint32_t first_seq = 0, last_seq = 0, first_ts = 0, last_ts_seen = 0;
+  bool any = false, next_known = false;
+  uint32_t next_seq = 0;
+  SdLogBlock b;
+  for (uint32_t i = start; i < lf.nblocks; i++) {
+    if (!read_block(&lf, i, blk) || !sdlog_block_decode(blk, b)) {
+      bad++;
+      next_known = false;
+      continue;
+    }
+    if (b.flags & SDLOG_BLOCK_FLUSHED) flushed++;
+    if (next_known && b.first_seq != next_seq) {
+      gaps++;
+      lost += b.first_seq - next_seq;
+    }
+    next_seq = b.first_seq + b.count;
+    next_known = true;
+
+    bool done = false;
+    for (uint8_t k = 0; k < b.count; k++) {
+      SdLogRecord r;
+      sdlog_block_record(b, k, r);
+      if (have_seq && r.seq < since_seq) continue;
+      if (have_from && r.ts_ms < from_ms) continue;
+      if (r.ts_ms > to_ms) {
+        done = true;
+        break;
+      }
+      if (!any) {
+        first_seq = r.seq;
+        first_ts = r.ts_ms;
+        any = true;
+      }
+      last_seq = r.seq;
+      last_ts_seen = r.ts_ms;
+      rows++;
+      if (sink) sink->put(r);
+    }
+    if (done) break;
+  }
+  delete sink;
+  if (out != stdout) fclose(out);
+
+  fprintf(stderr, "[SDLOG] %s: %s veh=%u epoch=%u, %u blocks, start block %u after %u reads\n",
+          path, hdr.device_id, hdr.vehicle, hdr.epoch, lf.nblocks, start, seek_reads);
+  fprintf(stderr, "[SDLOG] %u rows (seq %u..%u, ts %u..%u ms), %u bad blocks, %u flushed early, "
+                  "%u gaps (%u records dropped on the vehicle)\n",
+          rows, first_seq, last_seq, first_ts, last_ts_seen, bad, flushed, gaps, lost);
+  fclose(lf.fp);
+  return 0;
+}